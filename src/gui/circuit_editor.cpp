@@ -11,6 +11,7 @@
 
 #include "colors.h"
 #include "lsim_context.h"
+#include "sim_worker.h"
 #include "ui_context.h"
 
 namespace {
@@ -19,23 +20,20 @@ constexpr const char *POPUP_EMBED_CIRCUIT = "embed_circuit";
 constexpr const char *POPUP_SUB_CIRCUIT = "sub_circuit";
 constexpr const char* POPUP_EDIT_SEGMENT = "edit_segment";
 
+// extra room around the visible area before something is culled: labels and endpoints are drawn outside of the widget
+constexpr float CULL_MARGIN = 100.0f;
+
 } // unnamed namespace
 
 namespace lsim {
 
 namespace gui {
 
-size_t CircuitEditor::PointHash::operator() (const Point &p) const {
-		// abuse the fact that positions will always be aligned to the grid
-		auto x = (int32_t) p.x;
-		auto y = (int32_t) p.y;
-		return ((int64_t) y) << 32 | (size_t) x;
-}
-
 
 CircuitEditor::CircuitEditor(ModelCircuit *model_circuit) : 
 			m_model_circuit(model_circuit),
 			m_sim_circuit(nullptr),
+			m_sim_worker(nullptr),
 			m_view_only(false),
 			m_show_grid(true),
 			m_scroll_delta(0,0),
@@ -59,6 +57,8 @@ void CircuitEditor::init_ui_refresh() {
 
 	Point screen_origin = ImGui::GetCursorScreenPos();			// upper-left corner of the window in screen space
 	m_screen_offset = m_scroll_delta + screen_origin;			// translation from circuit space to screen space 
+	m_view_min = screen_origin;
+	m_view_max = screen_origin + Point(ImGui::GetContentRegionMax());
 	Point mouse_pos_screen = ImGui::GetMousePos();				// current position of mouse pointer in screen space
 	Point mouse_pos = mouse_pos_screen - m_screen_offset;		// position of mouse pointer in circuit space
 	
@@ -83,7 +83,7 @@ void CircuitEditor::init_ui_refresh() {
 	}
 
 	// screenspace point -> pin lookup is recreated every frame 
-	m_point_pin_lut.clear();
+	m_endpoint_lut.clear();
 
 	// reset hovered items
 	m_hovered_pin = PIN_ID_INVALID;
@@ -112,18 +112,28 @@ void CircuitEditor::draw_ui(UIContext *ui_context) {
 	// create two layers to draw the background and the widgets
 	draw_list->ChannelsSplit(2);
 
+	// endpoints of all widgets, also of the ones that are culled: a wire can be edited outside of the view
+	for (const auto &widget : m_widgets) {
+		m_endpoint_lut.add_widget(*widget);
+	}
+
 	// draw all widgets
 	for (auto &widget : m_widgets) {
 
+		const auto widget_aabb_min = widget->aabb_min() + m_screen_offset;
+		const auto widget_aabb_max = widget->aabb_max() + m_screen_offset;
+
+		// level of detail: widgets outside of the view aren't drawn at all (nor can they be hovered)
+		if (!is_visible(widget_aabb_min, widget_aabb_max)) {
+			continue;
+		}
+
 		ImGui::PushID(&widget);
 		
 		// setup
 		Transform widget_to_screen = widget->to_circuit();
 		widget_to_screen.translate(m_screen_offset);
 
-		const auto widget_aabb_min = widget->aabb_min() + m_screen_offset;
-		const auto widget_aabb_max = widget->aabb_max() + m_screen_offset;
-
 		// custom draw routine
 		if (widget->has_draw_callback()) {
 			ImGui::SetCursorScreenPos(widget_aabb_min);
@@ -174,11 +184,9 @@ void CircuitEditor::draw_ui(UIContext *ui_context) {
 
 			auto pin_color = COLOR_ENDPOINT;
 			if (is_simulating()) {
-				pin_color = COLOR_CONNECTION[m_sim_circuit->pin_output(pair.first)];
+				pin_color = COLOR_CONNECTION[display_pin_output(pair.first)];
 			}
 
-			m_point_pin_lut[endpoint_circuit] = pair.first;
-
 			draw_list->AddCircleFilled(endpoint_screen, 3, pin_color);
 
 			if (distance_squared(m_mouse_grid_point, endpoint_circuit) <= 2) {
@@ -198,11 +206,9 @@ void CircuitEditor::draw_ui(UIContext *ui_context) {
 
 		// check color & highlight when simulation is running
 		if (is_simulating() && wire->num_pins() > 0) {
-			auto value = m_sim_circuit->read_pin(wire->pin(0));
+			auto value = display_pin(wire->pin(0));
 			wire_color = COLOR_CONNECTION[value];
-
-			auto node_id = m_sim_circuit->pin_node(wire->pin(0));
-			dirty_node = m_sim_circuit->node_dirty(node_id);
+			dirty_node = display_node_dirty(wire->pin(0));
 		}
 
 		// segments
@@ -210,6 +216,10 @@ void CircuitEditor::draw_ui(UIContext *ui_context) {
 			const auto p0 = wire->segment_point(idx, 0) + m_screen_offset;
 			const auto p1 = wire->segment_point(idx, 1) + m_screen_offset;
 
+			if (!is_visible(Point(std::min(p0.x, p1.x), std::min(p0.y, p1.y)), Point(std::max(p0.x, p1.x), std::max(p0.y, p1.y)))) {
+				continue;
+			}
+
 			if (dirty_node) {
 				draw_list->AddLine(p0, p1, COLOR_CONNECTION_DIRTY, 4.0f);
 			}
@@ -220,8 +230,9 @@ void CircuitEditor::draw_ui(UIContext *ui_context) {
 
 		// draw junctions with more than 2 segments
 		for (size_t idx = 0; idx < wire->num_junctions(); ++idx) {
-			if (wire->junction_segment_count(idx) > 2) {
-				draw_list->AddCircleFilled(wire->junction_position(idx) + m_screen_offset, 4, wire_color);
+			const auto junction = wire->junction_position(idx) + m_screen_offset;
+			if (wire->junction_segment_count(idx) > 2 && is_visible(junction, junction)) {
+				draw_list->AddCircleFilled(junction, 4, wire_color);
 			}
 		}
 		
@@ -639,13 +650,13 @@ void CircuitEditor::ui_fix_wire(ModelWire* wire) {
 			}
 
 			new_wire->simplify();
-			wire_make_connections(new_wire);
+			m_endpoint_lut.connect_wire(new_wire);
 		}
 
 		m_model_circuit->remove_wire(wire->id());
 	} else {
 		wire->simplify();
-		wire_make_connections(wire);
+		m_endpoint_lut.connect_wire(wire);
 	}
 }
 
@@ -788,7 +799,7 @@ ComponentWidget *CircuitEditor::selected_widget() const {
 	return nullptr;
 }
 
-void CircuitEditor::set_simulation_instance(SimCircuit *sim_circuit, bool view_only) {
+void CircuitEditor::set_simulation_instance(SimCircuit *sim_circuit, bool view_only, SimWorker *sim_worker) {
 
 	if (sim_circuit != nullptr && m_sim_circuit == nullptr) {
 		m_state = CS_SIMULATING;
@@ -802,12 +813,44 @@ void CircuitEditor::set_simulation_instance(SimCircuit *sim_circuit, bool view_o
 	}
 
 	m_sim_circuit = sim_circuit;
+	m_sim_worker = sim_circuit != nullptr ? sim_worker : nullptr;
 }
 
 bool CircuitEditor::is_simulating() const {
 	return m_state == CS_SIMULATING;
 }
 
+Value CircuitEditor::display_pin(pin_id_t pin_id) const {
+	if (m_sim_worker != nullptr) {
+		return m_sim_worker->snapshot().read_pin(m_sim_circuit->pin_from_pin_id(pin_id));
+	}
+	return m_sim_circuit->read_pin(pin_id);
+}
+
+Value CircuitEditor::display_pin_output(pin_id_t pin_id) const {
+	if (m_sim_worker != nullptr) {
+		return m_sim_worker->snapshot().pin_output_value(m_sim_circuit->pin_from_pin_id(pin_id));
+	}
+	return m_sim_circuit->pin_output(pin_id);
+}
+
+bool CircuitEditor::display_node_dirty(pin_id_t pin_id) const {
+	if (m_sim_worker != nullptr) {
+		auto &snapshot = m_sim_worker->snapshot();
+		return snapshot.node_dirty(snapshot.pin_node(m_sim_circuit->pin_from_pin_id(pin_id)));
+	}
+	return m_sim_circuit->node_dirty(m_sim_circuit->pin_node(pin_id));
+}
+
+void CircuitEditor::write_pin(pin_id_t pin_id, Value value) {
+	if (m_sim_worker != nullptr) {
+		auto sim_circuit = m_sim_circuit;
+		m_sim_worker->post([=](Simulator *) {sim_circuit->write_pin(pin_id, value);});
+		return;
+	}
+	m_sim_circuit->write_pin(pin_id, value);
+}
+
 void CircuitEditor::copy_selected_components() {
 	m_copy_components.clear();
 	m_copy_center = {0, 0};
@@ -840,14 +883,9 @@ void CircuitEditor::paste_components() {
 	}
 }
 
-void CircuitEditor::wire_make_connections(ModelWire *wire) {
-	for (size_t j = 0; j < wire->num_junctions(); ++j) {
-		auto junction = wire->junction_position(j);	
-		auto found = m_point_pin_lut.find(junction);
-		if (found != m_point_pin_lut.end()) {
-			wire->add_pin(found->second);
-		}
-	}
+bool CircuitEditor::is_visible(const Point &screen_min, const Point &screen_max) const {
+	return screen_max.x >= m_view_min.x - CULL_MARGIN && screen_min.x <= m_view_max.x + CULL_MARGIN &&
+		   screen_max.y >= m_view_min.y - CULL_MARGIN && screen_min.y <= m_view_max.y + CULL_MARGIN;
 }
 
 void CircuitEditor::draw_grid(ImDrawList *draw_list) {
@@ -876,6 +914,9 @@ void CircuitEditor::ui_popup_embed_circuit() {
 
 		for (size_t i = 0; i < max; ++i) {
 			auto sub = lib->circuit_by_idx(i);
+			if (sub == nullptr) {
+				continue;
+			}
 			if (ImGui::Selectable(sub->name().c_str())) {
 				ui_embed_circuit(sub->name().c_str());
 			}
@@ -18,6 +18,7 @@ class ModelCircuit;
 class ModelWireSegment;
 class ModelWire;
 class SimCircuit;
+class SimWorker;
 
 namespace gui {
 
@@ -86,17 +87,24 @@ public:
     ComponentWidget *selected_widget() const;
 
     // simulation
-    void set_simulation_instance(SimCircuit *sim_circuit, bool view_only = false);
+    void set_simulation_instance(SimCircuit *sim_circuit, bool view_only = false, SimWorker *sim_worker = nullptr);
     bool is_simulating() const;
     bool is_view_only_simulation() const {return m_view_only;};
+    SimWorker *sim_worker() const {return m_sim_worker;}
+
+    // values to display: read from the latest snapshot when the simulation runs on a worker
+    Value display_pin(pin_id_t pin_id) const;
+    Value display_pin_output(pin_id_t pin_id) const;
+    bool display_node_dirty(pin_id_t pin_id) const;
+    void write_pin(pin_id_t pin_id, Value value);
 
     // copy & paste
     void copy_selected_components();
     void paste_components();
 
 private:
-    void wire_make_connections(ModelWire *wire);
     void draw_grid(ImDrawList *draw_list);
+    bool is_visible(const Point &screen_min, const Point &screen_max) const;
     void ui_popup_embed_circuit();
     void ui_popup_embed_circuit_open();
     void ui_popup_sub_circuit(UIContext *ui_context);
@@ -105,14 +113,9 @@ private:
 	void ui_popup_edit_segment_open();
 
 private:
-    struct PointHash {
-        size_t operator() (const Point &p) const;
-    };
-
     using component_container_t = std::vector<unique_ptr<ModelComponent> >;
     using widget_container_t = std::vector<unique_ptr<ComponentWidget> >;
     using point_container_t = std::vector<Point>;
-    using point_pin_lut_t = std::unordered_map<Point, pin_id_t, PointHash>;
 
     struct WireEndPoint {
         Point    m_position;
@@ -131,7 +134,7 @@ private:
 	
 	// circuit elements
     widget_container_t			m_widgets;				// widgets for the components
-    point_pin_lut_t				m_point_pin_lut;		// Point -> pin lookup
+    EndpointLut					m_endpoint_lut;			// Point -> pin lookup
 
 	// selection
     selection_container_t		m_selection;			// selected items
@@ -148,6 +151,8 @@ private:
     ModelWire *					m_hovered_wire;			// currently hovered wire
     Point						m_scroll_delta;			// distance the origin of circuit has been scrolled from origin of editor window
 	Point						m_screen_offset;		// translation from circuit space to screen space
+	Point						m_view_min;				// visible part of the editor window (screen space)
+	Point						m_view_max;
 
     Point						m_mouse_grid_point;		// grid point nearest to the mouse cursor
     Point						m_dragging_last_point;	// last point items were moved to while dragging
@@ -160,6 +165,7 @@ private:
 
 	// simulation specific variables
     SimCircuit *				m_sim_circuit;			// simulation circuit (nullptr == not simulating atm)
+    SimWorker *					m_sim_worker;			// worker running the simulation (nullptr == stepped by the UI)
     bool						m_view_only;			// view only simulation (user cannot change connector values)
     ComponentWidget *			m_popup_component;		// drill-down target component
 
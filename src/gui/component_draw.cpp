@@ -15,6 +15,7 @@
 #include "model_circuit.h"
 #include "sim_circuit.h"
 #include "sim_component.h"
+#include "sim_functions.h"
 
 namespace {
 
@@ -107,7 +108,9 @@ void component_register_basic() {
                 for (auto i = 0u; i < model->num_outputs(); ++ i)
                 {
                     auto cur_val = VALUE_FALSE;
-                    if (circuit_editor->is_simulating()) {
+                    if (circuit_editor->is_simulating() && circuit_editor->sim_worker() != nullptr) {
+                        cur_val = circuit_editor->display_pin_output(model->output_pin_id(i));
+                    } else if (circuit_editor->is_simulating()) {
                         cur_val = circuit_editor->sim_circuit()->user_value(model->output_pin_id(i));
                     }
                     auto center_pos = to_window.apply(Point(0, ((-height * 0.5f) + ((i + 0.5f) * pin_spacing)) * (desc ? -1.0f : 1.0f)));
@@ -117,7 +120,7 @@ void component_register_basic() {
                     if (circuit_editor->is_simulating() && !circuit_editor->is_view_only_simulation() &&
                         ImGui::InvisibleButton(value_label(cur_val), button_size)) {
                         cur_val = static_cast<Value>((cur_val + 1) % (is_tristate ? 3 : 2));
-                        circuit_editor->sim_circuit()->write_pin(model->output_pin_id(i), cur_val);
+                        circuit_editor->write_pin(model->output_pin_id(i), cur_val);
                     }
 
                     ImGuiEx::RectFilled(center_pos - button_half_size, center_pos + button_half_size, COLOR_CONNECTION[cur_val]);
@@ -174,7 +177,7 @@ void component_register_basic() {
                 for (auto i = 0u; i < comp->num_inputs(); ++ i) {
                     auto cur_val = VALUE_FALSE;
                     if (circuit_editor->is_simulating()) {
-                        cur_val = circuit_editor->sim_circuit()->read_pin(comp->input_pin_id(i));
+                        cur_val = circuit_editor->display_pin(comp->input_pin_id(i));
                     }
                     auto center_pos = to_window.apply(Point(0, ((-height * 0.5f) + ((i + 0.5f) * pin_spacing)) * (desc ? -1.0f : 1.0f)));
 
@@ -348,7 +351,7 @@ void component_register_extra() {
                 for (auto i = 0u; i < comp->num_inputs(); ++ i) {
                     auto cur_val = VALUE_FALSE;
                     if (circuit_editor->is_simulating()) {
-                        cur_val = circuit_editor->sim_circuit()->read_pin(comp->input_pin_id(i));
+                        cur_val = circuit_editor->display_pin(comp->input_pin_id(i));
                     }
                     auto center_pos = to_window.apply(Point(origin.x + (width * 0.5f), origin.y + (i * pin_spacing) + (pin_spacing * 0.5f)));
 
@@ -390,6 +393,45 @@ void component_register_extra() {
         }
     );
 
+    // rom
+    auto icon_rom = ComponentIcon::cache(COMPONENT_ROM, SHAPE_ROM, sizeof(SHAPE_ROM));
+    CircuitEditorFactory::register_materialize_func(
+        COMPONENT_ROM, [=](ModelComponent *comp, ComponentWidget *widget) {
+            widget->change_tooltip("ROM");
+            widget->change_icon(icon_rom);
+            materialize_gate(widget, 80, 60);
+        }
+    );
+
+    // ram
+    auto icon_ram = ComponentIcon::cache(COMPONENT_RAM, SHAPE_RAM, sizeof(SHAPE_RAM));
+    CircuitEditorFactory::register_materialize_func(
+        COMPONENT_RAM, [=](ModelComponent *comp, ComponentWidget *widget) {
+            widget->change_tooltip("RAM");
+            widget->change_icon(icon_ram);
+            materialize_gate(widget, 80, 60);
+        }
+    );
+
+    // register
+    auto icon_register = ComponentIcon::cache(COMPONENT_REGISTER, SHAPE_REGISTER, sizeof(SHAPE_REGISTER));
+    CircuitEditorFactory::register_materialize_func(
+        COMPONENT_REGISTER, [=](ModelComponent *comp, ComponentWidget *widget) {
+            widget->change_tooltip("Register");
+            widget->change_icon(icon_register);
+            materialize_gate(widget, 80, 60);
+        }
+    );
+
+    // counter
+    auto icon_counter = ComponentIcon::cache(COMPONENT_COUNTER, SHAPE_COUNTER, sizeof(SHAPE_COUNTER));
+    CircuitEditorFactory::register_materialize_func(
+        COMPONENT_COUNTER, [=](ModelComponent *comp, ComponentWidget *widget) {
+            widget->change_tooltip("Counter");
+            widget->change_icon(icon_counter);
+            materialize_gate(widget, 80, 60);
+        }
+    );
 
     // Text
     auto icon_text = ComponentIcon::cache(COMPONENT_TEXT, SHAPE_TEXT, sizeof(SHAPE_TEXT));
@@ -547,20 +589,25 @@ void component_register_input_output() {
                 const auto width = 4;
 
                 auto sim_comp = circuit_editor->is_simulating() ? circuit_editor->sim_circuit()->component_by_id(comp->id()) : nullptr;
-                auto enabled  = sim_comp != nullptr ? sim_comp->read_pin(sim_comp->control_pin_index(0)) == VALUE_TRUE : false;
+                auto enabled  = sim_comp != nullptr ? circuit_editor->display_pin(comp->control_pin_id(0)) == VALUE_TRUE : false;
 
                 ImU32 led_colors[8] = {color_off, color_off, color_off, color_off,color_off, color_off, color_off, color_off};
 
-                if (sim_comp != nullptr) {
-                    auto *extra = reinterpret_cast<ExtraData7SegmentLED *>(sim_comp->extra_data());
+                if (sim_comp != nullptr && circuit_editor->sim_worker() != nullptr) {
+                    // the brightness isn't part of the snapshot, show the segments that are lit right now
+                    if (enabled) {
+                        for (auto idx = 0u; idx < 8; ++idx) {
+                            led_colors[idx] = circuit_editor->display_pin(comp->input_pin_id(idx)) == VALUE_TRUE ? color_on : color_off;
+                        }
+                    }
+                } else if (sim_comp != nullptr) {
+                    float fractions[8];
 
-                    if (extra->m_num_samples > 0) {
+                    if (sim_7_segment_led_sample(sim_comp, fractions)) {
                         for (size_t idx = 0; idx < 8; ++idx) {
-                            float fraction = (extra->m_samples[idx] * 3.0f) / extra->m_num_samples;
-                            extra->m_samples[idx] = 0;
+                            float fraction = fractions[idx] * 3.0f;
                             led_colors[idx] = IM_COL32(std::min(255, 50 + (int) (205 * fraction)), 0, 0, 255);
                         } 
-                        extra->m_num_samples = 0;
                     } else if (enabled) {
                         for (auto idx = 0u; idx < 8; ++idx) {
                             led_colors[idx] = sim_comp->read_pin(idx) == VALUE_TRUE ? color_on : color_off;
@@ -1,6 +1,7 @@
 // component_icon.h - Johan Smet - BSD-3-Clause (see LICENSE)
 
 #include "component_icon.h"
+#include "icon_atlas.h"
 
 #include "imgui_ex.h"
 #define NANOSVG_IMPLEMENTATION
@@ -37,6 +38,11 @@ void ComponentIcon::draw(Transform transform, Point draw_size, ImDrawList* draw_
 	Point scale_xy = draw_size / m_size;
 	float scale = std::min(scale_xy.x, scale_xy.y);
 
+	// prefer the rasterised version, tessellating the curves every frame is expensive
+	if (IconAtlas::draw(this, transform, scale, draw_list, line_width, color)) {
+		return;
+	}
+
 	for (const auto& curve : m_curves) {
 		draw_list->AddBezierCurve(
 			transform.apply(curve[0] * scale),
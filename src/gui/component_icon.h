@@ -13,15 +13,19 @@ namespace lsim {
 namespace gui {
 
 class ComponentIcon {
+public:
+	using bezier_t = std::array<Point, 4>;
+	using bezier_container_t = std::vector<bezier_t>;
 public:
 	ComponentIcon(const char* data, size_t len);
+	const bezier_container_t &curves() const { return m_curves; }
+	Point size() const { return m_size; }
+
 	void draw(Transform transform, Point draw_size, ImDrawList* draw_list, size_t line_width, uint32_t color) const;
 	void draw(Point origin, Point draw_size, ImDrawList* draw_list, size_t line_width, uint32_t color) const;
 	static ComponentIcon* cache(uint32_t id, const char* data, size_t len);
 	static ComponentIcon* cached(uint32_t id);
 private:
-	using bezier_t = std::array<Point, 4>;
-	using bezier_container_t = std::vector<bezier_t>;
 	using icon_lut_t = std::unordered_map<uint32_t, unique_ptr<ComponentIcon> >;
 private:
 	bezier_container_t  m_curves;
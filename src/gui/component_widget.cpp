@@ -4,6 +4,7 @@
 
 #include "configuration.h"
 #include "model_component.h"
+#include "model_wire.h"
 
 namespace lsim {
 
@@ -115,6 +116,29 @@ void ComponentWidget::dematerialize() {
 	m_endpoints.clear();
 }
 
+size_t EndpointLut::PointHash::operator() (const Point &p) const {
+		// abuse the fact that positions will always be aligned to the grid
+		auto x = (int32_t) p.x;
+		auto y = (int32_t) p.y;
+		return ((int64_t) y) << 32 | (size_t) x;
+}
+
+void EndpointLut::add_widget(const ComponentWidget &widget) {
+	for (const auto &pair : widget.endpoints()) {
+		// pair.first = pin-id ; pair.second = position
+		m_lut[widget.to_circuit().apply(pair.second)] = pair.first;
+	}
+}
+
+void EndpointLut::connect_wire(ModelWire *wire) const {
+	for (size_t j = 0; j < wire->num_junctions(); ++j) {
+		auto found = m_lut.find(wire->junction_position(j));
+		if (found != m_lut.end()) {
+			wire->add_pin(found->second);
+		}
+	}
+}
+
 } // namespace lsim::gui
 
 } // namespace lsim
@@ -11,6 +11,8 @@
 
 namespace lsim {
 
+class ModelWire;
+
 namespace gui {
 
 class ComponentIcon;
@@ -73,6 +75,22 @@ private:
 	endpoint_map_t      m_endpoints;
 };
 
+// EndpointLut: circuit space position -> pin for the endpoints of the widgets of a circuit, used to connect the junctions
+//	of a wire to the pins they touch. Filled from every widget, also from the ones that are outside of the view.
+class EndpointLut {
+public:
+	void clear() { m_lut.clear(); }
+	void add_widget(const ComponentWidget &widget);
+	void connect_wire(ModelWire *wire) const;
+
+private:
+	struct PointHash {
+		size_t operator() (const Point &p) const;
+	};
+
+	std::unordered_map<Point, pin_id_t, PointHash> m_lut;
+};
+
 } // namespace lsim::gui
 
 } // namespace lsim
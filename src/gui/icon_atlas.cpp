@@ -0,0 +1,233 @@
+// icon_atlas.cpp - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// rasterised component icons, packed into a single texture
+
+#include "icon_atlas.h"
+#include "component_icon.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using namespace lsim;
+using namespace lsim::gui;
+
+constexpr int ATLAS_SIZE = 1024;
+constexpr int MAX_ICON_SIZE = 256;		// larger icons are always drawn as vectors
+constexpr float SCALE_STEPS = 8.0f;		// zoom levels are rounded to 1/8th
+
+struct AtlasEntry {
+	Point	m_uv_min;
+	Point	m_uv_max;
+	Point	m_half_size;		// half the size of the rasterised image in pixels (includes the padding)
+	float	m_pixel_scale;
+};
+
+struct AtlasKey {
+	const ComponentIcon *	m_icon;
+	int						m_scale_step;
+	size_t					m_line_width;
+
+	bool operator==(const AtlasKey &other) const {
+		return m_icon == other.m_icon && m_scale_step == other.m_scale_step && m_line_width == other.m_line_width;
+	}
+};
+
+struct AtlasKeyHash {
+	size_t operator()(const AtlasKey &key) const {
+		return std::hash<const void *>()(key.m_icon) ^ (static_cast<size_t>(key.m_scale_step) << 8) ^ key.m_line_width;
+	}
+};
+
+struct Atlas {
+	IconAtlasBackend	m_backend;
+	ImTextureID			m_texture = nullptr;
+	std::unordered_map<AtlasKey, AtlasEntry, AtlasKeyHash>	m_entries;
+
+	// shelf packing
+	int		m_shelf_x = 0;
+	int		m_shelf_y = 0;
+	int		m_shelf_height = 0;
+	bool	m_full = false;
+	int		m_full_frame = 0;	// frame in which the atlas ran out of space
+};
+
+Atlas atlas;
+
+inline float distance(const Point &a, const Point &b) {
+	return sqrtf(distance_squared(a, b));
+}
+
+inline float distance_to_segment(const Point &p, const Point &a, const Point &b) {
+	auto ab = b - a;
+	auto ap = p - a;
+	auto len_sq = ab.x * ab.x + ab.y * ab.y;
+	auto t = len_sq > 0.0f ? std::max(0.0f, std::min(1.0f, (ap.x * ab.x + ap.y * ab.y) / len_sq)) : 0.0f;
+	auto d = ap - ab * t;
+	return sqrtf(d.x * d.x + d.y * d.y);
+}
+
+// rasterise the outline of the icon as white strokes: alpha is the coverage of the pixel
+std::vector<uint8_t> rasterise(const ComponentIcon *icon, float pixel_scale, size_t line_width, int width, int height) {
+
+	// flatten the curves to line segments (the icon is centered on the origin)
+	std::vector<std::pair<Point, Point>> segments;
+	Point center(width / 2.0f, height / 2.0f);
+
+	for (const auto &curve : icon->curves()) {
+		Point p[4];
+		for (int i = 0; i < 4; ++i) {
+			p[i] = curve[i] * pixel_scale + center;
+		}
+		auto curve_length = distance(p[0], p[1]) + distance(p[1], p[2]) + distance(p[2], p[3]);
+		auto steps = std::max(1, static_cast<int>(curve_length / 2.0f));
+
+		auto prev = p[0];
+		for (int s = 1; s <= steps; ++s) {
+			auto t = static_cast<float>(s) / steps;
+			auto u = 1.0f - t;
+			auto next = p[0] * (u * u * u) + p[1] * (3 * u * u * t) + p[2] * (3 * u * t * t) + p[3] * (t * t * t);
+			segments.emplace_back(prev, next);
+			prev = next;
+		}
+	}
+
+	std::vector<uint8_t> pixels(width * height * 4, 0);
+	const auto half_width = static_cast<float>(line_width) / 2.0f;
+
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			Point pos(x + 0.5f, y + 0.5f);
+			auto dist = std::numeric_limits<float>::max();
+			for (const auto &seg : segments) {
+				dist = std::min(dist, distance_to_segment(pos, seg.first, seg.second));
+			}
+			auto coverage = std::max(0.0f, std::min(1.0f, half_width + 0.5f - dist));
+			auto out = &pixels[(y * width + x) * 4];
+			out[0] = out[1] = out[2] = 255;
+			out[3] = static_cast<uint8_t>(coverage * 255.0f + 0.5f);
+		}
+	}
+
+	return pixels;
+}
+
+const AtlasEntry *lookup(const ComponentIcon *icon, float pixel_scale, size_t line_width) {
+
+	AtlasKey key = {icon, static_cast<int>(roundf(pixel_scale * SCALE_STEPS)), line_width};
+	auto found = atlas.m_entries.find(key);
+	if (found != atlas.m_entries.end()) {
+		return &found->second;
+	}
+
+	if (atlas.m_full || key.m_scale_step <= 0) {
+		return nullptr;
+	}
+
+	// size of the image: the icon + room for the width of the lines
+	auto rounded_scale = key.m_scale_step / SCALE_STEPS;
+	auto padding = static_cast<int>(line_width) + 1;
+	auto width = static_cast<int>(ceilf(icon->size().x * rounded_scale)) + 2 * padding;
+	auto height = static_cast<int>(ceilf(icon->size().y * rounded_scale)) + 2 * padding;
+
+	if (width > MAX_ICON_SIZE || height > MAX_ICON_SIZE) {
+		return nullptr;
+	}
+
+	// find a spot in the atlas
+	if (atlas.m_shelf_x + width > ATLAS_SIZE) {
+		atlas.m_shelf_x = 0;
+		atlas.m_shelf_y += atlas.m_shelf_height;
+		atlas.m_shelf_height = 0;
+	}
+	if (atlas.m_shelf_y + height > ATLAS_SIZE) {
+		atlas.m_full = true;
+		atlas.m_full_frame = ImGui::GetFrameCount();
+		return nullptr;
+	}
+
+	if (atlas.m_texture == nullptr) {
+		atlas.m_texture = atlas.m_backend.create_texture(ATLAS_SIZE, ATLAS_SIZE);
+		if (atlas.m_texture == nullptr) {
+			// no point in trying again: always draw the vectors
+			atlas.m_backend = IconAtlasBackend();
+			return nullptr;
+		}
+	}
+
+	auto pixels = rasterise(icon, rounded_scale, line_width, width, height);
+	atlas.m_backend.update_texture(atlas.m_texture, atlas.m_shelf_x, atlas.m_shelf_y, width, height, pixels.data());
+
+	AtlasEntry entry;
+	entry.m_uv_min = Point(atlas.m_shelf_x, atlas.m_shelf_y) * (1.0f / ATLAS_SIZE);
+	entry.m_uv_max = Point(atlas.m_shelf_x + width, atlas.m_shelf_y + height) * (1.0f / ATLAS_SIZE);
+	entry.m_half_size = Point(width / 2.0f, height / 2.0f);
+	entry.m_pixel_scale = rounded_scale;
+
+	atlas.m_shelf_x += width;
+	atlas.m_shelf_height = std::max(atlas.m_shelf_height, height);
+
+	return &(atlas.m_entries[key] = entry);
+}
+
+void flush() {
+	// the parts of the texture that are reused are only overwritten in a later frame than the one that drew them
+	atlas.m_entries.clear();
+	atlas.m_shelf_x = 0;
+	atlas.m_shelf_y = 0;
+	atlas.m_shelf_height = 0;
+	atlas.m_full = false;
+}
+
+} // unnamed namespace
+
+namespace lsim {
+
+namespace gui {
+
+void IconAtlas::setup(IconAtlasBackend backend) {
+	atlas = Atlas();
+	atlas.m_backend = std::move(backend);
+}
+
+bool IconAtlas::draw(const ComponentIcon *icon, Transform transform, float scale, ImDrawList *draw_list, size_t line_width, uint32_t color) {
+
+	if (!atlas.m_backend.create_texture || !atlas.m_backend.update_texture) {
+		return false;
+	}
+
+	if (atlas.m_full && atlas.m_full_frame != ImGui::GetFrameCount()) {
+		flush();
+	}
+
+	// the transform may zoom as well: rasterise at the size the icon will have on screen
+	auto transform_scale = distance(transform.apply_to_vector(Point(1.0f, 0.0f)), Point(0.0f, 0.0f));
+	auto pixel_scale = scale * transform_scale;
+	auto entry = lookup(icon, pixel_scale, line_width);
+	if (entry == nullptr) {
+		return false;
+	}
+
+	// quad in icon space: the image was rasterised at the rounded zoom level, stretch it to the exact one and
+	//	compensate for the zoom that the transform will apply
+	auto half = entry->m_half_size * (pixel_scale / (entry->m_pixel_scale * transform_scale));
+	draw_list->AddImageQuad(
+		atlas.m_texture,
+		transform.apply(Point(-half.x, -half.y)),
+		transform.apply(Point(half.x, -half.y)),
+		transform.apply(Point(half.x, half.y)),
+		transform.apply(Point(-half.x, half.y)),
+		entry->m_uv_min, Point(entry->m_uv_max.x, entry->m_uv_min.y),
+		entry->m_uv_max, Point(entry->m_uv_min.x, entry->m_uv_max.y),
+		color);
+
+	return true;
+}
+
+} // namespace lsim::gui
+
+} // namespace lsim
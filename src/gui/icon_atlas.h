@@ -0,0 +1,43 @@
+// icon_atlas.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// rasterised component icons, packed into a single texture
+
+#ifndef LSIM_GUI_ICON_ATLAS_H
+#define LSIM_GUI_ICON_ATLAS_H
+
+#include "algebra.h"
+#include "imgui/imgui.h"
+
+#include <cstdint>
+#include <functional>
+
+namespace lsim {
+
+namespace gui {
+
+class ComponentIcon;
+
+// the renderer specific part: creating a texture and uploading (part of) its pixels (RGBA, 8 bits per channel)
+struct IconAtlasBackend {
+	std::function<ImTextureID (int width, int height)> create_texture;
+	std::function<void (ImTextureID texture, int x, int y, int width, int height, const uint8_t *pixels)> update_texture;
+};
+
+// the backend for OpenGL (3 or ES 2), creates the texture in the current context (icon_atlas_gl.cpp)
+IconAtlasBackend icon_atlas_opengl_backend();
+
+class IconAtlas {
+public:
+	static void setup(IconAtlasBackend backend);
+
+	// draw: draw the icon as a textured quad, rasterising it first if this zoom level wasn't seen before.
+	//	Returns false if the icon can't be drawn from the atlas (no backend, too large, atlas full). A full atlas
+	//	is cleared at the start of the next frame and refilled with the icons that are still drawn.
+	static bool draw(const ComponentIcon *icon, Transform transform, float scale, ImDrawList *draw_list, size_t line_width, uint32_t color);
+};
+
+} // namespace lsim::gui
+
+} // namespace lsim
+
+#endif // LSIM_GUI_ICON_ATLAS_H
@@ -0,0 +1,48 @@
+// icon_atlas_gl.cpp - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// OpenGL backend of the icon atlas, shared by the desktop and the Emscripten build
+
+#include "icon_atlas.h"
+#include "imgui/imgui_impl_opengl3.h"
+
+#include <cstdint>
+
+#if defined(__EMSCRIPTEN__)
+#include <SDL_opengles2.h>
+#elif defined(IMGUI_IMPL_OPENGL_LOADER_GL3W)
+#include <GL/gl3w.h>
+#elif defined(IMGUI_IMPL_OPENGL_LOADER_GLEW)
+#include <GL/glew.h>
+#elif defined(IMGUI_IMPL_OPENGL_LOADER_GLAD)
+#include <glad/glad.h>
+#else
+#include IMGUI_IMPL_OPENGL_LOADER_CUSTOM
+#endif
+
+namespace lsim {
+
+namespace gui {
+
+IconAtlasBackend icon_atlas_opengl_backend() {
+	IconAtlasBackend backend;
+	backend.create_texture = [](int width, int height) -> ImTextureID {
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		return reinterpret_cast<ImTextureID>(static_cast<intptr_t>(texture));
+	};
+	backend.update_texture = [](ImTextureID texture, int x, int y, int width, int height, const uint8_t *pixels) {
+		glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(reinterpret_cast<intptr_t>(texture)));
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	};
+	return backend;
+}
+
+} // namespace lsim::gui
+
+} // namespace lsim
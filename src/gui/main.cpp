@@ -23,6 +23,7 @@
 #endif
 
 #include "ui_window_main.h"
+#include "icon_atlas.h"
 
 const char *WINDOW_TITLE = "LSim";
 
@@ -96,6 +97,7 @@ int main(int argc, char**argv)
     // Setup Platform/Renderer bindings
     ImGui_ImplSDL2_InitForOpenGL(window, gl_context);
     ImGui_ImplOpenGL3_Init(glsl_version);
+    lsim::gui::IconAtlas::setup(lsim::gui::icon_atlas_opengl_backend());
 
     // Load Fonts
     // - If no fonts are loaded, dear imgui will use the default font. You can also load multiple fonts and use ImGui::PushFont()/PopFont() to select them.
@@ -15,6 +15,7 @@
 #include <SDL_opengles2.h>
 
 #include "ui_window_main.h"
+#include "icon_atlas.h"
 
 // Emscripten requires to have full control over the main loop. We're going to store our SDL book-keeping variables globally.
 // Having a single function that acts as a loop prevents us to store state in the stack of said function. So we need some location for this.
@@ -77,6 +78,7 @@ int main(int, char**)
     // Setup Platform/Renderer bindings
     ImGui_ImplSDL2_InitForOpenGL(g_Window, g_GLContext);
     ImGui_ImplOpenGL3_Init(glsl_version);
+    lsim::gui::IconAtlas::setup(lsim::gui::icon_atlas_opengl_backend());
 
     // Load Fonts
     // - If no fonts are loaded, dear imgui will use the default font. You can also load multiple fonts and use ImGui::PushFont()/PopFont() to select them.
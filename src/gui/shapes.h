@@ -140,6 +140,43 @@ constexpr const char SHAPE_7_SEGMENT_LED[] = R"(FILE
 FILE)";
 
 
+constexpr const char SHAPE_ROM[] = R"(FILE 
+<svg xmlns="http://www.w3.org/2000/svg" width="60" height="40">
+    <rect x="10" y="5" width="40" height="30"/>
+    <path d="M 15,12 H 45"/>
+    <path d="M 15,20 H 45"/>
+    <path d="M 15,28 H 45"/>
+</svg>
+FILE)";
+
+constexpr const char SHAPE_RAM[] = R"(FILE 
+<svg xmlns="http://www.w3.org/2000/svg" width="60" height="40">
+    <rect x="10" y="5" width="40" height="30"/>
+    <path d="M 15,12 H 45"/>
+    <path d="M 15,20 H 45"/>
+    <path d="M 15,28 H 45"/>
+    <path d="M 40,8 V 32"/>
+</svg>
+FILE)";
+
+constexpr const char SHAPE_REGISTER[] = R"(FILE 
+<svg xmlns="http://www.w3.org/2000/svg" width="60" height="40">
+    <rect x="10" y="5" width="40" height="30"/>
+    <path d="M 10,28 L 16,32 L 10,36"/>
+    <path d="M 20,15 H 40"/>
+    <path d="M 20,25 H 40"/>
+</svg>
+FILE)";
+
+constexpr const char SHAPE_COUNTER[] = R"(FILE 
+<svg xmlns="http://www.w3.org/2000/svg" width="60" height="40">
+    <rect x="10" y="5" width="40" height="30"/>
+    <path d="M 10,28 L 16,32 L 10,36"/>
+    <path d="M 30,12 V 28"/>
+    <path d="M 22,20 H 38"/>
+</svg>
+FILE)";
+
 constexpr const char SHAPE_TEXT[] = R"(FILE 
 <svg xmlns="http://www.w3.org/2000/svg" width="60" height="40">
     <path d="m 32.651154,7.9680183 h 2.202667 c 4.368,0 5.152,0.8213333 5.6,4.8906667 h 1.12 V 6.6613517 H 20.032488 v 6.1973333 h 1.12 c 0.448,-4.0693334 1.232,-4.8906667 5.6,-4.8906667 h 2.202667 V 29.024018 c 0,2.090666 -0.112,2.165333 -4.106667,2.389333 v 1.082666 h 11.909333 v -1.082666 c -3.994667,-0.224 -4.106667,-0.298667 -4.106667,-2.389333 z" />
@@ -5,6 +5,8 @@
 #include "lsim_context.h"
 #include "model_circuit.h"
 #include "component_widget.h"
+#include "sim_history.h"
+#include "sim_worker.h"
 
 #include "serialize.h"
 
@@ -14,8 +16,12 @@ namespace gui {
 
 UIContext::UIContext(LSimContext* lsim_context) :
 	m_lsim_context(lsim_context) { 
+	// restarting a stopped simulation patches it with the edits made in the meantime
+	m_lsim_context->sim()->enable_patching();
 }
 
+UIContext::~UIContext() = default;
+
 void UIContext::circuit_library_load(const std::string& filename) {
 	if (m_circuit_editor != nullptr) {
 		circuit_library_close();
@@ -54,6 +60,12 @@ void UIContext::change_active_circuit(ModelCircuit* circuit) {
 		return;
 	}
 
+	// a simulation can only be patched for edits of the circuit it was built from
+	if (m_sim_circuit != nullptr) {
+		simulation_stop();
+	}
+	simulation_discard();
+
 	if (circuit != nullptr) {
 		circuit->sync_sub_circuit_components();
 		m_circuit_editor = CircuitEditorFactory::create_circuit(circuit);
@@ -67,16 +79,67 @@ void UIContext::change_active_circuit(ModelCircuit* circuit) {
 void UIContext::simulation_start() {
 	auto sim = m_lsim_context->sim();
 
-	m_sim_circuit = m_circuit_editor->model_circuit()->instantiate(sim);
-	m_circuit_editor->set_simulation_instance(m_sim_circuit.get());
-	sim->init();
+	if (m_retained_sim_circuit != nullptr) {
+		// only apply the changes made in the editor since the simulation was stopped
+		m_sim_circuit = move(m_retained_sim_circuit);
+		m_sim_circuit->sync_with_model();
+	} else {
+		m_sim_circuit = m_circuit_editor->model_circuit()->instantiate(sim);
+		sim->init();
+	}
+
+	m_sim_history = std::make_unique<SimHistory>(sim);
+#ifdef __EMSCRIPTEN_PTHREADS__
+	auto history = m_sim_history.get();
+	m_sim_worker = std::make_unique<SimWorker>(sim, [history]() {history->step();});
+#endif
+	m_circuit_editor->set_simulation_instance(m_sim_circuit.get(), false, m_sim_worker.get());
 }
 
 void UIContext::simulation_stop() {
-	m_sim_circuit = nullptr;
+	m_sim_worker = nullptr;
+	m_sim_history = nullptr;
+	if (m_sim_circuit != nullptr) {
+		m_retained_sim_circuit = move(m_sim_circuit);
+	}
 	m_circuit_editor->set_simulation_instance(nullptr);
 	m_sub_circuit_views.clear();
-	m_lsim_context->sim()->clear_components();
+}
+
+void UIContext::simulation_discard() {
+	if (m_retained_sim_circuit != nullptr) {
+		m_retained_sim_circuit = nullptr;
+		m_lsim_context->sim()->clear_components();
+	}
+}
+
+void UIContext::simulation_run(size_t num_steps) {
+	if (m_sim_worker != nullptr) {
+		m_sim_worker->run(num_steps);
+	} else {
+		m_sim_history->run(num_steps);
+	}
+}
+
+void UIContext::simulation_pause(const std::function<void()> &func) {
+	if (m_sim_worker != nullptr) {
+		m_sim_worker->pause([&](Simulator *) {func();});
+	} else {
+		func();
+	}
+}
+
+timestamp_t UIContext::simulation_time() const {
+	if (m_sim_worker != nullptr) {
+		return m_sim_worker->snapshot().time();
+	}
+	return m_lsim_context->sim()->current_time();
+}
+
+void UIContext::simulation_refresh() {
+	if (m_sim_worker != nullptr) {
+		m_sim_worker->update_snapshot();
+	}
 }
 
 void UIContext::create_sub_circuit_view(SimCircuit* sim_circuit, ModelComponent *model_comp) {
@@ -84,7 +147,7 @@ void UIContext::create_sub_circuit_view(SimCircuit* sim_circuit, ModelComponent
 	auto nested_sim = sim_circuit->component_by_id(model_comp->id())->nested_instance();
 
 	auto sub_circuit = CircuitEditorFactory::create_circuit(nested_model);
-	sub_circuit->set_simulation_instance(nested_sim, true);
+	sub_circuit->set_simulation_instance(nested_sim, true, m_sim_worker.get());
 
 	m_sub_circuit_views.push_back(move(sub_circuit));
 }
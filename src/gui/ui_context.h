@@ -14,12 +14,15 @@ class LSimContext;
 class ModelCircuit;
 class ModelComponent;
 class SimCircuit;
+class SimHistory;
+class SimWorker;
 
 namespace gui {
 
 class UIContext {
 public:
 	UIContext(LSimContext* lsim_context);
+	~UIContext();
 
 	// accessors
 	LSimContext* lsim_context() const { return m_lsim_context; }
@@ -27,6 +30,8 @@ public:
 	int selected_circuit_idx() const { return m_selected_circuit_idx; }
 	CircuitEditor* circuit_editor() const { return m_circuit_editor.get(); }
 	SimCircuit* sim_circuit() const { return m_sim_circuit.get(); }
+	SimHistory* sim_history() const { return m_sim_history.get(); }
+	SimWorker* sim_worker() const { return m_sim_worker.get(); }
 
 	// library management
 	void circuit_library_load(const std::string& filename);
@@ -40,6 +45,14 @@ public:
 	// simulation control
 	void simulation_start();
 	void simulation_stop();
+	void simulation_discard();
+
+	// simulation stepping: on a worker thread when the build supports it (Emscripten with pthreads), the UI then
+	//  only reads the snapshots of the worker and needs simulation_pause to access the simulator
+	void simulation_run(size_t num_steps);
+	void simulation_pause(const std::function<void()> &func);
+	timestamp_t simulation_time() const;
+	void simulation_refresh();
 
 	// sub-circuit views
 	void create_sub_circuit_view(SimCircuit* sim_circuit, ModelComponent *model_comp);
@@ -51,6 +64,9 @@ private:
 	int										m_selected_circuit_idx = 0;
 	unique_ptr<CircuitEditor>				m_circuit_editor = nullptr;
 	unique_ptr<SimCircuit>					m_sim_circuit = nullptr;
+	unique_ptr<SimCircuit>					m_retained_sim_circuit = nullptr;	// stopped simulation, kept for incremental restart
+	unique_ptr<SimHistory>					m_sim_history;						// snapshots + recorded inputs to step backwards
+	unique_ptr<SimWorker>					m_sim_worker;						// runs the simulation off the UI thread (optional)
 	std::list<unique_ptr<CircuitEditor>>	m_sub_circuit_views;
 };
 
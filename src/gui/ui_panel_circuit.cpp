@@ -44,10 +44,11 @@ void ui_panel_circuit(UIContext* ui_context) {
 	}
 
 	// remove circuit from library if allowed
-	if (lib->num_circuits() > 1 && lib->main_circuit() != lib->circuit_by_idx(selected_circuit_idx)) {
+	auto selected_circuit = selected_circuit_idx < lib->num_circuits() ? lib->circuit_by_idx(selected_circuit_idx) : nullptr;
+	if (lib->num_circuits() > 1 && selected_circuit != nullptr && lib->main_circuit() != selected_circuit) {
 		ImGui::SameLine();
 		if (ImGui::Button("Delete")) {
-			lib->delete_circuit(lib->circuit_by_idx(selected_circuit_idx));
+			lib->delete_circuit(selected_circuit);
 			ui_context->change_active_circuit(lib->main_circuit());
 		}
 	}
@@ -57,6 +58,10 @@ void ui_panel_circuit(UIContext* ui_context) {
 
 	for (size_t i = 0; i < lib->num_circuits(); ++i) {
 		auto circuit = lib->circuit_by_idx(i);
+		if (circuit == nullptr) {
+			// failed to load
+			continue;
+		}
 		if (ImGui::Selectable(circuit->name().c_str(), selected_circuit_idx == i)) {
 			ui_context->change_active_circuit(circuit);
 		}
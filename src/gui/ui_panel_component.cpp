@@ -64,6 +64,10 @@ void ui_panel_component(UIContext* ui_context) {
 		add_component_button(COMPONENT_PULL_RESISTOR, "PullResistor", [](ModelCircuit* circuit) {return circuit->add_pull_resistor(VALUE_TRUE); });
 		add_component_button(COMPONENT_VIA, "Via", [](ModelCircuit* circuit) {return circuit->add_via("via", 1); });
 		add_component_button(COMPONENT_OSCILLATOR, "Oscillator", [](ModelCircuit* circuit) {return circuit->add_oscillator(5, 5); });
+		add_component_button(COMPONENT_ROM, "ROM", [](ModelCircuit* circuit) {return circuit->add_rom(8, 8); });
+		add_component_button(COMPONENT_RAM, "RAM", [](ModelCircuit* circuit) {return circuit->add_ram(8, 8); });
+		add_component_button(COMPONENT_REGISTER, "Register", [](ModelCircuit* circuit) {return circuit->add_register(8); });
+		add_component_button(COMPONENT_COUNTER, "Counter", [](ModelCircuit* circuit) {return circuit->add_counter(8, 255); });
 		add_component_button(COMPONENT_TEXT, "Text", [](ModelCircuit* circuit) {return circuit->add_text("text"); });
 		ImGui::EndGroup();
 	}
@@ -84,7 +88,7 @@ void ui_panel_component(UIContext* ui_context) {
 			ImGui::BeginGroup();
 			ImGui::Indent();
 			for (size_t idx = 0; idx < ref_lib->num_circuits(); ++idx) {
-				auto sub_name = ref_lib->circuit_by_idx(idx)->name();
+				auto sub_name = ref_lib->circuit_name(idx);
 				auto full_name = ref + ".";
 				full_name += sub_name;
 				add_component_button(COMPONENT_SUB_CIRCUIT, sub_name.c_str(),
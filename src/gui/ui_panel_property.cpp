@@ -6,6 +6,9 @@
 #include "circuit_editor.h"
 #include "lsim_context.h"
 #include "ui_context.h"
+#include "ui_popup_files.h"
+#include "rom_image.h"
+#include "sim_circuit.h"
 
 namespace lsim {
 
@@ -16,6 +19,8 @@ void ui_panel_property(UIContext* ui_context) {
 	auto circuit_editor = ui_context->circuit_editor();
 	auto context = ui_context->lsim_context();
 
+	ui_filename_entry_define();
+
 	if (circuit_editor != nullptr && circuit_editor->selected_widget() != nullptr) {
 		auto ui_comp = circuit_editor->selected_widget();
 		auto component = ui_comp->component_model();
@@ -63,6 +68,20 @@ void ui_panel_property(UIContext* ui_context) {
 			return property->value_as_lsim_value();
 		};
 
+		auto option_property = [](const char* caption, Property* property, const char* const* options, int num_options) {
+			auto value = property->value_as_string();
+			int cur_option = 0;
+			while (cur_option < num_options && value != options[cur_option]) {
+				++cur_option;
+			}
+
+			if (ImGui::Combo(caption, &cur_option, options, num_options)) {
+				property->value(options[cur_option]);
+				return true;
+			}
+			return false;
+		};
+
 		// orientation - present for all components
 		int cur_orientation = component->angle() / 90;
 		const char* orientations[] = { "East", "South", "West", "North" };
@@ -166,6 +185,39 @@ void ui_panel_property(UIContext* ui_context) {
 			}
 		}
 
+		if (component->type() == COMPONENT_ROM || component->type() == COMPONENT_RAM) {
+			if (ImGui::Button("Load Image")) {
+				ui_filename_entry_open([=](const std::string &filename) {
+					rom_data_t data;
+					if (!rom_image_load(context->full_file_path(filename).c_str(), component->num_outputs(), &data)) {
+						return;
+					}
+					rom_set_contents(component, data);
+
+					// hot-swap the contents of a running simulation, the rest of the simulation keeps its state
+					if (circuit_editor->is_simulating()) {
+						ui_context->simulation_pause([&]() {
+							circuit_editor->sim_circuit()->replace_memory_contents(component->id(), data);
+						});
+					}
+				});
+			}
+		}
+
+		if (component->type() == COMPONENT_REGISTER || component->type() == COMPONENT_COUNTER) {
+			option_property("Trigger", component->property("trigger"), CLOCK_TRIGGER_NAMES, 4);
+		}
+
+		if (component->type() == COMPONENT_COUNTER) {
+			option_property("On Goal", component->property("on_goal"), COUNTER_ON_GOAL_NAMES, 4);
+			auto max_value = component->property("max_value");
+			if (integer_property("Max Value", max_value)) {
+				if (max_value->value_as_integer() < 1) {
+					max_value->value(static_cast<int64_t>(1));
+				}
+			}
+		}
+
 		if (component->type() == COMPONENT_TEXT) {
 			if (text_property("Value", component->property("text"))) {
 				CircuitEditorFactory::rematerialize_component(circuit_editor, ui_comp);
@@ -9,6 +9,7 @@
 
 #include "lsim_context.h"
 #include "sim_circuit.h"
+#include "sim_history.h"
 #include "ui_context.h"
 
 namespace {
@@ -86,6 +87,7 @@ void main_window_update() {
 	static bool sim_running = false;
 	static bool sim_single_step = false;
 	static int cycles_per_frame = 5;
+	static int goto_time = 0;
 
 	ImGui::SetNextWindowPos({268, 0}, ImGuiSetCond_FirstUseEver);
 	ImGui::SetNextWindowSize({ImGui::GetIO().DisplaySize.x-268, ImGui::GetIO().DisplaySize.y}, ImGuiSetCond_FirstUseEver);
@@ -105,7 +107,17 @@ void main_window_update() {
 			ImGui::Checkbox("Run simulation", &sim_running);
 			ImGui::SameLine();
 			if (ImGui::Button("Reset simulation")) {
-				sim->init();
+				ui_context.simulation_pause([=]() {
+					// pick up property changes made while simulating (parameters are compiled at instantiation)
+					ui_context.sim_circuit()->sync_with_model();
+					sim->init();
+					ui_context.sim_history()->restart();
+				});
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Step back")) {
+				sim_running = false;
+				ui_context.simulation_pause([]() {ui_context.sim_history()->step_back(1);});
 			}
 			ImGui::SameLine();
 			sim_single_step = ImGui::Button("Step");
@@ -116,16 +128,25 @@ void main_window_update() {
 					cycles_per_frame = 1;
 				}
 			}
+			ImGui::SameLine();
+			ImGui::SetNextItemWidth(80);
+			ImGui::InputInt("##goto_time", &goto_time, 0, 0);
+			ImGui::SameLine();
+			if (ImGui::Button("Go to time")) {
+				sim_running = false;
+				ui_context.simulation_pause([]() {ui_context.sim_history()->goto_time(std::max(goto_time, 0));});
+			}
+			ImGui::SameLine();
+			ImGui::Text("Time: %llu", static_cast<unsigned long long>(ui_context.simulation_time()));
 		}
 
 		if (sim_single_step) {
-			sim->step();
+			ui_context.simulation_run(1);
 			sim_single_step = false;
 		} else if (sim_running && ui_context.sim_circuit() != nullptr) {
-			for (int i = 0; i < cycles_per_frame; ++i) {
-				sim->step();
-			}
+			ui_context.simulation_run(cycles_per_frame);
 		}
+		ui_context.simulation_refresh();
 
 		if (ui_context.circuit_editor() != nullptr) {
 			ui_context.circuit_editor()->refresh(&ui_context);
@@ -138,7 +159,7 @@ void main_window_update() {
 		bool keep_open = true;
 
 		ImGui::SetNextWindowSize(drill_down->circuit_dimensions() + Point(50,50), ImGuiCond_Appearing);
-		ImGui::Begin(drill_down->sim_circuit()->name(), &keep_open, ImGuiWindowFlags_NoScrollWithMouse);
+		ImGui::Begin(drill_down->sim_circuit()->name().c_str(), &keep_open, ImGuiWindowFlags_NoScrollWithMouse);
 			drill_down->refresh(&ui_context);
 		ImGui::End();
 
@@ -4,10 +4,11 @@
 //  This is not intended to be a fully compatible with all the features of Logisim.
 //  We're basically using Logisim as an easy way to construct our circuits.
 //  Current restrictions / not supported features:
-//  - only basic gates
+//  - only basic gates, ROM, RAM, Register and Counter
+//  - RAM writes are level sensitive while the clock is high and the clear input is ignored
 //  - gates are always 1 bit
-//  - connectors (Logisim: Pin) and buffers support > 1 data bits but have a pin per bit
-//      - NO: disabled again after rewrite / logisim support is low priority for now
+//  - connectors (Logisim: Pin), buffers and memory components support > 1 data bits, wires connect them bit by bit
+//    (splitters are not supported)
 //  - XOR gates are limited to two inputs
 //  - no custom subcircuit appearance, just the standard inputs on the left and outputs on the right
 //      - circuits to be nested should have "Use new box layout" (circuitnamedbox) and 
@@ -19,12 +20,14 @@
 #include <string>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
 
 #include "model_circuit.h"
 #include "lsim_context.h"
+#include "rom_image.h"
 #include "error.h"
 
 namespace {
@@ -58,9 +61,10 @@ private:
         uint64_t m_full = 0;
     };
 
+    // all the pins at a location: one group per component port, a multi-bit port has a pin for each bit
     struct LogisimConnection {
-        Position            m_position;
-        pin_id_container_t  m_pins;
+        Position                        m_position;
+        std::vector<pin_id_container_t> m_groups;
     };
 
     enum LogisimDirection {
@@ -85,6 +89,13 @@ private:
         int                 m_splitter_justify;
         bool                m_pin_output;
         bool                m_pin_tristate;
+        uint32_t            m_addr_width;
+        uint32_t            m_data_width;
+        uint32_t            m_max_value;
+        std::string         m_trigger;
+        std::string         m_on_goal;
+        std::string         m_ram_bus;
+        std::string         m_contents;
     };
 
     using wire_node_t = std::vector<uint64_t>;
@@ -98,6 +109,7 @@ private:
         std::unordered_map<std::string, Position> m_ipin_offsets;
         wire_container_t m_wires;
         tunnel_wire_map_t m_tunnels;
+        std::vector<std::pair<Position, pin_id_t>> m_default_high;  // inputs that are enabled when left unconnected
     };
 
     using circuit_map_t = std::unordered_map<std::string, CircuitConstruction>;
@@ -108,6 +120,7 @@ private:
     bool parse_wire(pugi::xml_node &wire_node);
 
     bool connect_components();
+    void connect_groups(const std::vector<const pin_id_container_t *> &groups);
 
     ModelComponent *handle_sub_circuit(const std::string &name, ComponentProperties &props);
     bool handle_gate(ModelComponent *component, ComponentProperties &props);
@@ -116,6 +129,10 @@ private:
     bool handle_pin(ModelComponent *connector, ComponentProperties &props);
     bool handle_splitter(ComponentProperties &props);
     bool handle_tunnel(ComponentProperties &props);
+    ModelComponent *handle_rom(ComponentProperties &props);
+    ModelComponent *handle_ram(ComponentProperties &props);
+    void handle_register(ModelComponent *component, ComponentProperties &props);
+    void handle_counter(ModelComponent *component, ComponentProperties &props);
     void compute_ipin_offsets();
 
     bool parse_location(const std::string &loc_string, Position &pos);
@@ -177,6 +194,7 @@ bool LogisimParser::parse_circuit(pugi::xml_node &circuit_node) {
     m_context.m_ipin_offsets.clear();
     m_context.m_wires.clear();
     m_context.m_tunnels.clear();
+    m_context.m_default_high.clear();
 
     /* iterate all components */
     for (auto comp : circuit_node.children("comp")) {
@@ -211,6 +229,10 @@ bool LogisimParser::parse_component(pugi::xml_node &comp_node) {
     comp_props.m_splitter_justify = -1;
     comp_props.m_pin_output = false;
     comp_props.m_pin_tristate = false;
+    comp_props.m_addr_width = 8;
+    comp_props.m_data_width = 8;
+    comp_props.m_max_value = 0xff;
+    comp_props.m_ram_bus = "combined";
     bool tristate_left = false;
     Value constant_val = VALUE_TRUE;
     Value pull_val = VALUE_FALSE;
@@ -219,8 +241,20 @@ bool LogisimParser::parse_component(pugi::xml_node &comp_node) {
         return false;
     }
 
+    // registers and counters are 8 bits wide unless specified otherwise
+    if (comp_type == "Register" || comp_type == "Counter") {
+        comp_props.m_width = 8;
+    }
+
     for (auto prop : comp_node.children("a")) {
         DEF_REQUIRED_ATTR(prop_name, prop, name);
+
+        // memory contents are stored as the text of the element
+        if (prop_name == "contents") {
+            comp_props.m_contents = prop.child_value();
+            continue;
+        }
+
         DEF_REQUIRED_ATTR(prop_val, prop, val);
 
         if (prop_name == "label") {
@@ -249,6 +283,18 @@ bool LogisimParser::parse_component(pugi::xml_node &comp_node) {
             parse_splitter_appearance(prop_val, comp_props.m_splitter_justify);
         } else if (prop_name == "pull") {
             pull_val = (prop_val == "1") ? VALUE_TRUE : (prop_val == "X") ? VALUE_ERROR : VALUE_FALSE;
+        } else if (prop_name == "addrWidth") {
+            comp_props.m_addr_width = attr_val.as_int(comp_props.m_addr_width);
+        } else if (prop_name == "dataWidth") {
+            comp_props.m_data_width = attr_val.as_int(comp_props.m_data_width);
+        } else if (prop_name == "trigger") {
+            comp_props.m_trigger = prop_val;
+        } else if (prop_name == "max") {
+            comp_props.m_max_value = static_cast<uint32_t>(std::strtoul(prop_val.c_str(), nullptr, 0));
+        } else if (prop_name == "ongoal") {
+            comp_props.m_on_goal = prop_val;
+        } else if (prop_name == "bus") {
+            comp_props.m_ram_bus = prop_val;
         }
     }
 
@@ -313,6 +359,18 @@ bool LogisimParser::parse_component(pugi::xml_node &comp_node) {
     } else if (comp_type == "Pull Resistor") {
         component = m_context.m_circuit->add_pull_resistor(pull_val);
         add_pin_location(comp_props.m_location, component->pin_id(0));
+    } else if (comp_type == "ROM") {
+        component = handle_rom(comp_props);
+        ok = component != nullptr;
+    } else if (comp_type == "RAM") {
+        component = handle_ram(comp_props);
+        ok = component != nullptr;
+    } else if (comp_type == "Register") {
+        component = m_context.m_circuit->add_register(comp_props.m_width);
+        handle_register(component, comp_props);
+    } else if (comp_type == "Counter") {
+        component = m_context.m_circuit->add_counter(comp_props.m_width, comp_props.m_max_value);
+        handle_counter(component, comp_props);
     } else if (comp_type == "Text" || comp_type == "Probe") {
         // ignore
     } else {
@@ -385,28 +443,73 @@ bool LogisimParser::parse_wire(pugi::xml_node &wire_node) {
 
 bool LogisimParser::connect_components() {
 
+    std::unordered_set<uint64_t> wire_points;
+
     for (const auto &node : m_context.m_wires) {
-        // XXX this isn't correct, should create a separate wire for each entry in connection
-        auto wire = m_context.m_circuit->create_wire();
+        std::vector<const pin_id_container_t *> groups;
 
         for (const auto &point : node) {
+            wire_points.insert(point);
             auto pin_pair = m_context.m_pin_locs.find(point);
             if (pin_pair != std::end(m_context.m_pin_locs)) {
-                auto &c = pin_pair->second;
-                for (auto pin : c.m_pins) {
-                    wire->add_pin(pin);
+                for (const auto &group : pin_pair->second.m_groups) {
+                    groups.push_back(&group);
                 }
             }
         }
 
-        if (wire->num_pins() <= 0) {
-            m_context.m_circuit->remove_wire(wire->id());
+        connect_groups(groups);
+    }
+
+    // components that touch without a wire in between
+    for (const auto &loc : m_context.m_pin_locs) {
+        if (loc.second.m_groups.size() < 2 || wire_points.count(loc.first) > 0) {
+            continue;
+        }
+
+        std::vector<const pin_id_container_t *> groups;
+        for (const auto &group : loc.second.m_groups) {
+            groups.push_back(&group);
+        }
+        connect_groups(groups);
+    }
+
+    // tie unconnected enable inputs high
+    for (const auto &entry : m_context.m_default_high) {
+        auto loc = m_context.m_pin_locs.find(entry.first.m_full);
+        assert(loc != m_context.m_pin_locs.end());
+
+        if (loc->second.m_groups.size() == 1 && wire_points.count(entry.first.m_full) == 0) {
+            auto constant = m_context.m_circuit->add_constant(VALUE_TRUE);
+            m_context.m_circuit->connect(constant->pin_id(0), entry.second);
         }
     }
 
     return true;
 }
 
+void LogisimParser::connect_groups(const std::vector<const pin_id_container_t *> &groups) {
+    // each bit of a bus gets its own wire
+    size_t num_bits = 0;
+    for (const auto &group : groups) {
+        num_bits = std::max(num_bits, group->size());
+    }
+
+    for (size_t bit = 0; bit < num_bits; ++bit) {
+        auto wire = m_context.m_circuit->create_wire();
+
+        for (const auto &group : groups) {
+            if (bit < group->size()) {
+                wire->add_pin((*group)[bit]);
+            }
+        }
+
+        if (wire->num_pins() < 2) {
+            m_context.m_circuit->remove_wire(wire->id());
+        }
+    }
+}
+
 ModelComponent *LogisimParser::handle_sub_circuit(const std::string &name, ComponentProperties &props) {
 
     // find the required circuit
@@ -610,6 +713,128 @@ bool LogisimParser::handle_tunnel(ComponentProperties &props) {
     return true;
 }
 
+ModelComponent *LogisimParser::handle_rom(ComponentProperties &props) {
+
+    // Logisim stores the contents as "addr/data: A D" followed by hexadecimal words (with N*value runs)
+    rom_data_t data;
+    auto newline = props.m_contents.find('\n');
+    if (newline != std::string::npos && !rom_image_from_hex(props.m_contents.c_str() + newline + 1, &data)) {
+        ERROR_MSG("Unparseable ROM contents \"%s\"", props.m_contents.c_str());
+        return nullptr;
+    }
+
+    auto component = m_context.m_circuit->add_rom(props.m_addr_width, props.m_data_width);
+    data.resize(static_cast<size_t>(1) << props.m_addr_width, 0);
+    rom_set_contents(component, data);
+
+    // memory components don't rotate: the location is the data output
+    auto loc = props.m_location;
+    add_pin_location({loc.m_x - 140, loc.m_y}, component->input_pin_id(0), component->num_inputs());
+    add_pin_location(loc, component->output_pin_id(0), component->num_outputs());
+
+    // chip select, the output is always enabled
+    Position cs_loc(loc.m_x - 90, loc.m_y + 40);
+    add_pin_location(cs_loc, component->control_pin_id(0));
+    m_context.m_default_high.push_back({cs_loc, component->control_pin_id(0)});
+    m_context.m_circuit->connect(m_context.m_circuit->add_constant(VALUE_TRUE)->pin_id(0), component->control_pin_id(1));
+
+    return component;
+}
+
+ModelComponent *LogisimParser::handle_ram(ComponentProperties &props) {
+
+    if (props.m_ram_bus != "combined" && props.m_ram_bus != "asynch" && props.m_ram_bus != "separate") {
+        ERROR_MSG("Unsupported RAM bus interface \"%s\"", props.m_ram_bus.c_str());
+        return nullptr;
+    }
+
+    auto circuit = m_context.m_circuit;
+    auto component = circuit->add_ram(props.m_addr_width, props.m_data_width);
+    auto addr_in = component->input_pin_id(0);
+    auto data_in = component->input_pin_id(props.m_addr_width);
+    auto chip_enable = component->control_pin_id(0);
+    auto write_enable = component->control_pin_id(1);
+    auto output_enable = component->control_pin_id(2);
+
+    // memory components don't rotate: the location is the data bus
+    auto loc = props.m_location;
+    add_pin_location({loc.m_x - 140, loc.m_y}, addr_in, props.m_addr_width);
+    add_pin_location(loc, component->output_pin_id(0), component->num_outputs());
+
+    Position cs_loc(loc.m_x - 90, loc.m_y + 40);
+    add_pin_location(cs_loc, chip_enable);
+    m_context.m_default_high.push_back({cs_loc, chip_enable});
+
+    // the load input (ld) enables the outputs
+    Position ld_loc(loc.m_x - 50, loc.m_y + 40);
+    add_pin_location(ld_loc, output_enable);
+    m_context.m_default_high.push_back({ld_loc, output_enable});
+
+    // lsim's RAM writes while its write enable is high:
+    //  - separate: write enable = str AND clk
+    //  - combined: write enable = NOT ld AND clk, the data inputs share the bus with the outputs
+    //  - asynch:   write enable = NOT ld
+    ModelComponent *write_gate = nullptr;
+    if (props.m_ram_bus != "asynch") {
+        write_gate = circuit->add_and_gate(2);
+        circuit->connect(write_gate->output_pin_id(0), write_enable);
+        add_pin_location({loc.m_x - 70, loc.m_y + 40}, write_gate->input_pin_id(1));
+    }
+
+    if (props.m_ram_bus == "separate") {
+        add_pin_location({loc.m_x - 110, loc.m_y + 40}, write_gate->input_pin_id(0));
+        add_pin_location({loc.m_x - 140, loc.m_y + 20}, data_in, props.m_data_width);
+        return component;
+    }
+
+    auto not_ld = circuit->add_not_gate();
+    circuit->connect(output_enable, not_ld->input_pin_id(0));
+    if (write_gate != nullptr) {
+        circuit->connect(not_ld->output_pin_id(0), write_gate->input_pin_id(0));
+    } else {
+        circuit->connect(not_ld->output_pin_id(0), write_enable);
+    }
+
+    for (auto bit = 0u; bit < props.m_data_width; ++bit) {
+        circuit->connect(data_in + bit, component->output_pin_id(bit));
+    }
+
+    return component;
+}
+
+void LogisimParser::handle_register(ModelComponent *component, ComponentProperties &props) {
+    if (!props.m_trigger.empty()) {
+        component->property("trigger")->value(props.m_trigger.c_str());
+    }
+
+    auto loc = props.m_location;
+    add_pin_location(loc, component->output_pin_id(0), component->num_outputs());
+    add_pin_location({loc.m_x - 30, loc.m_y}, component->input_pin_id(0), component->num_inputs());
+    add_pin_location({loc.m_x - 20, loc.m_y + 20}, component->control_pin_id(0));      // clock
+    add_pin_location({loc.m_x - 30, loc.m_y + 10}, component->control_pin_id(1));      // enable
+    m_context.m_default_high.push_back({{loc.m_x - 30, loc.m_y + 10}, component->control_pin_id(1)});
+    add_pin_location({loc.m_x - 10, loc.m_y + 20}, component->control_pin_id(2));      // clear
+}
+
+void LogisimParser::handle_counter(ModelComponent *component, ComponentProperties &props) {
+    if (!props.m_trigger.empty()) {
+        component->property("trigger")->value(props.m_trigger.c_str());
+    }
+    if (!props.m_on_goal.empty()) {
+        component->property("on_goal")->value(props.m_on_goal == "cont" ? "continue" : props.m_on_goal.c_str());
+    }
+
+    auto loc = props.m_location;
+    add_pin_location(loc, component->output_pin_id(0), props.m_width);
+    add_pin_location({loc.m_x, loc.m_y + 10}, component->output_pin_id(props.m_width));     // carry
+    add_pin_location({loc.m_x - 30, loc.m_y}, component->input_pin_id(0), component->num_inputs());
+    add_pin_location({loc.m_x - 20, loc.m_y + 20}, component->control_pin_id(0));           // clock
+    add_pin_location({loc.m_x - 30, loc.m_y - 10}, component->control_pin_id(1));           // load
+    add_pin_location({loc.m_x - 30, loc.m_y + 10}, component->control_pin_id(2));           // count
+    m_context.m_default_high.push_back({{loc.m_x - 30, loc.m_y + 10}, component->control_pin_id(2)});
+    add_pin_location({loc.m_x - 10, loc.m_y + 20}, component->control_pin_id(3));           // clear
+}
+
 void LogisimParser::compute_ipin_offsets() {
     Position offsets[2] = {
         {-220, 0},          // inputs (on the left)
@@ -676,34 +901,20 @@ bool LogisimParser::parse_splitter_appearance(const std::string &appear_string,
 }
 
 void LogisimParser::add_pin_location(const Position &loc, pin_id_t pin) {
-    LogisimConnection connection;
-    connection.m_position = loc;
-    connection.m_pins.push_back(pin);
-
-    // connect if there is already a pin in the same location
-    auto res = m_context.m_pin_locs.find(loc.m_full);
-    if (res != m_context.m_pin_locs.end()) {
-        // XXX make_connection(connection, res->second);
-    } else {
-       m_context.m_pin_locs[loc.m_full] = connection;
-    }      
+    add_pin_location(loc, pin, 1);
 }
 
 void LogisimParser::add_pin_location(const Position &loc, pin_id_t start, size_t count) {
-    LogisimConnection connection;
-    connection.m_position = loc;
+    pin_id_container_t group;
 
     for (size_t i = 0; i < count; ++i) {
-       connection.m_pins.push_back(start + i);
+       group.push_back(start + i);
     }
 
-    // connect if there is already a pin in the same location
-    auto res = m_context.m_pin_locs.find(loc.m_full);
-    if (res != m_context.m_pin_locs.end()) {
-        // XXX make_connection(connection, res->second);
-    } else {
-       m_context.m_pin_locs[loc.m_full] = connection;
-    }
+    // pins in the same location are connected by connect_components
+    auto &connection = m_context.m_pin_locs[loc.m_full];
+    connection.m_position = loc;
+    connection.m_groups.push_back(std::move(group));
 }
 
 LogisimParser::Position LogisimParser::input_pin_location( 
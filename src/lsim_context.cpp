@@ -2,6 +2,7 @@
 
 #include "lsim_context.h"
 #include "serialize.h"
+#include "memory_report.h"
 
 #include <cassert>
 
@@ -12,8 +13,9 @@ void LSimContext::load_reference_library(const char *name, const char *filename)
         return;
     }
 
+    // circuits of a reference library are only loaded when they're used
     auto lib = std::make_unique<ModelCircuitLibrary>(name, filename);
-    if (!deserialize_library(this, lib.get(), full_file_path(filename).c_str())) {
+    if (!deserialize_library_lazy(this, lib.get(), full_file_path(filename).c_str())) {
         lib = nullptr;
         return;
     }
@@ -112,4 +114,12 @@ std::string LSimContext::relative_file_path(const std::string &file) {
     return file;
 }
 
-} // namespace lsim
\ No newline at end of file
+void LSimContext::memory_usage(MemoryReport *report) const {
+    m_sim.memory_usage(report);
+    m_user_library.memory_usage(report);
+    for (const auto &entry : m_reference_libraries) {
+        entry.second->memory_usage(report);
+    }
+}
+
+} // namespace lsim
@@ -38,6 +38,10 @@ public:
     std::string full_file_path(const std::string &file);
     std::string relative_file_path(const std::string &file);
 
+    // memory footprint: the simulator and all the loaded circuits. Instances (SimCircuit) created with
+    //  ModelCircuit::instantiate are owned by the caller and are reported separately (SimCircuit::memory_usage).
+    void memory_usage(MemoryReport *report) const;
+
 private:
     using library_lut_t = std::unordered_map<std::string, ModelCircuitLibrary::uptr_t>;
     using folder_lut_t = std::unordered_map<std::string, std::string>;
@@ -0,0 +1,55 @@
+// memory_report.cpp - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// memory footprint accounting: estimate the memory used by the data structures of the model and the simulator
+
+#include "memory_report.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace lsim {
+
+void MemoryReport::add(const char *category, size_t bytes, size_t count) {
+    auto found = std::find_if(m_entries.begin(), m_entries.end(), [=](const auto &entry) {
+        return entry.m_category == category;
+    });
+
+    if (found != m_entries.end()) {
+        found->m_bytes += bytes;
+        found->m_count += count;
+    } else {
+        m_entries.push_back({category, bytes, count});
+    }
+}
+
+size_t MemoryReport::bytes(const char *category) const {
+    auto len = std::strlen(category);
+    size_t result = 0;
+
+    for (const auto &entry : m_entries) {
+        if (entry.m_category.compare(0, len, category) == 0 &&
+            (len == 0 || entry.m_category.size() == len || entry.m_category[len] == '/')) {
+            result += entry.m_bytes;
+        }
+    }
+
+    return result;
+}
+
+std::string MemoryReport::format() const {
+    std::string result;
+    char line[256];
+
+    for (const auto &entry : m_entries) {
+        std::snprintf(line, sizeof(line), "%-40s %14zu bytes %12zu objects\n",
+                      entry.m_category.c_str(), entry.m_bytes, entry.m_count);
+        result += line;
+    }
+    std::snprintf(line, sizeof(line), "%-40s %14zu bytes\n", "total", total());
+    result += line;
+
+    return result;
+}
+
+} // namespace lsim
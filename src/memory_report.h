@@ -0,0 +1,79 @@
+// memory_report.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// memory footprint accounting: estimate the memory used by the data structures of the model and the simulator
+
+#ifndef LSIM_MEMORY_REPORT_H
+#define LSIM_MEMORY_REPORT_H
+
+#include <cstddef>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lsim {
+
+// categories are hierarchical, separated by '/' (e.g. "simulator/nodes/dependents"). The estimates count the size of
+//  the objects and the memory their containers requested, not the overhead of the allocator.
+class MemoryReport {
+public:
+    struct Entry {
+        std::string     m_category;
+        size_t          m_bytes;
+        size_t          m_count;        // number of objects accounted for (informative only)
+    };
+    using entry_container_t = std::vector<Entry>;
+
+public:
+    void add(const char *category, size_t bytes, size_t count = 0);
+    void clear() {m_entries.clear();}
+
+    // bytes: total of the category and its sub-categories ("" for everything)
+    size_t bytes(const char *category) const;
+    size_t total() const {return bytes("");}
+    const entry_container_t &entries() const {return m_entries;}
+
+    // format: one line per category, in the order they were first added
+    std::string format() const;
+
+private:
+    entry_container_t   m_entries;
+};
+
+// budget for the simulation of a 2-input gate: simulator and circuit instance (model excluded), checked by the unit
+//  tests on a circuit of a million gates. It measures about 380 bytes: the component object (112, gates have no
+//  parameters), the node metadata and its vectors (124), the pin and node value tables (56), the warm reset image (62),
+//  scheduling (18) and the component lookup of the circuit (8). Getting near 64 bytes would take another layout of
+//  components and nodes (e.g. gates as plain arrays instead of objects), not a trimmed version of this one.
+constexpr size_t SIM_MEMORY_BUDGET_PER_GATE = 400;
+
+// heap memory owned by a container (the container object itself is part of its owner)
+constexpr size_t MEMORY_TREE_NODE_OVERHEAD = 4 * sizeof(void *);      // color, parent, left and right child
+constexpr size_t MEMORY_HASH_NODE_OVERHEAD = 2 * sizeof(void *);      // next pointer and cached hash
+
+template <typename T>
+size_t heap_bytes(const std::vector<T> &container) {
+    return container.capacity() * sizeof(T);
+}
+
+template <typename T>
+size_t heap_bytes(const std::set<T> &container) {
+    return container.size() * (sizeof(T) + MEMORY_TREE_NODE_OVERHEAD);
+}
+
+template <typename K, typename V>
+size_t heap_bytes(const std::unordered_map<K, V> &container) {
+    return container.bucket_count() * sizeof(void *) +
+           container.size() * (sizeof(typename std::unordered_map<K, V>::value_type) + MEMORY_HASH_NODE_OVERHEAD);
+}
+
+inline size_t heap_bytes(const std::string &str) {
+    // short strings are stored inside the object
+    auto obj = reinterpret_cast<const char *>(&str);
+    bool local = str.data() >= obj && str.data() < obj + sizeof(str);
+    return local ? 0 : str.capacity() + 1;
+}
+
+} // namespace lsim
+
+#endif // LSIM_MEMORY_REPORT_H
@@ -4,8 +4,10 @@
 
 #include "model_circuit.h"
 #include "sim_circuit.h"
+#include "sim_circuit_template.h"
 #include "lsim_context.h"
 #include "simulator.h"
+#include "memory_report.h"
 
 #include <cassert>
 #include "std_helper.h"
@@ -28,6 +30,14 @@ std::string unique_subcircuit_name(const std::string &circuit_name, uint32_t com
     return result;
 }
 
+inline void hash_combine(uint64_t *hash, uint64_t value) {
+    // FNV-1a over the bytes of the value
+    for (int b = 0; b < 8; ++b) {
+        *hash ^= (value >> (b * 8)) & 0xff;
+        *hash *= 0x100000001b3ull;
+    }
+}
+
 } // unnamed namespace
 
 namespace lsim {
@@ -40,6 +50,8 @@ ModelCircuit::ModelCircuit(const char *name, LSimContext *context, ModelCircuitL
         m_wire_id(0) {
 }
 
+ModelCircuit::~ModelCircuit() = default;
+
 void ModelCircuit::change_name(const char *name) {
     assert(name);
     m_name = name;
@@ -80,6 +92,15 @@ ModelComponent *ModelCircuit::create_component(ComponentType type, uint32_t inpu
         result->add_property(make_property("high_duration", default_cycle));
         result->add_property(make_property("initial_output", VALUE_FALSE));
     } else if (type == COMPONENT_7_SEGMENT_LED) {
+    } else if (type == COMPONENT_ROM || type == COMPONENT_RAM) {
+        result->add_property(make_property("data", ""));
+        result->add_property(make_property("initial_output", VALUE_UNDEFINED));
+    } else if (type == COMPONENT_REGISTER) {
+        result->add_property(make_property("trigger", CLOCK_TRIGGER_NAMES[TRIGGER_RISING_EDGE]));
+    } else if (type == COMPONENT_COUNTER) {
+        result->add_property(make_property("trigger", CLOCK_TRIGGER_NAMES[TRIGGER_RISING_EDGE]));
+        result->add_property(make_property("on_goal", COUNTER_ON_GOAL_NAMES[ON_GOAL_WRAP]));
+        result->add_property(make_property("max_value", static_cast<int64_t>(0)));
     } else {
         result->add_property(make_property("initial_output", VALUE_UNDEFINED));
     }
@@ -183,6 +204,55 @@ ModelWire *ModelCircuit::connect(pin_id_t pin_a, pin_id_t pin_b) {
     return wire;
 }
 
+size_t ModelCircuit::connect_pins(const pin_id_pair_container_t &connections) {
+    // group the pins into nets (union-find) and create one wire per net instead of one per connection
+    std::unordered_map<pin_id_t, size_t> pin_index;
+    std::vector<pin_id_t> pins;
+    std::vector<size_t> parent;
+    pin_index.reserve(connections.size() * 2);
+    pins.reserve(connections.size() * 2);
+    parent.reserve(connections.size() * 2);
+
+    auto index_of = [&](pin_id_t pin) {
+        auto found = pin_index.emplace(pin, pins.size());
+        if (found.second) {
+            pins.push_back(pin);
+            parent.push_back(parent.size());
+        }
+        return found.first->second;
+    };
+
+    auto find_root = [&](size_t idx) {
+        while (parent[idx] != idx) {
+            parent[idx] = parent[parent[idx]];
+            idx = parent[idx];
+        }
+        return idx;
+    };
+
+    for (const auto &connection : connections) {
+        auto root_a = find_root(index_of(connection.first));
+        auto root_b = find_root(index_of(connection.second));
+        parent[std::max(root_a, root_b)] = std::min(root_a, root_b);
+    }
+
+    // pins are numbered in order of appearance: the root of a net is its first pin
+    std::vector<ModelWire *> net_wires(pins.size(), nullptr);
+    size_t num_wires = 0;
+    m_wires.reserve(m_wires.size() + pins.size() / 2);
+
+    for (size_t idx = 0; idx < pins.size(); ++idx) {
+        auto root = find_root(idx);
+        if (net_wires[root] == nullptr) {
+            net_wires[root] = create_wire();
+            ++num_wires;
+        }
+        net_wires[root]->add_pin(pins[idx]);
+    }
+
+    return num_wires;
+}
+
 void ModelCircuit::disconnect_pin(pin_id_t pin) {
     std::vector<uint32_t> empty_wires;
 
@@ -381,6 +451,83 @@ ModelComponent *ModelCircuit::add_7_segment_led() {
     return create_component(COMPONENT_7_SEGMENT_LED, 8, 0, 1);
 }
 
+ModelComponent *ModelCircuit::add_rom(uint32_t address_bits, uint32_t data_bits) {
+    // the simulator allocates a word for every address
+    assert(address_bits > 0 && address_bits <= 24);
+    assert(data_bits > 0 && data_bits <= 32);
+    return create_component(COMPONENT_ROM, address_bits, data_bits, 2);
+}
+
+ModelComponent *ModelCircuit::add_ram(uint32_t address_bits, uint32_t data_bits) {
+    assert(address_bits > 0 && address_bits <= 24);
+    assert(data_bits > 0 && data_bits <= 32);
+    // inputs: address lines followed by the data lines, controls: chip enable, write enable, output enable
+    return create_component(COMPONENT_RAM, address_bits + data_bits, data_bits, 3);
+}
+
+ModelComponent *ModelCircuit::add_register(uint32_t data_bits) {
+    assert(data_bits > 0 && data_bits <= 32);
+    // controls: clock, enable, clear
+    return create_component(COMPONENT_REGISTER, data_bits, data_bits, 3);
+}
+
+ModelComponent *ModelCircuit::add_counter(uint32_t data_bits, uint32_t max_value) {
+    assert(data_bits > 0 && data_bits <= 32);
+    // inputs: load value, outputs: count followed by carry, controls: clock, load, count, clear
+    auto result = create_component(COMPONENT_COUNTER, data_bits, data_bits + 1, 4);
+    result->property("max_value")->value(static_cast<int64_t>(max_value));
+    return result;
+}
+
+std::vector<ModelComponent *> ModelCircuit::add_components(const model_component_spec_container_t &specs) {
+    std::vector<ModelComponent *> result;
+    result.reserve(specs.size());
+    m_components.reserve(m_components.size() + specs.size());
+
+    for (const auto &spec : specs) {
+        switch (spec.m_type) {
+            case COMPONENT_CONSTANT:
+                result.push_back(add_constant(spec.m_value));
+                break;
+            case COMPONENT_PULL_RESISTOR:
+                result.push_back(add_pull_resistor(spec.m_value));
+                break;
+            case COMPONENT_BUFFER:
+                result.push_back(add_buffer(spec.m_size));
+                break;
+            case COMPONENT_TRISTATE_BUFFER:
+                result.push_back(add_tristate_buffer(spec.m_size));
+                break;
+            case COMPONENT_AND_GATE:
+                result.push_back(add_and_gate(spec.m_size));
+                break;
+            case COMPONENT_OR_GATE:
+                result.push_back(add_or_gate(spec.m_size));
+                break;
+            case COMPONENT_NOT_GATE:
+                result.push_back(add_not_gate());
+                break;
+            case COMPONENT_NAND_GATE:
+                result.push_back(add_nand_gate(spec.m_size));
+                break;
+            case COMPONENT_NOR_GATE:
+                result.push_back(add_nor_gate(spec.m_size));
+                break;
+            case COMPONENT_XOR_GATE:
+                result.push_back(add_xor_gate());
+                break;
+            case COMPONENT_XNOR_GATE:
+                result.push_back(add_xnor_gate());
+                break;
+            default:
+                result.push_back(nullptr);
+                break;
+        }
+    }
+
+    return result;
+}
+
 ModelComponent *ModelCircuit::add_sub_circuit(const char *circuit, uint32_t num_inputs, uint32_t num_outputs) {
     return create_component(circuit, num_inputs, num_outputs);
 }
@@ -398,41 +545,107 @@ ModelComponent *ModelCircuit::add_text(const char *text) {
 }
 
 std::unique_ptr<SimCircuit> ModelCircuit::instantiate(Simulator *sim, bool top_level) {
-    auto instance = std::make_unique<SimCircuit>(sim, this);
-    std::unordered_map<std::string, ModelComponent *> via_lut;
-
-    // helper function to connect all pins of two vias
-    auto connect_vias = [&instance](ModelComponent *via_a, ModelComponent *via_b) {
-        assert(via_a->num_inputs() == via_b->num_inputs());
-        for (uint32_t i = 0u; i < via_a->num_inputs(); ++i) {
-            instance->connect_pins(via_a->input_pin_id(i), via_b->input_pin_id(i));
+    // nested circuits that are used multiple times are copied from the template instead of rebuilt
+    auto instance = sim_template()->instantiate(sim);
+
+    if (top_level) {
+        for (auto id : component_ids_of_type(COMPONENT_CONNECTOR_IN)) {
+            instance->component_by_id(id)->enable_user_values();
         }
-    };
 
-    for (auto &comp_it : m_components) {
-        auto comp = comp_it.second.get();
-        auto sim_comp = instance->add_component(comp);
+        // remember the state of the circuit to allow incremental updates of the simulation
+        if (sim->patching_enabled()) {
+            instance->capture_model_state();
+        }
+    }
+
+    return instance;
+}
+
+const SimCircuitTemplate *ModelCircuit::sim_template() {
+    fingerprint_lut_t fingerprints;
+    return sim_template(fingerprints);
+}
+
+const SimCircuitTemplate *ModelCircuit::sim_template(fingerprint_lut_t &fingerprints) {
+    auto fingerprint = layout_fingerprint(fingerprints);
+
+    if (m_sim_template == nullptr || fingerprint != m_sim_template_fingerprint) {
+        m_sim_template = SimCircuitTemplate::build(this, fingerprints);
+        m_sim_template_fingerprint = fingerprint;
+    }
+
+    return m_sim_template.get();
+}
 
+uint64_t ModelCircuit::layout_fingerprint(fingerprint_lut_t &fingerprints) {
+    auto found = fingerprints.find(this);
+    if (found != fingerprints.end()) {
+        return found->second;
+    }
+
+    // components and wires are combined independent of their order in the lookup tables
+    uint64_t result = 0;
+
+    for (const auto &pair : m_components) {
+        auto comp = pair.second.get();
+        uint64_t hash = 0xcbf29ce484222325ull;
+        hash_combine(&hash, reinterpret_cast<uintptr_t>(comp));
+        hash_combine(&hash, comp->id());
+        hash_combine(&hash, comp->type());
+        hash_combine(&hash, comp->num_inputs());
+        hash_combine(&hash, comp->num_outputs());
+        hash_combine(&hash, comp->num_controls());
+        if (comp->nested_circuit() != nullptr) {
+            hash_combine(&hash, reinterpret_cast<uintptr_t>(comp->nested_circuit()));
+            hash_combine(&hash, comp->nested_circuit()->layout_fingerprint(fingerprints));
+        }
         if (comp->type() == COMPONENT_VIA) {
-            auto name = comp->property_value("name", "via");
-            auto found = via_lut.find(name);
-            if (found != via_lut.end()) {
-                connect_vias(comp, found->second);
-            } else {
-                via_lut[name] = comp;
-            }
+            hash_combine(&hash, std::hash<std::string>()(comp->property_value("name", "via")));
         }
+        result += hash;
+    }
 
-        if (top_level && comp->type() == COMPONENT_CONNECTOR_IN) {
-            sim_comp->enable_user_values();
+    for (const auto &pair : m_wires) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        hash_combine(&hash, reinterpret_cast<uintptr_t>(pair.second.get()));
+        for (auto pin : pair.second->pins()) {
+            hash_combine(&hash, pin);
         }
+        result += hash;
     }
 
-    for (auto &wire : m_wires) {
-        instance->add_wire(wire.second.get());
+    hash_combine(&result, m_components.size());
+    hash_combine(&result, m_wires.size());
+    for (auto input : {true, false}) {
+        auto num_ports = input ? num_input_ports() : num_output_ports();
+        for (auto idx = 0u; idx < num_ports; ++idx) {
+            hash_combine(&result, port_by_index(input, idx));
+        }
     }
 
-    return std::move(instance);
+    fingerprints[this] = result;
+    return result;
+}
+
+void ModelCircuit::memory_usage(MemoryReport *report) const {
+    size_t ports = heap_bytes(m_ports_lut) + heap_bytes(m_input_ports) + heap_bytes(m_output_ports);
+    for (const auto &port : m_input_ports) {
+        ports += heap_bytes(port);
+    }
+    for (const auto &port : m_output_ports) {
+        ports += heap_bytes(port);
+    }
+
+    report->add("model/circuits",
+                sizeof(ModelCircuit) + heap_bytes(m_name) + heap_bytes(m_components) + heap_bytes(m_wires) + ports, 1);
+
+    for (const auto &entry : m_components) {
+        entry.second->memory_usage(report);
+    }
+    for (const auto &entry : m_wires) {
+        entry.second->memory_usage(report);
+    }
 }
 
-} // namespace lsim
\ No newline at end of file
+} // namespace lsim
@@ -15,6 +15,17 @@
 
 namespace lsim {
 
+class SimCircuitTemplate;
+
+// description of a component for bulk construction (see ModelCircuit::add_components)
+struct ModelComponentSpec {
+    ComponentType   m_type;
+    uint32_t        m_size;     // number of inputs (gates) or data bits (buffers)
+    Value           m_value;    // value of a constant, level of a pull resistor
+};
+
+using model_component_spec_container_t = std::vector<ModelComponentSpec>;
+
 class ModelCircuit {
 public:
     using uptr_t = std::unique_ptr<ModelCircuit>;
@@ -22,6 +33,7 @@ public:
 public:
     ModelCircuit(const char *name, class LSimContext *context, class ModelCircuitLibrary *ref_lib);
     ModelCircuit(const ModelCircuit &) = delete;
+    ~ModelCircuit();
 
     class LSimContext *context() const {return m_context;}
     class ModelCircuitLibrary *lib() const {return m_lib;}
@@ -37,6 +49,7 @@ protected:
     ModelComponent *create_component(const char *circuit_name, uint32_t input_pins, uint32_t output_pins);
 public:
     ModelComponent *component_by_id(uint32_t id);
+    size_t num_components() const {return m_components.size();}
     std::vector<uint32_t> component_ids() const;
     std::vector<uint32_t> component_ids_of_type(ComponentType type) const;
     void disconnect_component(uint32_t id);
@@ -47,6 +60,7 @@ public:
     // connections
     ModelWire *create_wire();
     ModelWire *connect(pin_id_t pin_a, pin_id_t pin_b);
+    size_t connect_pins(const pin_id_pair_container_t &connections);
     void disconnect_pin(pin_id_t pin);
     std::vector<uint32_t> wire_ids() const;
     ModelWire *wire_by_id(uint32_t id) const;
@@ -79,13 +93,31 @@ public:
     ModelComponent *add_via(const char *name, uint32_t data_bits);
     ModelComponent *add_oscillator(uint32_t low_duration, uint32_t high_duration);
     ModelComponent *add_7_segment_led();
+    ModelComponent *add_rom(uint32_t address_bits, uint32_t data_bits);
+    ModelComponent *add_ram(uint32_t address_bits, uint32_t data_bits);
+    ModelComponent *add_register(uint32_t data_bits);
+    ModelComponent *add_counter(uint32_t data_bits, uint32_t max_value);
     ModelComponent *add_sub_circuit(const char *circuit, uint32_t num_inputs, uint32_t num_outputs);
     ModelComponent *add_sub_circuit(const char *circuit);
     ModelComponent *add_text(const char *text);
 
+    // bulk creation of basic components (constants, pull resistors, buffers and gates)
+    //  - returns the components in the order of the specs, nullptr for an unsupported type
+    std::vector<ModelComponent *> add_components(const model_component_spec_container_t &specs);
+
     // instantiate into a simulator
     std::unique_ptr<class SimCircuit> instantiate(class Simulator *sim, bool top_level = true);
 
+    // simulation template: the precompiled layout used by instantiate. It is kept with the circuit and only rebuilt
+    //  when the layout of the circuit or of one of its nested circuits changed since (detected by a fingerprint of the
+    //  components, wires and ports, so changes made directly to a wire or component are noticed as well).
+    using fingerprint_lut_t = std::unordered_map<const ModelCircuit *, uint64_t>;
+    const SimCircuitTemplate *sim_template();
+    const SimCircuitTemplate *sim_template(fingerprint_lut_t &fingerprints);
+
+    // memory footprint: the circuit, its components and its wires
+    void memory_usage(MemoryReport *report) const;
+
 private:
     using component_lut_t = std::unordered_map<uint32_t, ModelComponent::uptr_t>;
     using port_container_t = std::vector<std::string>;
@@ -106,6 +138,11 @@ private:
     port_container_t m_input_ports;
     port_container_t m_output_ports;
 
+    std::unique_ptr<SimCircuitTemplate> m_sim_template;
+    uint64_t                            m_sim_template_fingerprint = 0;
+
+private:
+    uint64_t layout_fingerprint(fingerprint_lut_t &fingerprints);
 };
 
 } // namespace lsim
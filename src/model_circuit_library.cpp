@@ -3,6 +3,7 @@
 // a collection of circuits
 
 #include "model_circuit_library.h"
+#include "memory_report.h"
 #include "std_helper.h"
 #include <cassert>
 
@@ -17,6 +18,7 @@ ModelCircuit *ModelCircuitLibrary::create_circuit(const char *name, LSimContext
     assert(name);
 
     m_circuits.push_back(std::make_unique<ModelCircuit>(name, context, this));
+    m_lazy_names.emplace_back();
     auto circuit = m_circuits.back().get();
     m_circuit_lut[name] = circuit;
 
@@ -25,8 +27,16 @@ ModelCircuit *ModelCircuitLibrary::create_circuit(const char *name, LSimContext
 
 void ModelCircuitLibrary::delete_circuit(ModelCircuit *circuit) {
     assert (std::find_if(m_circuits.begin(), m_circuits.end(), [=](auto &o) {return o.get() == circuit;}) != m_circuits.end());
+	auto idx = circuit_idx(circuit);
 	remove_value(m_circuit_lut, circuit);
 	remove_owner(m_circuits, circuit);
+	m_lazy_names.erase(m_lazy_names.begin() + idx);
+
+	for (auto &lazy : m_lazy_lut) {
+		if (lazy.second > idx) {
+			--lazy.second;
+		}
+	}
 }
 
 void ModelCircuitLibrary::rename_circuit(ModelCircuit *circuit, const char *name) {
@@ -45,10 +55,24 @@ void ModelCircuitLibrary::swap_circuits(size_t idx_a, size_t idx_b) {
     assert(idx_b < m_circuits.size());
 
     std::swap(m_circuits[idx_a], m_circuits[idx_b]);
+    std::swap(m_lazy_names[idx_a], m_lazy_names[idx_b]);
+
+    for (auto &lazy : m_lazy_lut) {
+        if (lazy.second == idx_a) {
+            lazy.second = idx_b;
+        } else if (lazy.second == idx_b) {
+            lazy.second = idx_a;
+        }
+    }
 }
 
 ModelCircuit *ModelCircuitLibrary::circuit_by_idx(size_t idx) const {
     assert(idx < num_circuits());
+
+    if (!m_circuits[idx]) {
+        return load_circuit(idx, circuit_name(idx));
+    }
+
     return m_circuits[idx].get();
 }
 
@@ -60,9 +84,19 @@ ModelCircuit *ModelCircuitLibrary::circuit_by_name(const char *name) const {
         return res->second;
     }
 
+    auto lazy = m_lazy_lut.find(name);
+    if (lazy != m_lazy_lut.end()) {
+        return load_circuit(lazy->second, lazy->first);
+    }
+
     return nullptr;
 }
 
+bool ModelCircuitLibrary::has_circuit(const char *name) const {
+    assert(name);
+    return m_circuit_lut.count(name) > 0 || m_lazy_lut.count(name) > 0;
+}
+
 uint32_t ModelCircuitLibrary::circuit_idx(ModelCircuit *circuit) const {
     for (auto i = 0u; i < m_circuits.size(); ++i) {
         if (m_circuits[i].get() == circuit) {
@@ -73,9 +107,57 @@ uint32_t ModelCircuitLibrary::circuit_idx(ModelCircuit *circuit) const {
     return m_circuits.size();
 }
 
+std::string ModelCircuitLibrary::circuit_name(size_t idx) const {
+    assert(idx < num_circuits());
+
+    if (m_circuits[idx]) {
+        return m_circuits[idx]->name();
+    }
+
+    return m_lazy_names[idx];
+}
+
 void ModelCircuitLibrary::clear_circuits() {
     m_circuits.clear();
     m_circuit_lut.clear();
+    m_lazy_lut.clear();
+    m_lazy_names.clear();
+}
+
+void ModelCircuitLibrary::set_loader(ModelCircuitLoader::uptr_t loader) {
+    m_loader = std::move(loader);
+}
+
+void ModelCircuitLibrary::add_lazy_circuit(const char *name) {
+    assert(name);
+    assert(m_loader);
+
+    // reserve a slot to keep the order of the circuits in the library
+    m_lazy_lut[name] = m_circuits.size();
+    m_circuits.emplace_back(nullptr);
+    m_lazy_names.emplace_back(name);
+}
+
+bool ModelCircuitLibrary::is_circuit_loaded(size_t idx) const {
+    assert(idx < num_circuits());
+    return m_circuits[idx] != nullptr;
+}
+
+ModelCircuit *ModelCircuitLibrary::load_circuit(size_t idx, const std::string &name) const {
+    assert(m_loader);
+
+    // remove from the lookup table first: a circuit that (indirectly) nests itself shouldn't recurse forever
+    auto circuit_name = name;
+    m_lazy_lut.erase(circuit_name);
+
+    auto circuit = m_loader->load_circuit(const_cast<ModelCircuitLibrary *>(this), circuit_name.c_str());
+    if (!circuit) {
+        return nullptr;
+    }
+
+    m_circuits[idx] = std::move(circuit);
+    m_circuit_lut[circuit_name] = m_circuits[idx].get();
+    return m_circuits[idx].get();
 }
 
 void ModelCircuitLibrary::add_reference(const char *name) {
@@ -94,4 +176,12 @@ void ModelCircuitLibrary::clear_references() {
     m_references.clear();
 }
 
-} // namespace lsim
\ No newline at end of file
+void ModelCircuitLibrary::memory_usage(MemoryReport *report) const {
+    for (const auto &circuit : m_circuits) {
+        if (circuit) {
+            circuit->memory_usage(report);
+        }
+    }
+}
+
+} // namespace lsim
@@ -14,6 +14,20 @@
 namespace lsim {
 
 class LSimContext;
+class ModelCircuitLibrary;
+
+// interface to load circuits of a library on demand
+class ModelCircuitLoader {
+public:
+    using uptr_t = std::unique_ptr<ModelCircuitLoader>;
+
+public:
+    virtual ~ModelCircuitLoader() = default;
+    virtual ModelCircuit::uptr_t load_circuit(ModelCircuitLibrary *lib, const char *name) = 0;
+
+    // circuit_size: number of components and wires of a circuit that hasn't been loaded (without loading it)
+    virtual size_t circuit_size(const char *name) = 0;
+};
 
 class ModelCircuitLibrary {
 public:
@@ -39,25 +53,45 @@ public:
     size_t num_circuits() const {return m_circuits.size();}
     ModelCircuit *circuit_by_idx(size_t idx) const;
     ModelCircuit *circuit_by_name(const char *name) const;
+    bool has_circuit(const char *name) const;
     uint32_t circuit_idx(ModelCircuit *circuit) const;
+    std::string circuit_name(size_t idx) const;
     void clear_circuits();
 
+    // on-demand loading: circuits added with add_lazy_circuit are only loaded when first requested.
+    //  circuit_by_idx and circuit_by_name return nullptr for a circuit that fails to load.
+    void set_loader(ModelCircuitLoader::uptr_t loader);
+    ModelCircuitLoader *loader() const {return m_loader.get();}
+    void add_lazy_circuit(const char *name);
+    bool is_circuit_loaded(size_t idx) const;
+
     // references
     void add_reference(const char *name);
     void remove_reference(const char *name);
     void clear_references();
     const reference_container_t &references() const {return m_references;}
 
+    // memory footprint: the circuits that have been loaded
+    void memory_usage(MemoryReport *report) const;
+
 private:
     using circuit_container_t = std::vector<ModelCircuit::uptr_t>;
     using circuit_map_t = std::unordered_map<std::string, ModelCircuit *>;
+    using lazy_map_t = std::unordered_map<std::string, size_t>;
+
+private:
+    ModelCircuit *load_circuit(size_t idx, const std::string &name) const;
 
 private:
     std::string             m_name;
     std::string             m_path;
 
-    circuit_container_t     m_circuits;
-    circuit_map_t           m_circuit_lut;
+    // mutable: loading a circuit on demand doesn't change the observable contents of the library
+    mutable circuit_container_t     m_circuits;
+    mutable circuit_map_t           m_circuit_lut;
+    mutable lazy_map_t              m_lazy_lut;         // name -> index of circuits that haven't been loaded yet
+    std::vector<std::string>        m_lazy_names;       // index -> name of circuits added by add_lazy_circuit
+    ModelCircuitLoader::uptr_t      m_loader;
     std::string             m_main_circuit;
 
     reference_container_t   m_references;
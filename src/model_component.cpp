@@ -5,6 +5,7 @@
 #include "model_component.h"
 #include "model_circuit.h"
 #include "lsim_context.h"
+#include "memory_report.h"
 
 #include <cassert>
 
@@ -155,4 +156,14 @@ void ModelComponent::integrate_into_circuit(ModelCircuit *circuit, uint32_t id)
     m_id = id;
 }
 
-} // namespace lsim
\ No newline at end of file
+void ModelComponent::memory_usage(MemoryReport *report) const {
+    report->add("model/components", sizeof(ModelComponent) + heap_bytes(m_nested_name) + heap_bytes(m_port_lut), 1);
+
+    size_t properties = heap_bytes(m_properties);
+    for (const auto &entry : m_properties) {
+        properties += heap_bytes(entry.first) + entry.second->memory_bytes();
+    }
+    report->add("model/properties", properties, m_properties.size());
+}
+
+} // namespace lsim
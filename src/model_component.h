@@ -78,6 +78,9 @@ public:
     uptr_t copy() const;
     void integrate_into_circuit(ModelCircuit *circuit, uint32_t id);
 
+    // memory footprint: the component and its properties
+    void memory_usage(MemoryReport *report) const;
+
 private:
     ModelCircuit *m_circuit;
     uint32_t m_id;
@@ -3,6 +3,7 @@
 // Key/value pair to store extra information about specific components
 
 #include "model_property.h"
+#include "memory_report.h"
 
 #include <algorithm>
 
@@ -48,6 +49,15 @@ inline lsim::Value int_to_value(int64_t val) {
 
 namespace lsim {
 
+///////////////////////////////////////////////////////////////////////////////
+//
+// Property
+//
+
+size_t Property::key_heap_bytes() const {
+    return heap_bytes(m_key);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // StringProperty
@@ -62,6 +72,10 @@ Property::uptr_t StringProperty::clone() const {
     return make_property(key(), m_value.c_str());
 }
 
+size_t StringProperty::memory_bytes() const {
+    return sizeof(*this) + key_heap_bytes() + heap_bytes(m_value);
+}
+
 std::string StringProperty::value_as_string() const {
     return m_value;
 }
@@ -108,6 +122,10 @@ Property::uptr_t IntegerProperty::clone() const {
     return make_property(key(), m_value);
 }
 
+size_t IntegerProperty::memory_bytes() const {
+    return sizeof(*this) + key_heap_bytes();
+}
+
 std::string IntegerProperty::value_as_string() const {
     return std::to_string(m_value);
 }
@@ -154,6 +172,10 @@ Property::uptr_t BoolProperty::clone() const {
     return make_property(key(), m_value);
 }
 
+size_t BoolProperty::memory_bytes() const {
+    return sizeof(*this) + key_heap_bytes();
+}
+
 std::string BoolProperty::value_as_string() const {
     return (m_value) ? "true" : "false";
 }
@@ -200,6 +222,10 @@ Property::uptr_t ValueProperty::clone() const {
     return make_property(key(), m_value);
 }
 
+size_t ValueProperty::memory_bytes() const {
+    return sizeof(*this) + key_heap_bytes();
+}
+
 std::string ValueProperty::value_as_string() const {
     return VALUE_STRINGS[m_value];
 }
@@ -20,6 +20,9 @@ public:
     virtual const char *key() const {return m_key.c_str();};
     virtual uptr_t clone() const = 0;
 
+    // memory footprint: size of the property object and the strings it owns
+    virtual size_t memory_bytes() const = 0;
+
     // value accessors
     virtual std::string value_as_string() const = 0;
     virtual int64_t value_as_integer() const = 0;
@@ -32,6 +35,9 @@ public:
     virtual void value(bool val) = 0;
     virtual void value(Value val) = 0;
 
+protected:
+    size_t key_heap_bytes() const;
+
 private:
     std::string m_key;
 };
@@ -40,6 +46,7 @@ class StringProperty : public Property {
 public:
     StringProperty(const char *key, const char *value);
     uptr_t clone() const override;
+    size_t memory_bytes() const override;
 
     // value accessors
     std::string value_as_string() const override;
@@ -61,6 +68,7 @@ class IntegerProperty : public Property {
 public:
     IntegerProperty(const char *key, int64_t value);
     uptr_t clone() const override;
+    size_t memory_bytes() const override;
 
     // value accessors
     std::string value_as_string() const override;
@@ -82,6 +90,7 @@ class BoolProperty : public Property {
 public:
     BoolProperty(const char *key, bool value);
     uptr_t clone() const override;
+    size_t memory_bytes() const override;
 
     // value accessors
     std::string value_as_string() const override;
@@ -103,6 +112,7 @@ class ValueProperty : public Property {
 public:
     ValueProperty(const char *key, Value value);
     uptr_t clone() const override;
+    size_t memory_bytes() const override;
 
     // value accessors
     std::string value_as_string() const override;
@@ -4,6 +4,7 @@
 
 #include "model_wire.h"
 #include "model_circuit.h"
+#include "memory_report.h"
 
 #include <cassert>
 #include "std_helper.h"
@@ -271,6 +272,16 @@ bool ModelWire::in_one_piece() const {
     return false;
 }
 
+void ModelWire::memory_usage(MemoryReport *report) const {
+    report->add("model/wires", sizeof(ModelWire) + heap_bytes(m_pins), 1);
+
+    size_t geometry = heap_bytes(m_junctions) + heap_bytes(m_segments) + m_segments.size() * sizeof(ModelWireSegment);
+    for (const auto &junction : m_junctions) {
+        geometry += sizeof(ModelWireJunction) + junction->num_segments() * sizeof(ModelWireSegment *);
+    }
+    report->add("model/wire_geometry", geometry, m_junctions.size() + m_segments.size());
+}
+
 void ModelWire::remove_junction(ModelWireJunction *junction) {
     assert(junction);
 	remove_owner(m_junctions, junction);
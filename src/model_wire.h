@@ -68,6 +68,7 @@ public:
     void add_pin(pin_id_t pin);
     size_t num_pins() const {return m_pins.size();}
     pin_id_t pin(size_t index) const;
+    const pin_id_container_t &pins() const {return m_pins;}
     void remove_component_pins(uint32_t component_id);
     void remove_pin(pin_id_t pin);
     void clear_pins();
@@ -99,6 +100,9 @@ public:
     segment_set_t reachable_segments(ModelWireSegment *from_segment) const;
     bool in_one_piece() const;
 
+    // memory footprint: the wire, its pins and its geometry (junctions and segments)
+    void memory_usage(MemoryReport *report) const;
+
 private:
     void remove_junction(ModelWireJunction *junction);
     void remove_segment_from_junction(ModelWireJunction *junction, ModelWireSegment *segment);
@@ -7,13 +7,41 @@
 #include "lsim_context.h"
 #include "model_circuit.h"
 #include "sim_circuit.h"
+#include "sim_component.h"
+#include "sim_history.h"
+#include "sim_task.h"
+#include "sim_worker.h"
 #include "serialize.h"
+#include "rom_image.h"
 
 namespace py = pybind11;
 using namespace lsim;
 
 PYBIND11_MODULE(lsimpy, m) {
     m.def("pin_id_invalid", [](pin_id_t pin) -> bool {return pin == PIN_ID_INVALID;});
+    m.def("rom_set_contents", &rom_set_contents);
+    m.def("rom_contents", &rom_contents);
+    m.def("rom_image_from_binary",
+            [](py::bytes data, uint32_t data_bits) -> rom_data_t {
+                std::string raw = data;
+                return rom_image_from_binary(reinterpret_cast<const uint8_t *>(raw.data()), raw.size(), data_bits);
+            });
+    m.def("rom_create_circuit",
+            [](LSimContext *context, const char *name, uint32_t data_bits, const rom_data_t &data) -> ModelCircuit * {
+                return rom_create_circuit(context, context->user_library(), name, data_bits, data);
+            }, py::return_value_policy::reference);
+
+    m.attr("COMPONENT_CONSTANT") = COMPONENT_CONSTANT;
+    m.attr("COMPONENT_PULL_RESISTOR") = COMPONENT_PULL_RESISTOR;
+    m.attr("COMPONENT_BUFFER") = COMPONENT_BUFFER;
+    m.attr("COMPONENT_TRISTATE_BUFFER") = COMPONENT_TRISTATE_BUFFER;
+    m.attr("COMPONENT_AND_GATE") = COMPONENT_AND_GATE;
+    m.attr("COMPONENT_OR_GATE") = COMPONENT_OR_GATE;
+    m.attr("COMPONENT_NOT_GATE") = COMPONENT_NOT_GATE;
+    m.attr("COMPONENT_NAND_GATE") = COMPONENT_NAND_GATE;
+    m.attr("COMPONENT_NOR_GATE") = COMPONENT_NOR_GATE;
+    m.attr("COMPONENT_XOR_GATE") = COMPONENT_XOR_GATE;
+    m.attr("COMPONENT_XNOR_GATE") = COMPONENT_XNOR_GATE;
 
     py::enum_<Value>(m, "Value", py::arithmetic())
         .value("ValueFalse", lsim::Value::VALUE_FALSE)
@@ -71,12 +99,27 @@ PYBIND11_MODULE(lsimpy, m) {
         .def("add_nor_gate", &ModelCircuit::add_nor_gate, py::return_value_policy::reference)
         .def("add_xor_gate", &ModelCircuit::add_xor_gate, py::return_value_policy::reference)
         .def("add_xnor_gate", &ModelCircuit::add_xnor_gate, py::return_value_policy::reference)
+        .def("add_rom", &ModelCircuit::add_rom, py::return_value_policy::reference)
+        .def("add_ram", &ModelCircuit::add_ram, py::return_value_policy::reference)
+        .def("add_register", &ModelCircuit::add_register, py::return_value_policy::reference)
+        .def("add_counter", &ModelCircuit::add_counter, py::return_value_policy::reference)
         .def("add_sub_circuit", (ModelComponent *(ModelCircuit::*)(const char *))&ModelCircuit::add_sub_circuit, py::return_value_policy::reference)
         .def("create_wire", &ModelCircuit::create_wire, py::return_value_policy::reference)
         .def("connect", &ModelCircuit::connect, py::return_value_policy::reference)
+        .def("connect_pins", &ModelCircuit::connect_pins)
+        .def("add_components",
+                [](ModelCircuit *circuit, const std::vector<std::tuple<ComponentType, uint32_t, Value>> &specs) {
+                    model_component_spec_container_t model_specs;
+                    model_specs.reserve(specs.size());
+                    for (const auto &spec : specs) {
+                        model_specs.push_back({std::get<0>(spec), std::get<1>(spec), std::get<2>(spec)});
+                    }
+                    return circuit->add_components(model_specs);
+                }, py::return_value_policy::reference)
         .def("remove_wire", &ModelCircuit::remove_wire)
         .def("port_by_name", &ModelCircuit::port_by_name)
-        .def("instantiate", &ModelCircuit::instantiate, py::arg("sim"), py::arg("top_level") = true)
+        .def("instantiate", &ModelCircuit::instantiate, py::arg("sim"), py::arg("top_level") = true,
+             py::keep_alive<0, 2>())
     ;
 
     py::class_<Simulator>(m, "Simulator")
@@ -84,6 +127,116 @@ PYBIND11_MODULE(lsimpy, m) {
         .def("init", &Simulator::init)
         .def("step", &Simulator::step)
         .def("run_until_stable", &Simulator::run_until_stable)
+        .def("capture_reset_state", &Simulator::capture_reset_state)
+        .def("reset", &Simulator::reset)
+        .def("save_checkpoint", &Simulator::save_checkpoint)
+        .def("load_checkpoint", &Simulator::load_checkpoint)
+        .def("current_time", &Simulator::current_time)
+        .def("enable_patching", [](Simulator &sim) {
+            if (sim.num_pins() > 0 && !sim.patching_enabled()) {
+                throw py::value_error("enable patching before instantiating a circuit");
+            }
+            sim.enable_patching();
+        })
+        ;
+
+    py::class_<SimHistory>(m, "SimHistory")
+        .def(py::init<Simulator *, size_t>(), py::arg("sim"), py::arg("memory_budget") = SimHistory::DEFAULT_MEMORY_BUDGET,
+             py::keep_alive<1, 2>())
+        .def("restart", &SimHistory::restart)
+        .def("step", &SimHistory::step)
+        .def("run", &SimHistory::run)
+        .def("step_back", &SimHistory::step_back, py::arg("num_steps") = 1)
+        .def("goto_time", &SimHistory::goto_time)
+        .def("first_time", &SimHistory::first_time)
+        .def("last_time", &SimHistory::last_time)
+        .def("snapshot_interval", &SimHistory::snapshot_interval)
+        .def("memory_used", &SimHistory::memory_used)
+        ;
+
+    py::enum_<SimulationTask::StopReason>(m, "StopReason")
+        .value("StopNone", SimulationTask::STOP_NONE)
+        .value("StopCycles", SimulationTask::STOP_CYCLES)
+        .value("StopPin", SimulationTask::STOP_PIN)
+        .value("StopStable", SimulationTask::STOP_STABLE)
+        .value("StopCancelled", SimulationTask::STOP_CANCELLED)
+        .export_values()
+    ;
+
+    // snapshots can be read at any time, also while a task is running the simulation
+    auto snapshot_read_pin = [](SimSnapshot *snapshot, SimCircuit *circuit, pin_id_t pin_id) -> Value {
+        if (snapshot->layout_version() != circuit->sim()->layout_version()) {
+            throw py::value_error("the snapshot was taken before the simulator was renumbered");
+        }
+        auto pin = pin_id != PIN_ID_INVALID ? circuit->pin_from_pin_id(pin_id) : PIN_UNDEFINED;
+        if (pin == PIN_UNDEFINED || pin >= snapshot->num_pins()) {
+            throw py::value_error("invalid pin");
+        }
+        return snapshot->read_pin(pin);
+    };
+
+    py::class_<SimSnapshot, std::shared_ptr<SimSnapshot>>(m, "SimSnapshot")
+        .def("time", &SimSnapshot::time)
+        .def("read_pin", snapshot_read_pin)
+        .def("read_port",
+                [=](SimSnapshot *snapshot, SimCircuit *circuit, const char *port) -> Value {
+                    auto pin_id = circuit->description()->port_by_name(port);
+                    if (pin_id == PIN_ID_INVALID) {
+                        throw py::value_error(std::string("unknown port ") + port);
+                    }
+                    return snapshot_read_pin(snapshot, circuit, pin_id);
+                })
+        ;
+
+    // the simulation runs without the GIL: other Python threads (and an asyncio event loop) keep running.
+    //  Don't use the simulator or its circuits while the task runs, read the snapshots instead. The task keeps the
+    //  circuit alive, the circuit its simulator and the simulator the context that owns it.
+    py::class_<SimulationTask>(m, "SimulationTask")
+        .def(py::init([](SimCircuit *circuit, uint64_t cycles, const char *until_port, Value until_value, size_t until_stable) {
+                    SimulationTask::Options options;
+                    options.m_cycles = cycles;
+                    options.m_until_value = until_value;
+                    options.m_until_stable = until_stable;
+
+                    if (until_port != nullptr) {
+                        auto pin_id = circuit->description()->port_by_name(until_port);
+                        if (pin_id == PIN_ID_INVALID) {
+                            throw py::value_error(std::string("unknown port ") + until_port);
+                        }
+                        options.m_until_pin = circuit->pin_from_pin_id(pin_id);
+                    }
+
+                    if (cycles == 0 && until_port == nullptr && until_stable == 0) {
+                        throw py::value_error("a simulation task requires cycles, until_port or until_stable");
+                    }
+
+                    return std::make_unique<SimulationTask>(circuit->sim(), options);
+                }),
+                py::arg("circuit"), py::arg("cycles") = 0, py::arg("until_port") = py::none(),
+                py::arg("until_value") = VALUE_TRUE, py::arg("until_stable") = 0,
+                py::keep_alive<1, 2>())
+        .def("done", &SimulationTask::done)
+        .def("reason", &SimulationTask::reason)
+        .def("cycles", &SimulationTask::cycles)
+        .def("cancel", &SimulationTask::cancel)
+        .def("snapshot", &SimulationTask::snapshot)
+        .def("wait",
+                [](SimulationTask *task, py::object timeout) -> bool {
+                    auto seconds = timeout.is_none() ? -1.0 : timeout.cast<double>();
+                    py::gil_scoped_release release;
+                    return task->wait(seconds);
+                }, py::arg("timeout") = py::none())
+        .def("result",
+                [](SimulationTask *task) -> SimulationTask::StopReason {
+                    task->wait();
+                    return task->reason();
+                }, py::call_guard<py::gil_scoped_release>())
+        .def("__await__",
+                [](py::object task) {
+                    // wait on a thread of the default executor, the event loop isn't blocked
+                    auto loop = py::module::import("asyncio").attr("get_running_loop")();
+                    return loop.attr("run_in_executor")(py::none(), task.attr("result")).attr("__await__")();
+                })
         ;
 
     py::class_<ModelCircuitLibrary>(m, "ModelCircuitLibrary")
@@ -98,7 +251,7 @@ PYBIND11_MODULE(lsimpy, m) {
 
     py::class_<LSimContext>(m, "LSimContext")
         .def(py::init<>())
-        .def("sim", &LSimContext::sim, py::return_value_policy::reference)
+        .def("sim", &LSimContext::sim, py::return_value_policy::reference_internal)
         .def("user_library", &LSimContext::user_library, py::return_value_policy::reference)
         .def("create_user_circuit", &LSimContext::create_user_circuit, py::return_value_policy::reference)
         .def("load_user_library",
@@ -128,6 +281,30 @@ PYBIND11_MODULE(lsimpy, m) {
         .def("write_byte", &SimCircuit::write_byte)
         .def("write_pins", (void (SimCircuit::*)(const pin_id_container_t &, const value_container_t&))&SimCircuit::write_pins)
         .def("write_pins", (void (SimCircuit::*)(const pin_id_container_t &, uint64_t))&SimCircuit::write_pins)
+        .def("sync_with_model", [](SimCircuit &circuit) {
+            if (!circuit.sim()->patching_enabled()) {
+                throw py::value_error("the simulator wasn't set up for patching (call enable_patching before instantiating)");
+            }
+            circuit.sync_with_model();
+        })
+        .def("replace_memory_contents", &SimCircuit::replace_memory_contents)
+        .def("name", &SimCircuit::name)
+        .def("path", &SimCircuit::path)
+        .def("circuit_by_path", &SimCircuit::circuit_by_path, py::return_value_policy::reference)
+        .def("pin_by_path", &SimCircuit::pin_by_path)
+        .def("node_by_path", &SimCircuit::node_by_path)
+        .def("read_path", [](SimCircuit &circuit, const char *path) {
+            auto pin = circuit.pin_by_path(path);
+            if (pin == PIN_UNDEFINED) {
+                throw py::value_error(std::string("invalid path ") + path);
+            }
+            return circuit.sim()->read_pin(pin);
+        })
+        .def("nested_instance",
+                [](SimCircuit *circuit, uint32_t comp_id) -> SimCircuit * {
+                    auto comp = circuit->component_by_id(comp_id);
+                    return comp != nullptr ? comp->nested_instance() : nullptr;
+                }, py::return_value_policy::reference)
         .def("write_port",
                 [](SimCircuit *circuit, const char *port, Value value) {
                     circuit->write_pin(circuit->description()->port_by_name(port), value);
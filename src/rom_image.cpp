@@ -0,0 +1,251 @@
+// rom_image.cpp - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// load ROM images and program native ROM components
+
+#include "rom_image.h"
+#include "model_circuit.h"
+#include "model_circuit_library.h"
+#include "model_component.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+using namespace lsim;
+
+inline uint32_t data_mask(uint32_t data_bits) {
+    return data_bits >= 32 ? 0xffffffffu : (1u << data_bits) - 1;
+}
+
+inline uint32_t hex_digits(uint32_t data_bits) {
+    return (data_bits + 3) / 4;
+}
+
+inline int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+inline bool is_memory(ModelComponent *comp) {
+    return comp->type() == COMPONENT_ROM || comp->type() == COMPONENT_RAM;
+}
+
+inline uint32_t memory_address_bits(ModelComponent *comp) {
+    // RAM components have the data lines after the address lines
+    return comp->type() == COMPONENT_RAM ? comp->num_inputs() - comp->num_outputs() : comp->num_inputs();
+}
+
+// parse_word: parse an unsigned number that fits in 32 bits, end is set to the first character after it
+bool parse_word(const char *text, int base, uint32_t *value, char **end) {
+    errno = 0;
+    auto result = std::strtoull(text, end, base);
+    if (*end == text || errno == ERANGE || result > 0xffffffffull) {
+        return false;
+    }
+    *value = static_cast<uint32_t>(result);
+    return true;
+}
+
+bool ends_with(const std::string &str, const char *suffix) {
+    auto len = std::strlen(suffix);
+    return str.size() >= len && str.compare(str.size() - len, len, suffix) == 0;
+}
+
+} // unnamed namespace
+
+namespace lsim {
+
+rom_data_t rom_image_from_binary(const uint8_t *data, size_t size, uint32_t data_bits) {
+    assert(data_bits > 0 && data_bits <= 32);
+
+    const size_t word_size = (data_bits + 7) / 8;
+    const auto mask = data_mask(data_bits);
+    rom_data_t result;
+    result.reserve(size / word_size);
+
+    for (size_t offset = 0; offset + word_size <= size; offset += word_size) {
+        uint32_t word = 0;
+        for (size_t b = 0; b < word_size; ++b) {
+            word |= static_cast<uint32_t>(data[offset + b]) << (8 * b);
+        }
+        result.push_back(word & mask);
+    }
+
+    return result;
+}
+
+bool rom_image_from_hex(const char *text, rom_data_t *data) {
+    assert(text);
+    assert(data);
+
+    data->clear();
+
+    for (auto c = text; *c != '\0';) {
+        if (std::isspace(static_cast<unsigned char>(*c))) {
+            ++c;
+            continue;
+        }
+
+        if (*c == '#') {
+            while (*c != '\0' && *c != '\n') {
+                ++c;
+            }
+            continue;
+        }
+
+        char *end = nullptr;
+        uint32_t value = 0;
+        if (!parse_word(c, 16, &value, &end)) {
+            return false;
+        }
+
+        uint32_t count = 1;
+        if (*end == '*') {
+            // run-length: the count is decimal
+            char *count_end = nullptr;
+            if (!parse_word(c, 10, &count, &count_end) || count_end != end) {
+                return false;
+            }
+            c = end + 1;
+            if (!parse_word(c, 16, &value, &end)) {
+                return false;
+            }
+        }
+
+        // don't let a damaged image allocate more than any memory component can address
+        if (count > ROM_IMAGE_MAX_WORDS - data->size()) {
+            return false;
+        }
+
+        data->insert(data->end(), count, static_cast<uint32_t>(value));
+        c = end;
+    }
+
+    return true;
+}
+
+bool rom_image_load(const char *filename, uint32_t data_bits, rom_data_t *data) {
+    assert(filename);
+    assert(data);
+
+    std::ifstream input(filename, std::ios::binary);
+    if (!input) {
+        return false;
+    }
+
+    std::string contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    if (ends_with(filename, ".hex") || ends_with(filename, ".txt")) {
+        return rom_image_from_hex(contents.c_str(), data);
+    }
+
+    *data = rom_image_from_binary(reinterpret_cast<const uint8_t *>(contents.data()), contents.size(), data_bits);
+    return true;
+}
+
+uint32_t rom_address_bits(size_t word_count) {
+    uint32_t result = 0;
+    while ((static_cast<size_t>(1) << result) < word_count) {
+        ++result;
+    }
+    return result;
+}
+
+std::string rom_data_encode(const rom_data_t &data, uint32_t data_bits) {
+    static const char HEX[] = "0123456789abcdef";
+
+    const auto digits = hex_digits(data_bits);
+    const auto mask = data_mask(data_bits);
+
+    std::string result(data.size() * digits, '0');
+    auto out = &result[0];
+
+    for (auto word : data) {
+        word &= mask;
+        for (auto d = digits; d > 0; --d) {
+            out[d - 1] = HEX[word & 0xf];
+            word >>= 4;
+        }
+        out += digits;
+    }
+
+    return result;
+}
+
+rom_data_t rom_data_decode(const std::string &encoded, uint32_t data_bits, size_t word_count) {
+    const auto digits = hex_digits(data_bits);
+    const auto mask = data_mask(data_bits);
+
+    rom_data_t result(word_count, 0);
+    const auto available = std::min(word_count, encoded.size() / digits);
+
+    for (size_t idx = 0; idx < available; ++idx) {
+        uint32_t word = 0;
+        for (size_t d = 0; d < digits; ++d) {
+            auto value = hex_value(encoded[idx * digits + d]);
+            word = (word << 4) | static_cast<uint32_t>(value < 0 ? 0 : value);
+        }
+        result[idx] = word & mask;
+    }
+
+    return result;
+}
+
+void rom_set_contents(ModelComponent *rom, const rom_data_t &data) {
+    assert(rom);
+    assert(is_memory(rom));
+    rom->property("data")->value(rom_data_encode(data, rom->num_outputs()).c_str());
+}
+
+rom_data_t rom_contents(ModelComponent *rom) {
+    assert(rom);
+    assert(is_memory(rom));
+    return rom_data_decode(rom->property_value("data", ""), rom->num_outputs(),
+                           static_cast<size_t>(1) << memory_address_bits(rom));
+}
+
+ModelCircuit *rom_create_circuit(LSimContext *context, ModelCircuitLibrary *lib, const char *name,
+                                 uint32_t data_bits, const rom_data_t &data) {
+    assert(lib);
+    assert(name);
+
+    const auto address_bits = std::max(rom_address_bits(data.size()), 1u);
+
+    auto circuit = lib->create_circuit(name, context);
+
+    auto pin_CE = circuit->add_connector_in("CE", 1);
+    auto pin_OE = circuit->add_connector_in("OE", 1);
+    auto pin_Addr = circuit->add_connector_in("Addr", address_bits);
+    auto pin_Y = circuit->add_connector_out("Y", data_bits);
+
+    pin_CE->set_position({100, 40});
+    pin_OE->set_position({100, 80});
+    pin_Addr->set_position({100, 120 + address_bits * 10.0f});
+    pin_Y->set_position({400, 120 + data_bits * 10.0f});
+
+    auto rom = circuit->add_rom(address_bits, data_bits);
+    rom->set_position({250, 120 + std::max(address_bits, data_bits) * 10.0f});
+    rom_set_contents(rom, data);
+
+    circuit->connect(pin_CE->pin_id(0), rom->control_pin_id(0));
+    circuit->connect(pin_OE->pin_id(0), rom->control_pin_id(1));
+    for (auto idx = 0u; idx < address_bits; ++idx) {
+        circuit->connect(pin_Addr->pin_id(idx), rom->input_pin_id(idx));
+    }
+    for (auto idx = 0u; idx < data_bits; ++idx) {
+        circuit->connect(rom->output_pin_id(idx), pin_Y->pin_id(idx));
+    }
+
+    return circuit;
+}
+
+} // namespace lsim
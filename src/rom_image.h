@@ -0,0 +1,54 @@
+// rom_image.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// load ROM images and program native ROM components
+
+#ifndef LSIM_ROM_IMAGE_H
+#define LSIM_ROM_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lsim {
+
+class ModelCircuit;
+class ModelCircuitLibrary;
+class ModelComponent;
+class LSimContext;
+
+using rom_data_t = std::vector<uint32_t>;
+
+// rom_image_from_binary: split raw bytes into little-endian words, each word takes (data_bits + 7) / 8 bytes
+rom_data_t rom_image_from_binary(const uint8_t *data, size_t size, uint32_t data_bits);
+
+// largest image accepted from a file: the simulator allocates a word for each address (24 address lines at most)
+constexpr size_t ROM_IMAGE_MAX_WORDS = static_cast<size_t>(1) << 24;
+
+// rom_image_from_hex: parse a text image of whitespace separated hexadecimal words
+//      ('#' starts a comment, "N*value" repeats a value N times, N is decimal). Returns false for a malformed
+//      image, a word that doesn't fit in 32 bits or more than ROM_IMAGE_MAX_WORDS words.
+bool rom_image_from_hex(const char *text, rom_data_t *data);
+
+// rom_image_load: load a .hex (text) or binary image
+bool rom_image_load(const char *filename, uint32_t data_bits, rom_data_t *data);
+
+// rom_address_bits: number of address lines needed for the specified number of words
+uint32_t rom_address_bits(size_t word_count);
+
+// contents of a ROM or RAM component: stored in its "data" property as fixed-width hexadecimal words
+//  (for a RAM these are the initial contents)
+std::string rom_data_encode(const rom_data_t &data, uint32_t data_bits);
+rom_data_t rom_data_decode(const std::string &encoded, uint32_t data_bits, size_t word_count);
+
+void rom_set_contents(ModelComponent *rom, const rom_data_t &data);
+rom_data_t rom_contents(ModelComponent *rom);
+
+// rom_create_circuit: create a circuit with a single ROM component that has the same ports
+//      (CE, OE, Addr, Y) as the gate-level ROM circuits made by rom_builder.py
+ModelCircuit *rom_create_circuit(LSimContext *context, ModelCircuitLibrary *lib, const char *name,
+                                 uint32_t data_bits, const rom_data_t &data);
+
+} // namespace lsim
+
+#endif // LSIM_ROM_IMAGE_H
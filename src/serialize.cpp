@@ -8,8 +8,16 @@
 #include "model_circuit.h"
 #include "error.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 #include <pugixml.hpp>
 
 namespace {
@@ -71,6 +79,10 @@ const std::unordered_map<ComponentType, std::string> component_type_to_name = {
     {COMPONENT_VIA, "Via"},
     {COMPONENT_OSCILLATOR, "Oscillator"},
     {COMPONENT_7_SEGMENT_LED, "7SegmentLED"},
+    {COMPONENT_ROM, "Rom"},
+    {COMPONENT_RAM, "Ram"},
+    {COMPONENT_REGISTER, "Register"},
+    {COMPONENT_COUNTER, "Counter"},
     {COMPONENT_SUB_CIRCUIT, "SubCircuit"},
     {COMPONENT_TEXT, "Text"}
 };
@@ -97,101 +109,288 @@ private:
     std::string *m_output;
 };
 
+// destination of the serializer
+class XmlSink {
+public:
+    virtual ~XmlSink() = default;
+    virtual void begin_element(const char *name) = 0;
+    virtual void attribute(const char *name, const char *value) = 0;
+    virtual void end_element() = 0;
+};
+
+// build a pugixml document in memory
+class XmlDocumentSink : public XmlSink {
+public:
+    void begin_element(const char *name) override {
+        auto parent = m_stack.empty() ? static_cast<pugi::xml_node>(m_xml) : m_stack.back();
+        m_stack.push_back(parent.append_child(name));
+    }
+
+    void attribute(const char *name, const char *value) override {
+        assert(!m_stack.empty());
+        m_stack.back().append_attribute(name).set_value(value);
+    }
+
+    void end_element() override {
+        assert(!m_stack.empty());
+        m_stack.pop_back();
+    }
+
+    void dump_to_string(std::string *output) {
+        XmlStringWriter writer(output);
+        m_xml.save(writer);
+    }
+
+    bool dump_to_file(const char *filename) {
+        return m_xml.save_file(filename);
+    }
+
+private:
+    pugi::xml_document          m_xml;
+    std::vector<pugi::xml_node> m_stack;
+};
+
+// write xml text directly to a file, formatted the same way pugixml does
+class XmlStreamSink : public XmlSink {
+public:
+    XmlStreamSink(const char *filename) {
+        m_file = std::fopen(filename, "wb");
+        m_buffer.reserve(BUFFER_SIZE);
+        m_buffer.append("<?xml version=\"1.0\"?>\n");
+    }
+
+    ~XmlStreamSink() override {
+        close();
+    }
+
+    bool is_open() const {return m_file != nullptr;}
+
+    void begin_element(const char *name) override {
+        if (m_tag_open) {
+            m_buffer.append(">\n");
+        }
+
+        m_buffer.append(m_depth, '\t');
+        m_buffer.append("<");
+        m_buffer.append(name);
+        m_stack.push_back(name);
+        m_tag_open = true;
+        ++m_depth;
+    }
+
+    void attribute(const char *name, const char *value) override {
+        assert(m_tag_open);
+        m_buffer.append(" ");
+        m_buffer.append(name);
+        m_buffer.append("=\"");
+        append_escaped(value);
+        m_buffer.append("\"");
+    }
+
+    void end_element() override {
+        assert(!m_stack.empty());
+        --m_depth;
+
+        if (m_tag_open) {
+            m_buffer.append(" />\n");
+            m_tag_open = false;
+        } else {
+            m_buffer.append(m_depth, '\t');
+            m_buffer.append("</");
+            m_buffer.append(m_stack.back());
+            m_buffer.append(">\n");
+        }
+
+        m_stack.pop_back();
+
+        if (m_buffer.size() >= BUFFER_SIZE) {
+            flush();
+        }
+    }
+
+    bool close() {
+        if (m_file == nullptr) {
+            return false;
+        }
+
+        flush();
+        auto ok = !std::ferror(m_file);
+        ok = (std::fclose(m_file) == 0) && ok;
+        m_file = nullptr;
+        return ok;
+    }
+
+private:
+    void append_escaped(const char *value) {
+        for (auto c = value; *c != '\0'; ++c) {
+            switch (*c) {
+                case '&':
+                    m_buffer.append("&amp;");
+                    break;
+                case '<':
+                    m_buffer.append("&lt;");
+                    break;
+                case '"':
+                    m_buffer.append("&quot;");
+                    break;
+                default:
+                    if (static_cast<unsigned char>(*c) < 32) {
+                        // control characters as a two digit character reference
+                        auto ch = static_cast<unsigned char>(*c);
+                        m_buffer.append("&#");
+                        m_buffer.push_back(static_cast<char>('0' + ch / 10));
+                        m_buffer.push_back(static_cast<char>('0' + ch % 10));
+                        m_buffer.push_back(';');
+                    } else {
+                        m_buffer.push_back(*c);
+                    }
+            }
+        }
+    }
+
+    void flush() {
+        if (m_file != nullptr && !m_buffer.empty()) {
+            std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+        }
+        m_buffer.clear();
+    }
+
+private:
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    std::FILE *                 m_file = nullptr;
+    std::string                 m_buffer;
+    std::vector<const char *>   m_stack;
+    size_t                      m_depth = 0;
+    bool                        m_tag_open = false;
+};
+
+// write a circuit of a lazily loaded library that hasn't been loaded yet straight from its stored form
+bool copy_stored_circuit(ModelCircuitLoader *loader, const char *name, XmlSink *sink);
+
 class Serializer {
 public:
-    Serializer(LSimContext *context) : m_context(context) {
-        m_root = m_xml.append_child(XML_EL_LSIM);
-        m_root.append_attribute(XML_ATTR_VERSION).set_value(LSIM_XML_VERSION);
+    Serializer(LSimContext *context, XmlSink *sink) : m_context(context), m_sink(sink) {
     }
 
     void serialize_library(ModelCircuitLibrary *library) {
+        m_sink->begin_element(XML_EL_LSIM);
+        attribute(XML_ATTR_VERSION, LSIM_XML_VERSION);
 
         // references
         for (const auto &ref : library->references()) {
             auto lib = m_context->library_by_name(ref.c_str());
             if (lib != nullptr) {
-                auto ref_node = m_root.append_child(XML_EL_REFERENCE);
-                ref_node.append_attribute(XML_ATTR_NAME).set_value(ref.c_str());
-                ref_node.append_attribute(XML_ATTR_FILE).set_value(lib->path());
+                m_sink->begin_element(XML_EL_REFERENCE);
+                attribute(XML_ATTR_NAME, ref.c_str());
+                attribute(XML_ATTR_FILE, lib->path());
+                m_sink->end_element();
             }
         }
 
-        // circuits
+        // circuits: the circuits that weren't loaded can't have changed, don't load them just to write them
         for (size_t idx = 0; idx < library->num_circuits(); ++idx) {
-            serialize_circuit(library->circuit_by_idx(idx));
+            if (!library->is_circuit_loaded(idx) &&
+                copy_stored_circuit(library->loader(), library->circuit_name(idx).c_str(), m_sink)) {
+                continue;
+            }
+
+            auto circuit = library->circuit_by_idx(idx);
+            if (circuit != nullptr) {
+                serialize_circuit(circuit);
+            }
         }
 
         // main circuit
-        if (library->main_circuit() != nullptr) {
-            auto main_node = m_root.append_child(XML_EL_MAIN);
-            main_node.append_attribute(XML_ATTR_NAME).set_value(library->main_circuit_name());
+        if (library->has_circuit(library->main_circuit_name())) {
+            m_sink->begin_element(XML_EL_MAIN);
+            attribute(XML_ATTR_NAME, library->main_circuit_name());
+            m_sink->end_element();
         }
+
+        m_sink->end_element();
     }
 
-    void dump_to_string(std::string *output) {
-        XmlStringWriter writer(output);
-        m_xml.save(writer);
+private:
+    // attribute values are formatted the same way pugixml does
+    void attribute(const char *name, const char *value) {
+        m_sink->attribute(name, value);
     }
 
-    void dump_to_file(const char *filename) {
-        m_xml.save_file(filename);
+    void attribute(const char *name, int value) {
+        m_sink->attribute(name, std::to_string(value).c_str());
     }
 
-private:
-    void serialize_component(ModelComponent *component, pugi::xml_node *circuit_node) {
-        auto comp_node = circuit_node->append_child(XML_EL_COMPONENT);
+    void attribute(const char *name, uint32_t value) {
+        m_sink->attribute(name, std::to_string(value).c_str());
+    }
+
+    void attribute(const char *name, float value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", static_cast<double>(value));
+        m_sink->attribute(name, buffer);
+    }
+
+    void serialize_component(ModelComponent *component) {
+        m_sink->begin_element(XML_EL_COMPONENT);
 
         // id
-        comp_node.append_attribute(XML_ATTR_ID).set_value(component->id());
+        attribute(XML_ATTR_ID, component->id());
 
         // type
         auto type_name = component_type_to_name.find(component->type());
         if (type_name != component_type_to_name.end()) {
-            comp_node.append_attribute(XML_ATTR_TYPE).set_value(type_name->second.c_str());
+            attribute(XML_ATTR_TYPE, type_name->second.c_str());
         } else {
-            comp_node.append_attribute(XML_ATTR_TYPE).set_value(component->type());
+            attribute(XML_ATTR_TYPE, component->type());
         }
 
         // pins
-        comp_node.append_attribute(XML_ATTR_INPUTS).set_value(component->num_inputs());
-        comp_node.append_attribute(XML_ATTR_OUTPUTS).set_value(component->num_outputs());
-        comp_node.append_attribute(XML_ATTR_CONTROLS).set_value(component->num_controls());
+        attribute(XML_ATTR_INPUTS, component->num_inputs());
+        attribute(XML_ATTR_OUTPUTS, component->num_outputs());
+        attribute(XML_ATTR_CONTROLS, component->num_controls());
 
         // nested circuit
         if (component->nested_circuit() != nullptr) {
-            comp_node.append_attribute(XML_ATTR_NESTED).set_value(component->nested_circuit()->qualified_name().c_str());
+            attribute(XML_ATTR_NESTED, component->nested_circuit()->qualified_name().c_str());
         }
 
         // properties
         for (const auto &prop : component->properties()) {
-            auto prop_node = comp_node.append_child(XML_EL_PROPERTY);
-            prop_node.append_attribute(XML_ATTR_KEY).set_value(prop.second->key());
-            prop_node.append_attribute(XML_ATTR_VALUE).set_value(prop.second->value_as_string().c_str());
+            m_sink->begin_element(XML_EL_PROPERTY);
+            attribute(XML_ATTR_KEY, prop.second->key());
+            attribute(XML_ATTR_VALUE, prop.second->value_as_string().c_str());
+            m_sink->end_element();
         }
 
         // position
-        auto pos_node = comp_node.append_child(XML_EL_POSITION);
-        pos_node.append_attribute(XML_ATTR_X).set_value(component->position().x);
-        pos_node.append_attribute(XML_ATTR_Y).set_value(component->position().y);
+        m_sink->begin_element(XML_EL_POSITION);
+        attribute(XML_ATTR_X, component->position().x);
+        attribute(XML_ATTR_Y, component->position().y);
+        m_sink->end_element();
 
         // orientation
-        auto orient_node = comp_node.append_child(XML_EL_ORIENTATION);
-        orient_node.append_attribute(XML_ATTR_ANGLE).set_value(component->angle());
+        m_sink->begin_element(XML_EL_ORIENTATION);
+        attribute(XML_ATTR_ANGLE, component->angle());
+        m_sink->end_element();
+
+        m_sink->end_element();
     }
 
-    void serialize_wire(ModelWire *wire, pugi::xml_node *circuit_node) {
-        auto wire_node = circuit_node->append_child(XML_EL_WIRE);
+    void serialize_wire(ModelWire *wire) {
+        m_sink->begin_element(XML_EL_WIRE);
 
-        wire_node.append_attribute(XML_ATTR_ID).set_value(wire->id());
+        attribute(XML_ATTR_ID, wire->id());
 
         for (size_t idx = 0; idx < wire->num_segments(); ++idx) {
-            auto segment_node = wire_node.append_child(XML_EL_SEGMENT);
+            m_sink->begin_element(XML_EL_SEGMENT);
             const auto &p0 = wire->segment_point(idx, 0);
-            segment_node.append_attribute(XML_ATTR_X1).set_value(p0.x);
-            segment_node.append_attribute(XML_ATTR_Y1).set_value(p0.y);
+            attribute(XML_ATTR_X1, p0.x);
+            attribute(XML_ATTR_Y1, p0.y);
             const auto &p1 = wire->segment_point(idx, 1);
-            segment_node.append_attribute(XML_ATTR_X2).set_value(p1.x);
-            segment_node.append_attribute(XML_ATTR_Y2).set_value(p1.y);
+            attribute(XML_ATTR_X2, p1.x);
+            attribute(XML_ATTR_Y2, p1.y);
+            m_sink->end_element();
         }
 
 		auto format_wire_pin = [](auto pin_id) -> std::string {
@@ -202,34 +401,89 @@ private:
 		};
 
         for (size_t idx = 0; idx < wire->num_pins(); ++idx) {
-            auto pin_node = wire_node.append_child(XML_EL_PIN);
-			pin_node.append_attribute(XML_ATTR_VALUE).set_value(format_wire_pin(wire->pin(idx)).c_str());
+            m_sink->begin_element(XML_EL_PIN);
+			attribute(XML_ATTR_VALUE, format_wire_pin(wire->pin(idx)).c_str());
+            m_sink->end_element();
         }
+
+        m_sink->end_element();
     }
 
     void serialize_circuit(ModelCircuit *circuit) {
-        auto circuit_node = m_root.append_child(XML_EL_CIRCUIT);
-        circuit_node.append_attribute(XML_ATTR_NAME).set_value(circuit->name().c_str());
+        m_sink->begin_element(XML_EL_CIRCUIT);
+        attribute(XML_ATTR_NAME, circuit->name().c_str());
 
         // components
         auto comp_ids = circuit->component_ids();
         for (const auto &comp_id : comp_ids) {
-            serialize_component(circuit->component_by_id(comp_id), &circuit_node);
+            serialize_component(circuit->component_by_id(comp_id));
         }
 
         // wires
         auto wire_ids = circuit->wire_ids();
         for (const auto &wire_id : wire_ids) {
-            serialize_wire(circuit->wire_by_id(wire_id), &circuit_node);
+            serialize_wire(circuit->wire_by_id(wire_id));
         }
+
+        m_sink->end_element();
     }
 
 private:
     LSimContext *       m_context;
-    pugi::xml_document  m_xml;
-    pugi::xml_node      m_root;
+    XmlSink *           m_sink;
 };
 
+// libraries bigger than this are streamed to disk instead of being built in memory first
+constexpr size_t STREAMING_THRESHOLD = 10000;
+
+size_t library_size(ModelCircuitLibrary *lib) {
+    size_t result = 0;
+    for (size_t idx = 0; idx < lib->num_circuits(); ++idx) {
+        if (!lib->is_circuit_loaded(idx)) {
+            result += lib->loader() != nullptr ? lib->loader()->circuit_size(lib->circuit_name(idx).c_str()) : 0;
+            continue;
+        }
+        auto circuit = lib->circuit_by_idx(idx);
+        result += circuit->num_components() + circuit->wires().size();
+    }
+    return result;
+}
+
+// run func(0) ... func(count-1) spread over the available cores
+template <typename FUNC>
+void parallel_for(size_t count, FUNC func) {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    const size_t num_threads = 1;
+#else
+    const size_t num_threads = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), count);
+#endif
+
+    if (num_threads <= 1) {
+        for (size_t idx = 0; idx < count; ++idx) {
+            func(idx);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (auto idx = next++; idx < count; idx = next++) {
+            func(idx);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (size_t t = 1; t < num_threads; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
 #define REQUIRED_ATTR(var_name, node, attr_name)        \
     auto (var_name) = (node).attribute((attr_name));    \
     if (!(var_name)) {                                  \
@@ -244,6 +498,9 @@ private:
     REQUIRED_ATTR(var_name, var_name##_prop, XML_ATTR_VALUE);
 
 class Deserializer {
+public:
+    using component_id_map_t = std::unordered_map<uint32_t, uint32_t>;
+
 public:
     Deserializer(LSimContext *context) : m_context(context), 
 										 m_lib(nullptr) {
@@ -253,7 +510,7 @@ public:
         return m_xml.load_file(filename);
     }
 
-    bool parse_component(pugi::xml_node &comp_node, ModelCircuit *circuit) {
+    bool parse_component(pugi::xml_node &comp_node, ModelCircuit *circuit, component_id_map_t &id_map) {
         REQUIRED_ATTR(id_attr, comp_node, XML_ATTR_ID);
 
         // determine type of component
@@ -401,6 +658,49 @@ public:
                 component = circuit->add_7_segment_led();
                 break;
 
+            case COMPONENT_ROM: {
+                assert(num_inputs > 0);
+                assert(num_outputs > 0 && num_outputs <= 32);
+                assert(num_controls == 2);
+                REQUIRED_PROP(prop_data, comp_node, "data");
+                component = circuit->add_rom(num_inputs, num_outputs);
+                component->property("data")->value(prop_data.as_string());
+                break;
+            }
+
+            case COMPONENT_RAM: {
+                assert(num_outputs > 0 && num_outputs <= 32);
+                assert(num_inputs > num_outputs);
+                assert(num_controls == 3);
+                REQUIRED_PROP(prop_data, comp_node, "data");
+                component = circuit->add_ram(num_inputs - num_outputs, num_outputs);
+                component->property("data")->value(prop_data.as_string());
+                break;
+            }
+
+            case COMPONENT_REGISTER: {
+                assert(num_inputs > 0 && num_inputs <= 32);
+                assert(num_outputs == num_inputs);
+                assert(num_controls == 3);
+                REQUIRED_PROP(prop_trigger, comp_node, "trigger");
+                component = circuit->add_register(num_inputs);
+                component->property("trigger")->value(prop_trigger.as_string());
+                break;
+            }
+
+            case COMPONENT_COUNTER: {
+                assert(num_inputs > 0 && num_inputs <= 32);
+                assert(num_outputs == num_inputs + 1);
+                assert(num_controls == 4);
+                REQUIRED_PROP(prop_trigger, comp_node, "trigger");
+                REQUIRED_PROP(prop_on_goal, comp_node, "on_goal");
+                REQUIRED_PROP(prop_max, comp_node, "max_value");
+                component = circuit->add_counter(num_inputs, static_cast<uint32_t>(prop_max.as_llong()));
+                component->property("trigger")->value(prop_trigger.as_string());
+                component->property("on_goal")->value(prop_on_goal.as_string());
+                break;
+            }
+
             case COMPONENT_SUB_CIRCUIT : {
                 REQUIRED_ATTR(attr_name, comp_node, XML_ATTR_NESTED);
                 component = circuit->add_sub_circuit(attr_name.as_string(), num_inputs, num_outputs);
@@ -445,13 +745,13 @@ public:
         }
 
         if (component != nullptr) {
-            m_component_id_map[id_attr.as_int()] = component->id();
+            id_map[id_attr.as_int()] = component->id();
         }
 
         return true;
     }
 
-    bool parse_wire(pugi::xml_node wire_node, ModelCircuit *circuit) {
+    bool parse_wire(pugi::xml_node wire_node, ModelCircuit *circuit, const component_id_map_t &id_map) {
         ModelWire *wire = circuit->create_wire();
 
         for (auto segment_node : wire_node.children(XML_EL_SEGMENT)) {
@@ -476,8 +776,8 @@ public:
 
             // map component id to new value
             auto old_id = std::strtol(pin_string.c_str(), nullptr, 0);
-            auto found = m_component_id_map.find(old_id);
-            if (found == m_component_id_map.end()) {
+            auto found = id_map.find(old_id);
+            if (found == id_map.end()) {
                 ERROR_MSG("Unknown component-id \"%d\" in wire", old_id);
             }
             auto comp_id = found->second;
@@ -488,28 +788,39 @@ public:
         return true;
     }
 
-    bool parse_circuit(pugi::xml_node &circuit_node) {
-        const char *name = circuit_node.attribute(XML_ATTR_NAME).as_string();
-        if (name == nullptr) {
-            return false;
-        }
-
-        auto *circuit = m_lib->create_circuit(name, m_context);
-        if (circuit == nullptr) {
-            return false;
-        }
+    bool parse_circuit_contents(pugi::xml_node &circuit_node, ModelCircuit *circuit) {
+        // component ids in the file are mapped to the ids of the new components
+        component_id_map_t id_map;
 
         for (auto comp_node : circuit_node.children(XML_EL_COMPONENT)) {
-            parse_component(comp_node, circuit);
+            parse_component(comp_node, circuit, id_map);
         }
 
         for (auto wire_node : circuit_node.children(XML_EL_WIRE)) {
-            parse_wire(wire_node, circuit);
+            parse_wire(wire_node, circuit, id_map);
         }
 
         return true;
     }
 
+    ModelCircuit::uptr_t parse_lazy_circuit(ModelCircuitLibrary *lib, const char *name) {
+        auto found = m_circuit_nodes.find(name);
+        if (found == m_circuit_nodes.end()) {
+            return nullptr;
+        }
+
+        auto circuit = std::make_unique<ModelCircuit>(name, m_context, lib);
+        if (!parse_circuit_contents(found->second, circuit.get())) {
+            return nullptr;
+        }
+
+        // the xml of the circuit is no longer needed
+        m_circuit_nodes.erase(found);
+
+        circuit->sync_sub_circuit_components();
+        return circuit;
+    }
+
     bool parse_library(ModelCircuitLibrary *lib) {
         m_lib = lib;
 
@@ -526,11 +837,18 @@ public:
             lib->add_reference(attr_name.value());
         }
 
-        // circuits
+        // circuits: create them in order, the contents of the circuits are independent and can be parsed in parallel
+        std::vector<std::pair<pugi::xml_node, ModelCircuit *>> circuits;
+
         for (auto circuit_node : lsim_node.children(XML_EL_CIRCUIT)) {
-            parse_circuit(circuit_node);
+            const char *name = circuit_node.attribute(XML_ATTR_NAME).as_string();
+            circuits.emplace_back(circuit_node, lib->create_circuit(name, m_context));
         }
 
+        parallel_for(circuits.size(), [&](size_t idx) {
+            parse_circuit_contents(circuits[idx].first, circuits[idx].second);
+        });
+
         // main node
         auto main_node = lsim_node.child(XML_EL_MAIN);
         if (!!main_node) {
@@ -540,20 +858,123 @@ public:
 
         // sync sub circuits after all circuits have been loaded
         for (size_t idx = 0; idx < lib->num_circuits(); ++idx) {
-            lib->circuit_by_idx(idx)->sync_sub_circuit_components();
+            auto circuit = lib->circuit_by_idx(idx);
+            if (circuit != nullptr) {
+                circuit->sync_sub_circuit_components();
+            }
         }
 
         return true;
     }
 
+    bool index_library(ModelCircuitLibrary *lib) {
+        m_lib = lib;
+
+        auto lsim_node = m_xml.child(XML_EL_LSIM);
+        if (!lsim_node) {
+            return false;
+        }
+
+        // references
+        for (auto ref_node : lsim_node.children(XML_EL_REFERENCE)) {
+            REQUIRED_ATTR(attr_name, ref_node, XML_ATTR_NAME);
+            REQUIRED_ATTR(attr_file, ref_node, XML_ATTR_FILE);
+            m_context->load_reference_library(attr_name.value(), attr_file.value());
+            lib->add_reference(attr_name.value());
+        }
+
+        // circuits: only remember where to find them
+        for (auto circuit_node : lsim_node.children(XML_EL_CIRCUIT)) {
+            const char *name = circuit_node.attribute(XML_ATTR_NAME).as_string();
+            m_circuit_nodes[name] = circuit_node;
+        }
+
+        // main node
+        auto main_node = lsim_node.child(XML_EL_MAIN);
+        if (!!main_node) {
+            REQUIRED_ATTR(attr_name, main_node, XML_ATTR_NAME);
+            lib->change_main_circuit(attr_name.as_string());
+        }
+
+        return true;
+    }
+
+    size_t stored_circuit_size(const char *name) const {
+        auto found = m_circuit_nodes.find(name);
+        if (found == m_circuit_nodes.end()) {
+            return 0;
+        }
+
+        size_t result = 0;
+        for (auto child : found->second.children()) {
+            result += !strcmp(child.name(), XML_EL_COMPONENT) || !strcmp(child.name(), XML_EL_WIRE);
+        }
+        return result;
+    }
+
+    bool copy_stored_circuit(const char *name, XmlSink *sink) const {
+        auto found = m_circuit_nodes.find(name);
+        if (found == m_circuit_nodes.end()) {
+            return false;
+        }
+
+        copy_node(found->second, sink);
+        return true;
+    }
+
+    void add_lazy_circuits(ModelCircuitLibrary *lib) {
+        auto lsim_node = m_xml.child(XML_EL_LSIM);
+        for (auto circuit_node : lsim_node.children(XML_EL_CIRCUIT)) {
+            lib->add_lazy_circuit(circuit_node.attribute(XML_ATTR_NAME).as_string());
+        }
+    }
+
+private: 
+    static void copy_node(const pugi::xml_node &node, XmlSink *sink) {
+        sink->begin_element(node.name());
+        for (auto attr : node.attributes()) {
+            sink->attribute(attr.name(), attr.value());
+        }
+        for (auto child : node.children()) {
+            if (child.type() == pugi::node_element) {
+                copy_node(child, sink);
+            }
+        }
+        sink->end_element();
+    }
+
 private: 
     pugi::xml_document  m_xml;
     LSimContext *       m_context;
     ModelCircuitLibrary *    m_lib;
 
-    std::unordered_map<uint32_t, uint32_t>   m_component_id_map;
+    std::unordered_map<std::string, pugi::xml_node> m_circuit_nodes;
+};
+
+class LazyLoader : public ModelCircuitLoader {
+public:
+    LazyLoader(LSimContext *context) : m_deserializer(context) {
+    }
+
+    Deserializer &deserializer() {return m_deserializer;}
+
+    ModelCircuit::uptr_t load_circuit(ModelCircuitLibrary *lib, const char *name) override {
+        return m_deserializer.parse_lazy_circuit(lib, name);
+    }
+
+    size_t circuit_size(const char *name) override {
+        return m_deserializer.stored_circuit_size(name);
+    }
+
+private:
+    Deserializer    m_deserializer;
 };
 
+bool copy_stored_circuit(ModelCircuitLoader *loader, const char *name, XmlSink *sink) {
+    auto lazy_loader = dynamic_cast<LazyLoader *>(loader);
+    return lazy_loader != nullptr && lazy_loader->deserializer().copy_stored_circuit(name, sink);
+}
+
 } // unnamed namespace
 
 namespace lsim {
@@ -563,11 +984,29 @@ bool serialize_library(LSimContext *context, ModelCircuitLibrary *lib, const cha
     assert(lib);
     assert(filename);
 
-    Serializer serializer(context);
+    if (library_size(lib) >= STREAMING_THRESHOLD) {
+        return serialize_library_streaming(context, lib, filename);
+    }
+
+    XmlDocumentSink sink;
+    Serializer serializer(context, &sink);
     serializer.serialize_library(lib);
-    serializer.dump_to_file(filename);
+    return sink.dump_to_file(filename);
+}
 
-    return true;
+bool serialize_library_streaming(LSimContext *context, ModelCircuitLibrary *lib, const char *filename) {
+    assert(context);
+    assert(lib);
+    assert(filename);
+
+    XmlStreamSink sink(filename);
+    if (!sink.is_open()) {
+        return false;
+    }
+
+    Serializer serializer(context, &sink);
+    serializer.serialize_library(lib);
+    return sink.close();
 }
 
 bool deserialize_library(LSimContext *context, ModelCircuitLibrary *lib, const char *filename) {
@@ -586,4 +1025,27 @@ bool deserialize_library(LSimContext *context, ModelCircuitLibrary *lib, const c
     return true;
 }
 
+bool deserialize_library_lazy(LSimContext *context, ModelCircuitLibrary *lib, const char *filename) {
+    assert(context);
+    assert(lib);
+    assert(filename);
+
+    auto loader = std::make_unique<LazyLoader>(context);
+
+    if (!loader->deserializer().load_from_file(filename)) {
+        return false;
+    }
+
+    if (!loader->deserializer().index_library(lib)) {
+        return false;
+    }
+
+    // the loader keeps the parsed document alive until all circuits have been loaded
+    auto &deserializer = loader->deserializer();
+    lib->set_loader(std::move(loader));
+    deserializer.add_lazy_circuits(lib);
+
+    return true;
+}
+
 } // namespace lsim
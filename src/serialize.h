@@ -11,8 +11,14 @@ class LSimContext;
 class ModelCircuitLibrary;
 
 bool serialize_library(LSimContext *context, ModelCircuitLibrary *lib, const char *filename);
+
+// write the xml directly to the file without building a document in memory first (default for large libraries)
+bool serialize_library_streaming(LSimContext *context, ModelCircuitLibrary *lib, const char *filename);
 bool deserialize_library(LSimContext *context, ModelCircuitLibrary *lib, const char *filename);
 
+// only index the circuits in the file, circuits are parsed when they're first used
+bool deserialize_library_lazy(LSimContext *context, ModelCircuitLibrary *lib, const char *filename);
+
 } // namespace lsim
 
 #endif // LSIM_SERIALIZE_H
\ No newline at end of file
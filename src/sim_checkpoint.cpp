@@ -0,0 +1,527 @@
+// sim_checkpoint.cpp - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// save/restore the complete state of a simulation to/from disk
+
+#include "simulator.h"
+#include "model_component.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using namespace lsim;
+
+// file layout: a fixed header followed by a fixed sequence of arrays. Every array starts at an 8-byte aligned
+//  offset and holds fixed-width elements, so the file can be used directly from a memory mapping. The elements are
+//  stored in the byte order of the machine that saved them: a checkpoint only loads on a machine with the same byte
+//  order and word size.
+const char CHECKPOINT_MAGIC[8] = {'L', 'S', 'I', 'M', 'C', 'H', 'K', '\0'};
+const uint32_t CHECKPOINT_VERSION = 4;
+const uint32_t CHECKPOINT_BYTE_ORDER = 0x01020304;
+
+struct CheckpointHeader {
+    char        m_magic[8];
+    uint32_t    m_version;
+    uint32_t    m_header_size;
+    uint32_t    m_byte_order;       // CHECKPOINT_BYTE_ORDER as written by the saving machine
+    uint32_t    m_word_size;        // sizeof(size_t) on the saving machine
+    uint32_t    m_layout_version;   // layout_version of the saving simulator
+    uint32_t    m_same_simulator;   // only for the saving simulator: checked on m_layout_version, m_layout_hash unset
+    uint64_t    m_layout_hash;
+    uint64_t    m_time;
+    uint64_t    m_num_nodes;
+    uint64_t    m_num_pins;
+    uint64_t    m_num_components;
+};
+
+class CheckpointWriter {
+public:
+    explicit CheckpointWriter(std::string &out) : m_out(out) {}
+
+    template <typename T>
+    void write_array(const T *data, size_t count) {
+        write_bytes(data, count * sizeof(T));
+        pad();
+    }
+
+    template <typename T, typename S>
+    void write_converted(const std::vector<S> &data) {
+        std::vector<T> converted(data.begin(), data.end());
+        write_array(converted.data(), converted.size());
+    }
+
+    template <typename T, typename S>
+    void write_counted(const std::vector<S> &data) {
+        uint64_t count = data.size();
+        write_array(&count, 1);
+        write_converted<T>(data);
+    }
+
+private:
+    void write_bytes(const void *data, size_t size) {
+        m_out.append(reinterpret_cast<const char *>(data), size);
+    }
+
+    void pad() {
+        m_out.append((8 - (m_out.size() % 8)) % 8, '\0');
+    }
+
+private:
+    std::string &   m_out;
+};
+
+class CheckpointReader {
+public:
+    CheckpointReader(const char *data, size_t size) : m_data(data), m_size(size) {}
+
+    template <typename T>
+    const T *read_array(size_t count) {
+        if (m_failed || count > (m_size - m_offset) / sizeof(T)) {
+            m_failed = true;
+            return nullptr;
+        }
+
+        auto size = count * sizeof(T);
+        auto result = reinterpret_cast<const T *>(m_data + m_offset);
+        m_offset = std::min(m_offset + size + (8 - (size % 8)) % 8, m_size);
+        return result;
+    }
+
+    template <typename T, typename D>
+    bool read_converted(size_t count, std::vector<D> *dest) {
+        auto data = read_array<T>(count);
+        if (data == nullptr) {
+            return false;
+        }
+        dest->resize(count);
+        for (size_t idx = 0; idx < count; ++idx) {
+            (*dest)[idx] = static_cast<D>(data[idx]);
+        }
+        return true;
+    }
+
+    template <typename T, typename D>
+    bool read_counted(std::vector<D> *dest) {
+        auto count = read_array<uint64_t>(1);
+        return count != nullptr && read_converted<T>(*count, dest);
+    }
+
+    bool failed() const {return m_failed;}
+
+private:
+    const char *    m_data;
+    size_t          m_size;
+    size_t          m_offset = 0;
+    bool            m_failed = false;
+};
+
+// MappedFile: read-only view of the contents of a file, memory mapped where the platform allows it
+class MappedFile {
+public:
+    explicit MappedFile(const char *filename) {
+#ifndef _WIN32
+        auto fd = open(filename, O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            auto mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                m_data = static_cast<const char *>(mapped);
+                m_size = static_cast<size_t>(info.st_size);
+            }
+        }
+        m_valid = m_data != nullptr || info.st_size == 0;
+        close(fd);
+#else
+        std::ifstream in(filename, std::ios::binary);
+        if (!in) {
+            return;
+        }
+        m_buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+        m_valid = true;
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (m_data != nullptr) {
+            munmap(const_cast<char *>(m_data), m_size);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool valid() const {return m_valid;}
+    const char *data() const {return m_data;}
+    size_t size() const {return m_size;}
+
+private:
+    const char *    m_data = nullptr;
+    size_t          m_size = 0;
+    bool            m_valid = false;
+#ifdef _WIN32
+    std::string     m_buffer;
+#endif
+};
+
+inline void hash_combine(uint64_t *hash, uint64_t value) {
+    // FNV-1a over the bytes of the value
+    for (int b = 0; b < 8; ++b) {
+        *hash ^= (value >> (b * 8)) & 0xff;
+        *hash *= 0x100000001b3ull;
+    }
+}
+
+inline void hash_combine(uint64_t *hash, const std::string &value) {
+    hash_combine(hash, value.size());
+    for (auto c : value) {
+        *hash ^= static_cast<uint8_t>(c);
+        *hash *= 0x100000001b3ull;
+    }
+}
+
+} // unnamed namespace
+
+namespace lsim {
+
+uint64_t Simulator::layout_hash() const {
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    hash_combine(&hash, m_components.size());
+    hash_combine(&hash, m_pin_nodes.size());
+    hash_combine(&hash, m_node_metadata.size());
+
+    for (const auto &comp : m_components) {
+        if (comp == nullptr) {
+            hash_combine(&hash, 0);
+            continue;
+        }
+        hash_combine(&hash, comp->description()->type());
+        hash_combine(&hash, comp->num_pins());
+        for (auto pin : comp->pins()) {
+            hash_combine(&hash, m_pin_nodes[pin]);
+        }
+
+        // the properties configure the behaviour of the component (e.g. the durations of an oscillator)
+        const auto &properties = comp->description()->properties();
+        std::vector<const Property *> sorted;
+        for (const auto &entry : properties) {
+            sorted.push_back(entry.second.get());
+        }
+        std::sort(sorted.begin(), sorted.end(), [](auto a, auto b) {return std::strcmp(a->key(), b->key()) < 0;});
+        hash_combine(&hash, sorted.size());
+        for (auto prop : sorted) {
+            hash_combine(&hash, std::string(prop->key()));
+            hash_combine(&hash, prop->value_as_string());
+        }
+    }
+
+    return hash;
+}
+
+bool Simulator::save_checkpoint(const char *filename) {
+    assert(filename);
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    auto data = save_checkpoint_data();
+    out.write(data.data(), data.size());
+    return out.good();
+}
+
+bool Simulator::load_checkpoint(const char *filename) {
+    assert(filename);
+
+    MappedFile file(filename);
+    if (!file.valid()) {
+        return false;
+    }
+
+    return load_checkpoint_data(file.data(), file.size(), false);
+}
+
+std::string Simulator::save_checkpoint_data(bool same_simulator) {
+    assert(m_dirty_nodes_write.empty());
+
+    if (m_layout_changed) {
+        renumber();
+    }
+
+    const auto num_nodes = m_node_metadata.size();
+    const auto num_components = m_components.size();
+
+    CheckpointHeader header = {};
+    std::memcpy(header.m_magic, CHECKPOINT_MAGIC, sizeof(header.m_magic));
+    header.m_version = CHECKPOINT_VERSION;
+    header.m_header_size = sizeof(CheckpointHeader);
+    header.m_byte_order = CHECKPOINT_BYTE_ORDER;
+    header.m_word_size = sizeof(size_t);
+    header.m_layout_version = m_layout_version;
+    header.m_same_simulator = same_simulator;
+    header.m_layout_hash = same_simulator ? 0 : layout_hash();
+    header.m_time = m_time;
+    header.m_num_nodes = num_nodes;
+    header.m_num_pins = m_pin_nodes.size();
+    header.m_num_components = num_components;
+
+    // the fixed-size arrays, so appending doesn't have to reallocate (saved for every snapshot of a SimHistory)
+    std::string result;
+    result.reserve(sizeof(CheckpointHeader) + num_nodes * 48 + m_pin_nodes.size() + num_components * 16 + 256);
+    CheckpointWriter writer(result);
+    writer.write_array(&header, 1);
+
+    // nodes
+    std::vector<uint8_t> node_defaults;
+    std::vector<timestamp_t> node_time_dirty_write;
+    std::vector<uint32_t> active_offsets = {0};
+    std::vector<pin_t> active_pins;
+    node_defaults.reserve(num_nodes);
+    node_time_dirty_write.reserve(num_nodes);
+    active_offsets.reserve(num_nodes + 1);
+    active_pins.reserve(num_nodes);
+    for (const auto &meta : m_node_metadata) {
+        node_defaults.push_back(static_cast<uint8_t>(meta.m_default));
+        node_time_dirty_write.push_back(meta.m_time_dirty_write);
+        active_pins.insert(active_pins.end(), meta.m_active_pins.begin(), meta.m_active_pins.end());
+        active_offsets.push_back(static_cast<uint32_t>(active_pins.size()));
+    }
+
+    writer.write_converted<uint8_t>(m_node_values_read);
+    writer.write_converted<uint8_t>(m_node_values_write);
+    writer.write_array(m_node_write_time.data(), num_nodes);
+    writer.write_array(m_node_change_time.data(), num_nodes);
+    writer.write_array(node_time_dirty_write.data(), num_nodes);
+    writer.write_array(node_defaults.data(), num_nodes);
+    writer.write_array(active_offsets.data(), active_offsets.size());
+    writer.write_counted<uint32_t>(active_pins);
+    writer.write_counted<uint32_t>(m_dirty_nodes_read);
+
+    // pins
+    std::vector<uint32_t> pin_defaults;
+    for (const auto &entry : m_pin_defaults) {
+        pin_defaults.push_back(entry.first);
+        pin_defaults.push_back(entry.second);
+    }
+    writer.write_converted<uint8_t>(m_pin_values);
+    writer.write_counted<uint32_t>(pin_defaults);
+
+    // components
+    auto component_ids = [](const component_refs_t &comps) {
+        std::vector<uint32_t> ids;
+        for (auto comp : comps) {
+            ids.push_back(comp->id());
+        }
+        return ids;
+    };
+
+    // state of the components that have any: their user values followed by their extra data
+    std::vector<uint32_t> state_ids;
+    std::vector<uint64_t> state_offsets = {0};
+    std::vector<uint8_t> state_data;
+    for (const auto &comp : m_components) {
+        if (comp == nullptr || (!comp->user_values_enabled() && comp->extra_data_size() == 0)) {
+            continue;
+        }
+        auto state = comp->save_state(true);
+        state_ids.push_back(comp->id());
+        state_data.insert(state_data.end(), state.m_user_values.begin(), state.m_user_values.end());
+        state_offsets.push_back(state_data.size());
+        state_data.insert(state_data.end(), state.m_extra_data.begin(), state.m_extra_data.end());
+        state_offsets.push_back(state_data.size());
+    }
+
+    writer.write_array(m_input_changed.data(), num_components);
+    writer.write_counted<uint32_t>(component_ids(m_independent_components));
+    writer.write_counted<uint32_t>(component_ids(m_scheduled_components));
+
+    // pending wakeups as (time, component id) pairs, in heap order
+    std::vector<uint64_t> wakeups;
+    for (const auto &wakeup : m_wakeups) {
+        wakeups.push_back(wakeup.m_time);
+        wakeups.push_back(wakeup.m_comp->id());
+    }
+    writer.write_counted<uint64_t>(wakeups);
+    writer.write_counted<uint32_t>(state_ids);
+    writer.write_array(state_offsets.data(), state_offsets.size());
+    writer.write_counted<uint8_t>(state_data);
+
+    return result;
+}
+
+bool Simulator::load_checkpoint_data(const std::string &data, bool same_simulator) {
+    return load_checkpoint_data(data.data(), data.size(), same_simulator);
+}
+
+bool Simulator::load_checkpoint_data(const char *data, size_t size, bool same_simulator) {
+    if (m_layout_changed) {
+        renumber();
+    }
+
+    CheckpointReader reader(data, size);
+    auto header = reader.read_array<CheckpointHeader>(1);
+    if (header == nullptr ||
+        std::memcmp(header->m_magic, CHECKPOINT_MAGIC, sizeof(header->m_magic)) != 0 ||
+        header->m_version != CHECKPOINT_VERSION ||
+        header->m_header_size != sizeof(CheckpointHeader) ||
+        header->m_byte_order != CHECKPOINT_BYTE_ORDER ||
+        header->m_word_size != sizeof(size_t) ||
+        header->m_same_simulator != static_cast<uint32_t>(same_simulator) ||
+        (same_simulator ? header->m_layout_version != m_layout_version : header->m_layout_hash != layout_hash()) ||
+        header->m_num_nodes != m_node_metadata.size() ||
+        header->m_num_pins != m_pin_nodes.size() ||
+        header->m_num_components != m_components.size()) {
+        return false;
+    }
+
+    const auto num_nodes = m_node_metadata.size();
+    const auto num_components = m_components.size();
+
+    // read everything before modifying the simulator: a truncated file leaves it untouched
+    value_container_t values_read, values_write, node_defaults, pin_values;
+    timestamp_container_t write_time, change_time, time_dirty_write, input_changed;
+    std::vector<uint32_t> active_offsets, active_pins, dirty_nodes, pin_defaults, independent, scheduled, state_ids;
+    std::vector<uint64_t> wakeups, state_offsets;
+    std::vector<uint8_t> state_data;
+
+    reader.read_converted<uint8_t>(num_nodes, &values_read);
+    reader.read_converted<uint8_t>(num_nodes, &values_write);
+    reader.read_converted<timestamp_t>(num_nodes, &write_time);
+    reader.read_converted<timestamp_t>(num_nodes, &change_time);
+    reader.read_converted<timestamp_t>(num_nodes, &time_dirty_write);
+    reader.read_converted<uint8_t>(num_nodes, &node_defaults);
+    reader.read_converted<uint32_t>(num_nodes + 1, &active_offsets);
+    reader.read_counted<uint32_t>(&active_pins);
+    reader.read_counted<uint32_t>(&dirty_nodes);
+    reader.read_converted<uint8_t>(m_pin_nodes.size(), &pin_values);
+    reader.read_counted<uint32_t>(&pin_defaults);
+    reader.read_converted<timestamp_t>(num_components, &input_changed);
+    reader.read_counted<uint32_t>(&independent);
+    reader.read_counted<uint32_t>(&scheduled);
+    reader.read_counted<uint64_t>(&wakeups);
+    reader.read_counted<uint32_t>(&state_ids);
+    reader.read_converted<uint64_t>(state_ids.size() * 2 + 1, &state_offsets);
+    reader.read_counted<uint8_t>(&state_data);
+
+    auto out_of_range = [](const std::vector<uint32_t> &ids, size_t limit) {
+        return std::any_of(ids.begin(), ids.end(), [=](auto id) {return id >= limit;});
+    };
+
+    // component ids have to refer to a component that is instantiated in this simulator
+    auto invalid_component = [this](uint64_t id) {
+        return id >= m_components.size() || m_components[id] == nullptr;
+    };
+    auto invalid_components = [&](const std::vector<uint32_t> &ids) {
+        return std::any_of(ids.begin(), ids.end(), invalid_component);
+    };
+
+    bool wakeups_valid = wakeups.size() % 2 == 0;
+    for (size_t idx = 1; wakeups_valid && idx < wakeups.size(); idx += 2) {
+        wakeups_valid = !invalid_component(wakeups[idx]);
+    }
+
+    if (reader.failed() ||
+        !std::is_sorted(active_offsets.begin(), active_offsets.end()) || active_offsets.back() != active_pins.size() ||
+        !std::is_sorted(state_offsets.begin(), state_offsets.end()) || state_offsets.back() != state_data.size() ||
+        out_of_range(active_pins, m_pin_nodes.size()) || out_of_range(dirty_nodes, num_nodes) ||
+        invalid_components(independent) || invalid_components(scheduled) || !wakeups_valid ||
+        invalid_components(state_ids) || std::adjacent_find(state_ids.begin(), state_ids.end(), std::greater_equal<uint32_t>()) != state_ids.end()) {
+        return false;
+    }
+
+    // nodes
+    m_time = header->m_time;
+    m_node_values_read = move(values_read);
+    m_node_values_write = move(values_write);
+    m_node_write_time = move(write_time);
+    m_node_change_time = move(change_time);
+
+    for (node_t node_id = 0; node_id < num_nodes; ++node_id) {
+        auto &meta = m_node_metadata[node_id];
+        meta.m_default = node_defaults[node_id];
+        meta.m_time_dirty_write = time_dirty_write[node_id];
+        meta.m_active_pins.clear();
+        meta.m_active_pins.insert(active_pins.begin() + active_offsets[node_id], active_pins.begin() + active_offsets[node_id + 1]);
+    }
+
+    m_dirty_nodes_read.assign(dirty_nodes.begin(), dirty_nodes.end());
+    m_dirty_nodes_write.clear();
+    count_non_boolean_nodes();
+
+    // pins
+    m_pin_values = move(pin_values);
+    m_pin_defaults.clear();
+    for (size_t idx = 0; idx + 1 < pin_defaults.size(); idx += 2) {
+        m_pin_defaults[pin_defaults[idx]] = static_cast<Value>(pin_defaults[idx + 1]);
+    }
+
+    // components
+    m_input_changed = move(input_changed);
+    m_independent_components.clear();
+    std::fill(m_independent_active.begin(), m_independent_active.end(), 0);
+    for (auto id : independent) {
+        m_independent_components.push_back(m_components[id].get());
+        m_independent_active[id] = 1;
+    }
+    m_scheduled_components.clear();
+    std::fill(m_scheduled_active.begin(), m_scheduled_active.end(), 0);
+    for (auto id : scheduled) {
+        m_scheduled_components.push_back(m_components[id].get());
+        m_scheduled_active[id] = 1;
+    }
+    m_wakeups.clear();
+    for (size_t idx = 0; idx < wakeups.size(); idx += 2) {
+        m_wakeups.push_back({wakeups[idx], m_components[wakeups[idx + 1]].get()});
+    }
+    std::make_heap(m_wakeups.begin(), m_wakeups.end());
+
+    // components without saved state (ids are sorted) are cleared when they have any now
+    size_t state_idx = 0;
+    for (size_t id = 0; id < num_components; ++id) {
+        auto &comp = m_components[id];
+        SimComponent::State state;
+
+        if (state_idx < state_ids.size() && state_ids[state_idx] == id) {
+            auto first = state_data.begin() + state_offsets[state_idx * 2];
+            auto split = state_data.begin() + state_offsets[state_idx * 2 + 1];
+            auto last = state_data.begin() + state_offsets[state_idx * 2 + 2];
+            ++state_idx;
+
+            for (auto iter = first; iter != split; ++iter) {
+                state.m_user_values.push_back(static_cast<Value>(*iter));
+            }
+            state.m_extra_data.assign(split, last);
+        } else if (comp == nullptr || (!comp->user_values_enabled() && comp->extra_data_size() == 0)) {
+            continue;
+        }
+
+        comp->restore_state(state);
+    }
+
+    m_reset_image.m_valid = false;
+    m_reset_image.m_capture_pending = false;
+    return true;
+}
+
+} // namespace lsim
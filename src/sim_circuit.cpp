@@ -5,15 +5,42 @@
 #include "sim_circuit.h"
 #include "simulator.h"
 #include "sim_component.h"
+#include "memory_report.h"
 
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+#include "std_helper.h"
+
+namespace {
+
+using namespace lsim;
+
+size_t properties_hash(ModelComponent *comp) {
+    size_t result = 0;
+    for (const auto &prop : comp->properties()) {
+        result ^= std::hash<std::string>()(prop.first + "=" + prop.second->value_as_string());
+    }
+    return result;
+}
+
+} // unnamed namespace
 
 namespace lsim {
 
+bool SimCircuit::ComponentState::operator==(const ComponentState &other) const {
+    return m_type == other.m_type &&
+           m_num_inputs == other.m_num_inputs &&
+           m_num_outputs == other.m_num_outputs &&
+           m_num_controls == other.m_num_controls &&
+           m_nested == other.m_nested &&
+           m_properties_hash == other.m_properties_hash;
+}
+
 SimCircuit::SimCircuit(Simulator *sim, ModelCircuit *circuit_desc) :
         m_sim(sim),
-        m_circuit_desc(circuit_desc),
-        m_name("<unnamed>") {
+        m_circuit_desc(circuit_desc) {
     assert(sim);
     assert(circuit_desc);
 }
@@ -21,11 +48,11 @@ SimCircuit::SimCircuit(Simulator *sim, ModelCircuit *circuit_desc) :
 SimComponent *SimCircuit::add_component(ModelComponent *comp) {
     assert(comp);
     auto sim_comp = m_sim->create_component(comp);
-    m_components[comp->id()] = sim_comp;
+    set_component(comp->id(), sim_comp);
 
     if (comp->type() == COMPONENT_SUB_CIRCUIT) {
         auto nested_instance = comp->nested_circuit()->instantiate(m_sim, false);
-        nested_instance->build_name(comp->id());
+        nested_instance->set_parent(this, comp->id());
 
         for (auto idx = 0u; idx < sim_comp->num_inputs(); ++idx) {
             auto nested_pin = nested_instance->pin_from_pin_id(comp->nested_circuit()->port_by_index(true, idx));
@@ -67,9 +94,286 @@ void SimCircuit::connect_pins(pin_id_t pin_a, pin_id_t pin_b) {
     }
 }
 
-void SimCircuit::build_name(uint32_t comp_id) {
-    m_name = m_circuit_desc->name();
-    m_name += "#" + std::to_string(comp_id);
+void SimCircuit::connect_vias(ModelComponent *via_a, ModelComponent *via_b) {
+    assert(via_a->num_inputs() == via_b->num_inputs());
+    for (uint32_t i = 0u; i < via_a->num_inputs(); ++i) {
+        connect_pins(via_a->input_pin_id(i), via_b->input_pin_id(i));
+        m_via_connections.emplace_back(via_a->input_pin_id(i), via_b->input_pin_id(i));
+    }
+}
+
+size_t SimCircuit::WireStates::find(uint32_t wire_id) const {
+    auto found = std::lower_bound(m_ids.begin(), m_ids.end(), wire_id);
+    if (found == m_ids.end() || *found != wire_id) {
+        return m_ids.size();
+    }
+    return found - m_ids.begin();
+}
+
+void SimCircuit::capture_model_state() {
+    m_component_states.clear();
+
+    for (auto id : m_circuit_desc->component_ids()) {
+        auto comp = m_circuit_desc->component_by_id(id);
+        if (id >= m_component_states.size()) {
+            m_component_states.resize(id + 1, ComponentState{});
+        }
+        m_component_states[id] = {comp->type(), comp->num_inputs(), comp->num_outputs(), comp->num_controls(),
+                                  comp->nested_circuit(), properties_hash(comp)};
+    }
+    m_component_states.shrink_to_fit();
+
+    const auto &wires = m_circuit_desc->wires();
+    m_wire_states = {};
+    m_wire_states.m_ids.reserve(wires.size());
+    size_t num_pins = 0;
+    for (const auto &wire : wires) {
+        m_wire_states.m_ids.push_back(wire.first);
+        num_pins += wire.second->num_pins();
+    }
+    std::sort(m_wire_states.m_ids.begin(), m_wire_states.m_ids.end());
+
+    m_wire_states.m_pins.reserve(num_pins);
+    m_wire_states.m_offsets.reserve(wires.size() + 1);
+    m_wire_states.m_offsets.push_back(0);
+    for (auto id : m_wire_states.m_ids) {
+        const auto &pins = wires.at(id)->pins();
+        m_wire_states.m_pins.insert(m_wire_states.m_pins.end(), pins.begin(), pins.end());
+        m_wire_states.m_offsets.push_back(static_cast<uint32_t>(m_wire_states.m_pins.size()));
+    }
+}
+
+void SimCircuit::sync_with_model() {
+    assert(m_sim->patching_enabled());
+
+    // components that were removed or changed since the last capture
+    std::unordered_set<uint32_t> removed_comps;
+    bool vias_changed = false;
+
+    for (uint32_t id = 0; id < m_component_states.size(); ++id) {
+        const auto &state = m_component_states[id];
+        if (state.m_type == 0) {
+            continue;
+        }
+        auto comp = m_circuit_desc->component_by_id(id);
+        if (comp == nullptr ||
+            !(state == ComponentState{comp->type(), comp->num_inputs(), comp->num_outputs(), comp->num_controls(),
+                                      comp->nested_circuit(), properties_hash(comp)})) {
+            removed_comps.insert(id);
+            vias_changed |= state.m_type == COMPONENT_VIA;
+        }
+    }
+
+    // components that are new or have to be recreated
+    std::vector<ModelComponent *> added_comps;
+
+    for (auto id : m_circuit_desc->component_ids()) {
+        if (id >= m_component_states.size() || m_component_states[id].m_type == 0 || removed_comps.count(id) > 0) {
+            auto comp = m_circuit_desc->component_by_id(id);
+            added_comps.push_back(comp);
+            vias_changed |= comp->type() == COMPONENT_VIA;
+        }
+    }
+
+    // wires that were removed or changed or are connected to a recreated component
+    auto touches_removed = [&removed_comps](const pin_id_container_t &pins) {
+        return std::any_of(begin(pins), end(pins), [&](auto pin) {return removed_comps.count(component_id_from_pin_id(pin)) > 0;});
+    };
+
+    std::unordered_set<uint32_t> stale_wires;
+
+    for (size_t idx = 0; idx < m_wire_states.m_ids.size(); ++idx) {
+        auto wire = m_circuit_desc->wire_by_id(m_wire_states.m_ids[idx]);
+        auto pins = m_wire_states.pins(idx);
+        if (wire == nullptr || wire->pins() != pins || touches_removed(pins)) {
+            stale_wires.insert(m_wire_states.m_ids[idx]);
+        }
+    }
+
+    if (removed_comps.empty() && added_comps.empty() && stale_wires.empty() &&
+        m_wire_states.m_ids.size() == m_circuit_desc->wires().size()) {
+        return;
+    }
+
+    m_sim->patch_begin();
+
+    // break the connections that are no longer valid
+    for (auto id : stale_wires) {
+        disconnect_wire(m_wire_states.pins(m_wire_states.find(id)));
+    }
+
+    if (vias_changed) {
+        for (const auto &conn : m_via_connections) {
+            m_sim->disconnect_pins(pin_from_pin_id(conn.first), pin_from_pin_id(conn.second));
+        }
+        m_via_connections.clear();
+    }
+
+    // replace the changed components
+    for (auto id : removed_comps) {
+        remove_component(id);
+    }
+
+    for (auto comp : added_comps) {
+        auto sim_comp = add_component(comp);
+        if (comp->type() == COMPONENT_CONNECTOR_IN) {
+            sim_comp->enable_user_values();
+        }
+    }
+
+    // make the new connections
+    for (const auto &wire : m_circuit_desc->wires()) {
+        if (m_wire_states.find(wire.first) == m_wire_states.m_ids.size() || stale_wires.count(wire.first) > 0) {
+            add_wire(wire.second.get());
+        }
+    }
+
+    if (vias_changed) {
+        std::unordered_map<std::string, ModelComponent *> via_lut;
+        for (auto id : m_circuit_desc->component_ids_of_type(COMPONENT_VIA)) {
+            auto via = m_circuit_desc->component_by_id(id);
+            auto name = via->property_value("name", "via");
+            auto found = via_lut.find(name);
+            if (found != via_lut.end()) {
+                connect_vias(via, found->second);
+            } else {
+                via_lut[name] = via;
+            }
+        }
+    }
+
+    m_sim->patch_end();
+
+    capture_model_state();
+}
+
+void SimCircuit::disconnect_wire(const pin_id_container_t &pins) {
+    if (pins.size() < 2) {
+        return;
+    }
+
+    auto first_pin = pin_from_pin_id(pins[0]);
+    for (auto index = 1u; index < pins.size(); ++index) {
+        m_sim->disconnect_pins(first_pin, pin_from_pin_id(pins[index]));
+    }
+}
+
+void SimCircuit::remove_component(uint32_t comp_id) {
+    auto sim_comp = component_by_id(comp_id);
+    if (sim_comp == nullptr) {
+        return;
+    }
+
+    if (sim_comp->nested_instance() != nullptr) {
+        sim_comp->nested_instance()->remove_all_components();
+    }
+
+    m_sim->remove_component(sim_comp);
+    m_components[comp_id] = nullptr;
+}
+
+void SimCircuit::remove_all_components() {
+    for (uint32_t id = 0; id < m_components.size(); ++id) {
+        remove_component(id);
+    }
+    m_components.clear();
+}
+
+void SimCircuit::set_parent(SimCircuit *parent, uint32_t comp_id) {
+    m_parent = parent;
+    m_parent_comp_id = comp_id;
+}
+
+std::string SimCircuit::name() const {
+    if (m_parent == nullptr) {
+        return m_circuit_desc->name();
+    }
+    return m_circuit_desc->name() + "#" + std::to_string(m_parent_comp_id);
+}
+
+std::string SimCircuit::path() const {
+    if (m_parent == nullptr) {
+        return name();
+    }
+    return m_parent->path() + "/" + name();
+}
+
+SimCircuit *SimCircuit::walk_path(const char *path, const char **remainder) {
+    assert(path);
+
+    // the first segment is the name of this circuit
+    const auto &root_name = m_circuit_desc->name();
+    if (std::strncmp(path, root_name.c_str(), root_name.size()) != 0) {
+        return nullptr;
+    }
+
+    auto circuit = this;
+    auto c = path + root_name.size();
+
+    while (*c == '/') {
+        // segment: <circuit name>#<component id>
+        auto name_begin = ++c;
+        while (*c != '#' && *c != '\0') {
+            ++c;
+        }
+        if (*c != '#') {
+            return nullptr;
+        }
+        auto name_len = static_cast<size_t>(c - name_begin);
+
+        char *id_end = nullptr;
+        auto comp_id = std::strtoul(c + 1, &id_end, 10);
+        if (id_end == c + 1) {
+            return nullptr;
+        }
+        c = id_end;
+
+        auto comp = circuit->component_by_id(static_cast<uint32_t>(comp_id));
+        if (comp == nullptr || comp->nested_instance() == nullptr) {
+            return nullptr;
+        }
+
+        auto nested = comp->nested_instance();
+        const auto &nested_name = nested->m_circuit_desc->name();
+        if (nested_name.size() != name_len || nested_name.compare(0, name_len, name_begin, name_len) != 0) {
+            return nullptr;
+        }
+        circuit = nested;
+    }
+
+    *remainder = c;
+    return circuit;
+}
+
+SimCircuit *SimCircuit::circuit_by_path(const char *path) {
+    const char *remainder = nullptr;
+    auto circuit = walk_path(path, &remainder);
+    return (circuit != nullptr && *remainder == '\0') ? circuit : nullptr;
+}
+
+pin_t SimCircuit::pin_by_path(const char *path) {
+    const char *remainder = nullptr;
+    auto circuit = walk_path(path, &remainder);
+    if (circuit == nullptr || *remainder != '.') {
+        return PIN_UNDEFINED;
+    }
+
+    auto port = circuit->m_circuit_desc->port_by_name(remainder + 1);
+    if (port == PIN_ID_INVALID) {
+        return PIN_UNDEFINED;
+    }
+
+    return circuit->pin_from_pin_id(port);
+}
+
+node_t SimCircuit::node_by_path(const char *path) {
+    auto pin = pin_by_path(path);
+    return (pin != PIN_UNDEFINED) ? m_sim->pin_node(pin) : NODE_INVALID;
+}
+
+Value SimCircuit::read_path(const char *path) {
+    auto pin = pin_by_path(path);
+    return (pin != PIN_UNDEFINED) ? m_sim->read_pin(pin) : VALUE_UNDEFINED;
 }
 
 Value SimCircuit::read_pin(pin_id_t pin_id) {
@@ -231,24 +535,60 @@ Value SimCircuit::user_value(pin_id_t pin_id) {
     return comp->user_value(pin_index_from_pin_id(pin_id));
 }
 
-SimComponent *SimCircuit::component_by_id(uint32_t comp_id) {
+void SimCircuit::replace_memory_contents(uint32_t comp_id, const rom_data_t &data) {
+    auto comp = component_by_id(comp_id);
+    assert(comp);
 
-    auto found = m_components.find(comp_id);
-    if (found == m_components.end()) {
-        return nullptr;
+    auto desc = comp->description();
+    assert(desc->type() == COMPONENT_ROM || desc->type() == COMPONENT_RAM);
+
+    auto memory = reinterpret_cast<uint32_t *>(comp->extra_data());
+    auto num_words = comp->extra_data_size() / sizeof(uint32_t);
+    auto mask = desc->num_outputs() >= 32 ? 0xffffffffu : (1u << desc->num_outputs()) - 1;
+
+    for (size_t idx = 0; idx < num_words; ++idx) {
+        memory[idx] = idx < data.size() ? data[idx] & mask : 0;
+    }
+
+    // the caller may have updated the description as well: don't let that trigger a rebuild of the component,
+    //  but do pick up the contents init restores
+    if (comp_id < m_component_states.size() && m_component_states[comp_id].m_type != 0) {
+        m_component_states[comp_id].m_properties_hash = properties_hash(desc);
     }
+    comp->compile_parameters();
 
-    return found->second;
+    m_sim->update_reset_state(comp);
+    m_sim->schedule_input_changed(comp);
+}
+
+void SimCircuit::memory_usage(MemoryReport *report) const {
+    report->add("circuits/objects", sizeof(SimCircuit), 1);
+    report->add("circuits/component_lookup", heap_bytes(m_components),
+                std::count_if(m_components.begin(), m_components.end(), [](auto comp) {return comp != nullptr;}));
+    report->add("circuits/model_state",
+                heap_bytes(m_component_states) + heap_bytes(m_wire_states.m_ids) +
+                heap_bytes(m_wire_states.m_offsets) + heap_bytes(m_wire_states.m_pins) + heap_bytes(m_via_connections));
+}
+
+SimComponent *SimCircuit::component_by_id(uint32_t comp_id) {
+    return comp_id < m_components.size() ? m_components[comp_id] : nullptr;
 }
 
 pin_t SimCircuit::pin_from_pin_id(pin_id_t pin_id) {
 
-    auto found = m_components.find(component_id_from_pin_id(pin_id));
-    if (found == m_components.end()) {
+    auto comp = component_by_id(component_id_from_pin_id(pin_id));
+    if (comp == nullptr) {
         return PIN_UNDEFINED;
     }
 
-    return found->second->pin_by_index(pin_index_from_pin_id(pin_id));
+    return comp->pin_by_index(pin_index_from_pin_id(pin_id));
+}
+
+void SimCircuit::set_component(uint32_t comp_id, SimComponent *comp) {
+    if (comp_id >= m_components.size()) {
+        m_components.resize(comp_id + 1, nullptr);
+    }
+    m_components[comp_id] = comp;
 }
 
 } // namespace lsim
\ No newline at end of file
@@ -6,6 +6,7 @@
 #define LSIM_SIM_CIRCUIT_H
 
 #include "model_circuit.h"
+#include "rom_image.h"
 
 namespace lsim {
 
@@ -15,16 +16,43 @@ class SimCircuit {
 public:
     SimCircuit(Simulator *sim, ModelCircuit *circuit_desc);
     ModelCircuit *description() const {return m_circuit_desc;}
+    Simulator *sim() const {return m_sim;}
 
     // instantiation
     SimComponent *add_component(ModelComponent *comp);
     node_t add_wire(ModelWire *wire);
     void connect_pins(pin_id_t pin_a, pin_id_t pin_b);
+    void connect_vias(ModelComponent *via_a, ModelComponent *via_b);
     SimComponent *component_by_id(uint32_t comp_id);
 
-    // name
-    void build_name(uint32_t comp_id);
-    const char *name() const {return m_name.c_str();}
+    // incremental update: patch the simulation to match the changes made to the circuit description
+    //  since the last capture of its state (only the components of this circuit are compared, not nested circuits).
+    //  Requires a simulator with patching enabled before the circuit was instantiated (see Simulator::enable_patching).
+    void capture_model_state();
+    void sync_with_model();
+
+    // memory: replace the contents of a ROM or RAM component of a running simulation. Only the outputs of
+    //  the component are re-evaluated (in the next step), the state of the rest of the simulation is kept.
+    //  Words beyond the end of data are cleared, excess words are ignored. A warm reset keeps the new contents.
+    void replace_memory_contents(uint32_t comp_id, const rom_data_t &data);
+
+    // memory footprint: the lookup tables of this circuit. Its components (and the circuits nested in them) are
+    //  owned by the simulator and are reported by Simulator::memory_usage.
+    void memory_usage(MemoryReport *report) const;
+
+    // name: built on demand from the name of the circuit and the id of the sub-circuit component it's nested in
+    void set_parent(SimCircuit *parent, uint32_t comp_id);
+    SimCircuit *parent() const {return m_parent;}
+    std::string name() const;
+
+    // hierarchical paths: the name of each circuit from the top level down, separated by '/', optionally followed
+    //  by '.' and the name of a port (e.g. "computer/alu#12/adder#3.Y[2]"). Resolving a path takes one lookup per segment.
+    //  An invalid path gives nullptr, PIN_UNDEFINED, NODE_INVALID or VALUE_UNDEFINED.
+    std::string path() const;
+    SimCircuit *circuit_by_path(const char *path);
+    pin_t pin_by_path(const char *path);
+    node_t node_by_path(const char *path);
+    Value read_path(const char *path);
 
     // read/write
     Value read_pin(pin_id_t pin_id);
@@ -51,17 +79,56 @@ public:
     Value pin_output(pin_id_t pin_id);
     Value user_value(pin_id_t pin_id);
 
-private: 
+    // the simulator pin of a pin of the circuit description
     pin_t pin_from_pin_id(pin_id_t pin_id);
 
+private: 
+    void set_component(uint32_t comp_id, SimComponent *comp);
+    SimCircuit *walk_path(const char *path, const char **remainder);
+    void disconnect_wire(const pin_id_container_t &pins);
+    void remove_component(uint32_t comp_id);
+    void remove_all_components();
+
 private:
-    using sim_component_lut_t = std::unordered_map<uint32_t, SimComponent *>; 
+    struct ComponentState {
+        ComponentType   m_type;
+        uint32_t        m_num_inputs;
+        uint32_t        m_num_outputs;
+        uint32_t        m_num_controls;
+        ModelCircuit *  m_nested;
+        size_t          m_properties_hash;
+        bool operator==(const ComponentState &other) const;
+    };
+
+    // indexed by the id of the component description (ids are handed out sequentially by the circuit description)
+    using sim_component_lut_t = std::vector<SimComponent *>;
+    using component_state_lut_t = std::vector<ComponentState>;     // m_type == 0 for unused ids
+
+    // pins of every wire, sorted on wire id and stored back to back
+    struct WireStates {
+        std::vector<uint32_t>   m_ids;
+        std::vector<uint32_t>   m_offsets;          // pins of wire idx: m_offsets[idx] up to m_offsets[idx + 1]
+        pin_id_container_t      m_pins;
+
+        size_t find(uint32_t wire_id) const;        // index of the wire, m_ids.size() when not found
+        pin_id_container_t pins(size_t idx) const {
+            return pin_id_container_t(m_pins.begin() + m_offsets[idx], m_pins.begin() + m_offsets[idx + 1]);
+        }
+    };
 
 private:
+    friend class SimCircuitTemplate;
+
     ModelCircuit *    m_circuit_desc;
     Simulator *             m_sim;
     sim_component_lut_t     m_components;
-    std::string             m_name;
+    SimCircuit *            m_parent = nullptr;             // circuit containing the sub-circuit component this is an instance of
+    uint32_t                m_parent_comp_id = 0;
+
+    // state of the circuit description at the time of the last capture
+    component_state_lut_t   m_component_states;
+    WireStates              m_wire_states;
+    pin_id_pair_container_t m_via_connections;
 };
 
 
@@ -0,0 +1,173 @@
+// sim_circuit_template.cpp - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// precompiled, relocatable layout of a circuit and all its nested circuits
+
+#include "sim_circuit_template.h"
+#include "sim_circuit.h"
+#include "sim_component.h"
+#include "simulator.h"
+
+#include <cassert>
+#include "std_helper.h"
+
+namespace lsim {
+
+SimCircuitTemplate::uptr_t SimCircuitTemplate::build(ModelCircuit *circuit, fingerprint_lut_t &fingerprints) {
+    assert(circuit);
+
+    auto result = uptr_t(new SimCircuitTemplate());
+    auto comp_ids = circuit->component_ids();
+
+    result->m_circuits.push_back({circuit, NO_PARENT, static_cast<uint32_t>(comp_ids.size())});
+
+    // components of the circuit itself
+    result->m_components.reserve(comp_ids.size());
+    for (auto id : comp_ids) {
+        auto comp = circuit->component_by_id(id);
+        result->m_root_lut[id] = static_cast<uint32_t>(result->m_components.size());
+        result->m_components.push_back({comp, 0, result->m_num_pins});
+        result->m_num_pins += comp->num_inputs() + comp->num_outputs() + comp->num_controls();
+    }
+
+    // nested circuits
+    for (auto idx = 0u; idx < comp_ids.size(); ++idx) {
+        auto comp = result->m_components[idx].m_desc;
+        if (comp->type() == COMPONENT_SUB_CIRCUIT) {
+            assert(comp->nested_circuit());
+            result->append_nested(*comp->nested_circuit()->sim_template(fingerprints), idx);
+        }
+    }
+
+    // vias
+    std::unordered_map<std::string, ModelComponent *> via_lut;
+
+    for (auto idx = 0u; idx < comp_ids.size(); ++idx) {
+        auto via = result->m_components[idx].m_desc;
+        if (via->type() != COMPONENT_VIA) {
+            continue;
+        }
+
+        auto name = via->property_value("name", "via");
+        auto found_via = via_lut.find(name);
+        if (found_via == via_lut.end()) {
+            via_lut[name] = via;
+            continue;
+        }
+
+        auto other = found_via->second;
+        assert(via->num_inputs() == other->num_inputs());
+        for (auto i = 0u; i < via->num_inputs(); ++i) {
+            result->m_connections.emplace_back(result->root_pin(via->input_pin_id(i)), result->root_pin(other->input_pin_id(i)));
+            result->m_via_connections.emplace_back(via->input_pin_id(i), other->input_pin_id(i));
+        }
+    }
+
+    // wires
+    for (auto wire_id : circuit->wire_ids()) {
+        auto wire = circuit->wire_by_id(wire_id);
+        if (wire->num_pins() < 2) {
+            continue;
+        }
+
+        auto first_pin = result->root_pin(wire->pin(0));
+        for (auto idx = 1u; idx < wire->num_pins(); ++idx) {
+            auto pin = result->root_pin(wire->pin(idx));
+            if (first_pin != PIN_UNDEFINED && pin != PIN_UNDEFINED) {
+                result->m_connections.emplace_back(first_pin, pin);
+            }
+        }
+    }
+
+    result->layout_nodes();
+    return result;
+}
+
+std::unique_ptr<SimCircuit> SimCircuitTemplate::instantiate(Simulator *sim) const {
+    assert(sim);
+
+    auto pin_base = sim->add_pin_block(m_pin_nodes, m_num_nodes, m_connections);
+
+    std::vector<std::unique_ptr<SimCircuit>> circuits;
+    circuits.reserve(m_circuits.size());
+    for (const auto &entry : m_circuits) {
+        circuits.push_back(std::make_unique<SimCircuit>(sim, entry.m_desc));
+        circuits.back()->m_components.reserve(entry.m_num_components);
+    }
+
+    std::vector<SimComponent *> sim_comps;
+    sim_comps.reserve(m_components.size());
+    for (const auto &entry : m_components) {
+        auto sim_comp = sim->create_component(entry.m_desc, pin_base + entry.m_first_pin);
+        circuits[entry.m_circuit]->set_component(entry.m_desc->id(), sim_comp);
+        sim_comps.push_back(sim_comp);
+    }
+
+    // hand the nested circuits over to their sub-circuit component (nested circuits always come after their parent)
+    for (auto idx = circuits.size() - 1; idx > 0; --idx) {
+        auto parent_comp = m_circuits[idx].m_parent_comp;
+        circuits[idx]->set_parent(circuits[m_components[parent_comp].m_circuit].get(), m_components[parent_comp].m_desc->id());
+        sim_comps[parent_comp]->set_nested_instance(move(circuits[idx]));
+    }
+
+    circuits[0]->m_via_connections = m_via_connections;
+    return move(circuits[0]);
+}
+
+void SimCircuitTemplate::append_nested(const SimCircuitTemplate &nested, uint32_t parent_comp) {
+    const auto comp_base = static_cast<uint32_t>(m_components.size());
+    const auto circuit_base = static_cast<uint32_t>(m_circuits.size());
+    const auto pin_base = m_num_pins;
+
+    // copy the layout of the nested circuit with an offset
+    for (const auto &entry : nested.m_circuits) {
+        auto parent = entry.m_parent_comp == NO_PARENT ? parent_comp : comp_base + entry.m_parent_comp;
+        m_circuits.push_back({entry.m_desc, parent, entry.m_num_components});
+    }
+
+    for (const auto &entry : nested.m_components) {
+        m_components.push_back({entry.m_desc, circuit_base + entry.m_circuit, pin_base + entry.m_first_pin});
+    }
+
+    m_connections.reserve(m_connections.size() + nested.m_connections.size());
+    for (const auto &conn : nested.m_connections) {
+        m_connections.emplace_back(pin_base + conn.first, pin_base + conn.second);
+    }
+
+    m_num_pins += nested.m_num_pins;
+
+    // connect the ports of the nested circuit to the pins of the sub-circuit component
+    auto sub_comp = m_components[parent_comp];
+    auto nested_desc = nested.m_circuits.front().m_desc;
+
+    for (auto idx = 0u; idx < sub_comp.m_desc->num_inputs(); ++idx) {
+        auto nested_pin = nested.root_pin(nested_desc->port_by_index(true, idx));
+        m_connections.emplace_back(pin_base + nested_pin, sub_comp.m_first_pin + idx);
+    }
+
+    for (auto idx = 0u; idx < sub_comp.m_desc->num_outputs(); ++idx) {
+        auto nested_pin = nested.root_pin(nested_desc->port_by_index(false, idx));
+        m_connections.emplace_back(pin_base + nested_pin, sub_comp.m_first_pin + sub_comp.m_desc->num_inputs() + idx);
+    }
+}
+
+pin_t SimCircuitTemplate::root_pin(pin_id_t pin_id) const {
+    auto found = m_root_lut.find(component_id_from_pin_id(pin_id));
+    if (found == m_root_lut.end()) {
+        return PIN_UNDEFINED;
+    }
+
+    return m_components[found->second].m_first_pin + pin_index_from_pin_id(pin_id);
+}
+
+void SimCircuitTemplate::layout_nodes() {
+    auto root = connected_pin_roots(m_num_pins, m_connections);
+
+    m_pin_nodes.resize(m_num_pins);
+    m_num_nodes = 0;
+
+    for (pin_t pin = 0; pin < m_num_pins; ++pin) {
+        m_pin_nodes[pin] = (root[pin] == pin) ? m_num_nodes++ : m_pin_nodes[root[pin]];
+    }
+}
+
+} // namespace lsim
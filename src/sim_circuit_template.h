@@ -0,0 +1,74 @@
+// sim_circuit_template.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// precompiled, relocatable layout of a circuit and all its nested circuits
+
+#ifndef LSIM_SIM_CIRCUIT_TEMPLATE_H
+#define LSIM_SIM_CIRCUIT_TEMPLATE_H
+
+#include "sim_types.h"
+
+#include <memory>
+#include <unordered_map>
+
+namespace lsim {
+
+class SimCircuit;
+
+class SimCircuitTemplate {
+public:
+    using uptr_t = std::unique_ptr<SimCircuitTemplate>;
+    using fingerprint_lut_t = std::unordered_map<const ModelCircuit *, uint64_t>;
+
+public:
+    // build: lay out the circuit, copying the layout of its nested circuits from their own templates
+    //  (see ModelCircuit::sim_template, which keeps the template with the circuit)
+    static uptr_t build(ModelCircuit *circuit, fingerprint_lut_t &fingerprints);
+
+    // instantiate: create the components and copy the pin/node layout into the simulator
+    std::unique_ptr<SimCircuit> instantiate(Simulator *sim) const;
+
+    size_t num_components() const {return m_components.size();}
+    size_t num_pins() const {return m_num_pins;}
+    size_t num_nodes() const {return m_num_nodes;}
+
+private:
+    SimCircuitTemplate() = default;
+    void append_nested(const SimCircuitTemplate &nested, uint32_t parent_comp);
+    pin_t root_pin(pin_id_t pin_id) const;
+    void layout_nodes();
+
+private:
+    static constexpr uint32_t NO_PARENT = static_cast<uint32_t>(-1);
+
+    struct ComponentEntry {
+        ModelComponent *    m_desc;
+        uint32_t            m_circuit;          // index of the circuit the component belongs to
+        pin_t               m_first_pin;        // local index of the first pin of the component
+    };
+
+    struct CircuitEntry {
+        ModelCircuit *      m_desc;
+        uint32_t            m_parent_comp;      // index of the sub-circuit component that holds the circuit
+        uint32_t            m_num_components;
+    };
+
+    using component_container_t = std::vector<ComponentEntry>;
+    using circuit_container_t = std::vector<CircuitEntry>;
+    using component_lut_t = std::unordered_map<uint32_t, uint32_t>;
+
+private:
+    component_container_t   m_components;       // all components (depth-first: the circuit itself, then its nested circuits)
+    circuit_container_t     m_circuits;         // the circuit itself and all nested circuits
+    component_lut_t         m_root_lut;         // component-id -> index for the components of the circuit itself
+
+    pin_t                   m_num_pins = 0;
+    pin_pair_container_t    m_connections;      // local pin connections (wires, vias, ports of nested circuits)
+    pin_id_pair_container_t m_via_connections;  // via connections of the circuit itself
+
+    node_t                  m_num_nodes = 0;
+    node_container_t        m_pin_nodes;        // local node of each local pin
+};
+
+} // namespace lsim
+
+#endif // LSIM_SIM_CIRCUIT_TEMPLATE_H
@@ -3,10 +3,31 @@
 #include "sim_component.h"
 #include "sim_circuit.h"
 #include "simulator.h"
+#include "memory_report.h"
+#include "rom_image.h"
 #include <cassert>
+#include <numeric>
+#include <string>
 
 namespace lsim {
 
+namespace {
+
+// index of a property value in a list of option names (properties store the name)
+template <typename T, size_t N>
+T option_index(const std::string &value, const char *const (&names)[N], T def_value) {
+	for (size_t idx = 0; idx < N; ++idx) {
+		if (value == names[idx]) {
+			return static_cast<T>(idx);
+		}
+	}
+	return def_value;
+}
+
+} // unnamed namespace
+
+const SimComponentParams SimComponent::DEFAULT_PARAMS;
+
 SimComponent::SimComponent(Simulator* sim, ModelComponent* comp, uint32_t id) :
 	m_sim(sim),
 	m_comp_desc(comp),
@@ -14,66 +35,160 @@ SimComponent::SimComponent(Simulator* sim, ModelComponent* comp, uint32_t id) :
 	m_read_bad(false),
 	m_nested_circuit(nullptr) {
 
-	auto num_pins = comp->num_inputs() + comp->num_outputs() + comp->num_controls();
+	m_num_pins = comp->num_inputs() + comp->num_outputs() + comp->num_controls();
 	m_output_start = comp->num_inputs();
 	m_control_start = m_output_start + comp->num_outputs();
-	for (size_t idx = 0; idx < num_pins; ++idx) {
-		m_pins.push_back(sim->assign_pin(this, idx < m_output_start || idx >= m_control_start));
+	m_first_pin = PIN_UNDEFINED;
+	for (uint32_t idx = 0; idx < m_num_pins; ++idx) {
+		auto pin = sim->assign_pin(this, idx < m_output_start || idx >= m_control_start);
+		if (idx == 0) {
+			m_first_pin = pin;
+		}
+		assert(pin == m_first_pin + idx);
+	}
+
+	compile_parameters();
+}
+
+SimComponent::SimComponent(Simulator* sim, ModelComponent* comp, uint32_t id, pin_t first_pin) :
+	m_sim(sim),
+	m_comp_desc(comp),
+	m_id(id),
+	m_read_bad(false),
+	m_nested_circuit(nullptr) {
+
+	// pins were reserved in advance (block instantiation)
+	m_first_pin = first_pin;
+	m_num_pins = comp->num_inputs() + comp->num_outputs() + comp->num_controls();
+	m_output_start = comp->num_inputs();
+	m_control_start = m_output_start + comp->num_outputs();
+
+	compile_parameters();
+}
+
+void SimComponent::compile_parameters() {
+	SimComponentParams params;
+	params.m_initial_output = m_comp_desc->property_value("initial_output", VALUE_UNDEFINED);
+	bool has_params = params.m_initial_output != VALUE_UNDEFINED;
+
+	switch (m_comp_desc->type()) {
+		case COMPONENT_CONNECTOR_IN:
+			params.m_tri_state = m_comp_desc->property_value("tri_state", false);
+			has_params = true;
+			break;
+		case COMPONENT_CONSTANT:
+			params.m_value = m_comp_desc->property_value("value", VALUE_UNDEFINED);
+			has_params = true;
+			break;
+		case COMPONENT_PULL_RESISTOR:
+			params.m_value = m_comp_desc->property_value("pull_to", VALUE_UNDEFINED);
+			has_params = true;
+			break;
+		case COMPONENT_OSCILLATOR:
+			params.m_duration[0] = m_comp_desc->property_value("low_duration", static_cast<int64_t>(1));
+			params.m_duration[1] = m_comp_desc->property_value("high_duration", static_cast<int64_t>(1));
+			has_params = true;
+			break;
+		case COMPONENT_REGISTER:
+			params.m_trigger = option_index(m_comp_desc->property_value("trigger", ""), CLOCK_TRIGGER_NAMES, TRIGGER_RISING_EDGE);
+			has_params = true;
+			break;
+		case COMPONENT_COUNTER:
+			params.m_trigger = option_index(m_comp_desc->property_value("trigger", ""), CLOCK_TRIGGER_NAMES, TRIGGER_RISING_EDGE);
+			params.m_on_goal = option_index(m_comp_desc->property_value("on_goal", ""), COUNTER_ON_GOAL_NAMES, ON_GOAL_WRAP);
+			params.m_max_value = static_cast<uint32_t>(m_comp_desc->property_value("max_value", static_cast<int64_t>(0)));
+			has_params = true;
+			break;
+		case COMPONENT_ROM:
+		case COMPONENT_RAM:
+			// decoded once: init only copies the contents into the extra data
+			params.m_memory_contents = rom_contents(m_comp_desc);
+			has_params = true;
+			break;
+		default:
+			break;
+	}
+
+	// most components (e.g. gates) don't have any parameters: they don't pay for a copy of the defaults
+	if (has_params) {
+		m_params = std::make_unique<SimComponentParams>(std::move(params));
+	} else {
+		m_params = nullptr;
 	}
 }
 
 void SimComponent::apply_initial_values() {
-	auto initial_out = m_comp_desc->property_value("initial_output", VALUE_UNDEFINED);
+	auto initial_out = params().m_initial_output;
 	if (initial_out != VALUE_UNDEFINED) {
 		for (size_t pin = m_output_start; pin < m_control_start; ++pin) {
-			m_sim->pin_set_initial_value(m_pins[pin], initial_out);
+			m_sim->pin_set_initial_value(m_first_pin + pin, initial_out);
 		}
 	}
 
-	if (m_comp_desc->type() == COMPONENT_CONNECTOR_IN &&
-		!m_user_values.empty() &&
-		!m_comp_desc->property_value("tri_state", false)) {
+	if (!m_user_values.empty() && !params().m_tri_state &&
+		m_comp_desc->type() == COMPONENT_CONNECTOR_IN) {
 		for (size_t pin = m_output_start; pin < m_control_start; ++pin) {
 			m_user_values[pin] = VALUE_FALSE;
-			m_sim->pin_set_initial_value(m_pins[pin], initial_out);
+			m_sim->pin_set_initial_value(m_first_pin + pin, initial_out);
 		}
 	}
 }
 
+void SimComponent::renumber(uint32_t id, const pin_container_t &pin_map) {
+	m_id = id;
+	if (m_num_pins > 0) {
+		// the pins of a component stay together
+		assert(pin_map[m_first_pin + m_num_pins - 1] == pin_map[m_first_pin] + m_num_pins - 1);
+		m_first_pin = pin_map[m_first_pin];
+	}
+}
+
 pin_t SimComponent::pin_by_index(uint32_t index) const {
-	assert(index < m_pins.size());
-	return m_pins[index];
+	assert(index < m_num_pins);
+	return m_first_pin + index;
+}
+
+pin_container_t SimComponent::pins() const {
+	pin_container_t result(m_num_pins);
+	std::iota(result.begin(), result.end(), m_first_pin);
+	return result;
 }
 
 pin_container_t SimComponent::input_pins() const {
-	return pin_container_t(m_pins.begin(), m_pins.begin() + m_output_start);
+	pin_container_t result(m_output_start);
+	std::iota(result.begin(), result.end(), m_first_pin);
+	return result;
 }
 
 pin_container_t SimComponent::output_pins() const {
-	return pin_container_t(m_pins.begin() + m_output_start, m_pins.begin() + m_control_start);
+	pin_container_t result(m_control_start - m_output_start);
+	std::iota(result.begin(), result.end(), m_first_pin + m_output_start);
+	return result;
 }
 
 pin_container_t SimComponent::control_pins() const {
-	return pin_container_t(m_pins.begin() + m_control_start, m_pins.end());
+	pin_container_t result(m_num_pins - m_control_start);
+	std::iota(result.begin(), result.end(), m_first_pin + m_control_start);
+	return result;
 }
 
 Value SimComponent::read_pin(uint32_t index) const {
-	assert(index < m_pins.size());
-	return m_sim->read_pin(m_pins[index]);
+	assert(index < m_num_pins);
+	return m_sim->read_pin(m_first_pin + index);
 }
 
 void SimComponent::write_pin(uint32_t index, Value value) {
-	assert(index < m_pins.size());
+	assert(index < m_num_pins);
 	// XXX: is the second test really necessary?
-	if (value == VALUE_UNDEFINED && m_sim->pin_output_value(m_pins[index]) == value) {
+	if (value == VALUE_UNDEFINED && m_sim->pin_output_value(m_first_pin + index) == value) {
 		return;
 	}
-	m_sim->write_pin(m_pins[index], value);
+	m_sim->write_pin(m_first_pin + index, value);
 }
 
 bool SimComponent::read_pin_checked(uint32_t index) {
-	assert(index < m_pins.size());
-	auto value = m_sim->read_pin(m_pins[index]);
+	assert(index < m_num_pins);
+	auto value = m_sim->read_pin(m_first_pin + index);
 	m_read_bad |= (value != VALUE_TRUE && value != VALUE_FALSE);
 	return static_cast<bool>(value);
 }
@@ -85,7 +200,7 @@ void SimComponent::write_pin_checked(uint32_t index, bool value) {
 
 void SimComponent::enable_user_values() {
 	m_user_values.clear();
-	m_user_values.resize(m_pins.size(), VALUE_UNDEFINED);
+	m_user_values.resize(m_num_pins, VALUE_UNDEFINED);
 }
 
 Value SimComponent::user_value(uint32_t index) const {
@@ -96,13 +211,43 @@ Value SimComponent::user_value(uint32_t index) const {
 }
 
 void SimComponent::set_user_value(uint32_t index, Value value) {
-	assert(index < m_pins.size());
+	assert(index < m_num_pins);
 	m_user_values[index] = value;
 	m_sim->activate_independent_simulation_func(this);
+	m_sim->user_value_changed(this, index, value);
+}
+
+SimComponent::State SimComponent::save_state(bool with_extra_data) const {
+	State result;
+	result.m_user_values = m_user_values;
+	if (with_extra_data) {
+		result.m_extra_data = m_extra_data;
+	}
+	return result;
+}
+
+void SimComponent::restore_state(const State &state) {
+	m_user_values = state.m_user_values;
+	if (!state.m_extra_data.empty()) {
+		m_extra_data = state.m_extra_data;
+	}
 }
 
 void SimComponent::set_nested_instance(std::unique_ptr<class SimCircuit> instance) {
 	m_nested_circuit = std::move(instance);
 }
 
+void SimComponent::memory_usage(MemoryReport *report) const {
+	report->add("simulator/components/objects", sizeof(SimComponent), 1);
+	report->add("simulator/components/vectors",
+				heap_bytes(m_user_values) + heap_bytes(m_extra_data));
+	if (m_params) {
+		report->add("simulator/components/params", sizeof(SimComponentParams) + heap_bytes(m_params->m_memory_contents), 1);
+	}
+
+	if (m_nested_circuit) {
+		m_nested_circuit->memory_usage(report);
+	}
+}
+
 } // namespace lsim
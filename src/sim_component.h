@@ -6,33 +6,58 @@
 #include "sim_types.h"
 #include "sim_circuit.h"
 #include <memory>
+#include <vector>
 
 namespace lsim {
 
 class Simulator;
 
+// typed copy of the properties the simulation needs, so (re)initializing doesn't have to look them up by name
+//	(only allocated for components that have parameters, the others share the defaults)
+struct SimComponentParams {
+	std::vector<uint32_t>	m_memory_contents;	// ROM contents or initial contents of a RAM (decoded from the "data" property)
+	int64_t	m_duration[2] = {1, 1};			// oscillator low/high duration
+	uint32_t		m_max_value = 0;			// counter
+	Value	m_initial_output = VALUE_UNDEFINED;
+	Value	m_value = VALUE_UNDEFINED;		// constant value or pull resistor target
+	bool	m_tri_state = false;
+	ClockTrigger	m_trigger = TRIGGER_RISING_EDGE;
+	CounterOnGoal	m_on_goal = ON_GOAL_WRAP;
+};
+
 class SimComponent {
 public:
 	using uptr_t = std::unique_ptr<SimComponent>;
 public:
 	SimComponent(Simulator* sim, ModelComponent* comp, uint32_t id);
+	SimComponent(Simulator* sim, ModelComponent* comp, uint32_t id, pin_t first_pin);
 	ModelComponent* description() const { return m_comp_desc; }
+	Simulator* sim() const { return m_sim; }
 	uint32_t id() const { return m_id; }
 
 	void apply_initial_values();
 
+	// parameters: compiled from the properties of the description when the component is created.
+	//	Call compile_parameters after changing the properties of the description of a live component.
+	void compile_parameters();
+	const SimComponentParams &params() const { return m_params ? *m_params : DEFAULT_PARAMS; }
+
+	// renumbering: change the id of the component and remap its pins (pin_map: old pin -> new pin)
+	void renumber(uint32_t id, const pin_container_t &pin_map);
+
 	// pins
 	pin_t pin_by_index(uint32_t index) const;
 	uint32_t input_pin_index(uint32_t index) const { return index; }
 	uint32_t output_pin_index(uint32_t index) const { return m_output_start + index; }
 	uint32_t control_pin_index(uint32_t index) const { return m_control_start + index; }
-	const pin_container_t& pins() const { return m_pins; }
+	pin_container_t pins() const;
+	size_t num_pins() const { return m_num_pins; }
 	pin_container_t input_pins() const;
 	pin_container_t output_pins() const;
 	pin_container_t control_pins() const;
 	size_t num_inputs() const { return m_output_start; }
 	size_t num_outputs() const { return m_control_start - m_output_start; }
-	size_t num_controls() const { return m_pins.size() - m_control_start; }
+	size_t num_controls() const { return m_num_pins - m_control_start; }
 
 	// read/write_pin: read/write the value of the node the specified pin connects to
 	Value read_pin(uint32_t index) const;
@@ -44,6 +69,7 @@ public:
 	bool read_pin_checked(uint32_t index);
 	void write_pin_checked(uint32_t index, bool value);
 	void reset_bad_read_check() { m_read_bad = false; }
+	bool read_bad() const { return m_read_bad; }
 
 	// user_values: input from outside the circuit
 	void enable_user_values();
@@ -55,23 +81,41 @@ public:
 	void set_nested_instance(std::unique_ptr<SimCircuit> instance);
 	SimCircuit* nested_instance() const { return m_nested_circuit.get(); }
 
+	// memory footprint: the component, its vectors and its nested circuit
+	void memory_usage(MemoryReport *report) const;
+
 	// extra-data: component specific data structure
 	void set_extra_data_size(size_t size) { m_extra_data.resize(size); };
 	uint8_t* extra_data() { return m_extra_data.data(); }
+	size_t extra_data_size() const { return m_extra_data.size(); }
+
+	// state: copy of the data that changes while simulating (user values and extra data)
+	struct State {
+		value_container_t		m_user_values;
+		std::vector<uint8_t>	m_extra_data;
+	};
+	State save_state(bool with_extra_data) const;
+	void restore_state(const State &state);			// extra data is only restored when it was saved
+
+private:
+	static const SimComponentParams DEFAULT_PARAMS;
 
 private:
 	Simulator* m_sim;
 	ModelComponent* m_comp_desc;
 	uint32_t m_id;
 
-	pin_container_t m_pins;
-	value_container_t m_user_values;
-	std::vector<uint8_t> m_extra_data;
-
+	// the pins of a component are always numbered consecutively (also after renumbering)
+	pin_t m_first_pin;
+	uint32_t m_num_pins;
 	uint32_t m_output_start;
 	uint32_t m_control_start;
 	bool m_read_bad;
 
+	value_container_t m_user_values;
+	std::vector<uint8_t> m_extra_data;
+	std::unique_ptr<SimComponentParams> m_params;
+
 	std::unique_ptr<SimCircuit>    m_nested_circuit;
 };
 
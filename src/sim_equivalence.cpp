@@ -0,0 +1,495 @@
+// sim_equivalence.cpp - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// equivalence checking: simulate two circuits on the same input vectors and compare their outputs
+
+#include "sim_equivalence.h"
+#include "model_circuit.h"
+#include "sim_circuit.h"
+#include "sim_component.h"
+#include "sim_functions.h"
+#include "simulator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iterator>
+#include <limits>
+#include <thread>
+
+namespace lsim {
+
+namespace {
+
+using word_t = uint64_t;
+
+const word_t WORD_ONES = ~word_t(0);
+const size_t WORD_BITS = 64;
+const uint64_t BLOCKS_PER_CHUNK = 256;
+
+// nodes not driven by a gate
+const int DRIVER_NONE = -1;
+const int DRIVER_INPUT = -2;
+const int DRIVER_CONSTANT = -3;
+
+enum class NetOp : uint8_t {
+    BUFFER,
+    AND,
+    OR,
+    XOR
+};
+
+struct NetGate {
+    NetOp       m_op;
+    bool        m_invert;
+    node_t      m_output;
+    uint32_t    m_first_input;      // index in Netlist::m_gate_inputs
+    uint32_t    m_num_inputs;
+};
+
+// Netlist: a circuit flattened into gates, ordered so each gate comes after the gates driving its inputs
+class Netlist {
+public:
+    bool build(ModelCircuit *circuit, const std::vector<std::string> &inputs, const std::vector<std::string> &outputs,
+               std::string *error);
+
+    size_t num_nodes() const {return m_num_nodes;}
+    void evaluate(const word_t *input_words, word_t *output_words, word_t *nodes) const;
+
+private:
+    bool add_gate(NetOp op, bool invert, const node_container_t &inputs, node_t output);
+    bool levelize(std::string *error);
+
+private:
+    size_t                  m_num_nodes = 0;
+    std::vector<int>        m_drivers;              // gate driving each node (or one of the DRIVER_* values)
+    std::vector<NetGate>    m_gates;
+    node_container_t        m_gate_inputs;
+    std::vector<std::pair<node_t, word_t>> m_constants;
+    node_container_t        m_input_nodes;
+    node_container_t        m_output_nodes;
+};
+
+bool Netlist::build(ModelCircuit *circuit, const std::vector<std::string> &inputs,
+                    const std::vector<std::string> &outputs, std::string *error) {
+    Simulator sim;
+    sim_register_component_functions(&sim);
+    auto instance = circuit->instantiate(&sim);
+
+    m_num_nodes = sim.num_nodes();
+    m_drivers.assign(m_num_nodes, DRIVER_NONE);
+
+    for (const auto &name : inputs) {
+        auto node_id = instance->pin_node(circuit->port_by_name(name.c_str()));
+        if (m_drivers[node_id] != DRIVER_NONE) {
+            *error = circuit->name() + ": input " + name + " is connected to another input";
+            return false;
+        }
+        m_drivers[node_id] = DRIVER_INPUT;
+        m_input_nodes.push_back(node_id);
+    }
+
+    for (const auto &name : outputs) {
+        m_output_nodes.push_back(instance->pin_node(circuit->port_by_name(name.c_str())));
+    }
+
+    std::vector<std::pair<node_t, Value>> pulls;
+
+    for (uint32_t comp_id = 0; comp_id < sim.num_components(); ++comp_id) {
+        auto comp = sim.component_by_id(comp_id);
+        if (comp == nullptr) {
+            continue;
+        }
+
+        auto type = comp->description()->type();
+        auto input_nodes = [&]() {
+            node_container_t nodes;
+            for (uint32_t idx = 0; idx < comp->num_inputs(); ++idx) {
+                nodes.push_back(sim.pin_node(comp->pin_by_index(comp->input_pin_index(idx))));
+            }
+            return nodes;
+        };
+        auto output_node = [&](uint32_t idx) {
+            return sim.pin_node(comp->pin_by_index(comp->output_pin_index(idx)));
+        };
+
+        bool ok = true;
+
+        switch (type) {
+            case COMPONENT_CONNECTOR_IN:
+            case COMPONENT_CONNECTOR_OUT:
+            case COMPONENT_VIA:
+            case COMPONENT_SUB_CIRCUIT:
+            case COMPONENT_TEXT:
+                // only connect nodes
+                break;
+            case COMPONENT_CONSTANT:
+            case COMPONENT_PULL_RESISTOR: {
+                auto value = comp->params().m_value;
+                if (value != VALUE_TRUE && value != VALUE_FALSE) {
+                    *error = circuit->name() + ": constants and pull resistors must be true or false";
+                    return false;
+                }
+                auto node_id = sim.pin_node(comp->pin_by_index(0));
+                if (type == COMPONENT_PULL_RESISTOR) {
+                    pulls.emplace_back(node_id, value);
+                } else if (m_drivers[node_id] == DRIVER_NONE || m_drivers[node_id] == DRIVER_CONSTANT) {
+                    m_drivers[node_id] = DRIVER_CONSTANT;
+                    m_constants.emplace_back(node_id, value == VALUE_TRUE ? WORD_ONES : 0);
+                } else {
+                    ok = false;
+                }
+                break;
+            }
+            case COMPONENT_BUFFER: {
+                auto nodes = input_nodes();
+                for (uint32_t idx = 0; idx < comp->num_outputs() && ok; ++idx) {
+                    ok = add_gate(NetOp::BUFFER, false, {nodes[idx]}, output_node(idx));
+                }
+                break;
+            }
+            case COMPONENT_NOT_GATE:
+                ok = add_gate(NetOp::BUFFER, true, input_nodes(), output_node(0));
+                break;
+            case COMPONENT_AND_GATE:
+            case COMPONENT_NAND_GATE:
+                ok = add_gate(NetOp::AND, type == COMPONENT_NAND_GATE, input_nodes(), output_node(0));
+                break;
+            case COMPONENT_OR_GATE:
+            case COMPONENT_NOR_GATE:
+                ok = add_gate(NetOp::OR, type == COMPONENT_NOR_GATE, input_nodes(), output_node(0));
+                break;
+            case COMPONENT_XOR_GATE:
+            case COMPONENT_XNOR_GATE:
+                ok = add_gate(NetOp::XOR, type == COMPONENT_XNOR_GATE, input_nodes(), output_node(0));
+                break;
+            default:
+                *error = circuit->name() + ": component type " + std::to_string(type) +
+                         " can't be checked (only combinational logic is supported)";
+                return false;
+        }
+
+        if (!ok) {
+            *error = circuit->name() + ": a node is driven by more than one component";
+            return false;
+        }
+    }
+
+    // a pull resistor only determines the value of a node nothing else drives
+    for (const auto &pull : pulls) {
+        if (m_drivers[pull.first] == DRIVER_NONE) {
+            m_drivers[pull.first] = DRIVER_CONSTANT;
+            m_constants.emplace_back(pull.first, pull.second == VALUE_TRUE ? WORD_ONES : 0);
+        }
+    }
+
+    for (auto node_id : m_gate_inputs) {
+        if (m_drivers[node_id] == DRIVER_NONE) {
+            *error = circuit->name() + ": a gate has an input that isn't driven";
+            return false;
+        }
+    }
+
+    for (size_t idx = 0; idx < outputs.size(); ++idx) {
+        if (m_drivers[m_output_nodes[idx]] == DRIVER_NONE) {
+            *error = circuit->name() + ": output " + outputs[idx] + " isn't driven";
+            return false;
+        }
+    }
+
+    if (!levelize(error)) {
+        *error = circuit->name() + ": " + *error;
+        return false;
+    }
+
+    return true;
+}
+
+bool Netlist::add_gate(NetOp op, bool invert, const node_container_t &inputs, node_t output) {
+    if (m_drivers[output] != DRIVER_NONE) {
+        return false;
+    }
+
+    m_drivers[output] = static_cast<int>(m_gates.size());
+    m_gates.push_back({op, invert, output, static_cast<uint32_t>(m_gate_inputs.size()),
+                       static_cast<uint32_t>(inputs.size())});
+    m_gate_inputs.insert(m_gate_inputs.end(), inputs.begin(), inputs.end());
+    return true;
+}
+
+bool Netlist::levelize(std::string *error) {
+    // topological sort: a gate is ready once all the gates driving its inputs are placed
+    const auto num_gates = m_gates.size();
+    std::vector<uint32_t> pending(num_gates, 0);
+    std::vector<std::vector<uint32_t>> fanout(num_gates);
+
+    for (uint32_t gate_idx = 0; gate_idx < num_gates; ++gate_idx) {
+        const auto &gate = m_gates[gate_idx];
+        for (auto idx = gate.m_first_input; idx < gate.m_first_input + gate.m_num_inputs; ++idx) {
+            auto driver = m_drivers[m_gate_inputs[idx]];
+            if (driver >= 0) {
+                fanout[driver].push_back(gate_idx);
+                pending[gate_idx] += 1;
+            }
+        }
+    }
+
+    std::vector<uint32_t> order;
+    order.reserve(num_gates);
+    for (uint32_t gate_idx = 0; gate_idx < num_gates; ++gate_idx) {
+        if (pending[gate_idx] == 0) {
+            order.push_back(gate_idx);
+        }
+    }
+
+    for (size_t next = 0; next < order.size(); ++next) {
+        for (auto gate_idx : fanout[order[next]]) {
+            if (--pending[gate_idx] == 0) {
+                order.push_back(gate_idx);
+            }
+        }
+    }
+
+    if (order.size() != num_gates) {
+        *error = "the circuit contains a feedback loop";
+        return false;
+    }
+
+    std::vector<NetGate> gates;
+    gates.reserve(num_gates);
+    for (auto gate_idx : order) {
+        gates.push_back(m_gates[gate_idx]);
+    }
+    m_gates = std::move(gates);
+
+    return true;
+}
+
+void Netlist::evaluate(const word_t *input_words, word_t *output_words, word_t *nodes) const {
+    for (const auto &constant : m_constants) {
+        nodes[constant.first] = constant.second;
+    }
+
+    for (size_t idx = 0; idx < m_input_nodes.size(); ++idx) {
+        nodes[m_input_nodes[idx]] = input_words[idx];
+    }
+
+    for (const auto &gate : m_gates) {
+        auto input = &m_gate_inputs[gate.m_first_input];
+        auto word = nodes[input[0]];
+
+        switch (gate.m_op) {
+            case NetOp::BUFFER:
+                break;
+            case NetOp::AND:
+                for (uint32_t idx = 1; idx < gate.m_num_inputs; ++idx) {
+                    word &= nodes[input[idx]];
+                }
+                break;
+            case NetOp::OR:
+                for (uint32_t idx = 1; idx < gate.m_num_inputs; ++idx) {
+                    word |= nodes[input[idx]];
+                }
+                break;
+            case NetOp::XOR:
+                for (uint32_t idx = 1; idx < gate.m_num_inputs; ++idx) {
+                    word ^= nodes[input[idx]];
+                }
+                break;
+        }
+
+        nodes[gate.m_output] = gate.m_invert ? ~word : word;
+    }
+
+    for (size_t idx = 0; idx < m_output_nodes.size(); ++idx) {
+        output_words[idx] = nodes[m_output_nodes[idx]];
+    }
+}
+
+uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Stimulus: the input words of a block of 64 vectors. Derived from the block index only, so the threads can pick up
+//  blocks in any order and a diverging vector can be reproduced.
+class Stimulus {
+public:
+    Stimulus(size_t num_inputs, bool exhaustive, uint64_t seed) :
+            m_num_inputs(num_inputs),
+            m_exhaustive(exhaustive),
+            m_seed(seed) {
+    }
+
+    void generate(uint64_t block, word_t *words) const {
+        // exhaustive: vector v sets input i to bit i of v; the lowest six bits vary within a word
+        static const word_t PATTERNS[] = {
+            0xaaaaaaaaaaaaaaaaull, 0xccccccccccccccccull, 0xf0f0f0f0f0f0f0f0ull,
+            0xff00ff00ff00ff00ull, 0xffff0000ffff0000ull, 0xffffffff00000000ull
+        };
+
+        for (size_t idx = 0; idx < m_num_inputs; ++idx) {
+            if (!m_exhaustive) {
+                words[idx] = splitmix64(m_seed ^ splitmix64(block * m_num_inputs + idx));
+            } else if (idx < 6) {
+                words[idx] = PATTERNS[idx];
+            } else {
+                words[idx] = (((block * WORD_BITS) >> idx) & 1) ? WORD_ONES : 0;
+            }
+        }
+    }
+
+private:
+    size_t      m_num_inputs;
+    bool        m_exhaustive;
+    uint64_t    m_seed;
+};
+
+std::vector<std::string> port_names(ModelCircuit *circuit, bool input) {
+    std::vector<std::string> result;
+    auto count = input ? circuit->num_input_ports() : circuit->num_output_ports();
+    for (uint32_t idx = 0; idx < count; ++idx) {
+        result.push_back(circuit->port_name(input, idx));
+    }
+    return result;
+}
+
+bool same_ports(std::vector<std::string> a, std::vector<std::string> b) {
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    return a == b;
+}
+
+} // unnamed namespace
+
+EquivalenceResult check_equivalence(ModelCircuit *circuit_a, ModelCircuit *circuit_b,
+                                    const EquivalenceOptions &options) {
+    assert(circuit_a);
+    assert(circuit_b);
+
+    EquivalenceResult result;
+    result.m_input_names = port_names(circuit_a, true);
+    result.m_output_names = port_names(circuit_a, false);
+
+    if (!same_ports(result.m_input_names, port_names(circuit_b, true)) ||
+        !same_ports(result.m_output_names, port_names(circuit_b, false))) {
+        result.m_error = "the circuits don't have the same ports";
+        return result;
+    }
+
+    Netlist netlist_a;
+    Netlist netlist_b;
+    if (!netlist_a.build(circuit_a, result.m_input_names, result.m_output_names, &result.m_error) ||
+        !netlist_b.build(circuit_b, result.m_input_names, result.m_output_names, &result.m_error)) {
+        return result;
+    }
+
+    const auto num_inputs = result.m_input_names.size();
+    const auto num_outputs = result.m_output_names.size();
+
+    result.m_exhaustive = num_inputs <= std::min<size_t>(options.m_max_exhaustive_inputs, WORD_BITS - 1);
+    const uint64_t num_vectors = result.m_exhaustive ? uint64_t(1) << num_inputs : options.m_num_random_vectors;
+    const uint64_t num_blocks = (num_vectors + WORD_BITS - 1) / WORD_BITS;
+    const Stimulus stimulus(num_inputs, result.m_exhaustive, options.m_seed);
+
+    // lanes of the last block beyond the requested number of vectors aren't compared
+    auto lane_mask = [=](uint64_t block) {
+        auto lanes = std::min<uint64_t>(num_vectors - block * WORD_BITS, WORD_BITS);
+        return lanes == WORD_BITS ? WORD_ONES : (word_t(1) << lanes) - 1;
+    };
+
+    std::atomic<uint64_t> next_chunk{0};
+    std::atomic<uint64_t> first_diverging{std::numeric_limits<uint64_t>::max()};
+
+    auto check_blocks = [&]() {
+        std::vector<word_t> inputs(num_inputs);
+        std::vector<word_t> outputs_a(num_outputs);
+        std::vector<word_t> outputs_b(num_outputs);
+        std::vector<word_t> nodes_a(netlist_a.num_nodes());
+        std::vector<word_t> nodes_b(netlist_b.num_nodes());
+
+        for (;;) {
+            // chunks are handed out in order: once a divergence is found only earlier vectors still matter
+            auto first = next_chunk.fetch_add(BLOCKS_PER_CHUNK);
+            if (first >= num_blocks || first * WORD_BITS >= first_diverging.load()) {
+                return;
+            }
+
+            auto last = std::min(first + BLOCKS_PER_CHUNK, num_blocks);
+            for (auto block = first; block < last; ++block) {
+                stimulus.generate(block, inputs.data());
+                netlist_a.evaluate(inputs.data(), outputs_a.data(), nodes_a.data());
+                netlist_b.evaluate(inputs.data(), outputs_b.data(), nodes_b.data());
+
+                word_t diff = 0;
+                for (size_t idx = 0; idx < num_outputs; ++idx) {
+                    diff |= outputs_a[idx] ^ outputs_b[idx];
+                }
+                diff &= lane_mask(block);
+
+                if (diff != 0) {
+                    uint64_t lane = 0;
+                    while (((diff >> lane) & 1) == 0) {
+                        ++lane;
+                    }
+
+                    auto vector = block * WORD_BITS + lane;
+                    auto current = first_diverging.load();
+                    while (vector < current && !first_diverging.compare_exchange_weak(current, vector)) {
+                    }
+                    return;
+                }
+            }
+        }
+    };
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    const size_t num_threads = 1;
+#else
+    auto num_threads = options.m_num_threads;
+    if (num_threads == 0) {
+        num_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    num_threads = std::max<size_t>(std::min<uint64_t>(num_threads, (num_blocks + BLOCKS_PER_CHUNK - 1) / BLOCKS_PER_CHUNK), 1);
+#endif
+
+    std::vector<std::thread> threads;
+    for (size_t idx = 1; idx < num_threads; ++idx) {
+        threads.emplace_back(check_blocks);
+    }
+    check_blocks();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    if (first_diverging.load() == std::numeric_limits<uint64_t>::max()) {
+        result.m_equivalent = true;
+        result.m_num_vectors = num_vectors;
+        return result;
+    }
+
+    // reproduce the diverging vector
+    result.m_vector = first_diverging.load();
+    result.m_num_vectors = result.m_vector + 1;
+
+    const auto block = result.m_vector / WORD_BITS;
+    const auto lane = result.m_vector % WORD_BITS;
+    std::vector<word_t> inputs(num_inputs);
+    std::vector<word_t> outputs_a(num_outputs);
+    std::vector<word_t> outputs_b(num_outputs);
+    std::vector<word_t> nodes(std::max(netlist_a.num_nodes(), netlist_b.num_nodes()));
+
+    stimulus.generate(block, inputs.data());
+    netlist_a.evaluate(inputs.data(), outputs_a.data(), nodes.data());
+    netlist_b.evaluate(inputs.data(), outputs_b.data(), nodes.data());
+
+    auto lane_value = [=](word_t word) {return ((word >> lane) & 1) ? VALUE_TRUE : VALUE_FALSE;};
+    std::transform(inputs.begin(), inputs.end(), std::back_inserter(result.m_inputs), lane_value);
+    std::transform(outputs_a.begin(), outputs_a.end(), std::back_inserter(result.m_outputs_a), lane_value);
+    std::transform(outputs_b.begin(), outputs_b.end(), std::back_inserter(result.m_outputs_b), lane_value);
+
+    return result;
+}
+
+} // namespace lsim
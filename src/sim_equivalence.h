@@ -0,0 +1,48 @@
+// sim_equivalence.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// equivalence checking: simulate two circuits on the same input vectors and compare their outputs
+
+#ifndef LSIM_SIM_EQUIVALENCE_H
+#define LSIM_SIM_EQUIVALENCE_H
+
+#include "sim_types.h"
+
+#include <string>
+#include <vector>
+
+namespace lsim {
+
+class ModelCircuit;
+
+struct EquivalenceOptions {
+    uint32_t    m_max_exhaustive_inputs = 24;       // check all input combinations up to this number of inputs
+    uint64_t    m_num_random_vectors = 1 << 24;     // number of random vectors for larger circuits
+    uint64_t    m_seed = 1;
+    size_t      m_num_threads = 0;                  // 0 = one for each hardware thread
+};
+
+struct EquivalenceResult {
+    bool        m_equivalent = false;
+    bool        m_exhaustive = false;
+    uint64_t    m_num_vectors = 0;                  // number of vectors checked (up to the first diverging vector)
+    std::string m_error;                            // the circuits could not be compared
+
+    // first diverging vector: ports in the order of the first circuit
+    uint64_t                    m_vector = 0;
+    std::vector<std::string>    m_input_names;
+    std::vector<std::string>    m_output_names;
+    value_container_t           m_inputs;
+    value_container_t           m_outputs_a;
+    value_container_t           m_outputs_b;
+};
+
+// check_equivalence: both circuits need the same input and output ports (matched by name) and may only contain
+//  combinational logic (gates, buffers, constants and sub-circuits built from them). Each circuit is flattened into a
+//  levelized two-state netlist that evaluates 64 input vectors at once, one in every bit of a machine word. The vectors
+//  are split over several threads; the reported divergence is always the first one in vector order.
+EquivalenceResult check_equivalence(ModelCircuit *circuit_a, ModelCircuit *circuit_b,
+                                    const EquivalenceOptions &options = EquivalenceOptions());
+
+} // namespace lsim
+
+#endif // LSIM_SIM_EQUIVALENCE_H
@@ -41,6 +41,10 @@ using sim_component_functions_t = std::array<simulation_func_t, 3>;
 
 void sim_register_component_functions(Simulator *sim);
 
+// 7-segment LED: fraction of the time each segment was lit since the previous call, starts a new window.
+//  Returns false when no time has passed since the previous call.
+bool sim_7_segment_led_sample(SimComponent *comp, float fractions[8]);
+
 } // namespace lsim
 
 
@@ -5,6 +5,26 @@
 #include "sim_functions.h"
 #include "simulator.h"
 
+namespace {
+
+using namespace lsim;
+
+// two-state kernels: only valid while every node holds VALUE_FALSE or VALUE_TRUE (Simulator::two_state)
+template <typename OP>
+inline int fold_inputs(SimComponent *comp, OP op) {
+    auto output = static_cast<int>(comp->read_pin(0));
+    for (auto idx = 1u; idx < comp->num_inputs(); ++idx) {
+        output = op(output, static_cast<int>(comp->read_pin(idx)));
+    }
+    return output;
+}
+
+inline int and_op(int a, int b) {return a & b;}
+inline int or_op(int a, int b) {return a | b;}
+inline int xor_op(int a, int b) {return a ^ b;}
+
+} // unnamed namespace
+
 namespace lsim {
 
 void sim_register_gate_functions(Simulator *sim) {
@@ -30,6 +50,11 @@ void sim_register_gate_functions(Simulator *sim) {
     } SIM_FUNC_END
 
     SIM_INPUT_CHANGED_FUNC_BEGIN(AND_GATE) {
+        if (sim->two_state()) {
+            comp->write_pin(comp->output_pin_index(0), static_cast<Value>(fold_inputs(comp, and_op)));
+            return;
+        }
+
         comp->reset_bad_read_check();
 
         bool output = comp->read_pin_checked(0);
@@ -40,6 +65,11 @@ void sim_register_gate_functions(Simulator *sim) {
     } SIM_FUNC_END
 
     SIM_INPUT_CHANGED_FUNC_BEGIN(OR_GATE) {
+        if (sim->two_state()) {
+            comp->write_pin(comp->output_pin_index(0), static_cast<Value>(fold_inputs(comp, or_op)));
+            return;
+        }
+
         comp->reset_bad_read_check();
 
         bool output = comp->read_pin_checked(0);
@@ -50,12 +80,22 @@ void sim_register_gate_functions(Simulator *sim) {
     } SIM_FUNC_END
 
     SIM_INPUT_CHANGED_FUNC_BEGIN(NOT_GATE) {
+        if (sim->two_state()) {
+            comp->write_pin(1, static_cast<Value>(comp->read_pin(0) ^ 1));
+            return;
+        }
+
         comp->reset_bad_read_check();
         auto input = comp->read_pin_checked(0);
         comp->write_pin_checked(1, !input);
     } SIM_FUNC_END
 
     SIM_INPUT_CHANGED_FUNC_BEGIN(NAND_GATE) {
+        if (sim->two_state()) {
+            comp->write_pin(comp->output_pin_index(0), static_cast<Value>(fold_inputs(comp, and_op) ^ 1));
+            return;
+        }
+
         comp->reset_bad_read_check();
 
         bool output = comp->read_pin_checked(0);
@@ -66,6 +106,11 @@ void sim_register_gate_functions(Simulator *sim) {
     } SIM_FUNC_END
 
     SIM_INPUT_CHANGED_FUNC_BEGIN(NOR_GATE) {
+        if (sim->two_state()) {
+            comp->write_pin(comp->output_pin_index(0), static_cast<Value>(fold_inputs(comp, or_op) ^ 1));
+            return;
+        }
+
         comp->reset_bad_read_check();
 
         bool output = comp->read_pin_checked(0);
@@ -76,6 +121,11 @@ void sim_register_gate_functions(Simulator *sim) {
     } SIM_FUNC_END
 
     SIM_INPUT_CHANGED_FUNC_BEGIN(XOR_GATE) {
+        if (sim->two_state()) {
+            comp->write_pin(2, static_cast<Value>(fold_inputs(comp, xor_op)));
+            return;
+        }
+
         comp->reset_bad_read_check();
 
         auto output = comp->read_pin_checked(0);
@@ -84,6 +134,11 @@ void sim_register_gate_functions(Simulator *sim) {
     } SIM_FUNC_END
 
     SIM_INPUT_CHANGED_FUNC_BEGIN(XNOR_GATE) {
+        if (sim->two_state()) {
+            comp->write_pin(2, static_cast<Value>(fold_inputs(comp, xor_op) ^ 1));
+            return;
+        }
+
         comp->reset_bad_read_check();
 
         auto output = comp->read_pin_checked(0);
@@ -0,0 +1,224 @@
+// sim_history.cpp - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// step backwards through a simulation: periodic snapshots and replay of the recorded inputs
+
+#include "sim_history.h"
+#include "sim_component.h"
+#include "simulator.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace lsim {
+
+constexpr size_t SimHistory::DEFAULT_MEMORY_BUDGET;
+constexpr timestamp_t SimHistory::INITIAL_INTERVAL;
+
+SimHistory::SimHistory(Simulator *sim, size_t memory_budget) :
+        m_sim(sim),
+        m_memory_budget(memory_budget) {
+    assert(sim);
+    m_listener = m_sim->add_input_listener(
+            [this](SimComponent *comp, uint32_t index, Value value) {record_input(comp, index, value);},
+            [this](SimComponent *comp) {record_schedule(comp);});
+    restart();
+}
+
+SimHistory::~SimHistory() {
+    m_sim->remove_input_listener(m_listener);
+}
+
+void SimHistory::restart() {
+    m_time = m_sim->current_time();
+    m_last_time = m_time;
+    m_interval = INITIAL_INTERVAL;
+    m_snapshots.clear();
+    m_snapshot_memory = 0;
+    m_inputs.clear();
+    m_schedule_states.clear();
+    m_schedule_memory = 0;
+    m_next_input = 0;
+
+    take_snapshot();
+}
+
+void SimHistory::step() {
+    check_time();
+
+    m_sim->step();
+    m_time = m_sim->current_time();
+    m_last_time = std::max(m_last_time, m_time);
+
+    // snapshots are taken before the inputs of their timestamp are applied
+    if ((m_time - first_time()) % m_interval == 0 && m_snapshots.back().m_time < m_time) {
+        take_snapshot();
+    }
+
+    apply_inputs();
+}
+
+void SimHistory::run(size_t num_steps) {
+    for (size_t idx = 0; idx < num_steps; ++idx) {
+        step();
+    }
+}
+
+bool SimHistory::step_back(size_t num_steps) {
+    check_time();
+
+    if (num_steps > m_time - first_time()) {
+        return false;
+    }
+
+    return goto_time(m_time - num_steps);
+}
+
+bool SimHistory::goto_time(timestamp_t time) {
+    check_time();
+
+    if (time < first_time()) {
+        return false;
+    }
+
+    if (time < m_time) {
+        // restore the nearest snapshot at or before the requested time
+        auto found = std::upper_bound(m_snapshots.begin(), m_snapshots.end(), time,
+                                      [](timestamp_t t, const Snapshot &snapshot) {return t < snapshot.m_time;});
+        assert(found != m_snapshots.begin());
+        --found;
+
+        m_replaying = true;
+        auto loaded = m_sim->load_checkpoint_data(found->m_data, true);
+        m_replaying = false;
+
+        if (!loaded) {
+            // the circuit changed since the snapshot was taken
+            restart();
+            return false;
+        }
+
+        m_time = found->m_time;
+        m_next_input = std::lower_bound(m_inputs.begin(), m_inputs.end(), m_time,
+                                        [](const Input &input, timestamp_t t) {return input.m_time < t;}) -
+                       m_inputs.begin();
+        apply_inputs();
+    }
+
+    while (m_time < time) {
+        step();
+    }
+
+    return true;
+}
+
+timestamp_t SimHistory::first_time() const {
+    return m_snapshots.front().m_time;
+}
+
+size_t SimHistory::memory_used() const {
+    return m_snapshot_memory +
+           m_snapshots.capacity() * sizeof(Snapshot) +
+           m_inputs.capacity() * sizeof(Input) +
+           m_schedule_memory +
+           m_schedule_states.capacity() * sizeof(std::vector<uint8_t>);
+}
+
+void SimHistory::record_input(SimComponent *comp, uint32_t index, Value value) {
+    if (m_replaying) {
+        return;
+    }
+
+    start_input();
+    m_inputs.push_back({m_time, comp->id(), index, value, INPUT_USER_VALUE});
+    m_next_input = m_inputs.size();
+}
+
+void SimHistory::record_schedule(SimComponent *comp) {
+    if (m_replaying) {
+        return;
+    }
+
+    // the internal state of the component may have been modified from outside the simulation: keep a copy to restore
+    start_input();
+    auto state_idx = static_cast<uint32_t>(m_schedule_states.size());
+    m_schedule_states.emplace_back(comp->extra_data(), comp->extra_data() + comp->extra_data_size());
+    m_schedule_memory += m_schedule_states.back().capacity();
+    m_inputs.push_back({m_time, comp->id(), state_idx, VALUE_UNDEFINED, INPUT_SCHEDULE});
+    m_next_input = m_inputs.size();
+}
+
+void SimHistory::start_input() {
+    check_time();
+
+    // a new input in the past starts a new timeline
+    if (m_last_time > m_time) {
+        m_inputs.resize(m_next_input);
+
+        auto num_states = std::count_if(m_inputs.begin(), m_inputs.end(),
+                                        [](const Input &input) {return input.m_kind == INPUT_SCHEDULE;});
+        while (m_schedule_states.size() > static_cast<size_t>(num_states)) {
+            m_schedule_memory -= m_schedule_states.back().capacity();
+            m_schedule_states.pop_back();
+        }
+
+        while (m_snapshots.size() > 1 && m_snapshots.back().m_time > m_time) {
+            m_snapshot_memory -= m_snapshots.back().m_data.size();
+            m_snapshots.pop_back();
+        }
+        m_last_time = m_time;
+    }
+}
+
+void SimHistory::check_time() {
+    // the simulator was stepped or reset behind our back: the recording isn't valid anymore
+    if (m_sim->current_time() != m_time) {
+        restart();
+    }
+}
+
+void SimHistory::apply_inputs() {
+    m_replaying = true;
+
+    while (m_next_input < m_inputs.size() && m_inputs[m_next_input].m_time <= m_time) {
+        const auto &input = m_inputs[m_next_input++];
+        auto comp = m_sim->component_by_id(input.m_comp_id);
+
+        if (input.m_kind == INPUT_USER_VALUE) {
+            comp->set_user_value(input.m_index, input.m_value);
+        } else {
+            const auto &state = m_schedule_states[input.m_index];
+            assert(state.size() == comp->extra_data_size());
+            std::copy(state.begin(), state.end(), comp->extra_data());
+            m_sim->schedule_input_changed(comp);
+        }
+    }
+
+    m_replaying = false;
+}
+
+void SimHistory::take_snapshot() {
+    m_snapshots.push_back({m_time, m_sim->save_checkpoint_data(true)});
+    m_snapshot_memory += m_snapshots.back().m_data.size();
+
+    while (m_snapshot_memory > m_memory_budget && m_snapshots.size() > 2) {
+        thin_snapshots();
+    }
+}
+
+void SimHistory::thin_snapshots() {
+    // double the interval: drops every other snapshot, the start of the recording is always kept
+    m_interval *= 2;
+
+    const auto start = first_time();
+    const auto interval = m_interval;
+    m_snapshots.erase(std::remove_if(m_snapshots.begin(), m_snapshots.end(), [=](const Snapshot &snapshot) {
+                          return (snapshot.m_time - start) % interval != 0;
+                      }), m_snapshots.end());
+
+    m_snapshot_memory = 0;
+    for (const auto &snapshot : m_snapshots) {
+        m_snapshot_memory += snapshot.m_data.size();
+    }
+}
+
+} // namespace lsim
@@ -0,0 +1,98 @@
+// sim_history.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// step backwards through a simulation: periodic snapshots and replay of the recorded inputs
+
+#ifndef LSIM_SIM_HISTORY_H
+#define LSIM_SIM_HISTORY_H
+
+#include "sim_types.h"
+
+#include <string>
+#include <vector>
+
+namespace lsim {
+
+class SimComponent;
+class Simulator;
+
+// SimHistory: keeps a snapshot (an in-memory checkpoint) of the simulator every snapshot_interval() steps and records
+//  every input in between: the user values written and the components scheduled from outside of the simulation,
+//  with their internal state (e.g. a hot-swapped memory). Going back in time restores the nearest snapshot at or before the requested
+//  time and replays the recorded inputs forward, so it never costs more than one interval of re-simulation.
+//  When the snapshots outgrow the memory budget the interval doubles and every other snapshot is dropped.
+//  Writing an input while in the past starts a new timeline: the recorded future is forgotten.
+//  The simulation must be stepped through the history for the recording to be complete; restart() when the
+//  simulator was initialized, reset or stepped outside of it.
+class SimHistory {
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 64 * 1024 * 1024;
+    static constexpr timestamp_t INITIAL_INTERVAL = 64;
+
+public:
+    explicit SimHistory(Simulator *sim, size_t memory_budget = DEFAULT_MEMORY_BUDGET);
+    ~SimHistory();
+    SimHistory(const SimHistory &) = delete;
+
+    // restart: forget the history and start recording from the current state of the simulator
+    void restart();
+
+    // forward: replays the recorded inputs when stepping through a previously visited part of the timeline
+    void step();
+    void run(size_t num_steps);
+
+    // backward: returns false when the time is before the start of the recording
+    bool step_back(size_t num_steps);
+    bool goto_time(timestamp_t time);
+
+    timestamp_t first_time() const;
+    timestamp_t last_time() const {return m_last_time;}
+    timestamp_t snapshot_interval() const {return m_interval;}
+    size_t num_snapshots() const {return m_snapshots.size();}
+    size_t memory_used() const;
+
+private:
+    struct Snapshot {
+        timestamp_t     m_time;
+        std::string     m_data;
+    };
+
+    enum InputKind : uint8_t {
+        INPUT_USER_VALUE,
+        INPUT_SCHEDULE
+    };
+
+    struct Input {
+        timestamp_t     m_time;
+        uint32_t        m_comp_id;
+        uint32_t        m_index;            // user value: index of the value, schedule: index in m_schedule_states
+        Value           m_value;
+        InputKind       m_kind;
+    };
+
+    void record_input(SimComponent *comp, uint32_t index, Value value);
+    void record_schedule(SimComponent *comp);
+    void start_input();
+    void check_time();
+    void apply_inputs();
+    void take_snapshot();
+    void thin_snapshots();
+
+private:
+    Simulator *             m_sim;
+    size_t                  m_memory_budget;
+    timestamp_t             m_interval = INITIAL_INTERVAL;
+    timestamp_t             m_time = 0;                 // time of the simulator when last seen by the history
+    timestamp_t             m_last_time = 0;            // furthest point of the recorded timeline
+    std::vector<Snapshot>   m_snapshots;                // sorted on time, the first is the start of the recording
+    size_t                  m_snapshot_memory = 0;
+    std::vector<Input>      m_inputs;                   // sorted on time
+    std::vector<std::vector<uint8_t>> m_schedule_states;    // state of the component of each scheduled input
+    size_t                  m_schedule_memory = 0;
+    size_t                  m_next_input = 0;           // first input that wasn't applied yet
+    bool                    m_replaying = false;
+    size_t                  m_listener = 0;             // handle of the input listener registered with the simulator
+};
+
+} // namespace lsim
+
+#endif // LSIM_SIM_HISTORY_H
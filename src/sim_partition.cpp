@@ -0,0 +1,320 @@
+// sim_partition.cpp - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// partitioned simulation: split a circuit over several simulators that run in lock-step
+
+#include "sim_partition.h"
+#include "model_circuit.h"
+#include "model_component.h"
+#include "sim_circuit.h"
+#include "sim_functions.h"
+#include "simulator.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace lsim {
+
+struct PartitionedSimulation::Partition {
+    Simulator                   m_sim;
+    node_container_t            m_mailbox;          // nodes written by this partition in the current step
+    std::vector<timestamp_t>    m_resolved;         // timestamp when a node was last resolved by this partition
+};
+
+void PartitionedSimulation::Barrier::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto generation = m_generation;
+
+    if (++m_waiting == m_count) {
+        m_waiting = 0;
+        ++m_generation;
+        lock.unlock();
+        m_released.notify_all();
+        return;
+    }
+
+    m_released.wait(lock, [&]() {return m_generation != generation;});
+}
+
+PartitionedSimulation::PartitionedSimulation(ModelCircuit *circuit, size_t num_partitions) :
+        m_barrier(num_partitions) {
+    assert(circuit);
+    assert(num_partitions > 0);
+
+    for (size_t idx = 0; idx < num_partitions; ++idx) {
+        m_partitions.push_back(std::make_unique<Partition>());
+        sim_register_component_functions(&m_partitions.back()->m_sim);
+    }
+
+    // the first partition holds the complete circuit, it's the reference for the assignment and the layout of the others
+    auto reference = &m_partitions[0]->m_sim;
+    m_circuit = circuit->instantiate(reference);
+    reference->renumber();
+
+    assign_components();
+
+    if (threaded()) {
+        for (size_t idx = 1; idx < num_partitions; ++idx) {
+            m_workers.emplace_back([=]() {worker_main(idx);});
+        }
+    }
+}
+
+PartitionedSimulation::~PartitionedSimulation() {
+    {
+        std::lock_guard<std::mutex> lock(m_run_mutex);
+        m_quit = true;
+    }
+    m_run_start.notify_all();
+
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+Simulator *PartitionedSimulation::sim(size_t partition) const {
+    assert(partition < m_partitions.size());
+    return &m_partitions[partition]->m_sim;
+}
+
+SimCircuit *PartitionedSimulation::circuit() const {
+    return m_circuit.get();
+}
+
+void PartitionedSimulation::init() {
+    auto &reference = m_partitions[0]->m_sim;
+
+    for (auto &partition : m_partitions) {
+        partition->m_sim.init();
+        if (&partition->m_sim != &reference) {
+            partition->m_sim.copy_node_state(reference);
+        }
+        partition->m_mailbox.clear();
+        partition->m_resolved.assign(partition->m_sim.num_nodes(), 0);
+    }
+
+    std::fill(m_writer_count.begin(), m_writer_count.end(), 0);
+    std::fill(m_writer_value.begin(), m_writer_value.end(), VALUE_UNDEFINED);
+}
+
+void PartitionedSimulation::step() {
+    run(1);
+}
+
+void PartitionedSimulation::run(size_t num_steps) {
+    if (!threaded()) {
+        // same phases, one partition after the other
+        for (size_t s = 0; s < num_steps; ++s) {
+            for (size_t idx = 0; idx < m_partitions.size(); ++idx) {
+                m_partitions[idx]->m_sim.step_components();
+                publish(idx);
+            }
+            for (size_t idx = 0; idx < m_partitions.size(); ++idx) {
+                resolve(idx);
+            }
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_run_mutex);
+        m_run_steps = num_steps;
+        ++m_run_generation;
+    }
+    m_run_start.notify_all();
+
+    // the workers pass the barrier at the end of the last step before this returns: they're idle again
+    run_partition(0, num_steps);
+}
+
+void PartitionedSimulation::write_pin(pin_id_t pin_id, Value value) {
+    // the complete instance keeps all user values, the owner of the component acts on them
+    m_circuit->write_pin(pin_id, value);
+
+    auto comp_id = m_circuit->component_by_id(component_id_from_pin_id(pin_id))->id();
+    auto owner = m_owner[comp_id];
+    if (owner != 0) {
+        m_partitions[owner]->m_sim.component_by_id(comp_id)->set_user_value(pin_index_from_pin_id(pin_id), value);
+    }
+}
+
+Value PartitionedSimulation::read_pin(pin_id_t pin_id) const {
+    // all partitions resolve every written node: the complete instance can be read
+    return m_circuit->read_pin(pin_id);
+}
+
+bool PartitionedSimulation::threaded() const {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    return false;
+#else
+    return m_partitions.size() > 1;
+#endif
+}
+
+void PartitionedSimulation::assign_components() {
+    auto sim = &m_partitions[0]->m_sim;
+    const auto num_parts = m_partitions.size();
+    const auto num_comps = sim->num_components();
+    const auto num_nodes = sim->num_nodes();
+
+    // span of each node: the lowest and highest id of the components connected to it
+    std::vector<size_t> first(num_nodes, num_comps);
+    std::vector<size_t> last(num_nodes, 0);
+    std::vector<size_t> weight(num_comps + 1, 0);
+
+    for (uint32_t id = 0; id < num_comps; ++id) {
+        auto comp = sim->component_by_id(id);
+        if (comp == nullptr) {
+            continue;
+        }
+
+        auto type = comp->description()->type();
+        if (sim->component_has_function(type, SIM_FUNCTION_INPUT_CHANGED) ||
+            sim->component_has_function(type, SIM_FUNCTION_INDEPENDENT)) {
+            weight[id + 1] = 1;
+        }
+
+        for (auto pin : comp->pins()) {
+            auto node_id = sim->pin_node(pin);
+            if (node_id == NODE_INVALID) {
+                continue;
+            }
+            first[node_id] = std::min<size_t>(first[node_id], id);
+            last[node_id] = std::max<size_t>(last[node_id], id);
+        }
+    }
+
+    // crossing[s]: number of nodes cut when splitting the components in [0, s) and [s, num_comps)
+    std::vector<int64_t> crossing(num_comps + 2, 0);
+    for (node_t node_id = 0; node_id < num_nodes; ++node_id) {
+        if (first[node_id] < last[node_id]) {
+            crossing[first[node_id] + 1] += 1;
+            crossing[last[node_id] + 1] -= 1;
+        }
+    }
+    for (size_t s = 1; s < crossing.size(); ++s) {
+        crossing[s] += crossing[s - 1];
+    }
+    for (size_t id = 1; id < weight.size(); ++id) {
+        weight[id] += weight[id - 1];
+    }
+
+    // split points: balance the simulated components, then look around each ideal split for the smallest cut
+    const auto total = weight[num_comps];
+    const auto window = num_comps / (4 * num_parts);
+    std::vector<size_t> split(num_parts + 1, num_comps);
+    split[0] = 0;
+
+    for (size_t part = 1; part < num_parts; ++part) {
+        auto target = total * part / num_parts;
+        auto ideal = static_cast<size_t>(std::lower_bound(weight.begin(), weight.end(), target) - weight.begin());
+        ideal = std::max(ideal, split[part - 1]);
+
+        auto lo = std::max(split[part - 1], ideal > window ? ideal - window : 0);
+        auto hi = std::min(num_comps, ideal + window);
+        auto best = ideal;
+        for (auto s = lo; s <= hi; ++s) {
+            auto dist = [=](size_t x) {return x > ideal ? x - ideal : ideal - x;};
+            if (crossing[s] < crossing[best] || (crossing[s] == crossing[best] && dist(s) < dist(best))) {
+                best = s;
+            }
+        }
+        split[part] = best;
+    }
+
+    m_owner.assign(num_comps, 0);
+    for (size_t part = 0; part < num_parts; ++part) {
+        std::fill(m_owner.begin() + split[part], m_owner.begin() + split[part + 1], part);
+    }
+
+    m_num_cut_nodes = 0;
+    for (node_t node_id = 0; node_id < num_nodes; ++node_id) {
+        if (first[node_id] < last[node_id] && m_owner[first[node_id]] != m_owner[last[node_id]]) {
+            ++m_num_cut_nodes;
+        }
+    }
+
+    // the other partitions only create the components they own
+    for (size_t part = num_parts; part-- > 0; ) {
+        std::vector<uint8_t> owned(num_comps, 0);
+        std::fill(owned.begin() + split[part], owned.begin() + split[part + 1], 1);
+        if (part > 0) {
+            m_partitions[part]->m_sim.instantiate_partition(*sim, std::move(owned));
+        } else {
+            sim->set_owned_components(std::move(owned));
+        }
+    }
+
+    m_writer_count.assign(num_nodes * num_parts, 0);
+    m_writer_value.assign(num_nodes * num_parts, VALUE_UNDEFINED);
+}
+
+void PartitionedSimulation::publish(size_t partition) {
+    const auto num_parts = m_partitions.size();
+    auto &part = *m_partitions[partition];
+
+    part.m_mailbox = part.m_sim.nodes_written();
+
+    for (auto node_id : part.m_mailbox) {
+        m_writer_count[node_id * num_parts + partition] = static_cast<uint32_t>(part.m_sim.node_writer_count(node_id));
+        m_writer_value[node_id * num_parts + partition] = part.m_sim.node_writer_value(node_id);
+    }
+}
+
+void PartitionedSimulation::resolve(size_t partition) {
+    const auto num_parts = m_partitions.size();
+    auto &part = *m_partitions[partition];
+    const auto now = part.m_sim.current_time();
+
+    for (auto &other : m_partitions) {
+        for (auto node_id : other->m_mailbox) {
+            if (part.m_resolved[node_id] == now) {
+                continue;
+            }
+            part.m_resolved[node_id] = now;
+
+            size_t count = 0;
+            Value value = VALUE_UNDEFINED;
+            for (size_t idx = node_id * num_parts; idx < (node_id + 1) * num_parts; ++idx) {
+                if (m_writer_count[idx] == 1) {
+                    value = m_writer_value[idx];
+                }
+                count += m_writer_count[idx];
+            }
+
+            part.m_sim.resolve_node(node_id, count, value);
+        }
+    }
+
+    part.m_sim.end_step_nodes();
+}
+
+void PartitionedSimulation::worker_main(size_t partition) {
+    uint64_t generation = 0;
+
+    while (true) {
+        size_t num_steps = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_run_mutex);
+            m_run_start.wait(lock, [&]() {return m_quit || m_run_generation != generation;});
+            if (m_quit) {
+                return;
+            }
+            generation = m_run_generation;
+            num_steps = m_run_steps;
+        }
+
+        run_partition(partition, num_steps);
+    }
+}
+
+void PartitionedSimulation::run_partition(size_t partition, size_t num_steps) {
+    for (size_t s = 0; s < num_steps; ++s) {
+        m_partitions[partition]->m_sim.step_components();
+        publish(partition);
+        m_barrier.wait();
+        resolve(partition);
+        m_barrier.wait();
+    }
+}
+
+} // namespace lsim
@@ -0,0 +1,95 @@
+// sim_partition.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// partitioned simulation: split a circuit over several simulators that run in lock-step
+
+#ifndef LSIM_SIM_PARTITION_H
+#define LSIM_SIM_PARTITION_H
+
+#include "sim_types.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lsim {
+
+class ModelCircuit;
+class SimCircuit;
+class Simulator;
+
+// PartitionedSimulation: every partition runs the components assigned to it in a simulator of its own. Components are
+//  assigned in contiguous ranges of the renumbered (connectivity) order, with the split points moved to where the
+//  fewest nodes cross between partitions. The first partition instantiates the complete circuit (it is used to look up
+//  pins by pin-id), the others only create their own components on the same pin and node layout.
+//  Each step has two phases separated by a barrier: all partitions run their components and post the nodes they
+//  wrote (with the number of active writers and the written value) in their mailbox, then every partition resolves
+//  all posted nodes. The results are identical to running the circuit in a single simulator.
+//  The first partition runs on the calling thread, the others on worker threads that live as long as the simulation.
+class PartitionedSimulation {
+public:
+    PartitionedSimulation(ModelCircuit *circuit, size_t num_partitions);
+    ~PartitionedSimulation();
+    PartitionedSimulation(const PartitionedSimulation &) = delete;
+
+    size_t num_partitions() const {return m_partitions.size();}
+    size_t num_cut_nodes() const {return m_num_cut_nodes;}
+    Simulator *sim(size_t partition) const;
+    SimCircuit *circuit() const;
+    size_t component_partition(uint32_t sim_comp_id) const {return m_owner[sim_comp_id];}
+
+    // simulation
+    void init();
+    void step();
+    void run(size_t num_steps);
+
+    // read/write the (top-level) circuit
+    void write_pin(pin_id_t pin_id, Value value);
+    Value read_pin(pin_id_t pin_id) const;
+
+private:
+    struct Partition;
+
+    bool threaded() const;
+    void assign_components();
+    void publish(size_t partition);
+    void resolve(size_t partition);
+    void run_partition(size_t partition, size_t num_steps);
+    void worker_main(size_t partition);
+
+private:
+    class Barrier {
+    public:
+        explicit Barrier(size_t count) : m_count(count) {}
+        void wait();
+    private:
+        const size_t            m_count;
+        std::mutex              m_mutex;
+        std::condition_variable m_released;
+        size_t                  m_waiting = 0;
+        uint64_t                m_generation = 0;
+    };
+
+    std::vector<std::unique_ptr<Partition>> m_partitions;
+    std::unique_ptr<SimCircuit> m_circuit;                  // instance of the complete circuit (in the first partition)
+    std::vector<size_t>     m_owner;                        // partition of each simulator component
+    size_t                  m_num_cut_nodes = 0;            // nodes connected to components of several partitions
+    Barrier                 m_barrier;
+
+    // workers: one thread for each partition except the first, started once and woken for every run
+    std::vector<std::thread> m_workers;
+    std::mutex              m_run_mutex;
+    std::condition_variable m_run_start;
+    uint64_t                m_run_generation = 0;
+    size_t                  m_run_steps = 0;
+    bool                    m_quit = false;
+
+    // exchange: the writers of each node as seen by each partition (indexed [node * num_partitions + partition])
+    std::vector<uint32_t>   m_writer_count;
+    std::vector<Value>      m_writer_value;
+};
+
+} // namespace lsim
+
+#endif // LSIM_SIM_PARTITION_H
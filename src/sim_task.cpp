@@ -0,0 +1,140 @@
+// sim_task.cpp - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// run the simulation in the background until a stop condition is met
+
+#include "sim_task.h"
+#include "sim_worker.h"
+#include "simulator.h"
+
+#include <cassert>
+#include <chrono>
+
+namespace lsim {
+
+SimulationTask::SimulationTask(Simulator *sim, const Options &options) :
+        m_sim(sim),
+        m_options(options),
+        m_layout_version(sim->layout_version()) {
+    assert(m_options.m_cycles > 0 || m_options.m_until_pin != PIN_UNDEFINED || m_options.m_until_stable > 0);
+    assert(m_options.m_until_pin == PIN_UNDEFINED || m_options.m_until_pin < sim->num_pins());
+
+    publish();
+    m_thread = std::thread([this]() {task_main();});
+}
+
+SimulationTask::~SimulationTask() {
+    cancel();
+    m_thread.join();
+}
+
+void SimulationTask::cancel() {
+    m_cancel = true;
+}
+
+bool SimulationTask::wait(double timeout_seconds) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (timeout_seconds < 0) {
+        m_done_cv.wait(lock, [this]() {return done();});
+        return true;
+    }
+
+    return m_done_cv.wait_for(lock, std::chrono::duration<double>(timeout_seconds), [this]() {return done();});
+}
+
+SimulationTask::snapshot_ptr_t SimulationTask::snapshot() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_latest;
+}
+
+void SimulationTask::on_done(done_callback_t callback) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_reason.load() == STOP_NONE) {
+        m_done_callback = std::move(callback);
+        return;
+    }
+
+    lock.unlock();
+    callback(reason());
+}
+
+void SimulationTask::task_main() {
+    using clock_t = std::chrono::steady_clock;
+    const auto publish_interval = std::chrono::milliseconds(PUBLISH_INTERVAL_MS);
+
+    auto last_publish = clock_t::now();
+    size_t stable_cycles = 0;
+    auto reason = STOP_NONE;
+
+    while (reason == STOP_NONE) {
+        m_sim->step();
+        ++m_cycles;
+        reason = check_stop(stable_cycles);
+
+        // the clock is only consulted every few cycles, a cycle of a small circuit takes less time than reading it
+        if ((m_cycles.load(std::memory_order_relaxed) & 0xff) == 0 && clock_t::now() - last_publish >= publish_interval) {
+            publish();
+            last_publish = clock_t::now();
+        }
+    }
+
+    publish();
+
+    done_callback_t callback;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_reason = reason;
+        callback = std::move(m_done_callback);
+    }
+
+    if (callback) {
+        callback(reason);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done = true;
+    }
+    m_done_cv.notify_all();
+}
+
+SimulationTask::StopReason SimulationTask::check_stop(size_t &stable_cycles) const {
+    assert(m_sim->layout_version() == m_layout_version);
+
+    if (m_options.m_until_pin != PIN_UNDEFINED && m_sim->read_pin(m_options.m_until_pin) == m_options.m_until_value) {
+        return STOP_PIN;
+    }
+
+    if (m_options.m_until_stable > 0) {
+        stable_cycles = m_sim->nodes_changed().empty() ? stable_cycles + 1 : 0;
+        if (stable_cycles >= m_options.m_until_stable) {
+            return STOP_STABLE;
+        }
+    }
+
+    if (m_options.m_cycles > 0 && m_cycles.load() >= m_options.m_cycles) {
+        return STOP_CYCLES;
+    }
+
+    if (m_cancel.load()) {
+        return STOP_CANCELLED;
+    }
+
+    return STOP_NONE;
+}
+
+void SimulationTask::publish() {
+    // reuse the previous snapshot when no reader holds on to it anymore (it isn't reachable through m_latest)
+    auto snapshot = std::move(m_spare);
+    if (snapshot == nullptr || snapshot.use_count() > 1) {
+        snapshot = std::make_shared<SimSnapshot>();
+    }
+    snapshot->capture(m_sim);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_spare = std::move(m_latest);
+    m_latest = std::move(snapshot);
+}
+
+} // namespace lsim
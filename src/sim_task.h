@@ -0,0 +1,97 @@
+// sim_task.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// run the simulation in the background until a stop condition is met
+
+#ifndef LSIM_SIM_TASK_H
+#define LSIM_SIM_TASK_H
+
+#include "sim_types.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace lsim {
+
+class SimSnapshot;
+
+// SimulationTask: steps a simulator on a thread of its own until one of the stop conditions is met or the task is
+//  cancelled. The simulator belongs to the task while it runs: don't use it (or the circuits instantiated in it)
+//  until the task is done. Progress can be polled and the state of the simulation read from a snapshot, published
+//  regularly while stepping and once more when the task finishes.
+class SimulationTask {
+public:
+    enum StopReason {
+        STOP_NONE,              // still running
+        STOP_CYCLES,            // ran the maximum number of cycles
+        STOP_PIN,               // the pin reached the requested value
+        STOP_STABLE,            // no node changed for the requested number of cycles
+        STOP_CANCELLED
+    };
+
+    struct Options {
+        uint64_t    m_cycles = 0;                   // maximum number of cycles (0 = no limit)
+        pin_t       m_until_pin = PIN_UNDEFINED;    // stop when this pin reads m_until_value
+        Value       m_until_value = VALUE_TRUE;
+        size_t      m_until_stable = 0;             // stop after this many cycles without changes (0 = disabled)
+    };
+
+    using snapshot_ptr_t = std::shared_ptr<SimSnapshot>;
+    using done_callback_t = std::function<void(StopReason reason)>;
+
+    static constexpr int PUBLISH_INTERVAL_MS = 20;
+
+public:
+    // start the task: at least one stop condition is required. m_until_pin has to be taken from the simulator in its
+    //  current layout (i.e. after init), the task itself never renumbers.
+    SimulationTask(Simulator *sim, const Options &options);
+    ~SimulationTask();
+    SimulationTask(const SimulationTask &) = delete;
+
+    // cancel: ask the task to stop after the current cycle (doesn't wait)
+    void cancel();
+
+    // wait: block until the task is done, returns false on timeout (negative timeout = wait forever)
+    bool wait(double timeout_seconds = -1.0);
+
+    bool done() const {return m_done.load();}
+    StopReason reason() const {return m_reason.load();}
+    uint64_t cycles() const {return m_cycles.load();}
+
+    // snapshot: the latest published state of the simulation. The snapshot stays valid (and unchanged) for as long
+    //  as it is referenced, even after newer ones were published.
+    snapshot_ptr_t snapshot() const;
+
+    // on_done: called when the task stops, on the thread of the task (immediately when it already stopped). The task
+    //  is only done, and wait returns, after the callback finished.
+    void on_done(done_callback_t callback);
+
+private:
+    void task_main();
+    StopReason check_stop(size_t &stable_cycles) const;
+    void publish();
+
+private:
+    Simulator *                 m_sim;
+    Options                     m_options;
+    uint32_t                    m_layout_version;       // m_until_pin is only valid for this layout
+    std::atomic<uint64_t>       m_cycles{0};
+    std::atomic<StopReason>     m_reason{STOP_NONE};
+    std::atomic<bool>           m_done{false};
+    std::atomic<bool>           m_cancel{false};
+
+    mutable std::mutex          m_mutex;
+    std::condition_variable     m_done_cv;
+    done_callback_t             m_done_callback;
+    snapshot_ptr_t              m_latest;               // published snapshot
+    snapshot_ptr_t              m_spare;                // previously published, reused once nobody references it
+
+    std::thread                 m_thread;
+};
+
+} // namespace lsim
+
+#endif // LSIM_SIM_TASK_H
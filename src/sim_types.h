@@ -6,7 +6,9 @@
 #define LSIM_SIM_TYPES_H
 
 #include <vector>
+#include <cstddef>
 #include <cstdint>
+#include <utility>
 
 namespace lsim {
 
@@ -24,6 +26,7 @@ enum Value {
 using node_container_t = std::vector<node_t>;
 using pin_container_t = std::vector<pin_t>;
 using value_container_t = std::vector<Value>;
+using pin_pair_container_t = std::vector<std::pair<pin_t, pin_t>>;
 
 const pin_t PIN_UNDEFINED = static_cast<pin_t>(-1);
 const node_t NODE_INVALID = static_cast<node_t>(-1);
@@ -31,6 +34,7 @@ const node_t NODE_INVALID = static_cast<node_t>(-1);
 // pin-ids are used in the circuit description
 using pin_id_t = uint64_t;
 using pin_id_container_t = std::vector<pin_id_t>;
+using pin_id_pair_container_t = std::vector<std::pair<pin_id_t, pin_id_t>>;
 
 // component types - seems okay for now for these to be all listed here, not really expecting much extra types
 using ComponentType = uint32_t;
@@ -50,6 +54,10 @@ const ComponentType COMPONENT_XNOR_GATE = 0x0019;
 const ComponentType COMPONENT_VIA = 0x0020;
 const ComponentType COMPONENT_OSCILLATOR = 0x0021;
 const ComponentType COMPONENT_7_SEGMENT_LED = 0x0101;
+const ComponentType COMPONENT_ROM = 0x0201;
+const ComponentType COMPONENT_RAM = 0x0202;
+const ComponentType COMPONENT_REGISTER = 0x0203;
+const ComponentType COMPONENT_COUNTER = 0x0204;
 const ComponentType COMPONENT_SUB_CIRCUIT = 0x0301;
 const ComponentType COMPONENT_TEXT = 0x0401;
 const ComponentType COMPONENT_MAX_TYPE_ID = COMPONENT_TEXT;
@@ -60,9 +68,34 @@ struct ExtraDataOscillator {
     int64_t m_duration[2];
 };
 
+// 7-segment LED: the time each segment was lit is accumulated when the inputs change
 struct ExtraData7SegmentLED {
-    size_t   m_num_samples;
-    uint32_t m_samples[8];
+    timestamp_t m_window_start;     // start of the current brightness window
+    timestamp_t m_last_change;      // time the lit segments were last updated
+    timestamp_t m_on_time[8];       // time lit during the current window (up to m_last_change)
+    uint8_t     m_lit;              // bitmask of the currently lit segments
+};
+
+// clocked components (register, counter): the property values and their compiled form
+enum ClockTrigger : uint8_t {
+    TRIGGER_RISING_EDGE,
+    TRIGGER_FALLING_EDGE,
+    TRIGGER_HIGH_LEVEL,
+    TRIGGER_LOW_LEVEL
+};
+constexpr const char *CLOCK_TRIGGER_NAMES[] = {"rising", "falling", "high", "low"};
+
+enum CounterOnGoal : uint8_t {
+    ON_GOAL_WRAP,           // continue from zero (or max when counting down)
+    ON_GOAL_STAY,           // stop counting at the goal
+    ON_GOAL_CONTINUE,       // count past max (up to the largest value that fits)
+    ON_GOAL_LOAD            // load the data inputs
+};
+constexpr const char *COUNTER_ON_GOAL_NAMES[] = {"wrap", "stay", "continue", "load"};
+
+struct ExtraDataRegister {
+    uint32_t m_value;
+    Value    m_clock;       // clock value at the previous evaluation (edge detection)
 };
 
 // forward declarations
@@ -72,6 +105,8 @@ class ModelCircuit;
 class SimComponent;
 class Simulator;
 
+class MemoryReport;
+
 } // namespace lsim
 
 #endif // LSIM_SIM_TYPES_H
\ No newline at end of file
@@ -6,8 +6,91 @@
 #include "simulator.h"
 #include "model_circuit.h"
 
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+using namespace lsim;
+
+// clocked components: the clock is the first control pin, the previous value is kept in the extra data
+bool clock_triggered(SimComponent *comp, ExtraDataRegister *extra) {
+    auto clock = comp->read_pin(comp->control_pin_index(0));
+    auto previous = extra->m_clock;
+    extra->m_clock = clock;
+
+    switch (comp->params().m_trigger) {
+        case TRIGGER_RISING_EDGE:
+            return previous == VALUE_FALSE && clock == VALUE_TRUE;
+        case TRIGGER_FALLING_EDGE:
+            return previous == VALUE_TRUE && clock == VALUE_FALSE;
+        case TRIGGER_HIGH_LEVEL:
+            return clock == VALUE_TRUE;
+        case TRIGGER_LOW_LEVEL:
+            return clock == VALUE_FALSE;
+    }
+
+    return false;
+}
+
+void setup_clocked(Simulator *sim, SimComponent *comp) {
+    comp->set_extra_data_size(sizeof(ExtraDataRegister));
+    auto *extra = reinterpret_cast<ExtraDataRegister *>(comp->extra_data());
+    extra->m_value = 0;
+    extra->m_clock = VALUE_UNDEFINED;
+
+    for (auto pin = 0u; pin < comp->num_outputs(); ++pin) {
+        sim->pin_set_initial_value(comp->pin_by_index(comp->output_pin_index(pin)), VALUE_FALSE);
+    }
+}
+
+uint32_t read_data_inputs(SimComponent *comp, uint32_t data_bits, uint32_t value) {
+    comp->reset_bad_read_check();
+    uint32_t word = 0;
+    for (auto pin = 0u; pin < data_bits; ++pin) {
+        word |= static_cast<uint32_t>(comp->read_pin_checked(comp->input_pin_index(pin))) << pin;
+    }
+    return comp->read_bad() ? value : word;
+}
+
+void write_data_outputs(SimComponent *comp, uint32_t data_bits, uint32_t value) {
+    for (auto pin = 0u; pin < data_bits; ++pin) {
+        comp->write_pin(comp->output_pin_index(pin), ((value >> pin) & 1) ? VALUE_TRUE : VALUE_FALSE);
+    }
+}
+
+// 7-segment LED: add the time since the previous update to the segments that were lit during that time
+void led_accumulate(ExtraData7SegmentLED *extra, timestamp_t now) {
+    auto elapsed = now - extra->m_last_change;
+    for (auto idx = 0u; idx < 8; ++idx) {
+        if (extra->m_lit & (1 << idx)) {
+            extra->m_on_time[idx] += elapsed;
+        }
+    }
+    extra->m_last_change = now;
+}
+
+} // unnamed namespace
+
 namespace lsim {
 
+bool sim_7_segment_led_sample(SimComponent *comp, float fractions[8]) {
+    auto *extra = reinterpret_cast<ExtraData7SegmentLED *>(comp->extra_data());
+    auto now = comp->sim()->current_time();
+    if (now <= extra->m_window_start) {
+        return false;
+    }
+
+    led_accumulate(extra, now);
+    auto window = static_cast<float>(now - extra->m_window_start);
+    for (auto idx = 0u; idx < 8; ++idx) {
+        fractions[idx] = extra->m_on_time[idx] / window;
+        extra->m_on_time[idx] = 0;
+    }
+    extra->m_window_start = now;
+    return true;
+}
+
 void sim_register_various_functions(Simulator *sim) {
     SIM_SETUP_FUNC_BEGIN(CONNECTOR_IN) {
         if (!comp->user_values_enabled()) {
@@ -38,12 +121,12 @@ void sim_register_various_functions(Simulator *sim) {
     } SIM_FUNC_END;
 
     SIM_SETUP_FUNC_BEGIN(CONSTANT)  {
-        auto value = comp->description()->property("value")->value_as_lsim_value();
+        auto value = comp->params().m_value;
         sim->pin_set_initial_value(comp->pin_by_index(0), value);
     } SIM_FUNC_END;
 
     SIM_SETUP_FUNC_BEGIN(PULL_RESISTOR) {
-        auto value = comp->description()->property("pull_to")->value_as_lsim_value();
+        auto value = comp->params().m_value;
         sim->pin_set_default(comp->pin_by_index(0), value);
         sim->pin_set_initial_value(comp->pin_by_index(0), value);
     } SIM_FUNC_END;
@@ -54,9 +137,13 @@ void sim_register_various_functions(Simulator *sim) {
 
         auto value = sim->pin_output_value(comp->pin_by_index(0));
 
-        extra->m_duration[0] = comp->description()->property_value("low_duration", static_cast<int64_t>(1));
-        extra->m_duration[1] = comp->description()->property_value("high_duration", static_cast<int64_t>(1));
+        extra->m_duration[0] = comp->params().m_duration[0];
+        extra->m_duration[1] = comp->params().m_duration[1];
         extra->m_next_change = sim->current_time() + extra->m_duration[value];
+
+        // only needs to run when the output toggles: wait in the wakeup queue instead of running every step
+        sim->deactivate_independent_simulation_func(comp);
+        sim->schedule_wakeup(comp, extra->m_next_change);
     } SIM_FUNC_END;
 
     SIM_INDEPENDENT_FUNC_BEGIN(OSCILLATOR) {
@@ -67,23 +154,194 @@ void sim_register_various_functions(Simulator *sim) {
             
             extra->m_next_change = sim->current_time() + extra->m_duration[new_value];
             comp->write_pin(comp->output_pin_index(0), new_value);
+            sim->schedule_wakeup(comp, extra->m_next_change);
         }
     } SIM_FUNC_END;
 
     SIM_SETUP_FUNC_BEGIN(7_SEGMENT_LED) {
         comp->set_extra_data_size(sizeof(ExtraData7SegmentLED));
+        auto *extra = reinterpret_cast<ExtraData7SegmentLED *>(comp->extra_data());
+        extra->m_window_start = sim->current_time();
+        extra->m_last_change = sim->current_time();
+        std::fill(std::begin(extra->m_on_time), std::end(extra->m_on_time), 0);
+        extra->m_lit = 0;
     } SIM_FUNC_END;
 
-    SIM_INDEPENDENT_FUNC_BEGIN(7_SEGMENT_LED) {
+    SIM_INPUT_CHANGED_FUNC_BEGIN(7_SEGMENT_LED) {
         auto *extra = reinterpret_cast<ExtraData7SegmentLED *>(comp->extra_data());
-        auto led_on = comp->read_pin(comp->control_pin_index(0));
+        led_accumulate(extra, sim->current_time());
 
-        if (led_on == VALUE_TRUE) {
+        extra->m_lit = 0;
+        if (comp->read_pin(comp->control_pin_index(0)) == VALUE_TRUE) {
             for (auto pin_idx = 0u; pin_idx < comp->num_inputs(); ++pin_idx) {
-                extra->m_samples[pin_idx] += comp->read_pin(comp->input_pin_index(pin_idx)) == VALUE_TRUE ? 1: 0;
+                if (comp->read_pin(comp->input_pin_index(pin_idx)) == VALUE_TRUE) {
+                    extra->m_lit |= 1 << pin_idx;
+                }
+            }
+        }
+    } SIM_FUNC_END;
+
+    SIM_SETUP_FUNC_BEGIN(ROM) {
+        // the address is used as an index in the extra data
+        const auto &contents = comp->params().m_memory_contents;
+        comp->set_extra_data_size(contents.size() * sizeof(uint32_t));
+        std::copy(contents.begin(), contents.end(), reinterpret_cast<uint32_t *>(comp->extra_data()));
+    } SIM_FUNC_END;
+
+    SIM_INPUT_CHANGED_FUNC_BEGIN(ROM) {
+        // control pins: chip enable, output enable
+        if (comp->read_pin(comp->control_pin_index(0)) != VALUE_TRUE ||
+            comp->read_pin(comp->control_pin_index(1)) != VALUE_TRUE) {
+            for (auto pin = 0u; pin < comp->num_outputs(); ++pin) {
+                comp->write_pin(comp->output_pin_index(pin), VALUE_UNDEFINED);
+            }
+            return;
+        }
+
+        comp->reset_bad_read_check();
+        uint32_t address = 0;
+        for (auto pin = 0u; pin < comp->num_inputs(); ++pin) {
+            address |= static_cast<uint32_t>(comp->read_pin_checked(comp->input_pin_index(pin))) << pin;
+        }
+
+        auto word = reinterpret_cast<const uint32_t *>(comp->extra_data())[address];
+        for (auto pin = 0u; pin < comp->num_outputs(); ++pin) {
+            comp->write_pin_checked(comp->output_pin_index(pin), (word >> pin) & 1);
+        }
+    } SIM_FUNC_END;
+
+    SIM_SETUP_FUNC_BEGIN(RAM) {
+        // the "data" property holds the initial contents
+        const auto &contents = comp->params().m_memory_contents;
+        comp->set_extra_data_size(contents.size() * sizeof(uint32_t));
+        std::copy(contents.begin(), contents.end(), reinterpret_cast<uint32_t *>(comp->extra_data()));
+    } SIM_FUNC_END;
+
+    SIM_INPUT_CHANGED_FUNC_BEGIN(RAM) {
+        // input pins: address lines followed by the data lines
+        // control pins: chip enable, write enable, output enable
+        auto data_bits = comp->num_outputs();
+        auto address_bits = comp->num_inputs() - data_bits;
+        auto chip_enable = comp->read_pin(comp->control_pin_index(0)) == VALUE_TRUE;
+        auto write_enable = comp->read_pin(comp->control_pin_index(1)) == VALUE_TRUE;
+        auto output_enable = comp->read_pin(comp->control_pin_index(2)) == VALUE_TRUE;
+
+        auto write_undefined = [&]() {
+            for (auto pin = 0u; pin < data_bits; ++pin) {
+                comp->write_pin(comp->output_pin_index(pin), VALUE_UNDEFINED);
             }
+        };
+
+        if (!chip_enable) {
+            write_undefined();
+            return;
+        }
+
+        comp->reset_bad_read_check();
+        uint32_t address = 0;
+        for (auto pin = 0u; pin < address_bits; ++pin) {
+            address |= static_cast<uint32_t>(comp->read_pin_checked(comp->input_pin_index(pin))) << pin;
+        }
+
+        auto memory = reinterpret_cast<uint32_t *>(comp->extra_data());
+
+        if (write_enable) {
+            // level sensitive: memory follows the data lines as long as write enable is high
+            uint32_t word = 0;
+            for (auto pin = 0u; pin < data_bits; ++pin) {
+                word |= static_cast<uint32_t>(comp->read_pin_checked(comp->input_pin_index(address_bits + pin))) << pin;
+            }
+            if (!comp->read_bad()) {
+                memory[address] = word;
+            }
+            write_undefined();
+            return;
+        }
+
+        if (!output_enable) {
+            write_undefined();
+            return;
         }
-        extra->m_num_samples += 1;
+
+        auto word = memory[address];
+        for (auto pin = 0u; pin < data_bits; ++pin) {
+            comp->write_pin_checked(comp->output_pin_index(pin), (word >> pin) & 1);
+        }
+    } SIM_FUNC_END;
+
+    // register and counter follow the behaviour of their Logisim counterparts, except that the enable and count
+    //  inputs have to be connected (the Logisim importer ties them high when they aren't)
+    SIM_SETUP_FUNC_BEGIN(REGISTER) {
+        setup_clocked(sim, comp);
+    } SIM_FUNC_END;
+
+    SIM_INPUT_CHANGED_FUNC_BEGIN(REGISTER) {
+        // control pins: clock, enable, clear
+        auto *extra = reinterpret_cast<ExtraDataRegister *>(comp->extra_data());
+        auto data_bits = static_cast<uint32_t>(comp->num_inputs());
+        auto triggered = clock_triggered(comp, extra);
+        if (comp->read_pin(comp->control_pin_index(2)) == VALUE_TRUE) {
+            extra->m_value = 0;
+        } else if (triggered && comp->read_pin(comp->control_pin_index(1)) == VALUE_TRUE) {
+            extra->m_value = read_data_inputs(comp, data_bits, extra->m_value);
+        }
+
+        write_data_outputs(comp, data_bits, extra->m_value);
+    } SIM_FUNC_END;
+
+    SIM_SETUP_FUNC_BEGIN(COUNTER) {
+        setup_clocked(sim, comp);
+    } SIM_FUNC_END;
+
+    SIM_INPUT_CHANGED_FUNC_BEGIN(COUNTER) {
+        // control pins: clock, load, count, clear
+        //  load | count : on trigger
+        //   0   |   0   : keep
+        //   0   |   1   : count up
+        //   1   |   0   : load the data inputs
+        //   1   |   1   : count down
+        auto *extra = reinterpret_cast<ExtraDataRegister *>(comp->extra_data());
+        auto data_bits = static_cast<uint32_t>(comp->num_inputs());
+        auto mask = data_bits >= 32 ? ~uint32_t(0) : (uint32_t(1) << data_bits) - 1;
+        auto max_value = comp->params().m_max_value & mask;
+        auto triggered = clock_triggered(comp, extra);
+
+        auto load = comp->read_pin(comp->control_pin_index(1)) == VALUE_TRUE;
+        auto count = comp->read_pin(comp->control_pin_index(2)) == VALUE_TRUE;
+        auto goal = load ? 0 : max_value;
+        auto value = extra->m_value;
+
+        auto load_value = [&]() {
+            auto word = read_data_inputs(comp, data_bits, value);
+            return word > max_value ? word & max_value : word;
+        };
+
+        if (comp->read_pin(comp->control_pin_index(3)) == VALUE_TRUE) {
+            value = 0;
+        } else if (triggered && count && value == goal) {
+            switch (comp->params().m_on_goal) {
+                case ON_GOAL_WRAP:
+                    value = load ? max_value : 0;
+                    break;
+                case ON_GOAL_STAY:
+                    break;
+                case ON_GOAL_CONTINUE:
+                    value = load ? value - 1 : value + 1;
+                    break;
+                case ON_GOAL_LOAD:
+                    value = load_value();
+                    break;
+            }
+        } else if (triggered && count) {
+            value = load ? value - 1 : value + 1;
+        } else if (triggered && load) {
+            value = load_value();
+        }
+
+        extra->m_value = value & mask;
+        write_data_outputs(comp, data_bits, extra->m_value);
+        comp->write_pin(comp->output_pin_index(data_bits),
+                        (count && extra->m_value == goal) ? VALUE_TRUE : VALUE_FALSE);
     } SIM_FUNC_END;
 }
 
@@ -0,0 +1,212 @@
+// sim_worker.cpp - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// run a simulation on a thread of its own, the user interface renders from snapshots of its state
+
+#include "sim_worker.h"
+#include "simulator.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace lsim {
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// SimSnapshot
+//
+
+void SimSnapshot::capture(const Simulator *sim) {
+    m_time = sim->current_time();
+    m_layout_version = sim->layout_version();
+
+    m_pin_nodes.resize(sim->num_pins());
+    m_pin_values.resize(sim->num_pins());
+    for (pin_t pin = 0; pin < m_pin_nodes.size(); ++pin) {
+        m_pin_nodes[pin] = sim->pin_node(pin);
+        m_pin_values[pin] = sim->pin_output_value(pin);
+    }
+
+    m_node_values.resize(sim->num_nodes());
+    for (node_t node_id = 0; node_id < m_node_values.size(); ++node_id) {
+        m_node_values[node_id] = sim->read_node(node_id);
+    }
+
+    m_nodes_changed = sim->nodes_changed();
+    std::sort(m_nodes_changed.begin(), m_nodes_changed.end());
+}
+
+bool SimSnapshot::node_dirty(node_t node_id) const {
+    return std::binary_search(m_nodes_changed.begin(), m_nodes_changed.end(), node_id);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// SimWorker
+//
+
+SimWorker::SimWorker(Simulator *sim, step_func_t step_func) :
+        m_sim(sim),
+        m_step_func(std::move(step_func)),
+        m_back(std::make_unique<SimSnapshot>()),
+        m_latest(std::make_unique<SimSnapshot>()),
+        m_current(std::make_unique<SimSnapshot>()) {
+
+    if (!m_step_func) {
+        m_step_func = [sim]() {sim->step();};
+    }
+
+    m_current->capture(m_sim);
+    m_thread = std::thread([this]() {worker_main();});
+}
+
+SimWorker::~SimWorker() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake_worker.notify_one();
+    m_thread.join();
+}
+
+void SimWorker::run(size_t num_steps) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending = std::min(m_pending + num_steps, m_max_pending);
+    }
+    m_wake_worker.notify_one();
+}
+
+void SimWorker::set_max_pending(size_t max_pending) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_max_pending = max_pending;
+    m_pending = std::min(m_pending, m_max_pending);
+}
+
+size_t SimWorker::pending_steps() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending;
+}
+
+uint64_t SimWorker::steps_done() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_steps_done;
+}
+
+void SimWorker::post(command_t command) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_commands.push_back(std::move(command));
+    }
+    m_wake_worker.notify_one();
+}
+
+void SimWorker::pause(const command_t &func) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    ++m_pause_requests;
+    m_wake_waiters.wait(lock, [this]() {return !m_busy;});
+    lock.unlock();
+
+    // the worker doesn't start anything while a pause is requested: exclusive access to the simulator
+    func(m_sim);
+    publish();
+
+    lock.lock();
+    --m_pause_requests;
+    lock.unlock();
+    m_wake_worker.notify_one();
+}
+
+void SimWorker::wait_idle() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_wake_waiters.wait(lock, [this]() {return !m_busy && m_commands.empty() && m_pending == 0;});
+}
+
+bool SimWorker::update_snapshot() {
+    std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+    if (!m_fresh) {
+        return false;
+    }
+
+    std::swap(m_latest, m_current);
+    m_fresh = false;
+    return true;
+}
+
+void SimWorker::worker_main() {
+    using clock_t = std::chrono::steady_clock;
+    const auto slice = std::chrono::milliseconds(SLICE_MS);
+    const auto publish_interval = std::chrono::milliseconds(PUBLISH_INTERVAL_MS);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_wake_worker.wait(lock, [this]() {
+            return m_quit || (m_pause_requests == 0 && (!m_commands.empty() || m_pending > 0));
+        });
+        if (m_quit) {
+            break;
+        }
+
+        m_busy = true;
+        run_commands(lock);
+        auto last_publish = clock_t::now();
+
+        // step in slices: the lock is released while stepping, new commands and pause requests are handled in between
+        while (m_pending > 0 && m_pause_requests == 0 && !m_quit) {
+            auto todo = m_pending;
+            lock.unlock();
+
+            // the clock is only consulted every few steps, a step of a small circuit takes less time than reading it
+            auto slice_start = clock_t::now();
+            size_t done = 0;
+            while (done < todo) {
+                m_step_func();
+                ++done;
+                if (done % CLOCK_CHECK_STEPS == 0 && clock_t::now() - slice_start >= slice) {
+                    break;
+                }
+            }
+
+            auto now = clock_t::now();
+            if (now - last_publish >= publish_interval) {
+                publish();
+                last_publish = now;
+            }
+
+            lock.lock();
+            m_pending -= std::min(m_pending, done);
+            m_steps_done += done;
+            run_commands(lock);
+        }
+
+        lock.unlock();
+        publish();
+        lock.lock();
+
+        m_busy = false;
+        m_wake_waiters.notify_all();
+    }
+}
+
+void SimWorker::run_commands(std::unique_lock<std::mutex> &lock) {
+    while (!m_commands.empty()) {
+        std::vector<command_t> commands;
+        commands.swap(m_commands);
+
+        lock.unlock();
+        for (auto &command : commands) {
+            command(m_sim);
+        }
+        lock.lock();
+    }
+}
+
+void SimWorker::publish() {
+    m_back->capture(m_sim);
+
+    std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+    std::swap(m_back, m_latest);
+    m_fresh = true;
+}
+
+} // namespace lsim
@@ -0,0 +1,120 @@
+// sim_worker.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// run a simulation on a thread of its own, the user interface renders from snapshots of its state
+
+#ifndef LSIM_SIM_WORKER_H
+#define LSIM_SIM_WORKER_H
+
+#include "sim_types.h"
+
+#include <cassert>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace lsim {
+
+// SimSnapshot: copy of the values of the pins and nodes of a simulator at the end of a step. Pins and nodes are
+//  numbered as in the simulator at the time of the capture (see layout_version).
+class SimSnapshot {
+public:
+    void capture(const Simulator *sim);
+
+    timestamp_t time() const {return m_time;}
+    uint32_t layout_version() const {return m_layout_version;}
+    size_t num_nodes() const {return m_node_values.size();}
+    size_t num_pins() const {return m_pin_nodes.size();}
+
+    node_t pin_node(pin_t pin) const {assert(pin < m_pin_nodes.size()); return m_pin_nodes[pin];}
+    Value read_pin(pin_t pin) const {return read_node(pin_node(pin));}
+    Value pin_output_value(pin_t pin) const {assert(pin < m_pin_values.size()); return m_pin_values[pin];}
+    Value read_node(node_t node_id) const {assert(node_id < m_node_values.size()); return m_node_values[node_id];}
+    bool node_dirty(node_t node_id) const;
+
+private:
+    timestamp_t         m_time = 0;
+    uint32_t            m_layout_version = 0;
+    node_container_t    m_pin_nodes;
+    value_container_t   m_pin_values;
+    value_container_t   m_node_values;
+    node_container_t    m_nodes_changed;
+};
+
+// SimWorker: steps the simulator on a worker thread (a Web Worker in the Emscripten build with pthreads, where the
+//  memory of the simulator is a SharedArrayBuffer) so a heavy circuit doesn't block the thread of the user interface.
+//  Once started the worker owns the simulator: other threads post commands to change it (e.g. write an input) or
+//  pause the worker to access it directly. After a batch of steps the worker publishes a snapshot; the user interface
+//  picks up the latest one once per frame and only reads from it.
+class SimWorker {
+public:
+    using step_func_t = std::function<void()>;
+    using command_t = std::function<void(Simulator *sim)>;
+
+    static constexpr size_t DEFAULT_MAX_PENDING = 100000;
+    static constexpr int SLICE_MS = 2;                      // check for commands and pause requests about this often
+    static constexpr size_t CLOCK_CHECK_STEPS = 256;        // steps between reads of the clock while slicing
+    static constexpr int PUBLISH_INTERVAL_MS = 10;          // publish a snapshot at least this often while stepping
+
+public:
+    // step_func: advances the simulation one step (defaults to Simulator::step, e.g. replaced to step through a SimHistory)
+    explicit SimWorker(Simulator *sim, step_func_t step_func = nullptr);
+    ~SimWorker();
+    SimWorker(const SimWorker &) = delete;
+
+    // run: request more steps. The steps not done yet are capped at max_pending, so a circuit that can't keep up
+    //  with the requested rate doesn't build an ever growing backlog.
+    void run(size_t num_steps);
+    void set_max_pending(size_t max_pending);
+    size_t pending_steps() const;
+    uint64_t steps_done() const;
+
+    // post: run the command on the worker thread, before the next step
+    void post(command_t command);
+
+    // pause: wait for the worker to finish the slice of steps it is working on and run func on the calling thread with
+    //  exclusive access to the simulator. A new snapshot is published afterwards. Pause from one thread only.
+    void pause(const command_t &func);
+
+    // wait_idle: wait until all posted commands and requested steps are done
+    void wait_idle();
+
+    // update_snapshot: make the latest published snapshot current, returns false when nothing was published since.
+    //  Only call from the thread that reads the snapshot.
+    bool update_snapshot();
+    const SimSnapshot &snapshot() const {return *m_current;}
+
+private:
+    void worker_main();
+    void run_commands(std::unique_lock<std::mutex> &lock);
+    void publish();
+
+private:
+    Simulator *                     m_sim;
+    step_func_t                     m_step_func;
+    std::thread                     m_thread;
+
+    // shared state, protected by m_mutex
+    mutable std::mutex              m_mutex;
+    std::condition_variable         m_wake_worker;          // new steps, commands or pause requests released
+    std::condition_variable         m_wake_waiters;         // batch finished
+    std::vector<command_t>          m_commands;
+    size_t                          m_pending = 0;
+    size_t                          m_max_pending = DEFAULT_MAX_PENDING;
+    uint64_t                        m_steps_done = 0;
+    size_t                          m_pause_requests = 0;
+    bool                            m_busy = false;         // worker is running commands or steps (without holding the lock)
+    bool                            m_quit = false;
+
+    // snapshots: triple buffered, the worker fills m_back, m_latest is the last published, m_current is read by the UI
+    std::mutex                      m_snapshot_mutex;
+    std::unique_ptr<SimSnapshot>    m_back;
+    std::unique_ptr<SimSnapshot>    m_latest;
+    std::unique_ptr<SimSnapshot>    m_current;
+    bool                            m_fresh = false;
+};
+
+} // namespace lsim
+
+#endif // LSIM_SIM_WORKER_H
@@ -4,34 +4,116 @@
 #include "sim_functions.h"
 #include "model_circuit.h"
 #include "sim_circuit.h"
+#include "memory_report.h"
 
+#include <algorithm>
 #include <cassert>
+#include <numeric>
 #include "std_helper.h"
 
+namespace {
+
+inline bool is_boolean(lsim::Value value) {
+    return value == lsim::VALUE_FALSE || value == lsim::VALUE_TRUE;
+}
+
+} // unnamed namespace
+
 namespace lsim {
 
+pin_container_t connected_pin_roots(size_t num_pins, const pin_pair_container_t &connections) {
+    // union-find, the root of each group is its lowest pin
+    pin_container_t root(num_pins);
+    std::iota(begin(root), end(root), 0);
+
+    auto find_root = [&root](pin_t pin) {
+        while (root[pin] != pin) {
+            root[pin] = root[root[pin]];
+            pin = root[pin];
+        }
+        return pin;
+    };
+
+    for (const auto &conn : connections) {
+        auto root_a = find_root(conn.first);
+        auto root_b = find_root(conn.second);
+        if (root_a != root_b) {
+            root[std::max(root_a, root_b)] = std::min(root_a, root_b);
+        }
+    }
+
+    for (pin_t pin = 0; pin < num_pins; ++pin) {
+        root[pin] = root[root[pin]];
+    }
+
+    return root;
+}
+
 SimComponent *Simulator::create_component(ModelComponent *desc) {
     auto sim_comp = std::make_unique<SimComponent>(this, desc, static_cast<uint32_t> (m_components.size()));
     auto result = sim_comp.get();
 
     m_components.push_back(std::move(sim_comp));
 	m_input_changed.push_back(0);
+    m_layout_changed = true;
+    m_reset_image.m_valid = false;
 
     if (component_has_function(desc->type(), SIM_FUNCTION_SETUP)) {
         m_init_components.push_back(result);       
     }
 
+    m_scheduled_active.push_back(0);
+    m_independent_active.push_back(0);
+    if (component_has_function(desc->type(), SIM_FUNCTION_INDEPENDENT)) {
+        m_independent_components.push_back(result);
+        m_independent_active[result->id()] = 1;
+    }
+
+    return result;
+}
+
+SimComponent *Simulator::create_component(ModelComponent *desc, pin_t first_pin) {
+    auto sim_comp = std::make_unique<SimComponent>(this, desc, static_cast<uint32_t> (m_components.size()), first_pin);
+    auto result = sim_comp.get();
+
+    m_components.push_back(std::move(sim_comp));
+	m_input_changed.push_back(0);
+    m_layout_changed = true;
+    m_reset_image.m_valid = false;
+
+    // the pins were already assigned to nodes by add_pin_block, only register the component as a dependent
+    for (auto idx = 0u; idx < result->num_pins(); ++idx) {
+        if (idx < result->num_inputs() || idx >= result->num_inputs() + result->num_outputs()) {
+            m_node_metadata[m_pin_nodes[result->pin_by_index(idx)]].add_dependent(result);
+        }
+    }
+
+    if (component_has_function(desc->type(), SIM_FUNCTION_SETUP)) {
+        m_init_components.push_back(result);
+    }
+
+    m_scheduled_active.push_back(0);
+    m_independent_active.push_back(0);
     if (component_has_function(desc->type(), SIM_FUNCTION_INDEPENDENT)) {
         m_independent_components.push_back(result);
+        m_independent_active[result->id()] = 1;
     }
 
     return result;
 }
 
 void Simulator::clear_components() {
+    m_reset_image = ResetImage();
     m_components.clear();
+    m_input_changed.clear();
+    m_layout_changed = false;
     m_init_components.clear();
     m_independent_components.clear();
+    m_independent_active.clear();
+    m_wakeups.clear();
+    m_scheduled_components.clear();
+    m_scheduled_active.clear();
+    m_owned_components.clear();
     clear_pins();
     clear_nodes();
 }
@@ -50,26 +132,75 @@ node_t Simulator::connect_pins(pin_t pin_a, pin_t pin_b) {
     assert(pin_a < m_pin_nodes.size());
     assert(pin_b < m_pin_nodes.size());
 
-    const auto node_a = m_pin_nodes[pin_a];
-    const auto node_b = m_pin_nodes[pin_b];
+    m_layout_changed = true;
+    m_reset_image.m_valid = false;
+
+    auto node_a = m_pin_nodes[pin_a];
+    auto node_b = m_pin_nodes[pin_b];
 
-    if (node_a == node_b) {
-        // pins already connected to each other
-        return node_a;
+    if (node_a != node_b) {
+        if (m_patching) {
+            // keep the existing node: its state is carried over by patch_end
+            node_a = merge_nodes(std::min(node_a, node_b), std::max(node_a, node_b));
+            mark_patched_node(node_a);
+        } else {
+            node_a = merge_nodes(node_a, node_b);
+        }
     }
 
-    return merge_nodes(node_a, node_b);
+    if (m_patching_enabled) {
+        m_node_connections[node_a].emplace_back(pin_a, pin_b);
+    }
+
+    return node_a;
 }
 
 void Simulator::clear_pins() {
     m_pin_nodes.clear();
     m_pin_values.clear();
+    m_pin_defaults.clear();
+}
+
+pin_t Simulator::add_pin_block(const node_container_t &pin_nodes, node_t num_nodes, const pin_pair_container_t &connections) {
+    const auto pin_base = static_cast<pin_t>(m_pin_nodes.size());
+    const auto node_base = static_cast<node_t>(m_node_metadata.size());
+
+    // nodes
+    m_node_values_read.resize(node_base + num_nodes, VALUE_UNDEFINED);
+    m_node_values_write.resize(node_base + num_nodes, VALUE_UNDEFINED);
+    m_non_boolean_nodes += num_nodes;
+    m_node_metadata.resize(node_base + num_nodes);
+    m_node_write_time.resize(node_base + num_nodes, 0);
+    m_node_change_time.resize(node_base + num_nodes, 0);
+
+    // pins
+    m_pin_nodes.reserve(m_pin_nodes.size() + pin_nodes.size());
+    m_pin_values.resize(m_pin_values.size() + pin_nodes.size(), VALUE_UNDEFINED);
+
+    for (pin_t pin = 0; pin < pin_nodes.size(); ++pin) {
+        auto node_id = node_base + pin_nodes[pin];
+        m_pin_nodes.push_back(node_id);
+        m_node_metadata[node_id].m_pins.push_back(pin_base + pin);
+    }
+
+    // connections
+    if (m_patching_enabled) {
+        m_node_connections.resize(node_base + num_nodes);
+        for (const auto &conn : connections) {
+            m_node_connections[node_base + pin_nodes[conn.first]].emplace_back(pin_base + conn.first, pin_base + conn.second);
+        }
+    }
+
+    m_layout_changed = true;
+    m_reset_image.m_valid = false;
+    return pin_base;
 }
 
 void Simulator::pin_set_default(pin_t pin, Value value) {
     assert(pin < m_pin_nodes.size());
 
     auto node_id = m_pin_nodes[pin];
+    m_pin_defaults[pin] = value;
     node_set_default(node_id, value);
 }
 
@@ -133,9 +264,11 @@ void Simulator::pin_set_output_value(pin_t pin, Value value) {
 }
 
 node_t Simulator::assign_node(SimComponent *component, bool used_as_input) {
-    if (!m_free_nodes.empty()) {
+    // nodes created during a patch aren't reused: patch_end tells them apart from the existing nodes by their id
+    if (!m_free_nodes.empty() && !m_patching) {
         auto id = m_free_nodes.back();
         m_free_nodes.pop_back();
+        m_non_boolean_nodes += is_boolean(m_node_values_read[id]);
         m_node_values_read[id] = VALUE_UNDEFINED;
         m_node_values_write[id] = VALUE_UNDEFINED;
         m_node_metadata[id].m_default = VALUE_UNDEFINED;
@@ -145,19 +278,26 @@ node_t Simulator::assign_node(SimComponent *component, bool used_as_input) {
 		m_node_metadata[id].m_time_dirty_write = 0;
         m_node_write_time[id] = 0;
         m_node_change_time[id] = 0;
+        if (m_patching_enabled) {
+            m_node_connections[id].clear();
+        }
         if (used_as_input) {
-            m_node_metadata[id].m_dependents.insert(component);
+            m_node_metadata[id].add_dependent(component);
         }
         return id;
     }
 
     m_node_values_read.push_back(VALUE_UNDEFINED);
     m_node_values_write.push_back(VALUE_UNDEFINED);
+    ++m_non_boolean_nodes;
     m_node_metadata.push_back(NodeMetadata());
     m_node_write_time.push_back(0);
     m_node_change_time.push_back(0);
+    if (m_patching_enabled) {
+        m_node_connections.emplace_back();
+    }
     if (used_as_input) {
-        m_node_metadata.back().m_dependents.insert(component);
+        m_node_metadata.back().add_dependent(component);
     }
 
     return static_cast<node_t> (m_node_values_read.size()) - 1;
@@ -171,12 +311,14 @@ void Simulator::release_node(node_t node_id) {
 void Simulator::clear_nodes() {
     m_free_nodes.clear();
     m_node_values_read.clear();
+    m_non_boolean_nodes = 0;
     m_node_values_write.clear();
     m_node_metadata.clear();
     m_dirty_nodes_read.clear();
     m_dirty_nodes_write.clear();
     m_node_write_time.clear();
     m_node_change_time.clear();
+    m_node_connections.clear();
 }
 
 node_t Simulator::merge_nodes(node_t node_a, node_t node_b) {
@@ -192,8 +334,24 @@ node_t Simulator::merge_nodes(node_t node_a, node_t node_b) {
 		m_pin_nodes[pin] = node_a;
 	}
 
-    for (const auto &comp : meta_b.m_dependents) {
-        meta_a.m_dependents.insert(comp);
+    meta_a.m_dependents.insert(meta_a.m_dependents.end(), meta_b.m_dependents.begin(), meta_b.m_dependents.end());
+
+    if (m_patching_enabled) {
+        auto &conn_a = m_node_connections[node_a];
+        auto &conn_b = m_node_connections[node_b];
+        conn_a.insert(conn_a.end(), conn_b.begin(), conn_b.end());
+        conn_b.clear();
+    }
+
+    if (m_patching) {
+        // the merged node is live: keep the writers of both parts and leave nothing behind in the released node
+        for (auto pin : meta_b.m_active_pins) {
+            meta_a.m_active_pins.insert(pin);
+        }
+        meta_b.m_pins.clear();
+        meta_b.m_dependents.clear();
+        meta_b.m_active_pins.clear();
+        node_set_initial_value(node_b, VALUE_FALSE);
     }
 
     return node_a;
@@ -206,6 +364,7 @@ void Simulator::node_set_default(node_t node_id, Value value) {
 
 void Simulator::node_set_initial_value(node_t node_id, Value value) {
     assert(node_id < m_node_metadata.size());
+    m_non_boolean_nodes += !is_boolean(value) - !is_boolean(m_node_values_read[node_id]);
     m_node_values_read[node_id] = value;
     m_node_values_write[node_id] = value;
     m_node_write_time[node_id] = m_time;
@@ -219,6 +378,7 @@ void Simulator::write_node(node_t node_id, Value value, pin_t from_pin) {
 	if (node_meta.m_time_dirty_write != m_time) {
 		m_dirty_nodes_write.push_back(node_id);
 		node_meta.m_time_dirty_write = m_time;
+		reset_touch_node(node_id);
 	}
 
     if (value == VALUE_UNDEFINED) {
@@ -276,9 +436,17 @@ bool Simulator::component_has_function(ComponentType comp_type, SimFuncType func
 }
 
 void Simulator::init() {
+    if (m_layout_changed) {
+        renumber();
+    }
+
+    m_reset_image.m_valid = false;
+    m_reset_image.m_capture_pending = true;
+
     m_time = 1;
 
     std::fill(std::begin(m_node_values_read), std::end(m_node_values_read), VALUE_FALSE);
+    m_non_boolean_nodes = 0;
     std::fill(std::begin(m_node_values_write), std::end(m_node_values_write), VALUE_FALSE);
     std::fill(std::begin(m_node_write_time), std::end(m_node_write_time), 0);
     std::fill(std::begin(m_node_change_time), std::end(m_node_change_time), 0);
@@ -289,13 +457,17 @@ void Simulator::init() {
 		meta.m_active_pins.clear();
 		meta.m_time_dirty_write = 0;
     }
+    m_pin_defaults.clear();
 
     // apply initial values
     for (auto &comp : m_components) {
-		comp->apply_initial_values();
+        if (comp != nullptr) {
+            comp->apply_initial_values();
+        }
     }
 
     // run one time setup functions
+    m_wakeups.clear();
     for (auto comp : m_init_components) {
         auto &setup_func = m_sim_functions[comp->description()->type()][SIM_FUNCTION_SETUP];
         setup_func(this, comp);
@@ -308,15 +480,38 @@ void Simulator::init() {
 }
 
 void Simulator::step() {
+    step_components();
+    postprocess_dirty_nodes();
+
+    if (m_reset_image.m_capture_pending && m_dirty_nodes_read.empty()) {
+        m_reset_image.m_capture_pending = false;
+        if (!m_layout_changed) {
+            capture_reset_state();
+        }
+    }
+}
+
+void Simulator::step_components() {
     m_time = m_time + 1;
 	m_dirty_components.clear();
 
     // >> build a unique list of components with changed input values
+    for (auto comp : m_scheduled_components) {
+        m_scheduled_active[comp->id()] = 0;
+        if (m_input_changed[comp->id()] != m_time && owns_component(comp)) {
+            m_dirty_components.push_back(comp);
+            m_input_changed[comp->id()] = m_time;
+            reset_touch_component(comp);
+        }
+    }
+    m_scheduled_components.clear();
+
     for (auto node_id : m_dirty_nodes_read) {
         for (auto comp : m_node_metadata[node_id].m_dependents) {
-			if (m_input_changed[comp->id()] != m_time) {
+			if (m_input_changed[comp->id()] != m_time && owns_component(comp)) {
 				m_dirty_components.push_back(comp);
 				m_input_changed[comp->id()] = m_time;
+				reset_touch_component(comp);
 			}
         }
     }
@@ -328,14 +523,32 @@ void Simulator::step() {
     }
 
     // >> run simulation: independent components
-    for (auto comp : m_independent_components) {
-        auto &func = m_sim_functions[comp->description()->type()][SIM_FUNCTION_INDEPENDENT];
-        func(this, comp);
+    //  (a component may deactivate itself: only advance when it's still in the list)
+    for (size_t idx = 0; idx < m_independent_components.size(); ) {
+        auto comp = m_independent_components[idx];
+        if (owns_component(comp)) {
+            auto &func = m_sim_functions[comp->description()->type()][SIM_FUNCTION_INDEPENDENT];
+            func(this, comp);
+        }
+        if (idx < m_independent_components.size() && m_independent_components[idx] == comp) {
+            ++idx;
+        }
+    }
+
+    // >> run simulation: scheduled wakeups
+    while (!m_wakeups.empty() && m_wakeups.front().m_time <= m_time) {
+        auto comp = m_wakeups.front().m_comp;
+        std::pop_heap(m_wakeups.begin(), m_wakeups.end());
+        m_wakeups.pop_back();
+
+        if (owns_component(comp)) {
+            reset_touch_component(comp);
+            auto &func = m_sim_functions[comp->description()->type()][SIM_FUNCTION_INDEPENDENT];
+            func(this, comp);
+        }
     }
 
-    // >> post-process the dirty nodes
     m_dirty_nodes_read.clear();
-    postprocess_dirty_nodes();
 }
 
 void Simulator::run_until_stable(size_t stable_ticks) {
@@ -357,48 +570,821 @@ void Simulator::run_until_stable(size_t stable_ticks) {
     }
 }
 
+void Simulator::user_value_changed(SimComponent *comp, uint32_t index, Value value) {
+    m_reset_image.m_capture_pending = false;
+
+    for (const auto &listener : m_input_listeners) {
+        if (listener.m_on_user_value) {
+            listener.m_on_user_value(comp, index, value);
+        }
+    }
+}
+
+size_t Simulator::add_input_listener(user_value_listener_t on_user_value, schedule_listener_t on_schedule) {
+    m_input_listeners.push_back({m_next_listener_handle, std::move(on_user_value), std::move(on_schedule)});
+    return m_next_listener_handle++;
+}
+
+void Simulator::remove_input_listener(size_t handle) {
+    m_input_listeners.erase(std::remove_if(m_input_listeners.begin(), m_input_listeners.end(),
+                                           [=](const auto &listener) {return listener.m_handle == handle;}),
+                            m_input_listeners.end());
+}
+
 void Simulator::activate_independent_simulation_func(SimComponent *comp) {
-    if (!component_has_function(comp->description()->type(), SIM_FUNCTION_INDEPENDENT)) {
+    if (!component_has_function(comp->description()->type(), SIM_FUNCTION_INDEPENDENT) || !owns_component(comp)) {
         return;
     }
 
-    auto iter = std::find(m_independent_components.begin(), m_independent_components.end(), comp);
-    if (iter == m_independent_components.end()) {
+    reset_touch_component(comp);
+
+    if (!m_independent_active[comp->id()]) {
         m_independent_components.push_back(comp);
+        m_independent_active[comp->id()] = 1;
     }
 }
 
 void Simulator::deactivate_independent_simulation_func(SimComponent *comp) {
-	remove(m_independent_components, comp);
+    if (m_independent_active[comp->id()]) {
+        remove(m_independent_components, comp);
+        m_independent_active[comp->id()] = 0;
+    }
 }
 
-void Simulator::postprocess_dirty_nodes() {
+void Simulator::schedule_wakeup(SimComponent *comp, timestamp_t time) {
+    assert(comp);
+    assert(component_has_function(comp->description()->type(), SIM_FUNCTION_INDEPENDENT));
 
-    for (auto node_id : m_dirty_nodes_write) {
+    m_wakeups.push_back({time, comp});
+    std::push_heap(m_wakeups.begin(), m_wakeups.end());
+}
+
+void Simulator::schedule_input_changed(SimComponent *comp) {
+    assert(comp);
+
+    for (const auto &listener : m_input_listeners) {
+        if (listener.m_on_schedule) {
+            listener.m_on_schedule(comp);
+        }
+    }
+
+    if (!component_has_function(comp->description()->type(), SIM_FUNCTION_INPUT_CHANGED)) {
+        return;
+    }
+
+    if (!m_scheduled_active[comp->id()]) {
+        m_scheduled_components.push_back(comp);
+        m_scheduled_active[comp->id()] = 1;
+    }
+}
+
+void Simulator::enable_patching() {
+    // the connections between pins that already exist are unknown
+    assert(m_pin_nodes.empty() || m_patching_enabled);
+
+    m_patching_enabled = true;
+    m_node_connections.resize(m_node_metadata.size());
+}
+
+void Simulator::patch_begin() {
+    assert(m_patching_enabled);
+    assert(!m_patching);
+    assert(m_dirty_nodes_write.empty());
+
+    m_patching = true;
+    m_reset_image.m_capture_pending = false;
+    m_patch_first_component = m_components.size();
+    m_patch_first_node = m_node_metadata.size();
+    m_patched_nodes.clear();
+}
+
+void Simulator::mark_patched_node(node_t node_id) {
+    // nodes created during the patch are initialized from scratch anyway
+    if (node_id < m_patch_first_node) {
+        m_patched_nodes.push_back(node_id);
+    }
+}
+
+void Simulator::remove_component(SimComponent *comp) {
+    assert(m_patching);
+    assert(comp);
+    assert(m_components[comp->id()].get() == comp);
+
+    // mark the pins as unused, the nodes they were part of are rebuilt at the end of the patch
+    for (auto pin : comp->pins()) {
+        auto node_id = m_pin_nodes[pin];
+        if (node_id != NODE_INVALID) {
+            remove(m_node_metadata[node_id].m_dependents, comp);
+            mark_patched_node(node_id);
+        }
+        m_pin_nodes[pin] = NODE_INVALID;
+        m_pin_defaults.erase(pin);
+    }
+
+    remove(m_init_components, comp);
+    deactivate_independent_simulation_func(comp);
+    if (m_scheduled_active[comp->id()]) {
+        remove(m_scheduled_components, comp);
+        m_scheduled_active[comp->id()] = 0;
+    }
+    remove_if(m_wakeups, [=](const auto &wakeup) {return wakeup.m_comp == comp;});
+    std::make_heap(m_wakeups.begin(), m_wakeups.end());
+    m_components[comp->id()] = nullptr;
+}
+
+void Simulator::disconnect_pins(pin_t pin_a, pin_t pin_b) {
+    assert(m_patching);
+
+    // both pins of a connection are always part of the same node
+    auto node_id = m_pin_nodes[pin_a] != NODE_INVALID ? m_pin_nodes[pin_a] : m_pin_nodes[pin_b];
+    if (node_id == NODE_INVALID) {
+        return;
+    }
+
+    auto &connections = m_node_connections[node_id];
+    auto found = std::find_if(begin(connections), end(connections), [=](const auto &conn) {
+        return (conn.first == pin_a && conn.second == pin_b) || (conn.first == pin_b && conn.second == pin_a);
+    });
+
+    if (found != end(connections)) {
+        connections.erase(found);
+        mark_patched_node(node_id);
+    }
+}
+
+void Simulator::patch_end() {
+    assert(m_patching);
+
+    component_refs_t new_components;
+    for (auto id = m_patch_first_component; id < m_components.size(); ++id) {
+        if (m_components[id] != nullptr) {
+            new_components.push_back(m_components[id].get());
+        }
+    }
+
+    // regroup the pins of the existing nodes that lost a connection or a component, or were merged
+    std::sort(m_patched_nodes.begin(), m_patched_nodes.end());
+    m_patched_nodes.erase(std::unique(m_patched_nodes.begin(), m_patched_nodes.end()), m_patched_nodes.end());
+
+    const auto num_nodes = m_node_metadata.size();
+
+    for (auto node_id : m_patched_nodes) {
+        split_patched_node(node_id);
+    }
+
+    // nodes with only pins of new components: start from the same state as Simulator::init
+    for (auto node_id = static_cast<node_t>(m_patch_first_node); node_id < num_nodes; ++node_id) {
+        auto &pins = m_node_metadata[node_id].m_pins;
+        remove_if(pins, [=](auto pin) {return m_pin_nodes[pin] != node_id;});
+        node_set_initial_value(node_id, VALUE_FALSE);
+        m_node_write_time[node_id] = 0;
+        m_node_change_time[node_id] = 0;
+        if (!pins.empty()) {
+            m_dirty_nodes_read.push_back(node_id);
+        }
+    }
+
+    // nodes that were merged into another node aren't used anymore
+    remove_if(m_dirty_nodes_read, [this](auto node_id) {return m_node_metadata[node_id].m_pins.empty();});
+    std::sort(m_dirty_nodes_read.begin(), m_dirty_nodes_read.end());
+    m_dirty_nodes_read.erase(std::unique(m_dirty_nodes_read.begin(), m_dirty_nodes_read.end()), m_dirty_nodes_read.end());
+    m_patched_nodes.clear();
+
+    // initialize the components that were added during the patch
+    for (auto comp : new_components) {
+
+        comp->apply_initial_values();
+
+        auto &setup_func = m_sim_functions[comp->description()->type()][SIM_FUNCTION_SETUP];
+        if (setup_func != nullptr) {
+            setup_func(this, comp);
+        }
+    }
+
+    // the ids of the components and nodes are compacted by the renumbering in the next init()
+    m_layout_changed = true;
+    m_patching = false;
+}
+
+void Simulator::split_patched_node(node_t node_id) {
+    if (m_node_metadata[node_id].m_pins.empty()) {
+        // merged into another node during the patch
+        return;
+    }
+
+    // the pins that are still part of the node
+    pin_container_t pins;
+    for (auto pin : m_node_metadata[node_id].m_pins) {
+        if (m_pin_nodes[pin] == node_id) {
+            pins.push_back(pin);
+        }
+    }
+    std::sort(pins.begin(), pins.end());
+    pins.erase(std::unique(pins.begin(), pins.end()), pins.end());
+
+    auto local_pin = [&pins](pin_t pin) {
+        return static_cast<pin_t>(std::lower_bound(pins.begin(), pins.end(), pin) - pins.begin());
+    };
+
+    // state of the node before the patch
+    const auto old_value = m_node_values_read[node_id];
+    const auto old_change_time = m_node_change_time[node_id];
+    auto old_active = std::move(m_node_metadata[node_id].m_active_pins);
+    auto old_dependents = std::move(m_node_metadata[node_id].m_dependents);
+    auto old_connections = std::move(m_node_connections[node_id]);
+    m_node_metadata[node_id] = NodeMetadata();
+    m_node_connections[node_id].clear();
+
+    if (pins.empty()) {
+        node_set_initial_value(node_id, VALUE_FALSE);
+        release_node(node_id);
+        return;
+    }
+
+    // group the remaining pins by the connections that are left: the first group keeps the node
+    pin_pair_container_t connections;
+    for (const auto &conn : old_connections) {
+        if (m_pin_nodes[conn.first] == node_id && m_pin_nodes[conn.second] == node_id) {
+            connections.emplace_back(local_pin(conn.first), local_pin(conn.second));
+        }
+    }
+    auto root = connected_pin_roots(pins.size(), connections);
+
+    node_container_t group_nodes(pins.size(), NODE_INVALID);
+    node_container_t new_nodes;
+
+    for (pin_t idx = 0; idx < pins.size(); ++idx) {
+        auto &group = group_nodes[root[idx]];
+        if (group == NODE_INVALID) {
+            group = new_nodes.empty() ? node_id : assign_node(nullptr, false);
+            new_nodes.push_back(group);
+        }
+        m_pin_nodes[pins[idx]] = group;
+        m_node_metadata[group].m_pins.push_back(pins[idx]);
+    }
+
+    for (const auto &conn : old_connections) {
+        if (m_pin_nodes[conn.first] != NODE_INVALID && m_pin_nodes[conn.first] == m_pin_nodes[conn.second]) {
+            m_node_connections[m_pin_nodes[conn.first]].push_back(conn);
+        }
+    }
 
-        switch (m_node_metadata[node_id].m_active_pins.size()) {
-            case 0 :        // no active writers: use default value (i.e. pull-up/down resistor)
-                m_node_values_write[node_id] = m_node_metadata[node_id].m_default;
-                m_node_write_time[node_id] = m_time;
+    for (auto pin : old_active) {
+        if (m_pin_nodes[pin] != NODE_INVALID) {
+            m_node_metadata[m_pin_nodes[pin]].m_active_pins.insert(pin);
+        }
+    }
+
+    for (auto comp : old_dependents) {
+        for (auto idx = 0u; idx < comp->num_pins(); ++idx) {
+            if (idx >= comp->num_inputs() && idx < comp->num_inputs() + comp->num_outputs()) {
+                continue;
+            }
+            auto pin_node = m_pin_nodes[comp->pin_by_index(idx)];
+            if (std::find(new_nodes.begin(), new_nodes.end(), pin_node) != new_nodes.end()) {
+                m_node_metadata[pin_node].add_dependent(comp);
+            }
+        }
+    }
+
+    // resolve the value of each part from its remaining active writers
+    for (auto group : new_nodes) {
+        auto &meta = m_node_metadata[group];
+        for (auto pin : meta.m_pins) {
+            auto found = m_pin_defaults.find(pin);
+            if (found != m_pin_defaults.end()) {
+                meta.m_default = found->second;
+            }
+        }
+
+        auto value = VALUE_ERROR;
+        switch (meta.m_active_pins.size()) {
+            case 0 :
+                value = meta.m_default != VALUE_UNDEFINED ? meta.m_default : old_value;
+                break;
+            case 1 :
+                value = m_pin_values[*meta.m_active_pins.begin()];
                 break;
-            case 1 : {      // normal case - 1 active writer
-                pin_t pin = *m_node_metadata[node_id].m_active_pins.begin();
-                m_node_values_write[node_id] = m_pin_values[pin];
-                m_node_write_time[node_id] = m_time;
+            default :
                 break;
+        }
+
+        node_set_initial_value(group, value);
+        m_node_change_time[group] = (value != old_value) ? m_time : old_change_time;
+        m_dirty_nodes_read.push_back(group);
+    }
+}
+
+void Simulator::capture_reset_state() {
+    assert(!m_patching);
+    assert(m_dirty_nodes_write.empty());
+
+    if (m_layout_changed) {
+        // the image refers to nodes and components by id, make sure renumbering doesn't invalidate it later
+        renumber();
+    }
+
+    auto &image = m_reset_image;
+    image.m_valid = true;
+    image.m_capture_pending = false;
+    image.m_time = m_time;
+
+    image.m_node_values_read = m_node_values_read;
+    image.m_node_values_write = m_node_values_write;
+    image.m_node_write_time = m_node_write_time;
+    image.m_node_change_time = m_node_change_time;
+    image.m_node_time_dirty_write.resize(m_node_metadata.size());
+    image.m_node_active_offsets.resize(m_node_metadata.size() + 1);
+    image.m_node_active_pins.clear();
+    for (size_t node_id = 0; node_id < m_node_metadata.size(); ++node_id) {
+        const auto &meta = m_node_metadata[node_id];
+        image.m_node_time_dirty_write[node_id] = meta.m_time_dirty_write;
+        image.m_node_active_offsets[node_id] = static_cast<uint32_t>(image.m_node_active_pins.size());
+        image.m_node_active_pins.insert(image.m_node_active_pins.end(), meta.m_active_pins.begin(), meta.m_active_pins.end());
+    }
+    image.m_node_active_offsets.back() = static_cast<uint32_t>(image.m_node_active_pins.size());
+    image.m_node_active_pins.shrink_to_fit();
+    image.m_dirty_nodes_read = m_dirty_nodes_read;
+    image.m_pin_values = m_pin_values;
+
+    image.m_input_changed = m_input_changed;
+    image.m_independent_components = m_independent_components;
+    image.m_wakeups = m_wakeups;
+    // only keep the state of the components that have any (most gates don't)
+    image.m_state_ids.clear();
+    image.m_component_states.clear();
+    for (const auto &comp : m_components) {
+        if (comp == nullptr) {
+            continue;
+        }
+
+        // the contents of a ROM never change while simulating, don't keep a second copy
+        auto state = comp->save_state(comp->description()->type() != COMPONENT_ROM);
+        if (!state.m_user_values.empty() || !state.m_extra_data.empty()) {
+            image.m_state_ids.push_back(comp->id());
+            image.m_component_states.push_back(std::move(state));
+        }
+    }
+    image.m_state_ids.shrink_to_fit();
+    image.m_component_states.shrink_to_fit();
+
+    image.m_node_touched.assign(m_node_metadata.size(), 0);
+    image.m_touched_nodes.clear();
+    image.m_component_touched.assign(m_components.size(), 0);
+    image.m_touched_components.clear();
+}
+
+void Simulator::reset() {
+    auto &image = m_reset_image;
+
+    if (!image.m_valid || m_layout_changed || m_patching) {
+        init();
+        return;
+    }
+
+    // nodes
+    for (auto node_id : image.m_touched_nodes) {
+        auto &meta = m_node_metadata[node_id];
+        m_non_boolean_nodes += !is_boolean(image.m_node_values_read[node_id]) - !is_boolean(m_node_values_read[node_id]);
+        m_node_values_read[node_id] = image.m_node_values_read[node_id];
+        m_node_values_write[node_id] = image.m_node_values_write[node_id];
+        m_node_write_time[node_id] = image.m_node_write_time[node_id];
+        m_node_change_time[node_id] = image.m_node_change_time[node_id];
+        meta.m_time_dirty_write = image.m_node_time_dirty_write[node_id];
+        meta.m_active_pins.clear();
+        meta.m_active_pins.insert(image.m_node_active_pins.begin() + image.m_node_active_offsets[node_id],
+                                  image.m_node_active_pins.begin() + image.m_node_active_offsets[node_id + 1]);
+
+        // a pin can only be written through the node it is part of
+        for (auto pin : meta.m_pins) {
+            m_pin_values[pin] = image.m_pin_values[pin];
+        }
+
+        image.m_node_touched[node_id] = 0;
+    }
+    image.m_touched_nodes.clear();
+
+    // components: independent components change their state without being marked as touched
+    for (auto comp : m_independent_components) {
+        reset_touch_component(comp);
+        m_independent_active[comp->id()] = 0;
+    }
+    for (auto comp : image.m_independent_components) {
+        reset_touch_component(comp);
+        m_independent_active[comp->id()] = 1;
+    }
+
+    for (auto comp : image.m_touched_components) {
+        auto state = image.component_state(comp->id());
+        comp->restore_state(state != nullptr ? *state : SimComponent::State());
+        m_input_changed[comp->id()] = image.m_input_changed[comp->id()];
+        image.m_component_touched[comp->id()] = 0;
+    }
+    image.m_touched_components.clear();
+
+    m_independent_components = image.m_independent_components;
+    m_wakeups = image.m_wakeups;
+    m_dirty_nodes_read = image.m_dirty_nodes_read;
+    m_dirty_nodes_write.clear();
+    for (auto comp : m_scheduled_components) {
+        m_scheduled_active[comp->id()] = 0;
+    }
+    m_scheduled_components.clear();
+    m_time = image.m_time;
+}
+
+void Simulator::update_reset_state(SimComponent *comp) {
+    assert(comp);
+
+    if (!m_reset_image.m_valid) {
+        return;
+    }
+
+    // only the extra data that was saved with the image is restored (e.g. not the contents of a ROM)
+    auto state = m_reset_image.component_state(comp->id());
+    if (state != nullptr && !state->m_extra_data.empty()) {
+        state->m_extra_data.assign(comp->extra_data(), comp->extra_data() + comp->extra_data_size());
+    }
+}
+
+SimComponent::State *Simulator::ResetImage::component_state(uint32_t comp_id) {
+    auto found = std::lower_bound(m_state_ids.begin(), m_state_ids.end(), comp_id);
+    if (found == m_state_ids.end() || *found != comp_id) {
+        return nullptr;
+    }
+    return &m_component_states[found - m_state_ids.begin()];
+}
+
+void Simulator::reset_touch_node(node_t node_id) {
+    if (m_reset_image.m_valid && m_reset_image.m_node_touched[node_id] == 0) {
+        m_reset_image.m_node_touched[node_id] = 1;
+        m_reset_image.m_touched_nodes.push_back(node_id);
+    }
+}
+
+void Simulator::reset_touch_component(SimComponent *comp) {
+    if (m_reset_image.m_valid && m_reset_image.m_component_touched[comp->id()] == 0) {
+        m_reset_image.m_component_touched[comp->id()] = 1;
+        m_reset_image.m_touched_components.push_back(comp);
+    }
+}
+
+void Simulator::renumber() {
+    assert(m_dirty_nodes_write.empty());
+    assert(m_owned_components.empty());
+    m_reset_image.m_valid = false;
+
+    const auto num_pins = m_pin_nodes.size();
+    const auto num_nodes = m_node_metadata.size();
+
+    // component that owns each pin
+    component_refs_t pin_owner(num_pins, nullptr);
+    for (const auto &comp : m_components) {
+        if (comp == nullptr) {
+            continue;
+        }
+        for (auto pin : comp->pins()) {
+            if (m_pin_nodes[pin] != NODE_INVALID) {
+                pin_owner[pin] = comp.get();
             }
-            default :       // multiple active writers
-               m_node_values_write[node_id] = VALUE_ERROR;
-               break;
         }
+    }
 
-        if (m_node_values_read[node_id] != m_node_values_write[node_id]) {
-            m_node_change_time[node_id] = m_time;
-            m_node_values_read[node_id] = m_node_values_write[node_id];
-            m_dirty_nodes_read.push_back(node_id);
+    // breadth-first walk over the components connected to each other, starting from the components in creation order
+    component_refs_t comp_order;
+    node_container_t node_order;
+    std::vector<bool> comp_visited(m_components.size(), false);
+    std::vector<bool> node_visited(num_nodes, false);
+
+    comp_order.reserve(m_components.size());
+    node_order.reserve(num_nodes);
+
+    for (const auto &start : m_components) {
+        if (start == nullptr || comp_visited[start->id()]) {
+            continue;
+        }
+
+        comp_visited[start->id()] = true;
+        comp_order.push_back(start.get());
+
+        for (auto head = comp_order.size() - 1; head < comp_order.size(); ++head) {
+            for (auto pin : comp_order[head]->pins()) {
+                auto node_id = m_pin_nodes[pin];
+                if (node_id == NODE_INVALID || node_visited[node_id]) {
+                    continue;
+                }
+
+                node_visited[node_id] = true;
+                node_order.push_back(node_id);
+
+                for (auto other_pin : m_node_metadata[node_id].m_pins) {
+                    auto other = pin_owner[other_pin];
+                    if (other != nullptr && !comp_visited[other->id()]) {
+                        comp_visited[other->id()] = true;
+                        comp_order.push_back(other);
+                    }
+                }
+            }
+        }
+    }
+
+    // build old -> new lookup tables
+    pin_container_t pin_map(num_pins, PIN_UNDEFINED);
+    pin_t next_pin = 0;
+    for (auto comp : comp_order) {
+        for (auto pin : comp->pins()) {
+            pin_map[pin] = next_pin++;
+        }
+    }
+
+    node_container_t node_map(num_nodes, NODE_INVALID);
+    for (node_t idx = 0; idx < node_order.size(); ++idx) {
+        node_map[node_order[idx]] = idx;
+    }
+
+    // pins
+    node_container_t new_pin_nodes(next_pin);
+    value_container_t new_pin_values(next_pin);
+    for (pin_t pin = 0; pin < num_pins; ++pin) {
+        if (pin_map[pin] != PIN_UNDEFINED) {
+            new_pin_nodes[pin_map[pin]] = node_map[m_pin_nodes[pin]];
+            new_pin_values[pin_map[pin]] = m_pin_values[pin];
+        }
+    }
+
+    pin_value_lut_t new_defaults;
+    for (const auto &entry : m_pin_defaults) {
+        if (pin_map[entry.first] != PIN_UNDEFINED) {
+            new_defaults[pin_map[entry.first]] = entry.second;
+        }
+    }
+
+    // nodes
+    node_metadata_container_t new_metadata(node_order.size());
+    value_container_t new_values_read(node_order.size());
+    value_container_t new_values_write(node_order.size());
+    timestamp_container_t new_write_time(node_order.size());
+    timestamp_container_t new_change_time(node_order.size());
+    std::vector<pin_pair_container_t> new_connections(m_patching_enabled ? node_order.size() : 0);
+
+    for (node_t idx = 0; idx < node_order.size(); ++idx) {
+        auto old_id = node_order[idx];
+        auto &meta = new_metadata[idx];
+
+        meta.m_default = m_node_metadata[old_id].m_default;
+        meta.m_dependents = move(m_node_metadata[old_id].m_dependents);
+        meta.m_time_dirty_write = m_node_metadata[old_id].m_time_dirty_write;
+        for (auto pin : m_node_metadata[old_id].m_pins) {
+            if (pin_map[pin] != PIN_UNDEFINED) {
+                meta.m_pins.push_back(pin_map[pin]);
+            }
+        }
+        for (auto pin : m_node_metadata[old_id].m_active_pins) {
+            if (pin_map[pin] != PIN_UNDEFINED) {
+                meta.m_active_pins.insert(pin_map[pin]);
+            }
+        }
+
+        if (m_patching_enabled) {
+            for (const auto &conn : m_node_connections[old_id]) {
+                if (pin_map[conn.first] != PIN_UNDEFINED && pin_map[conn.second] != PIN_UNDEFINED) {
+                    new_connections[idx].emplace_back(pin_map[conn.first], pin_map[conn.second]);
+                }
+            }
+        }
+
+        new_values_read[idx] = m_node_values_read[old_id];
+        new_values_write[idx] = m_node_values_write[old_id];
+        new_write_time[idx] = m_node_write_time[old_id];
+        new_change_time[idx] = m_node_change_time[old_id];
+    }
+
+    node_container_t new_dirty_nodes;
+    for (auto node_id : m_dirty_nodes_read) {
+        if (node_map[node_id] != NODE_INVALID) {
+            new_dirty_nodes.push_back(node_map[node_id]);
+        }
+    }
+
+    // components
+    component_container_t new_components;
+    timestamp_container_t new_input_changed;
+    std::vector<uint8_t> new_independent_active;
+    std::vector<uint8_t> new_scheduled_active;
+    new_components.reserve(comp_order.size());
+    new_input_changed.reserve(comp_order.size());
+    new_independent_active.reserve(comp_order.size());
+    new_scheduled_active.reserve(comp_order.size());
+
+    for (auto comp : comp_order) {
+        auto old_id = comp->id();
+        comp->renumber(static_cast<uint32_t>(new_components.size()), pin_map);
+        new_components.push_back(move(m_components[old_id]));
+        new_input_changed.push_back(m_input_changed[old_id]);
+        new_independent_active.push_back(m_independent_active[old_id]);
+        new_scheduled_active.push_back(m_scheduled_active[old_id]);
+    }
+
+    // switch over
+    m_components = move(new_components);
+    m_input_changed = move(new_input_changed);
+    m_independent_active = move(new_independent_active);
+    m_scheduled_active = move(new_scheduled_active);
+    m_pin_nodes = move(new_pin_nodes);
+    m_pin_values = move(new_pin_values);
+    m_pin_defaults = move(new_defaults);
+    m_node_metadata = move(new_metadata);
+    m_node_values_read = move(new_values_read);
+    count_non_boolean_nodes();
+    m_node_values_write = move(new_values_write);
+    m_node_write_time = move(new_write_time);
+    m_node_change_time = move(new_change_time);
+    m_node_connections = move(new_connections);
+    m_dirty_nodes_read = move(new_dirty_nodes);
+    m_free_nodes.clear();
+
+    m_layout_changed = false;
+    ++m_layout_version;
+}
+
+void Simulator::memory_usage(MemoryReport *report) const {
+    assert(report);
+
+    // components
+    report->add("simulator/components/objects", heap_bytes(m_components));
+    for (const auto &comp : m_components) {
+        if (comp != nullptr) {
+            comp->memory_usage(report);
+        }
+    }
+    report->add("simulator/components/scheduling",
+                heap_bytes(m_input_changed) + heap_bytes(m_init_components) + heap_bytes(m_independent_components) +
+                heap_bytes(m_independent_active) + heap_bytes(m_wakeups) + heap_bytes(m_dirty_components) +
+                heap_bytes(m_scheduled_components) + heap_bytes(m_scheduled_active) + heap_bytes(m_owned_components));
+
+    // pins
+    report->add("simulator/pins/tables", heap_bytes(m_pin_nodes) + heap_bytes(m_pin_values), m_pin_nodes.size());
+    size_t connections = 0, num_connections = 0;
+    for (const auto &node_connections : m_node_connections) {
+        connections += heap_bytes(node_connections);
+        num_connections += node_connections.size();
+    }
+    report->add("simulator/pins/connections", heap_bytes(m_node_connections) + connections, num_connections);
+    report->add("simulator/pins/defaults", heap_bytes(m_pin_defaults), m_pin_defaults.size());
+
+    // nodes
+    size_t dependents = 0, pins = 0, active_pins = 0;
+    for (const auto &meta : m_node_metadata) {
+        dependents += heap_bytes(meta.m_dependents);
+        pins += heap_bytes(meta.m_pins);
+        active_pins += meta.m_active_pins.capacity() * sizeof(pin_t);
+    }
+    report->add("simulator/nodes/metadata", heap_bytes(m_node_metadata), m_node_metadata.size());
+    report->add("simulator/nodes/dependents", dependents);
+    report->add("simulator/nodes/pins", pins);
+    report->add("simulator/nodes/active_pins", active_pins);
+    report->add("simulator/nodes/values",
+                heap_bytes(m_node_values_read) + heap_bytes(m_node_values_write) + heap_bytes(m_node_write_time) +
+                heap_bytes(m_node_change_time) + heap_bytes(m_dirty_nodes_read) + heap_bytes(m_dirty_nodes_write) +
+                heap_bytes(m_free_nodes));
+
+    // warm reset
+    const auto &image = m_reset_image;
+    size_t image_bytes =
+            heap_bytes(image.m_node_values_read) + heap_bytes(image.m_node_values_write) +
+            heap_bytes(image.m_node_write_time) + heap_bytes(image.m_node_change_time) +
+            heap_bytes(image.m_node_time_dirty_write) + heap_bytes(image.m_node_active_offsets) +
+            heap_bytes(image.m_node_active_pins) + heap_bytes(image.m_state_ids) +
+            heap_bytes(image.m_dirty_nodes_read) + heap_bytes(image.m_pin_values) + heap_bytes(image.m_input_changed) +
+            heap_bytes(image.m_independent_components) + heap_bytes(image.m_wakeups) +
+            heap_bytes(image.m_component_states) + heap_bytes(image.m_node_touched) +
+            heap_bytes(image.m_touched_nodes) + heap_bytes(image.m_component_touched) +
+            heap_bytes(image.m_touched_components);
+    for (const auto &state : image.m_component_states) {
+        image_bytes += heap_bytes(state.m_user_values) + heap_bytes(state.m_extra_data);
+    }
+    report->add("simulator/reset_image", image_bytes);
+}
+
+void Simulator::set_owned_components(std::vector<uint8_t> owned) {
+    assert(owned.empty() || owned.size() == m_components.size());
+    m_owned_components = std::move(owned);
+}
+
+void Simulator::instantiate_partition(const Simulator &reference, std::vector<uint8_t> owned) {
+    assert(m_components.empty() && m_pin_nodes.empty());
+    assert(!reference.m_layout_changed);
+    assert(owned.size() == reference.m_components.size());
+
+    // pins & nodes: the same layout as the reference
+    const auto num_nodes = reference.m_node_metadata.size();
+    m_pin_nodes = reference.m_pin_nodes;
+    m_pin_values.assign(reference.m_pin_values.size(), VALUE_UNDEFINED);
+    m_node_metadata.resize(num_nodes);
+    for (size_t node_id = 0; node_id < num_nodes; ++node_id) {
+        m_node_metadata[node_id].m_pins = reference.m_node_metadata[node_id].m_pins;
+    }
+    m_node_values_read.assign(num_nodes, VALUE_UNDEFINED);
+    m_node_values_write.assign(num_nodes, VALUE_UNDEFINED);
+    m_non_boolean_nodes = num_nodes;
+    m_node_write_time.assign(num_nodes, 0);
+    m_node_change_time.assign(num_nodes, 0);
+
+    // components: the ids of the components that aren't owned stay empty
+    for (size_t id = 0; id < owned.size(); ++id) {
+        auto ref_comp = reference.m_components[id].get();
+        if (!owned[id] || ref_comp == nullptr) {
+            m_components.push_back(nullptr);
+            m_input_changed.push_back(0);
+            m_scheduled_active.push_back(0);
+            m_independent_active.push_back(0);
+            continue;
+        }
+
+        auto first_pin = ref_comp->num_pins() > 0 ? ref_comp->pin_by_index(0) : PIN_UNDEFINED;
+        auto comp = create_component(ref_comp->description(), first_pin);
+        if (ref_comp->user_values_enabled()) {
+            comp->enable_user_values();
         }
     }
 
+    m_layout_changed = false;
+    m_reset_image.m_valid = false;
+    set_owned_components(std::move(owned));
+}
+
+void Simulator::copy_node_state(const Simulator &reference) {
+    assert(reference.m_node_metadata.size() == m_node_metadata.size());
+    assert(reference.m_pin_nodes.size() == m_pin_nodes.size());
+
+    m_time = reference.m_time;
+    m_node_values_read = reference.m_node_values_read;
+    m_node_values_write = reference.m_node_values_write;
+    m_non_boolean_nodes = reference.m_non_boolean_nodes;
+    m_node_write_time = reference.m_node_write_time;
+    m_node_change_time = reference.m_node_change_time;
+    for (size_t node_id = 0; node_id < m_node_metadata.size(); ++node_id) {
+        const auto &ref_meta = reference.m_node_metadata[node_id];
+        m_node_metadata[node_id].m_default = ref_meta.m_default;
+        m_node_metadata[node_id].m_active_pins = ref_meta.m_active_pins;
+        m_node_metadata[node_id].m_time_dirty_write = ref_meta.m_time_dirty_write;
+    }
+    m_dirty_nodes_read = reference.m_dirty_nodes_read;
+    m_pin_values = reference.m_pin_values;
+    m_pin_defaults = reference.m_pin_defaults;
+}
+
+size_t Simulator::node_writer_count(node_t node_id) const {
+    assert(node_id < m_node_metadata.size());
+    return m_node_metadata[node_id].m_active_pins.size();
+}
+
+Value Simulator::node_writer_value(node_t node_id) const {
+    assert(node_id < m_node_metadata.size());
+    auto &active = m_node_metadata[node_id].m_active_pins;
+    return active.empty() ? VALUE_UNDEFINED : m_pin_values[*active.begin()];
+}
+
+void Simulator::resolve_node(node_t node_id, size_t writer_count, Value writer_value) {
+    assert(node_id < m_node_values_write.size());
+
+    switch (writer_count) {
+        case 0 :        // no active writers: use default value (i.e. pull-up/down resistor)
+            m_node_values_write[node_id] = m_node_metadata[node_id].m_default;
+            m_node_write_time[node_id] = m_time;
+            break;
+        case 1 :        // normal case - 1 active writer
+            m_node_values_write[node_id] = writer_value;
+            m_node_write_time[node_id] = m_time;
+            break;
+        default :       // multiple active writers
+           m_node_values_write[node_id] = VALUE_ERROR;
+           break;
+    }
+
+    if (m_node_values_read[node_id] != m_node_values_write[node_id]) {
+        m_non_boolean_nodes += !is_boolean(m_node_values_write[node_id]) - !is_boolean(m_node_values_read[node_id]);
+        m_node_change_time[node_id] = m_time;
+        m_node_values_read[node_id] = m_node_values_write[node_id];
+        m_dirty_nodes_read.push_back(node_id);
+    }
+}
+
+void Simulator::count_non_boolean_nodes() {
+    m_non_boolean_nodes = std::count_if(begin(m_node_values_read), end(m_node_values_read),
+                                        [](auto value) {return !is_boolean(value);});
+}
+
+void Simulator::end_step_nodes() {
+    m_dirty_nodes_write.clear();
+}
+
+void Simulator::postprocess_dirty_nodes() {
+
+    for (auto node_id : m_dirty_nodes_write) {
+        resolve_node(node_id, node_writer_count(node_id), node_writer_value(node_id));
+    }
+
     m_dirty_nodes_write.clear();
 }
 
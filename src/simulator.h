@@ -6,27 +6,42 @@
 // includes
 #include "sim_component.h"
 #include "sim_functions.h"
+#include "std_helper.h"
 
 
 #include <vector>
 #include <array>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
 
 namespace lsim {
 
 struct NodeMetadata {
-    using component_set_t = std::set<SimComponent *>;
-    using pin_set_t = std::set<pin_t>;
+    using component_list_t = std::vector<SimComponent *>;
+    using pin_set_t = flat_set<pin_t>;
 
     NodeMetadata() = default;
 
+    // add a component that reads the node (skips the component that was added last: pins of a component are added together)
+    void add_dependent(SimComponent *comp) {
+        if (m_dependents.empty() || m_dependents.back() != comp) {
+            m_dependents.push_back(comp);
+        }
+    }
+
     // data
     Value               m_default = VALUE_UNDEFINED;
-    component_set_t     m_dependents;
+    component_list_t    m_dependents;       // may list a component twice after merging nodes (harmless: step deduplicates)
 	pin_container_t		m_pins;
     pin_set_t           m_active_pins;
 	timestamp_t			m_time_dirty_write = 0;
 };
 
+// group pins that are connected to each other: returns the lowest pin of its group for each pin
+pin_container_t connected_pin_roots(size_t num_pins, const pin_pair_container_t &connections);
+
 class Simulator {
 public:
     Simulator() = default;
@@ -34,12 +49,16 @@ public:
 
     // components
     SimComponent *create_component(ModelComponent *desc);
+    SimComponent *create_component(ModelComponent *desc, pin_t first_pin);
     void clear_components();
+    size_t num_components() const {return m_components.size();}
+    SimComponent *component_by_id(uint32_t comp_id) const {return m_components[comp_id].get();}
 
-    // pins
+    // pins: pin_t and node_t (like component ids) are indices that change when the simulator renumbers (see renumber)
     pin_t assign_pin(SimComponent *component, bool used_as_input);
     node_t connect_pins(pin_t pin_a, pin_t pin_b);
     void clear_pins();
+    pin_t add_pin_block(const node_container_t &pin_nodes, node_t num_nodes, const pin_pair_container_t &connections);
     void pin_set_default(pin_t pin, Value value);
     void pin_set_initial_value(pin_t pin, Value value);
     void write_pin(pin_t pin, Value value);
@@ -48,6 +67,7 @@ public:
     bool pin_changed_previous_step(pin_t pin) const;
     timestamp_t pin_last_change_time(pin_t pin) const;
 
+    size_t num_pins() const {return m_pin_nodes.size();}
     node_t pin_node(pin_t pin) const;
     Value pin_output_value(pin_t pin) const;
     void pin_set_output_value(pin_t pin, Value value);
@@ -57,6 +77,7 @@ public:
     void release_node(node_t node_id);
     node_t merge_nodes(node_t node_a, node_t node_b);
     void clear_nodes();
+    size_t num_nodes() const {return m_node_values_read.size();}
 
     void node_set_default(node_t node_id, Value value);
     void node_set_initial_value(node_t node_id, Value value);
@@ -79,12 +100,109 @@ public:
     void step();
     void run_until_stable(size_t stable_ticks);
     timestamp_t current_time() const {return m_time;}
+    const node_container_t &nodes_changed() const {return m_dirty_nodes_read;}    // nodes that changed in the last step
+
+    // two-state mode: while every node holds a boolean value the gates skip the undefined/error handling
+    //  (falls back to four-state evaluation as soon as a node becomes undefined or an error)
+    void enable_two_state(bool enable) {m_two_state_enabled = enable;}
+    bool two_state() const {return m_two_state_enabled && m_non_boolean_nodes == 0;}
+
+    // warm reset: capture_reset_state stores an image of the current (settled) state of the simulation, reset returns
+    //  to that image by only restoring the nodes and components that were touched since. The image is also captured
+    //  automatically by the first step after init() in which no node changes, unless a user value was written or the
+    //  circuit changed before (the image would include the stimulus). Without a valid image (none captured or the
+    //  circuit changed since) reset falls back to init().
+    void capture_reset_state();
+    void reset();
+
+    // update_reset_state: copy the internal state of a component that was modified from outside the simulation (e.g. the
+    //  contents of a RAM) into the reset image, so reset doesn't undo the modification
+    void update_reset_state(SimComponent *comp);
+
+    // checkpoints: save the complete state of the simulation to disk and restore it into a simulator running the same
+    //  design (checked with layout_hash, which includes the component properties). Restoring fails, leaving the
+    //  simulator untouched, for a damaged file, a different design or a file saved on a machine with another byte
+    //  order or word size. Save between steps.
+    //  same_simulator: the data stays in memory and is only restored into the simulator that saved it (e.g. SimHistory).
+    //  The design is then checked on layout_version instead of the (much slower) layout_hash.
+    bool save_checkpoint(const char *filename);
+    bool load_checkpoint(const char *filename);
+    std::string save_checkpoint_data(bool same_simulator = false);
+    bool load_checkpoint_data(const std::string &data, bool same_simulator = false);
+    uint64_t layout_hash() const;
+
+    // input listeners: notified of the changes made to the simulation from outside of it (e.g. to record the inputs).
+    //  on_user_value is called for every user value written to a component, on_schedule for every call of
+    //  schedule_input_changed (made after the internal state of the component was modified, e.g. a hot-swapped memory).
+    //  Either function may be empty. Returns a handle to remove the listener with.
+    using user_value_listener_t = std::function<void(SimComponent *comp, uint32_t index, Value value)>;
+    using schedule_listener_t = std::function<void(SimComponent *comp)>;
+    size_t add_input_listener(user_value_listener_t on_user_value, schedule_listener_t on_schedule);
+    void remove_input_listener(size_t handle);
+    void user_value_changed(SimComponent *comp, uint32_t index, Value value);
 
+    // independent components: their independent function runs every step while activated
     void activate_independent_simulation_func(SimComponent *comp);
     void deactivate_independent_simulation_func(SimComponent *comp);
 
+    // schedule_wakeup: run the independent function of the component once, in the first step at or after the specified
+    //  time. Components that only change at known times (e.g. an oscillator) deactivate their independent function and
+    //  schedule their next change instead, so they don't cost anything in the steps in between.
+    void schedule_wakeup(SimComponent *comp, timestamp_t time);
+
+    // schedule_input_changed: run the input-changed function of the component in the next step, even if its inputs didn't change
+    //  (e.g. after its internal state was modified from outside the simulation)
+    void schedule_input_changed(SimComponent *comp);
+
+    // incremental changes: modify a running simulation without discarding the state of unaffected nodes.
+    //  Components created and pins connected between patch_begin and patch_end are merged into the simulation by patch_end.
+    //  Only the nodes touched by the patch are rebuilt, the full renumbering is postponed to the next init().
+    //  Splitting a node requires the connections between its pins: these are only recorded after enable_patching,
+    //  call it before instantiating the circuits that will be patched.
+    void enable_patching();
+    bool patching_enabled() const {return m_patching_enabled;}
+    void patch_begin();
+    void remove_component(SimComponent *comp);
+    void disconnect_pins(pin_t pin_a, pin_t pin_b);
+    void patch_end();
+    bool is_patching() const {return m_patching;}
+
+    // renumbering: order components, pins and nodes by connectivity so neighbouring logic is stored close together.
+    //  Also compacts the nodes released by merges. Runs automatically when the simulation is (re)initialized after changes
+    //  (also from capture_reset_state and the checkpoint functions). Renumbering invalidates the pin_t, node_t and
+    //  component ids handed out before: look them up again through the SimCircuit (its pin ids stay valid) or compare
+    //  layout_version to the version at the time the handle was taken.
+    void renumber();
+    uint32_t layout_version() const {return m_layout_version;}
+
+    // memory footprint: add an estimate of the memory used by the simulator, its components and their nested circuits
+    void memory_usage(MemoryReport *report) const;
+
+    // partitioned simulation (see sim_partition.h): a simulator only runs the components it owns. A step is split in
+    //  step_components, after which the partitions exchange the nodes they wrote, and resolve_node for each node
+    //  written by any of the partitions, followed by end_step_nodes.
+    void set_owned_components(std::vector<uint8_t> owned);
+    // instantiate_partition: copy the pin and node layout of a (renumbered) reference simulator but only create the
+    //  owned components, with the same ids as in the reference. copy_node_state takes over the initial node values
+    //  after init(), those are partly set by components that aren't part of the partition.
+    void instantiate_partition(const Simulator &reference, std::vector<uint8_t> owned);
+    void copy_node_state(const Simulator &reference);
+    bool owns_component(const SimComponent *comp) const {return m_owned_components.empty() || m_owned_components[comp->id()];}
+    void step_components();
+    const node_container_t &nodes_written() const {return m_dirty_nodes_write;}
+    size_t node_writer_count(node_t node_id) const;
+    Value node_writer_value(node_t node_id) const;
+    void resolve_node(node_t node_id, size_t writer_count, Value writer_value);
+    void end_step_nodes();
+
 private:
     void postprocess_dirty_nodes();
+    void count_non_boolean_nodes();
+    void mark_patched_node(node_t node_id);
+    void split_patched_node(node_t node_id);
+    void reset_touch_node(node_t node_id);
+    void reset_touch_component(SimComponent *comp);
+    bool load_checkpoint_data(const char *data, size_t size, bool same_simulator);
 
 private:
     using timestamp_container_t = std::vector<timestamp_t>;
@@ -92,6 +210,52 @@ private:
     using component_refs_t = std::vector<SimComponent *>;
     using node_metadata_container_t = std::vector<NodeMetadata>;
     using sim_func_container_t = std::vector<sim_component_functions_t>;
+    using pin_value_lut_t = std::unordered_map<pin_t, Value>;
+
+    struct Wakeup {
+        timestamp_t     m_time;
+        SimComponent *  m_comp;
+
+        // reversed: the standard heap algorithms keep the earliest wakeup at the front
+        bool operator<(const Wakeup &other) const {return m_time > other.m_time;}
+    };
+    using wakeup_container_t = std::vector<Wakeup>;
+
+    struct InputListener {
+        size_t                  m_handle;
+        user_value_listener_t   m_on_user_value;
+        schedule_listener_t     m_on_schedule;
+    };
+
+    struct ResetImage {
+        bool                    m_valid = false;
+        bool                    m_capture_pending = false;  // capture when the simulation settles after init
+        timestamp_t             m_time = 0;
+
+        value_container_t       m_node_values_read;
+        value_container_t       m_node_values_write;
+        timestamp_container_t   m_node_write_time;
+        timestamp_container_t   m_node_change_time;
+        timestamp_container_t   m_node_time_dirty_write;
+        std::vector<uint32_t>   m_node_active_offsets;      // active pins of node n: [offsets[n], offsets[n + 1])
+        pin_container_t         m_node_active_pins;
+        node_container_t        m_dirty_nodes_read;
+        value_container_t       m_pin_values;
+
+        timestamp_container_t   m_input_changed;
+        component_refs_t        m_independent_components;
+        wakeup_container_t      m_wakeups;
+        std::vector<uint32_t>   m_state_ids;                // components with user values or extra data (sorted)
+        std::vector<SimComponent::State> m_component_states;    // saved state of each component in m_state_ids
+
+        // nodes and components modified since the image was captured
+        std::vector<uint8_t>    m_node_touched;
+        node_container_t        m_touched_nodes;
+        std::vector<uint8_t>    m_component_touched;
+        component_refs_t        m_touched_components;
+
+        SimComponent::State *component_state(uint32_t comp_id);     // nullptr when nothing was saved
+    };
 
 private:
     timestamp_t    m_time = 0;								// current simulation timestamp
@@ -101,11 +265,16 @@ private:
 	timestamp_container_t		m_input_changed;			// timestamp when component was last added to "to simulate" list
     component_refs_t            m_init_components;			// components with an init function
     component_refs_t            m_independent_components;	// components with an input independent update function
+    std::vector<uint8_t>        m_independent_active;		// is the component in m_independent_components? (by id)
+    wakeup_container_t          m_wakeups;					// scheduled wakeups (min-heap on time)
 	component_refs_t			m_dirty_components;			// components with changed input values
+	component_refs_t			m_scheduled_components;		// components to simulate in the next step regardless of their inputs
+    std::vector<uint8_t>        m_scheduled_active;			// is the component in m_scheduled_components? (by id)
 
 	// pins
     node_container_t            m_pin_nodes;				// node assignment for each pin
     value_container_t           m_pin_values;				// last value written to a pin
+    pin_value_lut_t             m_pin_defaults;				// default value set through a pin (i.e. pull-up/down resistor)
 
 	// nodes
     node_metadata_container_t m_node_metadata;				// assorted metadata
@@ -114,12 +283,36 @@ private:
     value_container_t         m_node_values_write;			// values of the nodes in the current simulation run
     node_container_t          m_dirty_nodes_read;			// nodes that were changed in the last simulation run
     node_container_t          m_dirty_nodes_write;			// nodes that were changed in the current simulation run
+    size_t                    m_non_boolean_nodes = 0;		// number of nodes that are undefined or an error
+    bool                      m_two_state_enabled = true;
 
     timestamp_container_t     m_node_write_time;			// timestamp when node was last written to
     timestamp_container_t     m_node_change_time;			// timestamp when node last changed value
 
     // simulation functions
     sim_func_container_t        m_sim_functions;
+
+    // incremental changes
+    bool                        m_patching_enabled = false;	// record the connections between pins ?
+    bool                        m_patching = false;			// between patch_begin and patch_end ?
+    size_t                      m_patch_first_component = 0;	// first component created during the current patch
+    size_t                      m_patch_first_node = 0;		// first node created during the current patch
+    std::vector<pin_pair_container_t> m_node_connections;	// connections made between the pins of each node (when enabled)
+    node_container_t            m_patched_nodes;			// existing nodes touched by the current patch
+
+    // renumbering
+    bool                        m_layout_changed = false;	// components or connections changed since last renumbering
+    uint32_t                    m_layout_version = 0;		// incremented by each renumbering
+
+    // warm reset
+    ResetImage                  m_reset_image;
+
+    // partitioning
+    std::vector<uint8_t>        m_owned_components;			// components simulated by this simulator (empty = all)
+
+    // input listeners
+    std::vector<InputListener>  m_input_listeners;
+    size_t                      m_next_listener_handle = 1;
 };
 
 } // namespace lsim
@@ -50,6 +50,54 @@ void remove_if(std::vector<T>& container, Predicate condition) {
 	container.erase(std::remove_if(begin(container), end(container), condition), end(container));
 }
 
+// flat_set: a set stored as a sorted vector. A lot more compact than std::set for the handful of elements it's
+//	meant for (e.g. the pins driving a node), at the cost of linear time inserts and erases.
+template <typename T>
+class flat_set {
+public:
+	using const_iterator = typename std::vector<T>::const_iterator;
+
+public:
+	flat_set() = default;
+
+	void insert(const T &value) {
+		auto found = std::lower_bound(m_data.begin(), m_data.end(), value);
+		if (found == m_data.end() || *found != value) {
+			m_data.insert(found, value);
+		}
+	}
+
+	template <typename InputIt>
+	void insert(InputIt first, InputIt last) {
+		for (; first != last; ++first) {
+			insert(*first);
+		}
+	}
+
+	size_t erase(const T &value) {
+		auto found = std::lower_bound(m_data.begin(), m_data.end(), value);
+		if (found == m_data.end() || *found != value) {
+			return 0;
+		}
+		m_data.erase(found);
+		return 1;
+	}
+
+	size_t count(const T &value) const {return std::binary_search(m_data.begin(), m_data.end(), value) ? 1 : 0;}
+	size_t size() const {return m_data.size();}
+	bool empty() const {return m_data.empty();}
+	size_t capacity() const {return m_data.capacity();}
+	void clear() {m_data.clear();}
+
+	const_iterator begin() const {return m_data.begin();}
+	const_iterator end() const {return m_data.end();}
+
+	bool operator==(const flat_set &other) const {return m_data == other.m_data;}
+	bool operator!=(const flat_set &other) const {return m_data != other.m_data;}
+
+private:
+	std::vector<T> m_data;
+};
 
 } // namespace lsim
 
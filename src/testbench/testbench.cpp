@@ -0,0 +1,245 @@
+// testbench.cpp - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// coroutine based testbenches (requires C++20)
+
+#include "testbench.h"
+#include "sim_circuit.h"
+#include "simulator.h"
+#include "std_helper.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace lsim {
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// TestTask
+//
+
+std::coroutine_handle<> TestTask::FinalAwaiter::await_suspend(handle_t handle) noexcept {
+    auto continuation = handle.promise().m_continuation;
+    return continuation ? continuation : std::noop_coroutine();
+}
+
+TestTask::TestTask(TestTask &&other) noexcept : m_handle(other.m_handle) {
+    other.m_handle = nullptr;
+}
+
+TestTask &TestTask::operator=(TestTask &&other) noexcept {
+    if (this != &other) {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+        m_handle = other.m_handle;
+        other.m_handle = nullptr;
+    }
+    return *this;
+}
+
+TestTask::~TestTask() {
+    if (m_handle) {
+        m_handle.destroy();
+    }
+}
+
+std::coroutine_handle<> TestTask::await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    m_handle.promise().m_continuation = awaiting;
+    return m_handle;
+}
+
+void TestTask::await_resume() {
+    if (m_handle && m_handle.promise().m_exception) {
+        std::rethrow_exception(m_handle.promise().m_exception);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// TestBench
+//
+
+void TestBench::Awaiter::await_suspend(std::coroutine_handle<> handle) {
+    m_handle = handle;
+    m_bench->wait(this);
+}
+
+TestBench::TestBench(Simulator *sim, SimCircuit *circuit) :
+        m_sim(sim),
+        m_circuit(circuit) {
+    assert(sim);
+    assert(circuit);
+}
+
+void TestBench::spawn(TestTask task) {
+    add_task(std::move(task), false);
+}
+
+void TestBench::spawn_background(TestTask task) {
+    add_task(std::move(task), true);
+}
+
+size_t TestBench::num_running() const {
+    return std::count_if(begin(m_tasks), end(m_tasks), [](const auto &task) {return !task.m_background;});
+}
+
+bool TestBench::run(size_t max_steps) {
+    for (size_t step = 0; step < max_steps && num_running() > 0; ++step) {
+        m_sim->step();
+        wake_waiters();
+    }
+
+    return num_running() == 0;
+}
+
+timestamp_t TestBench::now() const {
+    return m_sim->current_time();
+}
+
+void TestBench::write(pin_id_t pin_id, Value value) {
+    m_circuit->write_pin(pin_id, value);
+}
+
+void TestBench::write(const pin_id_container_t &pins, uint64_t value) {
+    m_circuit->write_pins(pins, value);
+}
+
+Value TestBench::read(pin_id_t pin_id) const {
+    return m_circuit->read_pin(pin_id);
+}
+
+uint64_t TestBench::read(const pin_id_container_t &pins) const {
+    return m_circuit->read_pins(pins);
+}
+
+TestBench::Awaiter TestBench::steps(size_t count) {
+    Awaiter result(this);
+    result.m_wake_time = now() + count;
+    result.m_ready = count == 0;
+    return result;
+}
+
+TestBench::Awaiter TestBench::changed(pin_id_t pin_id) {
+    return watch({pin_id}, []() {return true;});
+}
+
+TestBench::Awaiter TestBench::rising_edge(pin_id_t pin_id) {
+    return watch({pin_id}, [=, this]() {return read(pin_id) == VALUE_TRUE;});
+}
+
+TestBench::Awaiter TestBench::falling_edge(pin_id_t pin_id) {
+    return watch({pin_id}, [=, this]() {return read(pin_id) == VALUE_FALSE;});
+}
+
+TestBench::Awaiter TestBench::bus_equals(const pin_id_container_t &pins, uint64_t value) {
+    return until(pins, [=, this]() {return read(pins) == value;});
+}
+
+TestBench::Awaiter TestBench::until(const pin_id_container_t &pins, std::function<bool()> condition) {
+    auto result = watch(pins, condition);
+    result.m_ready = condition();
+    return result;
+}
+
+TestTask TestBench::cycles(pin_id_t clock, size_t count) {
+    for (size_t idx = 0; idx < count; ++idx) {
+        co_await rising_edge(clock);
+    }
+}
+
+void TestBench::add_task(TestTask task, bool background) {
+    auto handle = task.m_handle;
+    m_tasks.push_back({std::move(task), background});
+
+    // run until the first suspension point
+    handle.resume();
+    finish_tasks();
+}
+
+void TestBench::wait(Awaiter *awaiter) {
+    if (awaiter->m_nodes.empty()) {
+        m_timed.emplace(awaiter->m_wake_time, m_timed_sequence++, awaiter);
+        return;
+    }
+
+    for (auto node_id : awaiter->m_nodes) {
+        m_watchers[node_id].push_back(awaiter);
+    }
+}
+
+void TestBench::wake_waiters() {
+    // >> find the tasks that can continue
+    while (!m_timed.empty() && std::get<0>(m_timed.top()) <= now()) {
+        m_ready.push_back(std::get<2>(m_timed.top()));
+        m_timed.pop();
+    }
+
+    for (auto node_id : m_sim->nodes_changed()) {
+        auto found = m_watchers.find(node_id);
+        if (found == m_watchers.end()) {
+            continue;
+        }
+
+        for (auto awaiter : found->second) {
+            if (!awaiter->m_ready && awaiter->m_condition()) {
+                awaiter->m_ready = true;
+                m_ready.push_back(awaiter);
+            }
+        }
+    }
+
+    if (m_ready.empty()) {
+        return;
+    }
+
+    // >> stop watching before resuming: the awaiter doesn't survive its task continuing
+    for (auto awaiter : m_ready) {
+        for (auto node_id : awaiter->m_nodes) {
+            auto &watchers = m_watchers[node_id];
+            remove(watchers, awaiter);
+            if (watchers.empty()) {
+                m_watchers.erase(node_id);
+            }
+        }
+    }
+
+    auto ready = std::move(m_ready);
+    m_ready.clear();
+
+    for (auto awaiter : ready) {
+        awaiter->m_handle.resume();
+    }
+
+    finish_tasks();
+}
+
+void TestBench::finish_tasks() {
+    for (auto iter = m_tasks.begin(); iter != m_tasks.end();) {
+        if (!iter->m_task.done()) {
+            ++iter;
+            continue;
+        }
+
+        auto exception = iter->m_task.m_handle.promise().m_exception;
+        iter = m_tasks.erase(iter);
+
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+}
+
+TestBench::Awaiter TestBench::watch(const pin_id_container_t &pins, std::function<bool()> condition) {
+    Awaiter result(this);
+    result.m_condition = std::move(condition);
+
+    for (auto pin_id : pins) {
+        result.m_nodes.push_back(m_circuit->pin_node(pin_id));
+    }
+    std::sort(begin(result.m_nodes), end(result.m_nodes));
+    result.m_nodes.erase(std::unique(begin(result.m_nodes), end(result.m_nodes)), end(result.m_nodes));
+
+    return result;
+}
+
+} // namespace lsim
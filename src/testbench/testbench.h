@@ -0,0 +1,152 @@
+// testbench.h - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// coroutine based testbenches (requires C++20)
+
+#ifndef LSIM_TESTBENCH_H
+#define LSIM_TESTBENCH_H
+
+#include "sim_types.h"
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace lsim {
+
+class SimCircuit;
+class Simulator;
+
+// TestTask: return type of a testbench coroutine. A task is started by spawning it on a TestBench or by awaiting it
+//  from another task (which resumes when the awaited task completes).
+class TestTask {
+public:
+    struct promise_type;
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept {return false;}
+        std::coroutine_handle<> await_suspend(handle_t handle) noexcept;
+        void await_resume() noexcept {}
+    };
+
+    struct promise_type {
+        TestTask get_return_object() {return TestTask(handle_t::from_promise(*this));}
+        std::suspend_always initial_suspend() noexcept {return {};}
+        FinalAwaiter final_suspend() noexcept {return {};}
+        void return_void() {}
+        void unhandled_exception() {m_exception = std::current_exception();}
+
+        std::coroutine_handle<>     m_continuation;
+        std::exception_ptr          m_exception;
+    };
+
+public:
+    TestTask(TestTask &&other) noexcept;
+    TestTask &operator=(TestTask &&other) noexcept;
+    TestTask(const TestTask &) = delete;
+    ~TestTask();
+
+    bool done() const {return !m_handle || m_handle.done();}
+
+    // awaiting a task from another task
+    bool await_ready() const noexcept {return done();}
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept;
+    void await_resume();
+
+private:
+    friend class TestBench;
+    explicit TestTask(handle_t handle) : m_handle(handle) {}
+
+private:
+    handle_t    m_handle;
+};
+
+// TestBench: drives the simulation and resumes the spawned tasks when the condition they're waiting for is met.
+//  Tasks waiting for a signal are only checked when one of the nodes they watch changed value.
+class TestBench {
+public:
+    class Awaiter {
+    public:
+        bool await_ready() const {return m_ready;}
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const {}
+
+    private:
+        friend class TestBench;
+        explicit Awaiter(TestBench *bench) : m_bench(bench) {}
+
+    private:
+        TestBench *             m_bench;
+        node_container_t        m_nodes;            // wake when one of these nodes changes and the condition holds
+        std::function<bool()>   m_condition;
+        timestamp_t             m_wake_time = 0;    // wake at this timestamp (without nodes)
+        bool                    m_ready = false;
+        std::coroutine_handle<> m_handle;
+    };
+
+public:
+    TestBench(Simulator *sim, SimCircuit *circuit);
+    TestBench(const TestBench &) = delete;
+
+    // tasks: run only advances the simulation while there are tasks that didn't complete yet, background tasks
+    //  (e.g. a clock generator) are resumed as well but don't keep the simulation running.
+    void spawn(TestTask task);
+    void spawn_background(TestTask task);
+    size_t num_running() const;
+
+    // run: step the simulation until all (foreground) tasks completed or max_steps have been simulated.
+    //  Returns true when all tasks completed. An exception thrown by a task is rethrown here.
+    bool run(size_t max_steps);
+
+    // access the circuit
+    Simulator *sim() const {return m_sim;}
+    SimCircuit *circuit() const {return m_circuit;}
+    timestamp_t now() const;
+
+    void write(pin_id_t pin_id, Value value);
+    void write(const pin_id_container_t &pins, uint64_t value);
+    Value read(pin_id_t pin_id) const;
+    uint64_t read(const pin_id_container_t &pins) const;
+
+    // conditions to co_await
+    Awaiter steps(size_t count);
+    Awaiter changed(pin_id_t pin_id);
+    Awaiter rising_edge(pin_id_t pin_id);
+    Awaiter falling_edge(pin_id_t pin_id);
+    Awaiter bus_equals(const pin_id_container_t &pins, uint64_t value);
+    Awaiter until(const pin_id_container_t &pins, std::function<bool()> condition);
+    TestTask cycles(pin_id_t clock, size_t count);
+
+private:
+    struct Task {
+        TestTask    m_task;
+        bool        m_background;
+    };
+
+    using timed_entry_t = std::tuple<timestamp_t, uint64_t, Awaiter *>;
+    using timed_queue_t = std::priority_queue<timed_entry_t, std::vector<timed_entry_t>, std::greater<timed_entry_t>>;
+
+    void add_task(TestTask task, bool background);
+    void wait(Awaiter *awaiter);
+    void wake_waiters();
+    void finish_tasks();
+    Awaiter watch(const pin_id_container_t &pins, std::function<bool()> condition);
+
+private:
+    Simulator *                 m_sim;
+    SimCircuit *                m_circuit;
+    std::vector<Task>           m_tasks;
+
+    std::unordered_map<node_t, std::vector<Awaiter *>> m_watchers;   // tasks waiting for a change of a node
+    timed_queue_t               m_timed;                            // tasks waiting for a timestamp
+    uint64_t                    m_timed_sequence = 0;
+    std::vector<Awaiter *>      m_ready;
+};
+
+} // namespace lsim
+
+#endif // LSIM_TESTBENCH_H
@@ -0,0 +1,126 @@
+// equivalence_main.cpp - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// Check that two (combinational) circuits compute the same outputs for the same inputs
+
+#include "lsim_context.h"
+#include "model_circuit.h"
+#include "serialize.h"
+#include "sim_equivalence.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+
+namespace {
+
+using namespace std::chrono;
+steady_clock::time_point chrono_ref;
+
+inline void chrono_reset() {
+    chrono_ref = steady_clock::now();
+}
+
+inline double chrono_report() {
+    duration<double> span = duration_cast<duration<double>>(steady_clock::now() - chrono_ref);
+    return span.count();
+}
+
+void usage(const char *program) {
+    std::printf("usage: %s [-x inputs] [-n vectors] [-s seed] [-t threads] <library_a> <circuit_a> <library_b> <circuit_b>\n", program);
+    std::printf("    library_a/b : .lsim files containing the circuits to compare (may be the same file)\n");
+    std::printf("    circuit_a/b : names of the circuits, they must have the same input and output ports\n");
+    std::printf("    -x          : check all input combinations up to this number of inputs (default: 24)\n");
+    std::printf("    -n          : number of random vectors for circuits with more inputs (default: 16777216)\n");
+    std::printf("    -s          : seed of the random vectors (default: 1)\n");
+    std::printf("    -t          : number of threads (default: one for each hardware thread)\n");
+}
+
+lsim::ModelCircuit *load_circuit(lsim::LSimContext *context, const char *library, const char *name) {
+    if (!lsim::deserialize_library(context, context->user_library(), library)) {
+        std::printf("!!! unable to load library (%s)\n", library);
+        return nullptr;
+    }
+
+    auto circuit = context->user_library()->circuit_by_name(name);
+    if (circuit == nullptr) {
+        std::printf("!!! circuit %s not found in %s\n", name, library);
+    }
+    return circuit;
+}
+
+const char *value_string(lsim::Value value) {
+    return value == lsim::VALUE_TRUE ? "1" : "0";
+}
+
+} // unnamed namespace
+
+int main(int argc, char *argv[]) {
+    lsim::EquivalenceOptions options;
+    const char *args[4] = {};
+    int num_args = 0;
+
+    for (int idx = 1; idx < argc; ++idx) {
+        if (std::strcmp(argv[idx], "-x") == 0 && idx + 1 < argc) {
+            options.m_max_exhaustive_inputs = static_cast<uint32_t>(std::atoi(argv[++idx]));
+        } else if (std::strcmp(argv[idx], "-n") == 0 && idx + 1 < argc) {
+            options.m_num_random_vectors = std::strtoull(argv[++idx], nullptr, 10);
+        } else if (std::strcmp(argv[idx], "-s") == 0 && idx + 1 < argc) {
+            options.m_seed = std::strtoull(argv[++idx], nullptr, 10);
+        } else if (std::strcmp(argv[idx], "-t") == 0 && idx + 1 < argc) {
+            options.m_num_threads = static_cast<size_t>(std::atoi(argv[++idx]));
+        } else if (num_args < 4) {
+            args[num_args++] = argv[idx];
+        } else {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (num_args != 4) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    // separate contexts: both libraries may contain circuits with the same name
+    lsim::LSimContext context_a;
+    lsim::LSimContext context_b;
+    auto circuit_a = load_circuit(&context_a, args[0], args[1]);
+    auto circuit_b = load_circuit(&context_b, args[2], args[3]);
+    if (circuit_a == nullptr || circuit_b == nullptr) {
+        return -1;
+    }
+
+    std::printf("--- comparing circuits\n");
+    chrono_reset();
+    auto result = lsim::check_equivalence(circuit_a, circuit_b, options);
+    auto duration = chrono_report();
+
+    if (!result.m_error.empty()) {
+        std::printf("!!! %s\n", result.m_error.c_str());
+        return -1;
+    }
+
+    std::printf("+++ done (%f seconds): %llu %s vectors (%.2f million vectors/s)\n",
+                duration,
+                static_cast<unsigned long long>(result.m_num_vectors),
+                result.m_exhaustive ? "exhaustive" : "random",
+                result.m_num_vectors / (duration * 1000000));
+
+    if (result.m_equivalent) {
+        std::printf("+++ the circuits are equivalent\n");
+        return 0;
+    }
+
+    std::printf("!!! the circuits diverge at vector %llu\n", static_cast<unsigned long long>(result.m_vector));
+    for (size_t idx = 0; idx < result.m_input_names.size(); ++idx) {
+        std::printf("    input  %-16s = %s\n", result.m_input_names[idx].c_str(), value_string(result.m_inputs[idx]));
+    }
+    for (size_t idx = 0; idx < result.m_output_names.size(); ++idx) {
+        std::printf("    output %-16s = %s / %s%s\n", result.m_output_names[idx].c_str(),
+                    value_string(result.m_outputs_a[idx]), value_string(result.m_outputs_b[idx]),
+                    result.m_outputs_a[idx] != result.m_outputs_b[idx] ? "  <--" : "");
+    }
+
+    return 1;
+}
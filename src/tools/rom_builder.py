@@ -238,8 +238,28 @@ class RomBuilder:
     def write(self, data_bin):
         data = self.__unpack_data(data_bin)
         limit = min(len(data), self.word_count)
+
+        # gather the pull-down buffers for each segment and create them in bulk
+        pull_downs = [[] for s in range(self.segment_count)]
         for i in range(limit):
-            self.set_location(i, data[i])
+            s, c, r = self.__split_address(i)
+            for b in range(self.word_size):
+                if (data[i] >> b) & 1 == 0:
+                    pull_downs[s].append((c, r, b))
+
+        for s in range(self.segment_count):
+            segment = self.segments[s]
+            circuit_desc = segment["circuit_desc"]
+            gnd = segment["GND"].output_pin_id(0)
+            rows = [segment["row_demux"].port_by_name("O[{}]".format(r)) for r in range(self.row_count)]
+
+            buffers = circuit_desc.add_components([(lsimpy.COMPONENT_TRISTATE_BUFFER, 1, lsimpy.ValueFalse)] * len(pull_downs[s]))
+            connections = []
+            for pd, (c, r, b) in zip(buffers, pull_downs[s]):
+                connections.append((gnd, pd.input_pin_id(0)))
+                connections.append((rows[r], pd.control_pin_id(0)))
+                connections.append((segment["col_buffers"][c].input_pin_id(b), pd.output_pin_id(0)))
+            circuit_desc.connect_pins(connections)
 
     def verify(self, data_bin):
         data = self.__unpack_data(data_bin)
@@ -0,0 +1,119 @@
+// rom_image_main.cpp - Johan Smet - BSD-3-Clause (see LICENSE)
+//
+// Create a ROM circuit (or a hex image) from a binary or hex image
+
+#include "lsim_context.h"
+#include "model_circuit.h"
+#include "rom_image.h"
+#include "serialize.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+
+namespace {
+
+using namespace std::chrono;
+steady_clock::time_point chrono_ref;
+
+inline void chrono_reset() {
+    chrono_ref = steady_clock::now();
+}
+
+inline double chrono_report() {
+    duration<double> span = duration_cast<duration<double>>(steady_clock::now() - chrono_ref);
+    return span.count();
+}
+
+void usage(const char *program) {
+    std::printf("usage: %s [-w 8|16|32] [-n name] <image_file> <output_file>\n", program);
+    std::printf("    image_file  : binary data or a .hex file with whitespace separated hexadecimal words\n");
+    std::printf("    output_file : .lsim to create a library with a ROM circuit, .hex to write a hex image\n");
+    std::printf("    -w          : number of bits in a word (default: 8)\n");
+    std::printf("    -n          : name of the ROM circuit (default: rom)\n");
+}
+
+bool write_hex_image(const char *filename, const lsim::rom_data_t &data, uint32_t data_bits) {
+    auto file = std::fopen(filename, "w");
+    if (file == nullptr) {
+        return false;
+    }
+
+    const int digits = static_cast<int>((data_bits + 3) / 4);
+    for (size_t idx = 0; idx < data.size(); ++idx) {
+        std::fprintf(file, "%0*x%c", digits, data[idx], ((idx + 1) % 16 == 0) ? '\n' : ' ');
+    }
+    std::fprintf(file, "\n");
+
+    return std::fclose(file) == 0;
+}
+
+} // unnamed namespace
+
+int main(int argc, char *argv[]) {
+    uint32_t data_bits = 8;
+    std::string name = "rom";
+    const char *image_file = nullptr;
+    const char *output_file = nullptr;
+
+    for (int idx = 1; idx < argc; ++idx) {
+        if (std::strcmp(argv[idx], "-w") == 0 && idx + 1 < argc) {
+            data_bits = static_cast<uint32_t>(std::atoi(argv[++idx]));
+        } else if (std::strcmp(argv[idx], "-n") == 0 && idx + 1 < argc) {
+            name = argv[++idx];
+        } else if (image_file == nullptr) {
+            image_file = argv[idx];
+        } else if (output_file == nullptr) {
+            output_file = argv[idx];
+        } else {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (image_file == nullptr || output_file == nullptr || (data_bits != 8 && data_bits != 16 && data_bits != 32)) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    std::printf("--- reading image\n");
+    chrono_reset();
+    lsim::rom_data_t data;
+    if (!lsim::rom_image_load(image_file, data_bits, &data) || data.empty()) {
+        std::printf("!!! unable to read image (%s)\n", image_file);
+        return -1;
+    }
+    std::printf("+++ done (%f seconds): %zu words\n", chrono_report(), data.size());
+
+    std::string output = output_file;
+    if (output.size() > 4 && output.compare(output.size() - 4, 4, ".hex") == 0) {
+        std::printf("--- writing hex image\n");
+        chrono_reset();
+        if (!write_hex_image(output_file, data, data_bits)) {
+            std::printf("!!! unable to write image (%s)\n", output_file);
+            return -1;
+        }
+        std::printf("+++ done (%f seconds)\n", chrono_report());
+        return 0;
+    }
+
+    std::printf("--- creating ROM circuit\n");
+    chrono_reset();
+    lsim::LSimContext lsim_context;
+    auto lib = lsim_context.user_library();
+    lsim::rom_create_circuit(&lsim_context, lib, name.c_str(), data_bits, data);
+    lib->change_main_circuit(name.c_str());
+    std::printf("+++ done (%f seconds)\n", chrono_report());
+
+    std::printf("--- writing library\n");
+    chrono_reset();
+    if (!lsim::serialize_library(&lsim_context, lib, output_file)) {
+        std::printf("!!! unable to write library (%s)\n", output_file);
+        return -1;
+    }
+    std::printf("+++ done (%f seconds)\n", chrono_report());
+
+    return 0;
+}
@@ -4,6 +4,7 @@
 
 #include "lsim_context.h"
 #include "serialize.h"
+#include "memory_report.h"
 #include <cstdio>
 #include <cassert>
 #include <chrono>
@@ -57,5 +58,11 @@ int main() {
     double duration = chrono_report();
     std::printf("+++ done (%f seconds): %.2f Hz (%.2f kHz)\n", duration, CYCLE_COUNT / duration, CYCLE_COUNT / (duration * 1000));
 
+    std::printf("--- memory usage\n");
+    lsim::MemoryReport report;
+    lsim_context.memory_usage(&report);
+    circuit->memory_usage(&report);
+    std::printf("%s", report.format().c_str());
+
     return 0;
 }
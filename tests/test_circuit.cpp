@@ -1,6 +1,18 @@
 #include "catch.hpp"
 #include "lsim_context.h"
+#include "memory_report.h"
 #include "sim_circuit.h"
+#include "sim_circuit_template.h"
+#include "sim_equivalence.h"
+#include "sim_history.h"
+#include "sim_partition.h"
+#include "sim_task.h"
+#include "sim_worker.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
 
 using namespace lsim;
 
@@ -283,4 +295,1251 @@ TEST_CASE("8bit adder (multi-level cloning)", "[circuit]") {
             }
         }
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Incremental update of a running simulation", "[circuit]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+
+    // SR-latch: its state should survive the changes to the rest of the circuit
+    auto in_s = circuit_desc->add_connector_in("S", 1);
+    auto in_r = circuit_desc->add_connector_in("R", 1);
+    auto out_q = circuit_desc->add_connector_out("Q", 1);
+    auto nor_1 = circuit_desc->add_nor_gate(2);
+    auto nor_2 = circuit_desc->add_nor_gate(2);
+    circuit_desc->connect(in_r->pin_id(0), nor_1->pin_id(0));
+    circuit_desc->connect(nor_2->pin_id(2), nor_1->pin_id(1));
+    circuit_desc->connect(in_s->pin_id(0), nor_2->pin_id(0));
+    circuit_desc->connect(nor_1->pin_id(2), nor_2->pin_id(1));
+    circuit_desc->connect(nor_1->pin_id(2), out_q->pin_id(0));
+
+    // simple path that will be edited
+    auto in_a = circuit_desc->add_connector_in("A", 1);
+    auto out_y = circuit_desc->add_connector_out("Y", 1);
+    auto not_gate = circuit_desc->add_not_gate();
+    circuit_desc->connect(in_a->pin_id(0), not_gate->pin_id(0));
+    auto wire_y = circuit_desc->connect(not_gate->pin_id(1), out_y->pin_id(0));
+
+    sim->enable_patching();
+    auto circuit = circuit_desc->instantiate(sim);
+    sim->init();
+
+    circuit->write_pin(in_r->pin_id(0), VALUE_TRUE);
+    circuit->write_pin(in_s->pin_id(0), VALUE_FALSE);
+    sim->run_until_stable(5);
+    circuit->write_pin(in_r->pin_id(0), VALUE_FALSE);
+    circuit->write_pin(in_s->pin_id(0), VALUE_TRUE);
+    sim->run_until_stable(5);
+    circuit->write_pin(in_s->pin_id(0), VALUE_FALSE);
+    circuit->write_pin(in_a->pin_id(0), VALUE_TRUE);
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_pin(out_q->pin_id(0)) == VALUE_TRUE);
+    REQUIRE(circuit->read_pin(out_y->pin_id(0)) == VALUE_FALSE);
+
+    // add a second inverter in the path
+    auto latch_node = sim->pin_node(circuit->pin_from_pin_id(out_q->pin_id(0)));
+    circuit_desc->remove_wire(wire_y->id());
+    auto not_2 = circuit_desc->add_not_gate();
+    circuit_desc->connect(not_gate->pin_id(1), not_2->pin_id(0));
+    circuit_desc->connect(not_2->pin_id(1), out_y->pin_id(0));
+    circuit->sync_with_model();
+    sim->run_until_stable(5);
+
+    // only the nodes touched by the change were rebuilt
+    REQUIRE(sim->pin_node(circuit->pin_from_pin_id(out_q->pin_id(0))) == latch_node);
+    REQUIRE(circuit->read_pin(out_q->pin_id(0)) == VALUE_TRUE);
+    REQUIRE(circuit->read_pin(out_y->pin_id(0)) == VALUE_TRUE);
+    circuit->write_pin(in_a->pin_id(0), VALUE_FALSE);
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_pin(out_y->pin_id(0)) == VALUE_FALSE);
+
+    // remove the inverters again and replace them with a constant
+    circuit_desc->remove_component(not_gate->id());
+    circuit_desc->remove_component(not_2->id());
+    auto constant = circuit_desc->add_constant(VALUE_TRUE);
+    circuit_desc->connect(constant->pin_id(0), out_y->pin_id(0));
+    circuit->sync_with_model();
+    sim->run_until_stable(5);
+
+    REQUIRE(circuit->read_pin(out_q->pin_id(0)) == VALUE_TRUE);
+    REQUIRE(circuit->read_pin(out_y->pin_id(0)) == VALUE_TRUE);
+
+    // the latch still works after the changes
+    circuit->write_pin(in_r->pin_id(0), VALUE_TRUE);
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_pin(out_q->pin_id(0)) == VALUE_FALSE);
+
+    // nested circuits can be added to a running simulation
+    create_1bit_adder(&lsim_context);
+    auto out_o = circuit_desc->add_connector_out("O", 1);
+    auto sub = circuit_desc->add_sub_circuit("adder_1bit");
+    circuit_desc->connect(in_a->pin_id(0), sub->port_by_name("A"));
+    circuit_desc->connect(in_r->pin_id(0), sub->port_by_name("B"));
+    circuit_desc->connect(in_s->pin_id(0), sub->port_by_name("Ci"));
+    circuit_desc->connect(sub->port_by_name("O"), out_o->pin_id(0));
+    circuit->sync_with_model();
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_pin(out_o->pin_id(0)) == VALUE_TRUE);
+
+    circuit->write_pin(in_a->pin_id(0), VALUE_TRUE);
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_pin(out_o->pin_id(0)) == VALUE_FALSE);
+}
+
+TEST_CASE("Nodes are renumbered after instantiation", "[circuit]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    // chain of inverters, connected in reverse order of creation
+    const int num_gates = 16;
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+    auto in = circuit_desc->add_connector_in("in", 1);
+    auto out = circuit_desc->add_connector_out("out", 1);
+
+    std::vector<ModelComponent *> gates;
+    for (int i = 0; i < num_gates; ++i) {
+        gates.push_back(circuit_desc->add_not_gate());
+    }
+
+    circuit_desc->connect(gates.back()->pin_id(1), out->pin_id(0));
+    for (int i = num_gates - 1; i > 0; --i) {
+        circuit_desc->connect(gates[i-1]->pin_id(1), gates[i]->pin_id(0));
+    }
+    circuit_desc->connect(in->pin_id(0), gates.front()->pin_id(0));
+
+    auto circuit = circuit_desc->instantiate(sim);
+    auto version = sim->layout_version();
+    sim->init();
+
+    // handles taken before the renumbering are stale
+    REQUIRE(sim->layout_version() != version);
+    version = sim->layout_version();
+    sim->init();
+    REQUIRE(sim->layout_version() == version);
+
+    // merged nodes are compacted: the chain uses exactly num_gates + 1 nodes
+    std::vector<node_t> nodes;
+    nodes.push_back(circuit->pin_node(in->pin_id(0)));
+    for (auto gate : gates) {
+        REQUIRE(circuit->pin_node(gate->pin_id(0)) == nodes.back());
+        nodes.push_back(circuit->pin_node(gate->pin_id(1)));
+    }
+    REQUIRE(circuit->pin_node(out->pin_id(0)) == nodes.back());
+
+    for (auto node : nodes) {
+        REQUIRE(node <= static_cast<node_t>(num_gates));
+    }
+
+    // and connected nodes are numbered close to each other
+    for (size_t idx = 1; idx < nodes.size(); ++idx) {
+        REQUIRE(nodes[idx] - nodes[idx-1] == 1);
+    }
+
+    circuit->write_pin(in->pin_id(0), VALUE_TRUE);
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_pin(out->pin_id(0)) == VALUE_TRUE);
+}
+
+TEST_CASE("Circuit templates are reused between instances", "[circuit]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    auto adder_4bit_desc = create_4bit_adder(&lsim_context);
+
+    // the nested 1bit adder is only compiled once, the templates are kept with the circuits
+    auto adder_1bit = lsim_context.user_library()->circuit_by_name("adder_1bit");
+    auto tmpl = adder_4bit_desc.circuit->sim_template();
+    auto tmpl_1bit = adder_1bit->sim_template();
+    REQUIRE(tmpl);
+    REQUIRE(tmpl_1bit);
+    REQUIRE(adder_4bit_desc.circuit->sim_template() == tmpl);
+    REQUIRE(adder_1bit->sim_template() == tmpl_1bit);
+    REQUIRE(tmpl->num_components() == 4 * (tmpl_1bit->num_components() + 1) + 5);
+
+    // instances created from the same template are independent
+    auto circuit_a = tmpl->instantiate(sim);
+    auto circuit_b = tmpl->instantiate(sim);
+    REQUIRE(circuit_a);
+    REQUIRE(circuit_b);
+    for (auto id : adder_4bit_desc.circuit->component_ids_of_type(COMPONENT_CONNECTOR_IN)) {
+        circuit_a->component_by_id(id)->enable_user_values();
+        circuit_b->component_by_id(id)->enable_user_values();
+    }
+
+    sim->init();
+
+    circuit_a->write_pin(adder_4bit_desc.pin_Ci->pin_id(0), VALUE_FALSE);
+    circuit_a->write_output_pins(adder_4bit_desc.pin_A->id(), 3);
+    circuit_a->write_output_pins(adder_4bit_desc.pin_B->id(), 5);
+    circuit_b->write_pin(adder_4bit_desc.pin_Ci->pin_id(0), VALUE_TRUE);
+    circuit_b->write_output_pins(adder_4bit_desc.pin_A->id(), 9);
+    circuit_b->write_output_pins(adder_4bit_desc.pin_B->id(), 9);
+    sim->run_until_stable(5);
+
+    REQUIRE(circuit_a->read_nibble(adder_4bit_desc.pin_O->id()) == 8);
+    REQUIRE(circuit_a->read_pin(adder_4bit_desc.pin_Co->pin_id(0)) == VALUE_FALSE);
+    REQUIRE(circuit_b->read_nibble(adder_4bit_desc.pin_O->id()) == 3);
+    REQUIRE(circuit_b->read_pin(adder_4bit_desc.pin_Co->pin_id(0)) == VALUE_TRUE);
+
+    // changing a nested circuit rebuilds the templates that include it
+    const auto num_components = tmpl->num_components();
+    adder_1bit->add_not_gate();
+    REQUIRE(adder_4bit_desc.circuit->sim_template()->num_components() == num_components + 4);
+}
+
+TEST_CASE("Warm reset restores the captured state", "[circuit]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+
+    // SR-latch next to a clocked AND-gate
+    auto in_s = circuit_desc->add_connector_in("S", 1);
+    auto in_r = circuit_desc->add_connector_in("R", 1);
+    auto out_q = circuit_desc->add_connector_out("Q", 1);
+    auto nor_1 = circuit_desc->add_nor_gate(2);
+    auto nor_2 = circuit_desc->add_nor_gate(2);
+    circuit_desc->connect(in_r->pin_id(0), nor_1->pin_id(0));
+    circuit_desc->connect(nor_2->pin_id(2), nor_1->pin_id(1));
+    circuit_desc->connect(in_s->pin_id(0), nor_2->pin_id(0));
+    circuit_desc->connect(nor_1->pin_id(2), nor_2->pin_id(1));
+    circuit_desc->connect(nor_1->pin_id(2), out_q->pin_id(0));
+
+    auto clock = circuit_desc->add_oscillator(2, 3);
+    auto and_gate = circuit_desc->add_and_gate(2);
+    auto out_y = circuit_desc->add_connector_out("Y", 1);
+    circuit_desc->connect(clock->pin_id(0), and_gate->pin_id(0));
+    circuit_desc->connect(nor_1->pin_id(2), and_gate->pin_id(1));
+    circuit_desc->connect(and_gate->pin_id(2), out_y->pin_id(0));
+
+    sim->enable_patching();
+    auto circuit = circuit_desc->instantiate(sim);
+
+    // reset without an image falls back to a full initialization
+    sim->reset();
+    circuit->write_pin(in_s->pin_id(0), VALUE_FALSE);
+    circuit->write_pin(in_r->pin_id(0), VALUE_TRUE);
+    sim->run_until_stable(2);
+    circuit->write_pin(in_r->pin_id(0), VALUE_FALSE);
+    sim->run_until_stable(2);
+    REQUIRE(circuit->read_pin(out_q->pin_id(0)) == VALUE_FALSE);
+
+    sim->capture_reset_state();
+    auto start_time = sim->current_time();
+
+    auto run_case = [&]() {
+        std::vector<Value> trace;
+        circuit->write_pin(in_s->pin_id(0), VALUE_TRUE);
+        for (int i = 0; i < 4; ++i) {
+            sim->step();
+            trace.push_back(circuit->read_pin(out_q->pin_id(0)));
+            trace.push_back(circuit->read_pin(out_y->pin_id(0)));
+        }
+        circuit->write_pin(in_s->pin_id(0), VALUE_FALSE);
+        for (int i = 0; i < 12; ++i) {
+            sim->step();
+            trace.push_back(circuit->read_pin(out_q->pin_id(0)));
+            trace.push_back(circuit->read_pin(out_y->pin_id(0)));
+        }
+        return trace;
+    };
+
+    auto first = run_case();
+    REQUIRE(circuit->read_pin(out_q->pin_id(0)) == VALUE_TRUE);
+    REQUIRE(std::count(first.begin(), first.end(), VALUE_TRUE) > 0);
+
+    sim->reset();
+    REQUIRE(sim->current_time() == start_time);
+    REQUIRE(circuit->read_pin(out_q->pin_id(0)) == VALUE_FALSE);
+    REQUIRE(circuit->read_pin(out_y->pin_id(0)) == VALUE_FALSE);
+    REQUIRE(circuit->user_value(in_s->pin_id(0)) == VALUE_FALSE);
+
+    // the same stimulus gives the same result after every reset
+    for (int i = 0; i < 3; ++i) {
+        REQUIRE(run_case() == first);
+        sim->reset();
+    }
+
+    // changing the circuit invalidates the image
+    circuit_desc->add_not_gate();
+    circuit->sync_with_model();
+    sim->reset();
+    REQUIRE(sim->current_time() == 1);
+}
+
+TEST_CASE("Warm reset image is captured after the first settle", "[circuit]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+    auto in_a = circuit_desc->add_connector_in("A", 1);
+    auto in_b = circuit_desc->add_connector_in("B", 1);
+    auto out_y = circuit_desc->add_connector_out("Y", 1);
+    auto and_gate = circuit_desc->add_and_gate(2);
+    circuit_desc->connect(in_a->pin_id(0), and_gate->pin_id(0));
+    circuit_desc->connect(in_b->pin_id(0), and_gate->pin_id(1));
+    circuit_desc->connect(and_gate->pin_id(2), out_y->pin_id(0));
+
+    auto circuit = circuit_desc->instantiate(sim);
+
+    // without stimulus the image is captured once the simulation settles after init
+    sim->init();
+    sim->run_until_stable(2);
+    circuit->write_pin(in_a->pin_id(0), VALUE_TRUE);
+    circuit->write_pin(in_b->pin_id(0), VALUE_TRUE);
+    sim->run_until_stable(2);
+    REQUIRE(circuit->read_pin(out_y->pin_id(0)) == VALUE_TRUE);
+    sim->reset();
+    REQUIRE(sim->current_time() > 1);
+    REQUIRE(circuit->read_pin(out_y->pin_id(0)) == VALUE_FALSE);
+    REQUIRE(circuit->user_value(in_a->pin_id(0)) == VALUE_FALSE);
+
+    // writing an input before the simulation settled prevents the automatic capture
+    sim->init();
+    circuit->write_pin(in_a->pin_id(0), VALUE_TRUE);
+    sim->run_until_stable(2);
+    sim->reset();
+    REQUIRE(sim->current_time() == 1);
+}
+
+TEST_CASE("Hierarchical paths", "[circuit]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    auto adder_4bit = create_4bit_adder(&lsim_context);
+
+    auto circuit_desc = lsim_context.create_user_circuit("top");
+    auto pin_A = circuit_desc->add_connector_in("A", 4);
+    auto pin_B = circuit_desc->add_connector_in("B", 4);
+    auto adder = circuit_desc->add_sub_circuit("adder_4bit");
+    for (int idx = 0; idx < 4; ++idx) {
+        auto suffix = "[" + std::to_string(idx) + "]";
+        circuit_desc->connect(pin_A->pin_id(idx), adder->port_by_name(("A" + suffix).c_str()));
+        circuit_desc->connect(pin_B->pin_id(idx), adder->port_by_name(("B" + suffix).c_str()));
+    }
+
+    auto circuit = circuit_desc->instantiate(sim);
+    sim->init();
+    circuit->write_output_pins(pin_A->id(), uint64_t(0x7));
+    circuit->write_output_pins(pin_B->id(), uint64_t(0x5));
+    sim->run_until_stable(5);
+
+    auto adder_path = "top/adder_4bit#" + std::to_string(adder->id());
+    auto adder_instance = circuit->circuit_by_path(adder_path.c_str());
+    REQUIRE(adder_instance != nullptr);
+    REQUIRE(adder_instance == circuit->component_by_id(adder->id())->nested_instance());
+    REQUIRE(adder_instance->path() == adder_path);
+    REQUIRE(circuit->path() == "top");
+
+    // 7 + 5 = 0b1100
+    REQUIRE(circuit->read_path((adder_path + ".O[0]").c_str()) == VALUE_FALSE);
+    REQUIRE(circuit->read_path((adder_path + ".O[2]").c_str()) == VALUE_TRUE);
+    REQUIRE(circuit->read_path((adder_path + ".Co").c_str()) == VALUE_FALSE);
+
+    // every bit adder can be reached and names itself
+    auto adder_ids = adder_4bit.circuit->component_ids_of_type(COMPONENT_SUB_CIRCUIT);
+    REQUIRE(adder_ids.size() == 4);
+    for (auto id : adder_ids) {
+        auto bit_path = adder_path + "/adder_1bit#" + std::to_string(id);
+        auto bit_instance = circuit->circuit_by_path(bit_path.c_str());
+        REQUIRE(bit_instance != nullptr);
+        REQUIRE(bit_instance->path() == bit_path);
+        REQUIRE(bit_instance->parent() == adder_instance);
+
+        auto pin = circuit->pin_by_path((bit_path + ".O").c_str());
+        REQUIRE(pin != PIN_UNDEFINED);
+        REQUIRE(circuit->node_by_path((bit_path + ".O").c_str()) != NODE_INVALID);
+    }
+
+    // invalid paths
+    REQUIRE(circuit->circuit_by_path("other") == nullptr);
+    REQUIRE(circuit->circuit_by_path("top/adder_1bit#1") == nullptr);
+    REQUIRE(circuit->circuit_by_path((adder_path + "/adder_1bit#999").c_str()) == nullptr);
+    REQUIRE(circuit->pin_by_path((adder_path + ".Nope").c_str()) == PIN_UNDEFINED);
+    REQUIRE(circuit->pin_by_path(adder_path.c_str()) == PIN_UNDEFINED);
+    REQUIRE(circuit->node_by_path((adder_path + ".Nope").c_str()) == NODE_INVALID);
+    REQUIRE(circuit->read_path((adder_path + ".Nope").c_str()) == VALUE_UNDEFINED);
+    REQUIRE(circuit->read_path("other.O") == VALUE_UNDEFINED);
+}
+
+TEST_CASE("Partitioned simulation matches a single simulator", "[circuit]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    create_4bit_adder(&lsim_context);
+
+    // 4-bit adder next to an SR-latch gating a clock
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+    auto pin_A = circuit_desc->add_connector_in("A", 4);
+    auto pin_B = circuit_desc->add_connector_in("B", 4);
+    auto pin_O = circuit_desc->add_connector_out("O", 4);
+    auto adder = circuit_desc->add_sub_circuit("adder_4bit");
+    for (int idx = 0; idx < 4; ++idx) {
+        auto suffix = "[" + std::to_string(idx) + "]";
+        circuit_desc->connect(pin_A->pin_id(idx), adder->port_by_name(("A" + suffix).c_str()));
+        circuit_desc->connect(pin_B->pin_id(idx), adder->port_by_name(("B" + suffix).c_str()));
+        circuit_desc->connect(adder->port_by_name(("O" + suffix).c_str()), pin_O->pin_id(idx));
+    }
+
+    auto in_s = circuit_desc->add_connector_in("S", 1);
+    auto in_r = circuit_desc->add_connector_in("R", 1);
+    auto nor_1 = circuit_desc->add_nor_gate(2);
+    auto nor_2 = circuit_desc->add_nor_gate(2);
+    circuit_desc->connect(in_r->pin_id(0), nor_1->pin_id(0));
+    circuit_desc->connect(nor_2->pin_id(2), nor_1->pin_id(1));
+    circuit_desc->connect(in_s->pin_id(0), nor_2->pin_id(0));
+    circuit_desc->connect(nor_1->pin_id(2), nor_2->pin_id(1));
+
+    auto clock = circuit_desc->add_oscillator(2, 3);
+    auto and_gate = circuit_desc->add_and_gate(2);
+    auto out_y = circuit_desc->add_connector_out("Y", 1);
+    circuit_desc->connect(clock->pin_id(0), and_gate->pin_id(0));
+    circuit_desc->connect(nor_1->pin_id(2), and_gate->pin_id(1));
+    circuit_desc->connect(and_gate->pin_id(2), out_y->pin_id(0));
+
+    auto circuit = circuit_desc->instantiate(sim);
+    sim->init();
+
+    PartitionedSimulation partitioned(circuit_desc, 3);
+    REQUIRE(partitioned.num_partitions() == 3);
+    REQUIRE(partitioned.sim(0)->num_nodes() == sim->num_nodes());
+
+    // only the first partition holds the complete circuit
+    for (size_t p = 1; p < partitioned.num_partitions(); ++p) {
+        auto part_sim = partitioned.sim(p);
+        REQUIRE(part_sim->num_nodes() == sim->num_nodes());
+        for (uint32_t id = 0; id < part_sim->num_components(); ++id) {
+            REQUIRE((part_sim->component_by_id(id) != nullptr) == (partitioned.component_partition(id) == p));
+        }
+    }
+    partitioned.init();
+
+    auto write = [&](pin_id_t pin_id, Value value) {
+        circuit->write_pin(pin_id, value);
+        partitioned.write_pin(pin_id, value);
+    };
+
+    auto compare_steps = [&](size_t num_steps) {
+        for (size_t s = 0; s < num_steps; ++s) {
+            sim->step();
+            partitioned.step();
+            for (size_t p = 0; p < partitioned.num_partitions(); ++p) {
+                REQUIRE(partitioned.sim(p)->current_time() == sim->current_time());
+                for (node_t node_id = 0; node_id < sim->num_nodes(); ++node_id) {
+                    INFO("step " << sim->current_time() << " partition " << p << " node " << node_id);
+                    REQUIRE(partitioned.sim(p)->read_node(node_id) == sim->read_node(node_id));
+                }
+            }
+        }
+    };
+
+    write(in_s->pin_id(0), VALUE_FALSE);
+    write(in_r->pin_id(0), VALUE_TRUE);
+    compare_steps(4);
+    write(in_r->pin_id(0), VALUE_FALSE);
+
+    for (int a = 0; a < 16; a += 3) {
+        for (int b = 0; b < 16; b += 5) {
+            for (int idx = 0; idx < 4; ++idx) {
+                write(pin_A->pin_id(idx), static_cast<Value>((a >> idx) & 1));
+                write(pin_B->pin_id(idx), static_cast<Value>((b >> idx) & 1));
+            }
+            write(in_s->pin_id(0), static_cast<Value>((a + b) & 1));
+            compare_steps(12);
+            REQUIRE(circuit->read_nibble(pin_O->id()) == ((a + b) & 0xf));
+            REQUIRE(partitioned.read_pin(pin_O->pin_id(0)) == circuit->read_pin(pin_O->pin_id(0)));
+        }
+    }
+
+    // a longer run in one go ends in the same state
+    write(in_s->pin_id(0), VALUE_TRUE);
+    for (int i = 0; i < 50; ++i) {
+        sim->step();
+    }
+    partitioned.run(50);
+    for (node_t node_id = 0; node_id < sim->num_nodes(); ++node_id) {
+        REQUIRE(partitioned.sim(1)->read_node(node_id) == sim->read_node(node_id));
+    }
+}
+
+TEST_CASE("Checkpoints restore the complete simulation state", "[circuit]") {
+
+    const char *checkpoint_file = "test_checkpoint.lsimchk";
+
+    struct TestCircuit {
+        ModelComponent *in_addr;
+        ModelComponent *in_d;
+        ModelComponent *clock;
+        std::unique_ptr<SimCircuit> circuit;
+    };
+
+    // RAM written on every high phase of an oscillator
+    auto build = [](LSimContext *lsim_context, bool extra_gate) {
+        auto circuit_desc = lsim_context->create_user_circuit("main");
+        auto in_addr = circuit_desc->add_connector_in("Addr", 2);
+        auto in_d = circuit_desc->add_connector_in("D", 4);
+        auto out_y = circuit_desc->add_connector_out("Y", 4);
+        auto enable = circuit_desc->add_constant(VALUE_TRUE);
+        auto clock = circuit_desc->add_oscillator(3, 2);
+        auto ram = circuit_desc->add_ram(2, 4);
+
+        for (uint32_t idx = 0; idx < 2; ++idx) {
+            circuit_desc->connect(in_addr->pin_id(idx), ram->input_pin_id(idx));
+        }
+        for (uint32_t idx = 0; idx < 4; ++idx) {
+            circuit_desc->connect(in_d->pin_id(idx), ram->input_pin_id(2 + idx));
+            circuit_desc->connect(ram->output_pin_id(idx), out_y->pin_id(idx));
+        }
+        circuit_desc->connect(enable->pin_id(0), ram->control_pin_id(0));
+        circuit_desc->connect(clock->pin_id(0), ram->control_pin_id(1));
+        circuit_desc->connect(enable->pin_id(0), ram->control_pin_id(2));
+
+        if (extra_gate) {
+            auto not_gate = circuit_desc->add_not_gate();
+            circuit_desc->connect(clock->pin_id(0), not_gate->pin_id(0));
+        }
+
+        auto circuit = circuit_desc->instantiate(lsim_context->sim());
+        lsim_context->sim()->init();
+        return TestCircuit{in_addr, in_d, clock, std::move(circuit)};
+    };
+
+    auto run = [](Simulator *sim, TestCircuit &test, uint64_t seed) {
+        std::vector<Value> trace;
+        for (int i = 0; i < 60; ++i) {
+            if (i % 7 == 0) {
+                test.circuit->write_output_pins(test.in_addr->id(), (seed + i) & 3);
+                test.circuit->write_output_pins(test.in_d->id(), (seed * 3 + i) & 15);
+            }
+            sim->step();
+            for (node_t node_id = 0; node_id < sim->num_nodes(); ++node_id) {
+                trace.push_back(sim->read_node(node_id));
+            }
+        }
+        return trace;
+    };
+
+    LSimContext context_a;
+    auto sim_a = context_a.sim();
+    auto test_a = build(&context_a, false);
+    run(sim_a, test_a, 1);
+    REQUIRE(sim_a->save_checkpoint(checkpoint_file));
+    auto saved_time = sim_a->current_time();
+    auto expected = run(sim_a, test_a, 5);
+
+    // restore into a fresh simulation of the same design
+    LSimContext context_b;
+    auto sim_b = context_b.sim();
+    auto test_b = build(&context_b, false);
+    REQUIRE(sim_b->layout_hash() == sim_a->layout_hash());
+    REQUIRE(sim_b->load_checkpoint(checkpoint_file));
+    REQUIRE(sim_b->current_time() == saved_time);
+    REQUIRE(run(sim_b, test_b, 5) == expected);
+
+    // a different design is refused
+    LSimContext context_c;
+    auto sim_c = context_c.sim();
+    auto test_c = build(&context_c, true);
+    REQUIRE(sim_c->layout_hash() != sim_a->layout_hash());
+    REQUIRE(!sim_c->load_checkpoint(checkpoint_file));
+    REQUIRE(sim_c->current_time() == 1);
+
+    // as is the same design with a differently configured component
+    test_b.clock->property("high_duration")->value(static_cast<int64_t>(5));
+    REQUIRE(sim_b->layout_hash() != sim_a->layout_hash());
+    REQUIRE(!sim_b->load_checkpoint(checkpoint_file));
+
+    // so is a damaged file
+    {
+        std::ifstream in(checkpoint_file, std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        std::ofstream out(checkpoint_file, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), data.size() / 2);
+    }
+    REQUIRE(!sim_a->load_checkpoint(checkpoint_file));
+    REQUIRE(!sim_a->load_checkpoint("does_not_exist.lsimchk"));
+
+    std::remove(checkpoint_file);
+}
+
+TEST_CASE("Reverse stepping replays the recorded inputs", "[circuit]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    // RAM written on every high phase of an oscillator
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+    auto in_addr = circuit_desc->add_connector_in("Addr", 2);
+    auto in_d = circuit_desc->add_connector_in("D", 4);
+    auto out_y = circuit_desc->add_connector_out("Y", 4);
+    auto enable = circuit_desc->add_constant(VALUE_TRUE);
+    auto clock = circuit_desc->add_oscillator(3, 2);
+    auto ram = circuit_desc->add_ram(2, 4);
+
+    for (uint32_t idx = 0; idx < 2; ++idx) {
+        circuit_desc->connect(in_addr->pin_id(idx), ram->input_pin_id(idx));
+    }
+    for (uint32_t idx = 0; idx < 4; ++idx) {
+        circuit_desc->connect(in_d->pin_id(idx), ram->input_pin_id(2 + idx));
+        circuit_desc->connect(ram->output_pin_id(idx), out_y->pin_id(idx));
+    }
+    circuit_desc->connect(enable->pin_id(0), ram->control_pin_id(0));
+    circuit_desc->connect(clock->pin_id(0), ram->control_pin_id(1));
+    circuit_desc->connect(enable->pin_id(0), ram->control_pin_id(2));
+
+    auto circuit = circuit_desc->instantiate(sim);
+    sim->init();
+
+    auto read_nodes = [=]() {
+        std::vector<Value> values;
+        for (node_t node_id = 0; node_id < sim->num_nodes(); ++node_id) {
+            values.push_back(sim->read_node(node_id));
+        }
+        return values;
+    };
+
+    // a small budget forces the history to thin out its snapshots
+    SimHistory history(sim, 8 * 1024);
+    const auto start = sim->current_time();
+    REQUIRE(history.first_time() == start);
+
+    std::vector<std::vector<Value>> trace;
+    trace.push_back(read_nodes());
+    for (int i = 1; i <= 1000; ++i) {
+        history.step();
+        if (i % 13 == 0) {
+            circuit->write_output_pins(in_addr->id(), i & 3);
+            circuit->write_output_pins(in_d->id(), (i * 7) & 15);
+        }
+        trace.push_back(read_nodes());
+    }
+
+    REQUIRE(history.last_time() == start + 1000);
+    REQUIRE(history.snapshot_interval() > SimHistory::INITIAL_INTERVAL);
+    REQUIRE(history.memory_used() < 32 * 1024);
+
+    // backward
+    REQUIRE(history.step_back(1));
+    REQUIRE(sim->current_time() == start + 999);
+    REQUIRE(read_nodes() == trace[999]);
+
+    for (auto t : {500, 37, 0, 999, 640, 641, 13, 1000}) {
+        REQUIRE(history.goto_time(start + t));
+        REQUIRE(sim->current_time() == start + t);
+        REQUIRE(read_nodes() == trace[t]);
+    }
+
+    REQUIRE(!history.step_back(1001));
+    REQUIRE(!history.goto_time(start - 1));
+
+    // stepping forward through the recorded timeline replays the inputs
+    REQUIRE(history.goto_time(start + 200));
+    for (int i = 201; i <= 300; ++i) {
+        history.step();
+        REQUIRE(read_nodes() == trace[i]);
+    }
+    REQUIRE(history.last_time() == start + 1000);
+
+    // a new input in the past forgets the recorded future
+    circuit->write_output_pins(in_d->id(), 0);
+    REQUIRE(history.last_time() == start + 300);
+    history.run(100);
+    auto branch = read_nodes();
+    REQUIRE(history.step_back(50));
+    history.run(50);
+    REQUIRE(read_nodes() == branch);
+
+    // hot-swapping the contents of the memory is an input as well
+    auto sim_ram = circuit->component_by_id(ram->id());
+    auto read_memory = [=]() {
+        return std::vector<uint8_t>(sim_ram->extra_data(), sim_ram->extra_data() + sim_ram->extra_data_size());
+    };
+
+    const auto swap_time = sim->current_time();
+    const auto memory_before = read_memory();
+    circuit->replace_memory_contents(ram->id(), {0x9, 0xa, 0xb, 0xc});
+    const auto memory_swapped = read_memory();
+    REQUIRE(memory_swapped != memory_before);
+    history.run(20);
+    auto swapped = read_nodes();
+    auto memory_after = read_memory();
+
+    REQUIRE(history.goto_time(swap_time - 5));
+    REQUIRE(read_memory() == memory_before);
+    REQUIRE(history.goto_time(swap_time));
+    REQUIRE(read_memory() == memory_swapped);
+    history.run(20);
+    REQUIRE(read_nodes() == swapped);
+    REQUIRE(read_memory() == memory_after);
+
+    // other listeners are notified alongside the history
+    size_t user_values = 0;
+    size_t schedules = 0;
+    auto listener = sim->add_input_listener([&](SimComponent *, uint32_t, Value) {++user_values;},
+                                            [&](SimComponent *) {++schedules;});
+    circuit->write_output_pins(in_d->id(), 5);
+    circuit->replace_memory_contents(ram->id(), {0x1});
+    REQUIRE(user_values == 4);
+    REQUIRE(schedules == 1);
+    sim->remove_input_listener(listener);
+
+    const auto memory_second = read_memory();
+    history.step();
+    REQUIRE(history.step_back(1));
+    REQUIRE(read_memory() == memory_second);
+    REQUIRE(user_values == 4);
+    REQUIRE(schedules == 1);
+
+    // the simulator was reset outside of the history
+    sim->init();
+    history.step();
+    REQUIRE(history.first_time() == sim->current_time() - 1);
+}
+
+TEST_CASE("Stepping through the history stays cheap", "[circuit]") {
+
+    // a chain of AND gates driven by an oscillator: every step only touches a few gates, taking a snapshot touches
+    //  every node and component
+    auto build = [](LSimContext *lsim_context) {
+        const size_t num_gates = 200000;
+        auto circuit_desc = lsim_context->create_user_circuit("main");
+        auto clock = circuit_desc->add_oscillator(5, 5);
+        auto enable = circuit_desc->add_constant(VALUE_TRUE);
+        auto gates = circuit_desc->add_components(model_component_spec_container_t(num_gates, {COMPONENT_AND_GATE, 2, VALUE_FALSE}));
+
+        pin_id_pair_container_t connections;
+        connections.reserve(num_gates * 2);
+        connections.push_back({clock->pin_id(0), gates[0]->input_pin_id(0)});
+        for (size_t idx = 0; idx < num_gates; ++idx) {
+            if (idx > 0) {
+                connections.push_back({gates[idx - 1]->output_pin_id(0), gates[idx]->input_pin_id(0)});
+            }
+            connections.push_back({enable->pin_id(0), gates[idx]->input_pin_id(1)});
+        }
+        circuit_desc->connect_pins(connections);
+
+        auto circuit = circuit_desc->instantiate(lsim_context->sim());
+        lsim_context->sim()->init();
+        return circuit;
+    };
+
+    using clock_t = std::chrono::steady_clock;
+    const size_t num_steps = 2000;
+
+    LSimContext context_direct;
+    auto circuit_direct = build(&context_direct);
+    auto start = clock_t::now();
+    for (size_t i = 0; i < num_steps; ++i) {
+        context_direct.sim()->step();
+    }
+    std::chrono::duration<double> direct_time = clock_t::now() - start;
+
+    LSimContext context_history;
+    auto circuit_history = build(&context_history);
+    SimHistory history(context_history.sim());
+    start = clock_t::now();
+    history.run(num_steps);
+    std::chrono::duration<double> history_time = clock_t::now() - start;
+
+    for (node_t node_id = 0; node_id < context_direct.sim()->num_nodes(); node_id += 101) {
+        REQUIRE(context_history.sim()->read_node(node_id) == context_direct.sim()->read_node(node_id));
+    }
+
+    // snapshots are only taken every so many steps and skip the design hash: recording the history may cost a few
+    //  times direct stepping, not a full checkpoint per step
+    REQUIRE(history_time.count() < 8 * direct_time.count() + 0.5);
+}
+
+TEST_CASE("Equivalence checking", "[circuit]") {
+
+    LSimContext lsim_context;
+
+    auto add_ports = [](ModelCircuit *circuit, ModelComponent **in_a, ModelComponent **in_b, ModelComponent **in_sel,
+                        ModelComponent **out_y) {
+        *in_a = circuit->add_connector_in("A", 1);
+        *in_b = circuit->add_connector_in("B", 1);
+        *in_sel = circuit->add_connector_in("Sel", 1);
+        *out_y = circuit->add_connector_out("Y", 1);
+    };
+
+    ModelComponent *in_a, *in_b, *in_sel, *out_y;
+
+    // 2-to-1 multiplexer with and/or gates
+    auto mux_and_or = lsim_context.create_user_circuit("mux_and_or");
+    add_ports(mux_and_or, &in_a, &in_b, &in_sel, &out_y);
+    auto not_sel = mux_and_or->add_not_gate();
+    auto and_a = mux_and_or->add_and_gate(2);
+    auto and_b = mux_and_or->add_and_gate(2);
+    auto or_y = mux_and_or->add_or_gate(2);
+    mux_and_or->connect(in_sel->pin_id(0), not_sel->pin_id(0));
+    mux_and_or->connect(in_a->pin_id(0), and_a->pin_id(0));
+    mux_and_or->connect(not_sel->pin_id(1), and_a->pin_id(1));
+    mux_and_or->connect(in_b->pin_id(0), and_b->pin_id(0));
+    mux_and_or->connect(in_sel->pin_id(0), and_b->pin_id(1));
+    mux_and_or->connect(and_a->pin_id(2), or_y->pin_id(0));
+    mux_and_or->connect(and_b->pin_id(2), or_y->pin_id(1));
+    mux_and_or->connect(or_y->pin_id(2), out_y->pin_id(0));
+
+    // the same multiplexer with nand gates only, ports declared in a different order
+    auto mux_nand = lsim_context.create_user_circuit("mux_nand");
+    out_y = mux_nand->add_connector_out("Y", 1);
+    in_sel = mux_nand->add_connector_in("Sel", 1);
+    in_b = mux_nand->add_connector_in("B", 1);
+    in_a = mux_nand->add_connector_in("A", 1);
+    auto nand_sel = mux_nand->add_nand_gate(2);
+    auto nand_a = mux_nand->add_nand_gate(2);
+    auto nand_b = mux_nand->add_nand_gate(2);
+    auto nand_y = mux_nand->add_nand_gate(2);
+    mux_nand->connect(in_sel->pin_id(0), nand_sel->pin_id(0));
+    mux_nand->connect(in_sel->pin_id(0), nand_sel->pin_id(1));
+    mux_nand->connect(in_a->pin_id(0), nand_a->pin_id(0));
+    mux_nand->connect(nand_sel->pin_id(2), nand_a->pin_id(1));
+    mux_nand->connect(in_b->pin_id(0), nand_b->pin_id(0));
+    mux_nand->connect(in_sel->pin_id(0), nand_b->pin_id(1));
+    mux_nand->connect(nand_a->pin_id(2), nand_y->pin_id(0));
+    mux_nand->connect(nand_b->pin_id(2), nand_y->pin_id(1));
+    mux_nand->connect(nand_y->pin_id(2), out_y->pin_id(0));
+
+    // a wrong one: selects A when Sel is high and both inputs are high
+    auto mux_bad = lsim_context.create_user_circuit("mux_bad");
+    add_ports(mux_bad, &in_a, &in_b, &in_sel, &out_y);
+    auto xor_y = mux_bad->add_xor_gate();
+    auto sub_mux = mux_bad->add_sub_circuit("mux_and_or");
+    mux_bad->connect(in_a->pin_id(0), sub_mux->pin_id(0));
+    mux_bad->connect(in_b->pin_id(0), sub_mux->pin_id(1));
+    mux_bad->connect(in_sel->pin_id(0), sub_mux->pin_id(2));
+    mux_bad->connect(sub_mux->pin_id(3), xor_y->pin_id(0));
+    auto and_ab = mux_bad->add_and_gate(3);
+    mux_bad->connect(in_a->pin_id(0), and_ab->pin_id(0));
+    mux_bad->connect(in_b->pin_id(0), and_ab->pin_id(1));
+    mux_bad->connect(in_sel->pin_id(0), and_ab->pin_id(2));
+    mux_bad->connect(and_ab->pin_id(3), xor_y->pin_id(1));
+    mux_bad->connect(xor_y->pin_id(2), out_y->pin_id(0));
+
+    auto result = check_equivalence(mux_and_or, mux_nand);
+    REQUIRE(result.m_error.empty());
+    REQUIRE(result.m_equivalent);
+    REQUIRE(result.m_exhaustive);
+    REQUIRE(result.m_num_vectors == 8);
+
+    result = check_equivalence(mux_and_or, mux_bad);
+    REQUIRE(result.m_error.empty());
+    REQUIRE(!result.m_equivalent);
+    REQUIRE(result.m_vector == 7);
+    REQUIRE(result.m_inputs == value_container_t({VALUE_TRUE, VALUE_TRUE, VALUE_TRUE}));
+    REQUIRE(result.m_outputs_a[0] == VALUE_TRUE);
+    REQUIRE(result.m_outputs_b[0] == VALUE_FALSE);
+
+    // wide circuits: a parity tree against a chain, exhaustively split over threads and with random vectors
+    const int width = 20;
+    auto parity_tree = lsim_context.create_user_circuit("parity_tree");
+    auto parity_chain = lsim_context.create_user_circuit("parity_chain");
+    auto tree_in = parity_tree->add_connector_in("D", width);
+    auto chain_in = parity_chain->add_connector_in("D", width);
+    auto tree_out = parity_tree->add_connector_out("P", 1);
+    auto chain_out = parity_chain->add_connector_out("P", 1);
+
+    std::vector<pin_id_t> level;
+    for (int idx = 0; idx < width; ++idx) {
+        level.push_back(tree_in->pin_id(idx));
+    }
+    while (level.size() > 1) {
+        std::vector<pin_id_t> next;
+        for (size_t idx = 0; idx + 1 < level.size(); idx += 2) {
+            auto gate = parity_tree->add_xor_gate();
+            parity_tree->connect(level[idx], gate->pin_id(0));
+            parity_tree->connect(level[idx + 1], gate->pin_id(1));
+            next.push_back(gate->pin_id(2));
+        }
+        if (level.size() % 2) {
+            next.push_back(level.back());
+        }
+        level = next;
+    }
+    parity_tree->connect(level[0], tree_out->pin_id(0));
+
+    auto chain = chain_in->pin_id(0);
+    ModelComponent *gate = nullptr;
+    for (int idx = 1; idx < width; ++idx) {
+        gate = parity_chain->add_xnor_gate();
+        auto inverter = parity_chain->add_not_gate();
+        parity_chain->connect(chain, gate->pin_id(0));
+        parity_chain->connect(chain_in->pin_id(idx), gate->pin_id(1));
+        parity_chain->connect(gate->pin_id(2), inverter->pin_id(0));
+        chain = inverter->pin_id(1);
+    }
+    parity_chain->connect(chain, chain_out->pin_id(0));
+
+    EquivalenceOptions options;
+    options.m_num_threads = 4;
+    result = check_equivalence(parity_tree, parity_chain, options);
+    REQUIRE(result.m_equivalent);
+    REQUIRE(result.m_exhaustive);
+    REQUIRE(result.m_num_vectors == 1u << width);
+
+    options.m_max_exhaustive_inputs = 8;
+    options.m_num_random_vectors = 100000;
+    result = check_equivalence(parity_tree, parity_chain, options);
+    REQUIRE(result.m_equivalent);
+    REQUIRE(!result.m_exhaustive);
+    REQUIRE(result.m_num_vectors == 100000);
+
+    // break the chain: the first divergence is reported, whatever thread found it
+    auto stuck = parity_chain->add_constant(VALUE_FALSE);
+    parity_chain->disconnect_pin(gate->pin_id(1));
+    parity_chain->connect(stuck->pin_id(0), gate->pin_id(1));
+    options.m_max_exhaustive_inputs = 24;
+    result = check_equivalence(parity_tree, parity_chain, options);
+    REQUIRE(!result.m_equivalent);
+    REQUIRE(result.m_vector == 1u << (width - 1));
+
+    // unsupported circuits
+    REQUIRE(!check_equivalence(mux_and_or, parity_tree).m_error.empty());
+    auto clocked = lsim_context.create_user_circuit("clocked");
+    add_ports(clocked, &in_a, &in_b, &in_sel, &out_y);
+    auto osc = clocked->add_oscillator(1, 1);
+    clocked->connect(osc->pin_id(0), out_y->pin_id(0));
+    REQUIRE(!check_equivalence(mux_and_or, clocked).m_error.empty());
+}
+
+TEST_CASE("Bulk construction", "[circuit]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+    auto in_a = circuit_desc->add_connector_in("A", 8);
+
+    // 16k inverters, each bit of A drives 2k of them
+    const size_t num_gates = 16384;
+    auto gates = circuit_desc->add_components(model_component_spec_container_t(num_gates, {COMPONENT_NOT_GATE, 1, VALUE_FALSE}));
+    REQUIRE(gates.size() == num_gates);
+    REQUIRE(circuit_desc->num_components() == num_gates + 1);
+
+    auto extra = circuit_desc->add_components({
+        {COMPONENT_PULL_RESISTOR, 1, VALUE_TRUE},
+        {COMPONENT_CONNECTOR_IN, 1, VALUE_FALSE},
+        {COMPONENT_AND_GATE, 3, VALUE_FALSE}
+    });
+    REQUIRE(extra[0]->type() == COMPONENT_PULL_RESISTOR);
+    REQUIRE(extra[0]->property_value("pull_to", VALUE_FALSE) == VALUE_TRUE);
+    REQUIRE(extra[1] == nullptr);
+    REQUIRE(extra[2]->num_inputs() == 3);
+
+    // connections that share a pin end up on the same wire
+    pin_id_pair_container_t connections;
+    for (size_t idx = 0; idx < num_gates; ++idx) {
+        connections.push_back({in_a->pin_id(idx % 8), gates[idx]->input_pin_id(0)});
+    }
+    connections.push_back({extra[0]->pin_id(0), extra[2]->input_pin_id(0)});
+    connections.push_back({extra[2]->input_pin_id(1), extra[2]->input_pin_id(0)});
+    REQUIRE(circuit_desc->connect_pins(connections) == 9);
+    REQUIRE(circuit_desc->wires().size() == 9);
+
+    auto circuit = circuit_desc->instantiate(sim);
+    sim->init();
+
+    pin_id_container_t pins_a;
+    for (int idx = 0; idx < 8; ++idx) {
+        pins_a.push_back(in_a->pin_id(idx));
+    }
+
+    for (uint64_t a : {0x00u, 0xa5u, 0xffu}) {
+        circuit->write_pins(pins_a, a);
+        sim->run_until_stable(5);
+        for (size_t idx = 0; idx < num_gates; idx += 97) {
+            REQUIRE(circuit->read_pin(gates[idx]->output_pin_id(0)) == (((a >> (idx % 8)) & 1) ? VALUE_FALSE : VALUE_TRUE));
+        }
+    }
+
+    REQUIRE(circuit->read_pin(extra[2]->input_pin_id(1)) == VALUE_TRUE);
+}
+
+TEST_CASE("Memory footprint of a million gates", "[circuit]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+
+    // every gate reads the outputs of the two gates before it
+    const size_t num_gates = 1000000;
+    auto gates = circuit_desc->add_components(model_component_spec_container_t(num_gates, {COMPONENT_AND_GATE, 2, VALUE_FALSE}));
+
+    pin_id_pair_container_t connections;
+    connections.reserve(num_gates * 2);
+    for (size_t idx = 2; idx < num_gates; ++idx) {
+        connections.push_back({gates[idx - 1]->output_pin_id(0), gates[idx]->input_pin_id(0)});
+        connections.push_back({gates[idx - 2]->output_pin_id(0), gates[idx]->input_pin_id(1)});
+    }
+    circuit_desc->connect_pins(connections);
+
+    auto circuit = circuit_desc->instantiate(sim);
+    sim->init();
+    for (int i = 0; i < 10; ++i) {
+        sim->step();
+    }
+
+    MemoryReport report;
+    sim->memory_usage(&report);
+    circuit->memory_usage(&report);
+    REQUIRE(report.bytes("simulator/nodes") > 0);
+    REQUIRE(report.bytes("simulator/components/params") == 0);
+    REQUIRE(report.bytes("simulator/node") == 0);
+    REQUIRE(report.total() == report.bytes("simulator") + report.bytes("circuits"));
+    REQUIRE(report.total() / num_gates < SIM_MEMORY_BUDGET_PER_GATE);
+
+    // the context adds the circuit descriptions
+    MemoryReport full_report;
+    lsim_context.memory_usage(&full_report);
+    REQUIRE(full_report.bytes("simulator") == report.bytes("simulator"));
+    REQUIRE(full_report.bytes("model/components") >= num_gates * sizeof(ModelComponent));
+    REQUIRE(full_report.bytes("model/wires") > 0);
+}
+
+// the worker needs threads: not available in the single-threaded wasm build
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+
+ModelCircuit *create_xor_chain(LSimContext *lsim_context, size_t num_gates, ModelComponent **in_a, pin_id_t *out = nullptr) {
+    // every gate combines the output of the previous gate with a bit of A, the first gate is driven by an oscillator
+    auto circuit_desc = lsim_context->create_user_circuit("main");
+    *in_a = circuit_desc->add_connector_in("A", 8);
+    auto clock = circuit_desc->add_oscillator(3, 3);
+
+    auto prev_out = clock->pin_id(0);
+    for (size_t idx = 0; idx < num_gates; ++idx) {
+        auto gate = circuit_desc->add_xor_gate();
+        circuit_desc->connect(prev_out, gate->input_pin_id(0));
+        circuit_desc->connect((*in_a)->pin_id(idx % 8), gate->input_pin_id(1));
+        prev_out = gate->output_pin_id(0);
+    }
+
+    if (out != nullptr) {
+        *out = prev_out;
+    }
+    return circuit_desc;
+}
+
+TEST_CASE("Simulation worker matches direct stepping", "[circuit][worker]") {
+
+    LSimContext context_direct;
+    LSimContext context_worker;
+    auto sim = context_direct.sim();
+
+    ModelComponent *in_a = nullptr;
+    auto circuit = create_xor_chain(&context_direct, 256, &in_a)->instantiate(sim);
+    auto circuit_worker = create_xor_chain(&context_worker, 256, &in_a)->instantiate(context_worker.sim());
+    sim->init();
+    context_worker.sim()->init();
+
+    pin_id_container_t pins_a;
+    for (int idx = 0; idx < 8; ++idx) {
+        pins_a.push_back(in_a->pin_id(idx));
+    }
+
+    SimWorker worker(context_worker.sim());
+    REQUIRE(worker.snapshot().time() == sim->current_time());
+    REQUIRE(worker.snapshot().num_nodes() == sim->num_nodes());
+
+    auto compare_snapshot = [&]() {
+        auto &snapshot = worker.snapshot();
+        REQUIRE(snapshot.time() == sim->current_time());
+        for (node_t node_id = 0; node_id < sim->num_nodes(); ++node_id) {
+            REQUIRE(snapshot.read_node(node_id) == sim->read_node(node_id));
+            REQUIRE(snapshot.node_dirty(node_id) == sim->node_dirty(node_id));
+        }
+        for (pin_t pin = 0; pin < sim->num_pins(); ++pin) {
+            REQUIRE(snapshot.read_pin(pin) == sim->read_pin(pin));
+            REQUIRE(snapshot.pin_output_value(pin) == sim->pin_output_value(pin));
+        }
+    };
+
+    for (uint64_t a : {0x00u, 0x5au, 0xffu, 0x13u}) {
+        circuit->write_pins(pins_a, a);
+        for (int i = 0; i < 37; ++i) {
+            sim->step();
+        }
+
+        worker.post([&, a](Simulator *) {circuit_worker->write_pins(pins_a, a);});
+        worker.run(37);
+        worker.wait_idle();
+        REQUIRE(worker.update_snapshot());
+        REQUIRE(!worker.update_snapshot());
+        compare_snapshot();
+    }
+
+    // steps requested while paused wait for the pause to end, the backlog is capped
+    auto steps_done = worker.steps_done();
+    worker.set_max_pending(10);
+    worker.pause([&](Simulator *paused_sim) {
+        REQUIRE(paused_sim->current_time() == sim->current_time());
+        worker.run(100);
+        REQUIRE(worker.pending_steps() == 10);
+        REQUIRE(worker.steps_done() == steps_done);
+    });
+    worker.wait_idle();
+    REQUIRE(worker.steps_done() == steps_done + 10);
+
+    for (int i = 0; i < 10; ++i) {
+        sim->step();
+    }
+    worker.update_snapshot();
+    compare_snapshot();
+}
+
+TEST_CASE("Simulation worker runs long batches", "[circuit][worker]") {
+
+    LSimContext context_direct;
+    LSimContext context_worker;
+    auto sim = context_direct.sim();
+
+    ModelComponent *in_a = nullptr;
+    const size_t num_gates = 4096;
+    auto circuit = create_xor_chain(&context_direct, num_gates, &in_a)->instantiate(sim);
+    auto circuit_worker = create_xor_chain(&context_worker, num_gates, &in_a)->instantiate(context_worker.sim());
+    sim->init();
+    context_worker.sim()->init();
+    circuit->write_pin(in_a->pin_id(0), VALUE_TRUE);
+    circuit_worker->write_pin(in_a->pin_id(0), VALUE_TRUE);
+
+    using clock_t = std::chrono::steady_clock;
+    const size_t num_steps = 2000;
+
+    auto start = clock_t::now();
+    for (size_t i = 0; i < num_steps; ++i) {
+        sim->step();
+    }
+    std::chrono::duration<double> direct_time = clock_t::now() - start;
+
+    SimWorker worker(context_worker.sim());
+    start = clock_t::now();
+    worker.run(num_steps);
+    worker.wait_idle();
+    std::chrono::duration<double> worker_time = clock_t::now() - start;
+
+    REQUIRE(worker.steps_done() == num_steps);
+    worker.update_snapshot();
+    REQUIRE(worker.snapshot().time() == sim->current_time());
+    for (node_t node_id = 0; node_id < sim->num_nodes(); ++node_id) {
+        REQUIRE(worker.snapshot().read_node(node_id) == sim->read_node(node_id));
+    }
+
+    // loose on purpose, only a gross slowdown fails: the worker has to reach a quarter of the direct steps/s, with a
+    //  quarter second of slack for scheduling the worker thread on a loaded machine
+    INFO("direct: " << num_steps / direct_time.count() << " steps/s, worker: " << num_steps / worker_time.count() << " steps/s");
+    REQUIRE(worker_time.count() < 4 * direct_time.count() + 0.25);
+}
+
+TEST_CASE("Simulation tasks run in the background", "[circuit][worker]") {
+
+    LSimContext context_direct;
+    LSimContext context_task;
+    auto sim = context_direct.sim();
+    auto sim_task = context_task.sim();
+
+    // the output of the chain follows the oscillator with a delay
+    ModelComponent *in_a = nullptr;
+    pin_id_t last_out = PIN_ID_INVALID;
+    auto circuit = create_xor_chain(&context_direct, 64, &in_a, &last_out)->instantiate(sim);
+    auto circuit_task = create_xor_chain(&context_task, 64, &in_a)->instantiate(sim_task);
+    sim->init();
+    sim_task->init();
+
+    SECTION("fixed number of cycles") {
+        SimulationTask task(sim_task, {1000});
+        REQUIRE(task.wait());
+        REQUIRE(task.done());
+        REQUIRE(task.reason() == SimulationTask::STOP_CYCLES);
+        REQUIRE(task.cycles() == 1000);
+
+        for (int i = 0; i < 1000; ++i) {
+            sim->step();
+        }
+        auto snapshot = task.snapshot();
+        REQUIRE(snapshot->time() == sim->current_time());
+        for (node_t node_id = 0; node_id < sim->num_nodes(); ++node_id) {
+            REQUIRE(snapshot->read_node(node_id) == sim->read_node(node_id));
+        }
+    }
+
+    SECTION("until a pin has a value") {
+        while (circuit->read_pin(last_out) != VALUE_TRUE) {
+            sim->step();
+        }
+
+        SimulationTask::Options options;
+        options.m_until_pin = circuit_task->pin_from_pin_id(last_out);
+        options.m_until_value = VALUE_TRUE;
+        SimulationTask task(sim_task, options);
+        REQUIRE(task.wait(10.0));
+        REQUIRE(task.reason() == SimulationTask::STOP_PIN);
+        REQUIRE(task.snapshot()->time() == sim->current_time());
+        REQUIRE(task.snapshot()->read_pin(options.m_until_pin) == VALUE_TRUE);
+    }
+
+    SECTION("cancel a task") {
+        SimulationTask::Options options;
+        options.m_until_pin = circuit_task->pin_from_pin_id(in_a->pin_id(0));      // never changes
+        auto start_time = sim_task->current_time();
+        SimulationTask task(sim_task, options);
+
+        auto first = task.snapshot();
+        REQUIRE(!task.wait(0.05));
+        REQUIRE(!task.done());
+        REQUIRE(task.reason() == SimulationTask::STOP_NONE);
+
+        SimulationTask::StopReason callback_reason = SimulationTask::STOP_NONE;
+        task.on_done([&](SimulationTask::StopReason reason) {callback_reason = reason;});
+        task.cancel();
+        REQUIRE(task.wait());
+        REQUIRE(task.reason() == SimulationTask::STOP_CANCELLED);
+        REQUIRE(callback_reason == SimulationTask::STOP_CANCELLED);
+
+        // older snapshots are unchanged
+        REQUIRE(first->time() == start_time);
+        REQUIRE(task.snapshot()->time() == start_time + task.cycles());
+        REQUIRE(sim_task->current_time() == start_time + task.cycles());
+    }
+}
+
+TEST_CASE("Simulation task until stable", "[circuit][worker]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+    auto in_a = circuit_desc->add_connector_in("A", 1);
+    auto prev_out = in_a->pin_id(0);
+    for (int idx = 0; idx < 15; ++idx) {
+        auto gate = circuit_desc->add_not_gate();
+        circuit_desc->connect(prev_out, gate->input_pin_id(0));
+        prev_out = gate->output_pin_id(0);
+    }
+
+    auto circuit = circuit_desc->instantiate(sim);
+    sim->init();
+
+    for (auto value : {VALUE_TRUE, VALUE_FALSE}) {
+        circuit->write_pin(in_a->pin_id(0), value);
+
+        SimulationTask::Options options;
+        options.m_until_stable = 5;
+        options.m_cycles = 1000;
+        SimulationTask task(sim, options);
+        REQUIRE(task.wait());
+        REQUIRE(task.reason() == SimulationTask::STOP_STABLE);
+        REQUIRE(task.cycles() < 100);
+        REQUIRE(circuit->read_pin(prev_out) == (value == VALUE_TRUE ? VALUE_FALSE : VALUE_TRUE));
+    }
+}
+
+#endif
@@ -0,0 +1,49 @@
+#include "catch.hpp"
+#include "lsim_context.h"
+#include "model_wire.h"
+#include "gui/component_widget.h"
+
+using namespace lsim;
+using namespace lsim::gui;
+
+TEST_CASE("Wires connect to endpoints outside of the view", "[editor]") {
+
+    LSimContext lsim_context;
+
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+    auto gate_a = circuit_desc->add_and_gate(2);
+    gate_a->set_position({100, 100});
+    auto gate_b = circuit_desc->add_and_gate(2);
+    gate_b->set_position({5000, 4000});
+
+    // the endpoints as the editor materializes them: inputs on the left, output on the right
+    std::vector<std::unique_ptr<ComponentWidget>> widgets;
+    for (auto gate : {gate_a, gate_b}) {
+        auto widget = std::make_unique<ComponentWidget>(gate);
+        widget->add_endpoint(gate->input_pin_id(0), {-20, -10});
+        widget->add_endpoint(gate->input_pin_id(1), {-20, 10});
+        widget->add_endpoint(gate->output_pin_id(0), {20, 0});
+        widgets.push_back(std::move(widget));
+    }
+
+    // gate_b is far away from gate_a: only one of them would be visible in the editor
+    EndpointLut lut;
+    for (const auto &widget : widgets) {
+        lut.add_widget(*widget);
+    }
+
+    auto wire = circuit_desc->create_wire();
+    wire->add_segment({120, 100}, {120, 3990});
+    wire->add_segment({120, 3990}, {4980, 3990});
+    lut.connect_wire(wire);
+
+    REQUIRE(wire->num_pins() == 2);
+    REQUIRE(wire->pin(0) == gate_a->output_pin_id(0));
+    REQUIRE(wire->pin(1) == gate_b->input_pin_id(0));
+
+    // editing the wire far from gate_a reconnects both ends
+    wire->clear_pins();
+    wire->split_at_new_junction({2000, 3990});
+    lut.connect_wire(wire);
+    REQUIRE(wire->num_pins() == 2);
+}
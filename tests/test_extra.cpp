@@ -1,6 +1,9 @@
 #include "catch.hpp"
 #include "lsim_context.h"
 #include "sim_circuit.h"
+#include "sim_component.h"
+#include "rom_image.h"
+#include "sim_functions.h"
 
 using namespace lsim;
 
@@ -189,4 +192,410 @@ TEST_CASE("Oscillator Long", "[extra]") {
             sim->step();
         }
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Oscillator wakeups survive a reset", "[extra]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+    auto clock = circuit_desc->add_oscillator(3, 2);
+    auto out = circuit_desc->add_connector_out("out", 1);
+    circuit_desc->connect(clock->output_pin_id(0), out->pin_id(0));
+
+    auto circuit = circuit_desc->instantiate(sim);
+    sim->init();
+    sim->capture_reset_state();
+
+    std::vector<Value> expected;
+    for (int i = 0; i < 12; ++i) {
+        expected.push_back(circuit->read_pin(out->pin_id(0)));
+        sim->step();
+    }
+
+    // reset in the middle of a period: the pending wakeup is replaced by the one of the reset image
+    sim->reset();
+    for (int i = 0; i < 12; ++i) {
+        REQUIRE(circuit->read_pin(out->pin_id(0)) == expected[i]);
+        sim->step();
+    }
+}
+
+TEST_CASE("7-segment LED brightness", "[extra]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+    auto clock = circuit_desc->add_oscillator(3, 1);
+    auto high = circuit_desc->add_constant(VALUE_TRUE);
+    auto led = circuit_desc->add_7_segment_led();
+    circuit_desc->connect(clock->output_pin_id(0), led->input_pin_id(0));
+    circuit_desc->connect(high->pin_id(0), led->input_pin_id(1));
+    circuit_desc->connect(high->pin_id(0), led->control_pin_id(0));
+
+    auto circuit = circuit_desc->instantiate(sim);
+    sim->init();
+    auto sim_led = circuit->component_by_id(led->id());
+
+    // skip the startup, a new window starts with each sample
+    float fractions[8];
+    for (int i = 0; i < 4; ++i) {
+        sim->step();
+    }
+    REQUIRE(sim_7_segment_led_sample(sim_led, fractions));
+    REQUIRE(!sim_7_segment_led_sample(sim_led, fractions));
+
+    for (int i = 0; i < 400; ++i) {
+        sim->step();
+    }
+    REQUIRE(sim_7_segment_led_sample(sim_led, fractions));
+    REQUIRE(fractions[0] == Approx(0.25f).margin(0.01f));
+    REQUIRE(fractions[1] == Approx(1.0f));
+    REQUIRE(fractions[2] == 0.0f);
+}
+
+TEST_CASE("Rom", "[extra]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    rom_data_t data;
+    REQUIRE(rom_image_from_hex("# test image\n01 ff 3*5a\n  0c", &data));
+    REQUIRE(data == rom_data_t({0x01, 0xff, 0x5a, 0x5a, 0x5a, 0x0c}));
+
+    // malformed images are refused instead of misread
+    rom_data_t bad;
+    REQUIRE(rom_image_from_hex("ffffffff 10*1", &bad));
+    REQUIRE(bad.size() == 11);
+    REQUIRE(!rom_image_from_hex("1a*ff", &bad));           // the count is decimal
+    REQUIRE(!rom_image_from_hex("0x4*7", &bad));
+    REQUIRE(!rom_image_from_hex("123456789ab", &bad));     // doesn't fit in 32 bits
+    REQUIRE(!rom_image_from_hex("4000000000*0", &bad));    // larger than any memory component
+    REQUIRE(!rom_image_from_hex("5000000000*0", &bad));
+    REQUIRE(!rom_image_from_hex("3*", &bad));
+
+    const uint8_t raw[] = {0x34, 0x12, 0x78, 0x56, 0xff};
+    REQUIRE(rom_image_from_binary(raw, sizeof(raw), 16) == rom_data_t({0x1234, 0x5678}));
+
+    auto circuit_desc = rom_create_circuit(&lsim_context, lsim_context.user_library(), "rom", 8, data);
+    REQUIRE(circuit_desc);
+    REQUIRE(circuit_desc->num_input_ports() == 2 + 3);
+    REQUIRE(circuit_desc->num_output_ports() == 8);
+
+    auto rom = circuit_desc->component_by_id(circuit_desc->component_ids_of_type(COMPONENT_ROM).front());
+    auto contents = rom_contents(rom);
+    REQUIRE(contents.size() == 8);
+    for (size_t idx = 0; idx < contents.size(); ++idx) {
+        REQUIRE(contents[idx] == (idx < data.size() ? data[idx] : 0));
+    }
+
+    auto circuit = circuit_desc->instantiate(sim);
+    sim->init();
+
+    auto pins_addr = pin_id_container_t();
+    for (int idx = 0; idx < 3; ++idx) {
+        pins_addr.push_back(circuit_desc->port_by_name(("Addr[" + std::to_string(idx) + "]").c_str()));
+    }
+    auto pins_y = pin_id_container_t();
+    for (int idx = 0; idx < 8; ++idx) {
+        pins_y.push_back(circuit_desc->port_by_name(("Y[" + std::to_string(idx) + "]").c_str()));
+    }
+
+    circuit->write_pin(circuit_desc->port_by_name("CE"), VALUE_TRUE);
+    circuit->write_pin(circuit_desc->port_by_name("OE"), VALUE_TRUE);
+    for (uint64_t addr = 0; addr < 8; ++addr) {
+        circuit->write_pins(pins_addr, addr);
+        sim->run_until_stable(5);
+        REQUIRE(circuit->read_byte(pins_y) == contents[addr]);
+    }
+
+    // outputs are floating when the ROM isn't enabled
+    circuit->write_pin(circuit_desc->port_by_name("OE"), VALUE_FALSE);
+    sim->run_until_stable(5);
+    for (auto pin : pins_y) {
+        REQUIRE(circuit->read_pin(pin) == VALUE_UNDEFINED);
+    }
+}
+
+TEST_CASE("Replace rom contents while simulating", "[extra]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    auto rom_desc = rom_create_circuit(&lsim_context, lsim_context.user_library(), "rom", 8, {0x10, 0x11, 0x12, 0x13});
+    auto rom_id = rom_desc->component_ids_of_type(COMPONENT_ROM).front();
+
+    // main circuit: the rom as a sub-circuit next to a latch that should keep its state
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+    auto in_addr = circuit_desc->add_connector_in("Addr", 2);
+    auto in_en = circuit_desc->add_connector_in("En", 1);
+    auto out_y = circuit_desc->add_connector_out("Y", 8);
+    auto in_set = circuit_desc->add_connector_in("Set", 1);
+    auto out_q = circuit_desc->add_connector_out("Q", 1);
+    auto rom = circuit_desc->add_sub_circuit("rom");
+    auto latch = circuit_desc->add_or_gate(2);
+
+    circuit_desc->connect(in_en->pin_id(0), rom->port_by_name("CE"));
+    circuit_desc->connect(in_en->pin_id(0), rom->port_by_name("OE"));
+    for (int idx = 0; idx < 2; ++idx) {
+        circuit_desc->connect(in_addr->pin_id(idx), rom->port_by_name(("Addr[" + std::to_string(idx) + "]").c_str()));
+    }
+    for (int idx = 0; idx < 8; ++idx) {
+        circuit_desc->connect(rom->port_by_name(("Y[" + std::to_string(idx) + "]").c_str()), out_y->pin_id(idx));
+    }
+    circuit_desc->connect(in_set->pin_id(0), latch->input_pin_id(0));
+    circuit_desc->connect(latch->output_pin_id(0), latch->input_pin_id(1));
+    circuit_desc->connect(latch->output_pin_id(0), out_q->pin_id(0));
+
+    auto circuit = circuit_desc->instantiate(sim);
+    sim->init();
+
+    pin_id_container_t pins_addr = {in_addr->pin_id(0), in_addr->pin_id(1)};
+    pin_id_container_t pins_y;
+    for (int idx = 0; idx < 8; ++idx) {
+        pins_y.push_back(out_y->pin_id(idx));
+    }
+
+    circuit->write_output_pins(in_en->id(), VALUE_TRUE);
+    circuit->write_output_pins(in_set->id(), VALUE_TRUE);
+    circuit->write_pins(pins_addr, 2);
+    sim->run_until_stable(5);
+    circuit->write_output_pins(in_set->id(), VALUE_FALSE);
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_byte(pins_y) == 0x12);
+    REQUIRE(circuit->read_pin(out_q->pin_id(0)) == VALUE_TRUE);
+
+    // swap the contents: the current address is re-read without touching any of the inputs
+    auto rom_instance = circuit->component_by_id(rom->id())->nested_instance();
+    rom_instance->replace_memory_contents(rom_id, {0x20, 0x21, 0x22});
+    auto time = sim->current_time();
+    sim->step();
+    sim->step();
+    REQUIRE(sim->current_time() == time + 2);
+    REQUIRE(circuit->read_byte(pins_y) == 0x22);
+    REQUIRE(circuit->read_pin(out_q->pin_id(0)) == VALUE_TRUE);
+
+    // words that were not supplied are cleared
+    circuit->write_pins(pins_addr, 3);
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_byte(pins_y) == 0x00);
+    circuit->write_pins(pins_addr, 0);
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_byte(pins_y) == 0x20);
+}
+
+TEST_CASE("Ram", "[extra]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+    auto in_addr = circuit_desc->add_connector_in("Addr", 2);
+    auto in_d = circuit_desc->add_connector_in("D", 4);
+    auto in_ce = circuit_desc->add_connector_in("CE", 1);
+    auto in_we = circuit_desc->add_connector_in("WE", 1);
+    auto in_oe = circuit_desc->add_connector_in("OE", 1);
+    auto out_y = circuit_desc->add_connector_out("Y", 4);
+    auto ram = circuit_desc->add_ram(2, 4);
+    rom_set_contents(ram, {0x1, 0x2, 0x3, 0x4});
+
+    for (uint32_t idx = 0; idx < 2; ++idx) {
+        circuit_desc->connect(in_addr->pin_id(idx), ram->input_pin_id(idx));
+    }
+    for (uint32_t idx = 0; idx < 4; ++idx) {
+        circuit_desc->connect(in_d->pin_id(idx), ram->input_pin_id(2 + idx));
+        circuit_desc->connect(ram->output_pin_id(idx), out_y->pin_id(idx));
+    }
+    circuit_desc->connect(in_ce->pin_id(0), ram->control_pin_id(0));
+    circuit_desc->connect(in_we->pin_id(0), ram->control_pin_id(1));
+    circuit_desc->connect(in_oe->pin_id(0), ram->control_pin_id(2));
+
+    auto circuit = circuit_desc->instantiate(sim);
+    sim->init();
+
+    circuit->write_output_pins(in_ce->id(), VALUE_TRUE);
+    circuit->write_output_pins(in_we->id(), VALUE_FALSE);
+    circuit->write_output_pins(in_oe->id(), VALUE_TRUE);
+
+    // initial contents
+    for (uint64_t addr = 0; addr < 4; ++addr) {
+        circuit->write_output_pins(in_addr->id(), addr);
+        sim->run_until_stable(5);
+        REQUIRE(circuit->read_nibble(out_y->id()) == addr + 1);
+    }
+
+    // write
+    circuit->write_output_pins(in_addr->id(), uint64_t(2));
+    circuit->write_output_pins(in_d->id(), uint64_t(0xa));
+    circuit->write_output_pins(in_we->id(), VALUE_TRUE);
+    sim->run_until_stable(5);
+    circuit->write_output_pins(in_we->id(), VALUE_FALSE);
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_nibble(out_y->id()) == 0xa);
+
+    // hot-swap
+    circuit->replace_memory_contents(ram->id(), {0xf, 0xe, 0xd, 0xc});
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_nibble(out_y->id()) == 0xd);
+
+    // a warm reset doesn't bring back the replaced contents
+    sim->capture_reset_state();
+    circuit->write_output_pins(in_we->id(), VALUE_TRUE);
+    sim->run_until_stable(5);
+    circuit->write_output_pins(in_we->id(), VALUE_FALSE);
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_nibble(out_y->id()) == 0xa);
+    circuit->replace_memory_contents(ram->id(), {0x5, 0x6, 0x7, 0x8});
+    sim->reset();
+    circuit->write_output_pins(in_addr->id(), uint64_t(1));
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_nibble(out_y->id()) == 0x6);
+    circuit->write_output_pins(in_addr->id(), uint64_t(2));
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_nibble(out_y->id()) == 0x7);
+
+    // the model keeps the initial contents
+    REQUIRE(rom_contents(ram) == rom_data_t({0x1, 0x2, 0x3, 0x4}));
+
+    // they were decoded when the component was created: init only copies them
+    REQUIRE(circuit->component_by_id(ram->id())->params().m_memory_contents == rom_data_t({0x1, 0x2, 0x3, 0x4}));
+    sim->init();
+    circuit->write_output_pins(in_ce->id(), VALUE_TRUE);
+    circuit->write_output_pins(in_oe->id(), VALUE_TRUE);
+    circuit->write_output_pins(in_addr->id(), uint64_t(1));
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_nibble(out_y->id()) == 0x2);
+}
+
+TEST_CASE("Component parameters", "[extra]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+    auto constant = circuit_desc->add_constant(VALUE_TRUE);
+    auto out = circuit_desc->add_connector_out("out", 1);
+    circuit_desc->connect(constant->pin_id(0), out->pin_id(0));
+
+    auto circuit = circuit_desc->instantiate(sim);
+    auto sim_constant = circuit->component_by_id(constant->id());
+    REQUIRE(sim_constant->params().m_value == VALUE_TRUE);
+
+    sim->init();
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_pin(out->pin_id(0)) == VALUE_TRUE);
+
+    // properties are compiled once: changing the description has no effect until the parameters are recompiled
+    constant->property("value")->value(VALUE_FALSE);
+    sim->init();
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_pin(out->pin_id(0)) == VALUE_TRUE);
+
+    sim_constant->compile_parameters();
+    sim->init();
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_pin(out->pin_id(0)) == VALUE_FALSE);
+}
+
+TEST_CASE("Register and counter", "[extra]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+    auto in_clk = circuit_desc->add_connector_in("Clk", 1);
+    auto in_clr = circuit_desc->add_connector_in("Clr", 1);
+    auto in_en = circuit_desc->add_connector_in("En", 1);
+    auto in_ld = circuit_desc->add_connector_in("Ld", 1);
+    auto in_ct = circuit_desc->add_connector_in("Ct", 1);
+    auto in_d = circuit_desc->add_connector_in("D", 4);
+    auto out_r = circuit_desc->add_connector_out("R", 4);
+    auto out_c = circuit_desc->add_connector_out("C", 4);
+    auto out_carry = circuit_desc->add_connector_out("Carry", 1);
+
+    auto reg = circuit_desc->add_register(4);
+    auto counter = circuit_desc->add_counter(4, 9);
+    counter->property("trigger")->value("falling");
+
+    for (int idx = 0; idx < 4; ++idx) {
+        circuit_desc->connect(in_d->pin_id(idx), reg->input_pin_id(idx));
+        circuit_desc->connect(in_d->pin_id(idx), counter->input_pin_id(idx));
+        circuit_desc->connect(reg->output_pin_id(idx), out_r->pin_id(idx));
+        circuit_desc->connect(counter->output_pin_id(idx), out_c->pin_id(idx));
+    }
+    circuit_desc->connect(counter->output_pin_id(4), out_carry->pin_id(0));
+    circuit_desc->connect(in_clk->pin_id(0), reg->control_pin_id(0));
+    circuit_desc->connect(in_en->pin_id(0), reg->control_pin_id(1));
+    circuit_desc->connect(in_clr->pin_id(0), reg->control_pin_id(2));
+    circuit_desc->connect(in_clk->pin_id(0), counter->control_pin_id(0));
+    circuit_desc->connect(in_ld->pin_id(0), counter->control_pin_id(1));
+    circuit_desc->connect(in_ct->pin_id(0), counter->control_pin_id(2));
+    circuit_desc->connect(in_clr->pin_id(0), counter->control_pin_id(3));
+
+    auto circuit = circuit_desc->instantiate(sim);
+    sim->init();
+
+    auto pins = [](ModelComponent *connector) {
+        pin_id_container_t result;
+        for (auto idx = 0u; idx < connector->num_inputs() + connector->num_outputs(); ++idx) {
+            result.push_back(connector->pin_id(idx));
+        }
+        return result;
+    };
+    auto pins_d = pins(in_d);
+    auto pins_r = pins(out_r);
+    auto pins_c = pins(out_c);
+
+    auto clock = [&](Value value) {
+        circuit->write_pin(in_clk->pin_id(0), value);
+        sim->run_until_stable(5);
+    };
+
+    circuit->write_pin(in_clr->pin_id(0), VALUE_FALSE);
+    circuit->write_pin(in_en->pin_id(0), VALUE_TRUE);
+    circuit->write_pin(in_ld->pin_id(0), VALUE_FALSE);
+    circuit->write_pin(in_ct->pin_id(0), VALUE_TRUE);
+    circuit->write_pins(pins_d, 5);
+    clock(VALUE_FALSE);
+    REQUIRE(circuit->read_nibble(pins_r) == 0);
+    REQUIRE(circuit->read_nibble(pins_c) == 0);
+
+    // register stores on the rising edge, the counter counts on the falling edge
+    clock(VALUE_TRUE);
+    REQUIRE(circuit->read_nibble(pins_r) == 5);
+    REQUIRE(circuit->read_nibble(pins_c) == 0);
+
+    circuit->write_pin(in_en->pin_id(0), VALUE_FALSE);
+    circuit->write_pins(pins_d, 7);
+    clock(VALUE_FALSE);
+    REQUIRE(circuit->read_nibble(pins_c) == 1);
+    clock(VALUE_TRUE);
+    REQUIRE(circuit->read_nibble(pins_r) == 5);
+
+    // the counter wraps at its maximum value, carry is high while it's at the goal
+    for (int step = 2; step <= 12; ++step) {
+        clock(VALUE_FALSE);
+        REQUIRE(circuit->read_nibble(pins_c) == step % 10);
+        REQUIRE(circuit->read_pin(out_carry->pin_id(0)) == (step % 10 == 9 ? VALUE_TRUE : VALUE_FALSE));
+        clock(VALUE_TRUE);
+    }
+
+    // load and count down
+    circuit->write_pin(in_ld->pin_id(0), VALUE_TRUE);
+    circuit->write_pin(in_ct->pin_id(0), VALUE_FALSE);
+    clock(VALUE_FALSE);
+    REQUIRE(circuit->read_nibble(pins_c) == 7);
+    clock(VALUE_TRUE);
+
+    circuit->write_pin(in_ct->pin_id(0), VALUE_TRUE);
+    clock(VALUE_FALSE);
+    REQUIRE(circuit->read_nibble(pins_c) == 6);
+
+    // clear is asynchronous
+    circuit->write_pin(in_clr->pin_id(0), VALUE_TRUE);
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_nibble(pins_r) == 0);
+    REQUIRE(circuit->read_nibble(pins_c) == 0);
+}
@@ -488,4 +488,89 @@ TEST_CASE("XnorGate", "[gate]") {
         sim->run_until_stable(5);
         REQUIRE(circuit->read_pin(out->pin_id(0)) == test[2]);
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Two-state mode", "[gate]") {
+
+    // a tri-state buffer feeding a few gates: run with and without two-state mode and compare all nodes
+    struct TestCircuit {
+        ModelComponent *in;
+        ModelComponent *en;
+        ModelComponent *out;
+        std::unique_ptr<SimCircuit> circuit;
+    };
+
+    auto build = [](LSimContext *lsim_context) {
+        auto circuit_desc = lsim_context->create_user_circuit("main");
+        auto in = circuit_desc->add_connector_in("in", 3);
+        auto en = circuit_desc->add_connector_in("en", 1);
+        auto out = circuit_desc->add_connector_out("out", 3);
+        auto buffer = circuit_desc->add_tristate_buffer(1);
+        auto and_gate = circuit_desc->add_and_gate(3);
+        auto nor_gate = circuit_desc->add_nor_gate(2);
+        auto xnor_gate = circuit_desc->add_xnor_gate();
+        auto not_gate = circuit_desc->add_not_gate();
+
+        circuit_desc->connect(en->pin_id(0), buffer->control_pin_id(0));
+        circuit_desc->connect(in->pin_id(0), buffer->input_pin_id(0));
+        circuit_desc->connect(buffer->output_pin_id(0), and_gate->input_pin_id(0));
+        circuit_desc->connect(in->pin_id(1), and_gate->input_pin_id(1));
+        circuit_desc->connect(in->pin_id(2), and_gate->input_pin_id(2));
+        circuit_desc->connect(and_gate->output_pin_id(0), nor_gate->input_pin_id(0));
+        circuit_desc->connect(in->pin_id(1), nor_gate->input_pin_id(1));
+        circuit_desc->connect(nor_gate->output_pin_id(0), xnor_gate->input_pin_id(0));
+        circuit_desc->connect(in->pin_id(2), xnor_gate->input_pin_id(1));
+        circuit_desc->connect(xnor_gate->output_pin_id(0), not_gate->input_pin_id(0));
+        circuit_desc->connect(and_gate->output_pin_id(0), out->pin_id(0));
+        circuit_desc->connect(xnor_gate->output_pin_id(0), out->pin_id(1));
+        circuit_desc->connect(not_gate->output_pin_id(0), out->pin_id(2));
+        return TestCircuit{in, en, out, circuit_desc->instantiate(lsim_context->sim())};
+    };
+
+    LSimContext context_fast;
+    LSimContext context_full;
+    auto fast = build(&context_fast);
+    auto full = build(&context_full);
+    auto sim_fast = context_fast.sim();
+    auto sim_full = context_full.sim();
+    sim_full->enable_two_state(false);
+
+    sim_fast->init();
+    sim_full->init();
+
+    auto apply = [&](int in_value, Value en_value) {
+        for (auto test : {&fast, &full}) {
+            for (int idx = 0; idx < 3; ++idx) {
+                test->circuit->write_pin(test->in->pin_id(idx), static_cast<Value>((in_value >> idx) & 1));
+            }
+            test->circuit->write_pin(test->en->pin_id(0), en_value);
+        }
+
+        for (int step = 0; step < 8; ++step) {
+            sim_fast->step();
+            sim_full->step();
+
+            bool all_boolean = true;
+            for (node_t node_id = 0; node_id < sim_fast->num_nodes(); ++node_id) {
+                REQUIRE(sim_fast->read_node(node_id) == sim_full->read_node(node_id));
+                all_boolean &= sim_fast->read_node(node_id) <= VALUE_TRUE;
+            }
+            REQUIRE(sim_fast->two_state() == all_boolean);
+            REQUIRE(!sim_full->two_state());
+        }
+    };
+
+    for (int value = 0; value < 8; ++value) {
+        apply(value, VALUE_TRUE);
+        REQUIRE(sim_fast->two_state());
+    }
+
+    // releasing the tri-state buffer switches back to four-state evaluation
+    apply(7, VALUE_FALSE);
+    REQUIRE(!sim_fast->two_state());
+    REQUIRE(fast.circuit->read_pin(fast.out->pin_id(0)) == VALUE_ERROR);
+
+    apply(6, VALUE_TRUE);
+    REQUIRE(sim_fast->two_state());
+    REQUIRE(fast.circuit->read_pin(fast.out->pin_id(0)) == VALUE_FALSE);
+}
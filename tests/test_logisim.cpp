@@ -909,6 +909,103 @@ This file is intended to be loaded by Logisim-evolution (https://github.com/reds
 </project>
 )FILE";
 
+const char *logisim_memory_data = R"FILE(
+<?xml version="1.0" encoding="UTF-8" standalone="no"?>
+<project source="2.15.0" version="1.0">
+This file is intended to be loaded by Logisim-evolution (https://github.com/reds-heig/logisim-evolution).
+<lib desc="#Wiring" name="0"/>
+  <lib desc="#Gates" name="1"/>
+  <lib desc="#Memory" name="4"/>
+  <main name="main"/>
+  <options>
+    <a name="gateUndefined" val="ignore"/>
+    <a name="simlimit" val="1000"/>
+    <a name="simrand" val="0"/>
+    <a name="tickmain" val="half_period"/>
+  </options>
+  <circuit name="main">
+    <a name="circuit" val="main"/>
+    <a name="clabel" val=""/>
+    <a name="clabelup" val="east"/>
+    <a name="clabelfont" val="SansSerif bold 16"/>
+    <a name="circuitnamedbox" val="true"/>
+    <a name="circuitnamedboxfixedsize" val="true"/>
+    <a name="circuitvhdlpath" val=""/>
+    <wire from="(200,150)" to="(280,150)"/>
+    <wire from="(280,150)" to="(580,150)"/>
+    <wire from="(280,120)" to="(280,150)"/>
+    <wire from="(580,150)" to="(580,220)"/>
+    <wire from="(300,100)" to="(360,100)"/>
+    <wire from="(500,100)" to="(560,100)"/>
+    <wire from="(560,100)" to="(560,200)"/>
+    <wire from="(560,200)" to="(570,200)"/>
+    <wire from="(600,200)" to="(650,200)"/>
+    <comp lib="0" loc="(200,150)" name="Pin">
+      <a name="label" val="Clk"/>
+    </comp>
+    <comp lib="4" loc="(300,100)" name="Counter">
+      <a name="width" val="4"/>
+      <a name="max" val="0x9"/>
+    </comp>
+    <comp lib="0" loc="(300,110)" name="Pin">
+      <a name="facing" val="west"/>
+      <a name="output" val="true"/>
+      <a name="label" val="C"/>
+    </comp>
+    <comp lib="4" loc="(500,100)" name="ROM">
+      <a name="addrWidth" val="4"/>
+      <a name="dataWidth" val="8"/>
+      <a name="contents">addr/data: 4 8
+1 2 4 8 10 20 40 80
+3*ff
+</a>
+    </comp>
+    <comp lib="0" loc="(560,100)" name="Pin">
+      <a name="facing" val="west"/>
+      <a name="output" val="true"/>
+      <a name="width" val="8"/>
+      <a name="label" val="Y"/>
+    </comp>
+    <comp lib="4" loc="(600,200)" name="Register">
+      <a name="trigger" val="falling"/>
+    </comp>
+    <comp lib="0" loc="(650,200)" name="Pin">
+      <a name="facing" val="west"/>
+      <a name="output" val="true"/>
+      <a name="width" val="8"/>
+      <a name="label" val="R"/>
+    </comp>
+    <comp lib="4" loc="(500,400)" name="RAM">
+      <a name="addrWidth" val="4"/>
+      <a name="dataWidth" val="8"/>
+      <a name="bus" val="separate"/>
+    </comp>
+    <comp lib="0" loc="(360,400)" name="Pin">
+      <a name="width" val="4"/>
+      <a name="label" val="A"/>
+    </comp>
+    <comp lib="0" loc="(360,420)" name="Pin">
+      <a name="width" val="8"/>
+      <a name="label" val="D"/>
+    </comp>
+    <comp lib="0" loc="(390,440)" name="Pin">
+      <a name="facing" val="north"/>
+      <a name="label" val="Str"/>
+    </comp>
+    <comp lib="0" loc="(430,440)" name="Pin">
+      <a name="facing" val="north"/>
+      <a name="label" val="WClk"/>
+    </comp>
+    <comp lib="0" loc="(500,400)" name="Pin">
+      <a name="facing" val="west"/>
+      <a name="output" val="true"/>
+      <a name="width" val="8"/>
+      <a name="label" val="Q"/>
+    </comp>
+  </circuit>
+</project>
+)FILE";
+
 using namespace lsim;
 
 TEST_CASE ("Small Logisim Circuit", "[logisim]") {
@@ -1100,6 +1197,77 @@ TEST_CASE ("Logisim nested circuit", "[logisim]") {
     }
 }
 
+TEST_CASE ("Logisim memory components", "[logisim]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    REQUIRE(load_logisim(&lsim_context, logisim_memory_data, std::strlen(logisim_memory_data)));
+    auto circuit_desc = lsim_context.user_library()->main_circuit();
+    REQUIRE(circuit_desc->component_ids_of_type(COMPONENT_ROM).size() == 1);
+    REQUIRE(circuit_desc->component_ids_of_type(COMPONENT_RAM).size() == 1);
+    REQUIRE(circuit_desc->component_ids_of_type(COMPONENT_REGISTER).size() == 1);
+    REQUIRE(circuit_desc->component_ids_of_type(COMPONENT_COUNTER).size() == 1);
+
+    auto port_pins = [&](const char *name, int width) {
+        pin_id_container_t result;
+        for (int idx = 0; idx < width; ++idx) {
+            result.push_back(circuit_desc->port_by_name((std::string(name) + "[" + std::to_string(idx) + "]").c_str()));
+        }
+        return result;
+    };
+    auto pins_Y = port_pins("Y", 8);
+    auto pins_R = port_pins("R", 8);
+    auto pins_A = port_pins("A", 4);
+    auto pins_D = port_pins("D", 8);
+    auto pins_Q = port_pins("Q", 8);
+    const uint32_t rom[] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0xff, 0xff};
+
+    auto circuit = circuit_desc->instantiate(sim);
+    REQUIRE(circuit);
+    sim->init();
+
+    // counter (rising edge, wraps after 9) addresses the ROM, the register samples the ROM on the falling edge
+    auto clk = circuit_desc->port_by_name("Clk");
+    circuit->write_pin(clk, VALUE_FALSE);
+    sim->run_until_stable(5);
+    REQUIRE(circuit->read_byte(pins_Y) == rom[0]);
+
+    for (int step = 1; step <= 12; ++step) {
+        circuit->write_pin(clk, VALUE_TRUE);
+        sim->run_until_stable(5);
+        REQUIRE(circuit->read_byte(pins_Y) == rom[step % 10]);
+        REQUIRE(circuit->read_pin(circuit_desc->port_by_name("C")) == (step % 10 == 9 ? VALUE_TRUE : VALUE_FALSE));
+
+        circuit->write_pin(clk, VALUE_FALSE);
+        sim->run_until_stable(5);
+        REQUIRE(circuit->read_byte(pins_R) == rom[step % 10]);
+    }
+
+    // RAM with a separate data input: writes while store and the clock are high
+    auto str = circuit_desc->port_by_name("Str");
+    auto wclk = circuit_desc->port_by_name("WClk");
+    circuit->write_pin(str, VALUE_FALSE);
+    circuit->write_pin(wclk, VALUE_FALSE);
+
+    for (uint64_t addr = 0; addr < 16; ++addr) {
+        circuit->write_pins(pins_A, addr);
+        circuit->write_pins(pins_D, addr * 3 + 1);
+        circuit->write_pin(str, VALUE_TRUE);
+        circuit->write_pin(wclk, VALUE_TRUE);
+        sim->run_until_stable(5);
+        circuit->write_pin(wclk, VALUE_FALSE);
+        circuit->write_pin(str, VALUE_FALSE);
+        sim->run_until_stable(5);
+    }
+
+    for (uint64_t addr = 0; addr < 16; ++addr) {
+        circuit->write_pins(pins_A, addr);
+        sim->run_until_stable(5);
+        REQUIRE(circuit->read_byte(pins_Q) == addr * 3 + 1);
+    }
+}
+
 #if 0
 
 TEST_CASE ("Logisim +1 databits", "[logisim]") {
@@ -0,0 +1,207 @@
+#include "catch.hpp"
+#include "lsim_context.h"
+#include "serialize.h"
+#include "sim_circuit.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace lsim;
+
+TEST_CASE("Reference libraries are loaded on demand", "[serialize]") {
+
+    const char *lib_file = "test_reference_lib.lsim";
+
+    // create a library with a few circuits
+    {
+        LSimContext lsim_context;
+
+        auto not_desc = lsim_context.create_user_circuit("inverter");
+        auto not_in = not_desc->add_connector_in("in", 1);
+        auto not_out = not_desc->add_connector_out("out", 1);
+        auto gate = not_desc->add_not_gate();
+        not_desc->connect(not_in->pin_id(0), gate->input_pin_id(0));
+        not_desc->connect(gate->output_pin_id(0), not_out->pin_id(0));
+
+        auto double_desc = lsim_context.create_user_circuit("double_inverter");
+        auto dbl_in = double_desc->add_connector_in("in", 1);
+        auto dbl_out = double_desc->add_connector_out("out", 1);
+        auto inv_1 = double_desc->add_sub_circuit("inverter");
+        auto inv_2 = double_desc->add_sub_circuit("inverter");
+        double_desc->connect(dbl_in->pin_id(0), inv_1->port_by_name("in"));
+        double_desc->connect(inv_1->port_by_name("out"), inv_2->port_by_name("in"));
+        double_desc->connect(inv_2->port_by_name("out"), dbl_out->pin_id(0));
+
+        auto unused_desc = lsim_context.create_user_circuit("unused");
+        unused_desc->add_and_gate(2);
+
+        REQUIRE(serialize_library(&lsim_context, lsim_context.user_library(), lib_file));
+    }
+
+    LSimContext lsim_context;
+    lsim_context.load_reference_library("ref", lib_file);
+
+    auto ref_lib = lsim_context.library_by_name("ref");
+    REQUIRE(ref_lib);
+    REQUIRE(ref_lib->num_circuits() == 3);
+    REQUIRE(ref_lib->circuit_name(1) == "double_inverter");
+
+    // nothing has been parsed yet
+    for (size_t idx = 0; idx < ref_lib->num_circuits(); ++idx) {
+        REQUIRE(!ref_lib->is_circuit_loaded(idx));
+    }
+
+    // using a circuit loads it and its nested circuits
+    auto main_desc = lsim_context.create_user_circuit("main");
+    auto in = main_desc->add_connector_in("in", 1);
+    auto out = main_desc->add_connector_out("out", 1);
+    auto sub = main_desc->add_sub_circuit("ref.double_inverter");
+    REQUIRE(sub->nested_circuit());
+    main_desc->connect(in->pin_id(0), sub->port_by_name("in"));
+    main_desc->connect(sub->port_by_name("out"), out->pin_id(0));
+
+    REQUIRE(ref_lib->is_circuit_loaded(0));
+    REQUIRE(ref_lib->is_circuit_loaded(1));
+    REQUIRE(!ref_lib->is_circuit_loaded(2));
+
+    // loaded circuits are cached
+    REQUIRE(lsim_context.find_circuit("ref.double_inverter") == sub->nested_circuit());
+
+    auto sim = lsim_context.sim();
+    auto circuit = main_desc->instantiate(sim);
+    sim->init();
+
+    for (auto value : {VALUE_FALSE, VALUE_TRUE}) {
+        circuit->write_pin(in->pin_id(0), value);
+        sim->run_until_stable(5);
+        REQUIRE(circuit->read_pin(out->pin_id(0)) == value);
+    }
+
+    // saving the library copies the circuits that weren't loaded without parsing them
+    const char *copy_file = "test_reference_copy.lsim";
+    REQUIRE(serialize_library(&lsim_context, ref_lib, copy_file));
+    REQUIRE(!ref_lib->is_circuit_loaded(2));
+
+    {
+        LSimContext copy_context;
+        REQUIRE(deserialize_library(&copy_context, copy_context.user_library(), copy_file));
+        REQUIRE(copy_context.user_library()->num_circuits() == 3);
+        auto unused = copy_context.user_library()->circuit_by_name("unused");
+        REQUIRE(unused);
+        REQUIRE(unused->num_components() == 1);
+    }
+
+    std::remove(copy_file);
+    std::remove(lib_file);
+}
+
+TEST_CASE("Libraries with many circuits are loaded correctly", "[serialize]") {
+
+    const char *lib_file = "test_many_circuits.lsim";
+    const int num_circuits = 24;
+
+    // chain of circuits: each circuit nests the previous one and adds an inverter
+    {
+        LSimContext lsim_context;
+
+        for (int idx = 0; idx < num_circuits; ++idx) {
+            auto circuit_desc = lsim_context.create_user_circuit(("chain_" + std::to_string(idx)).c_str());
+            auto in = circuit_desc->add_connector_in("in", 1);
+            auto out = circuit_desc->add_connector_out("out", 1);
+            auto gate = circuit_desc->add_not_gate();
+            circuit_desc->connect(gate->output_pin_id(0), out->pin_id(0));
+
+            if (idx == 0) {
+                circuit_desc->connect(in->pin_id(0), gate->input_pin_id(0));
+            } else {
+                auto sub = circuit_desc->add_sub_circuit(("chain_" + std::to_string(idx - 1)).c_str());
+                circuit_desc->connect(in->pin_id(0), sub->port_by_name("in"));
+                circuit_desc->connect(sub->port_by_name("out"), gate->input_pin_id(0));
+            }
+        }
+        lsim_context.user_library()->change_main_circuit("chain_5");
+
+        REQUIRE(serialize_library(&lsim_context, lsim_context.user_library(), lib_file));
+    }
+
+    LSimContext lsim_context;
+    auto lib = lsim_context.user_library();
+    REQUIRE(deserialize_library(&lsim_context, lib, lib_file));
+    std::remove(lib_file);
+
+    REQUIRE(lib->num_circuits() == num_circuits);
+    REQUIRE(lib->main_circuit() == lib->circuit_by_name("chain_5"));
+
+    for (int idx = 0; idx < num_circuits; ++idx) {
+        auto circuit_desc = lib->circuit_by_idx(idx);
+        REQUIRE(circuit_desc->name() == "chain_" + std::to_string(idx));
+        REQUIRE(circuit_desc->component_ids().size() == (idx == 0 ? 3 : 4));
+        REQUIRE(circuit_desc->num_input_ports() == 1);
+        REQUIRE(circuit_desc->num_output_ports() == 1);
+    }
+
+    // nested circuits are linked after all circuits have been loaded
+    auto top_desc = lib->circuit_by_idx(num_circuits - 1);
+    for (auto id : top_desc->component_ids_of_type(COMPONENT_SUB_CIRCUIT)) {
+        REQUIRE(top_desc->component_by_id(id)->nested_circuit() == lib->circuit_by_idx(num_circuits - 2));
+    }
+
+    auto sim = lsim_context.sim();
+    auto circuit = top_desc->instantiate(sim);
+    sim->init();
+
+    auto in_id = top_desc->component_ids_of_type(COMPONENT_CONNECTOR_IN).front();
+    auto out_id = top_desc->component_ids_of_type(COMPONENT_CONNECTOR_OUT).front();
+    circuit->write_pin(pin_id_assemble(in_id, 0), VALUE_TRUE);
+    sim->run_until_stable(5);
+
+    // an even number of inverters
+    REQUIRE(circuit->read_pin(pin_id_assemble(out_id, 0)) == VALUE_TRUE);
+}
+
+TEST_CASE("Streaming serializer writes the same output", "[serialize]") {
+
+    const char *doc_file = "test_stream_doc.lsim";
+    const char *stream_file = "test_stream_out.lsim";
+
+    LSimContext lsim_context;
+
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+    auto in = circuit_desc->add_connector_in("in", 4);
+    auto out = circuit_desc->add_connector_out("out", 4);
+    for (int idx = 0; idx < 4; ++idx) {
+        auto gate = circuit_desc->add_not_gate();
+        gate->set_position({10.5f * idx, 20.25f});
+        gate->set_angle(90 * idx);
+        auto wire = circuit_desc->connect(in->pin_id(idx), gate->input_pin_id(0));
+        wire->add_segment(Point(1.0f / 3.0f, 2), Point(4, 5));
+        circuit_desc->connect(gate->output_pin_id(0), out->pin_id(idx));
+    }
+    circuit_desc->add_text("a < b & \"c\"\n");
+    lsim_context.user_library()->change_main_circuit("main");
+
+    REQUIRE(serialize_library(&lsim_context, lsim_context.user_library(), doc_file));
+    REQUIRE(serialize_library_streaming(&lsim_context, lsim_context.user_library(), stream_file));
+
+    auto read_file = [](const char *filename) -> std::string {
+        std::ifstream input(filename, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    };
+
+    auto doc_contents = read_file(doc_file);
+    REQUIRE(!doc_contents.empty());
+    REQUIRE(doc_contents == read_file(stream_file));
+
+    // and can be read back
+    LSimContext load_context;
+    REQUIRE(deserialize_library(&load_context, load_context.user_library(), stream_file));
+    auto loaded = load_context.user_library()->main_circuit();
+    REQUIRE(loaded);
+    REQUIRE(loaded->num_components() == circuit_desc->num_components());
+    REQUIRE(loaded->wires().size() == circuit_desc->wires().size());
+
+    std::remove(doc_file);
+    std::remove(stream_file);
+}
@@ -0,0 +1,131 @@
+#include "catch.hpp"
+#include "lsim_context.h"
+#include "sim_circuit.h"
+#include "testbench/testbench.h"
+
+#include <stdexcept>
+
+using namespace lsim;
+
+TEST_CASE("Coroutine testbench", "[testbench]") {
+
+    LSimContext lsim_context;
+    auto sim = lsim_context.sim();
+
+    auto circuit_desc = lsim_context.create_user_circuit("main");
+
+    // gated clock
+    auto in_clk = circuit_desc->add_connector_in("Clk", 1);
+    auto in_en = circuit_desc->add_connector_in("En", 1);
+    auto out_y = circuit_desc->add_connector_out("Y", 1);
+    auto and_gate = circuit_desc->add_and_gate(2);
+    circuit_desc->connect(in_clk->pin_id(0), and_gate->pin_id(0));
+    circuit_desc->connect(in_en->pin_id(0), and_gate->pin_id(1));
+    circuit_desc->connect(and_gate->pin_id(2), out_y->pin_id(0));
+
+    // 4-bit xor
+    auto in_a = circuit_desc->add_connector_in("A", 4);
+    auto in_b = circuit_desc->add_connector_in("B", 4);
+    auto out_o = circuit_desc->add_connector_out("O", 4);
+    pin_id_container_t pins_A, pins_B, pins_O;
+    for (int idx = 0; idx < 4; ++idx) {
+        auto xor_gate = circuit_desc->add_xor_gate();
+        circuit_desc->connect(in_a->pin_id(idx), xor_gate->pin_id(0));
+        circuit_desc->connect(in_b->pin_id(idx), xor_gate->pin_id(1));
+        circuit_desc->connect(xor_gate->pin_id(2), out_o->pin_id(idx));
+        pins_A.push_back(in_a->pin_id(idx));
+        pins_B.push_back(in_b->pin_id(idx));
+        pins_O.push_back(out_o->pin_id(idx));
+    }
+
+    auto circuit = circuit_desc->instantiate(sim);
+    sim->init();
+
+    TestBench bench(sim, circuit.get());
+    bench.write(in_clk->pin_id(0), VALUE_FALSE);
+    bench.write(in_en->pin_id(0), VALUE_FALSE);
+    bench.write(pins_A, 0);
+    bench.write(pins_B, 0);
+
+    auto clock_generator = [&]() -> TestTask {
+        for (;;) {
+            co_await bench.steps(4);
+            bench.write(in_clk->pin_id(0), VALUE_TRUE);
+            co_await bench.steps(4);
+            bench.write(in_clk->pin_id(0), VALUE_FALSE);
+        }
+    };
+
+    int edges = 0;
+    auto edge_counter = [&]() -> TestTask {
+        for (;;) {
+            co_await bench.rising_edge(out_y->pin_id(0));
+            ++edges;
+        }
+    };
+
+    auto apply_xor = [&](uint64_t a, uint64_t b) -> TestTask {
+        bench.write(pins_A, a);
+        bench.write(pins_B, b);
+        co_await bench.bus_equals(pins_O, a ^ b);
+    };
+
+    int evaluations = 0;
+    bool done = false;
+    auto main_task = [&]() -> TestTask {
+        // clock gated off
+        co_await bench.steps(20);
+        REQUIRE(edges == 0);
+
+        // clock enabled
+        bench.write(in_en->pin_id(0), VALUE_TRUE);
+        co_await bench.cycles(out_y->pin_id(0), 3);
+        auto start = bench.now();
+        co_await bench.falling_edge(out_y->pin_id(0));
+        REQUIRE(bench.now() - start == 4);
+        co_await bench.cycles(out_y->pin_id(0), 2);
+
+        // nested tasks
+        co_await apply_xor(5, 3);
+        REQUIRE(bench.read(pins_O) == 6);
+        co_await apply_xor(9, 9);
+        REQUIRE(bench.read(pins_O) == 0);
+
+        // a condition is only evaluated when one of the watched nodes changes
+        bench.write(in_en->pin_id(0), VALUE_FALSE);
+        co_await bench.until(pins_O, [&]() {++evaluations; return bench.read(pins_O) == 0xf;});
+        done = true;
+    };
+
+    auto trigger = [&]() -> TestTask {
+        co_await bench.steps(150);
+        bench.write(pins_A, 0xa);
+        bench.write(pins_B, 0x5);
+    };
+
+    bench.spawn_background(clock_generator());
+    bench.spawn_background(edge_counter());
+    bench.spawn(main_task());
+    REQUIRE(bench.num_running() == 1);
+
+    REQUIRE(!bench.run(100));
+    REQUIRE(edges == 5);
+    REQUIRE(!done);
+    REQUIRE(evaluations == 1);
+
+    bench.spawn(trigger());
+    REQUIRE(bench.run(1000));
+    REQUIRE(done);
+    REQUIRE(evaluations <= 5);
+    REQUIRE(bench.read(pins_O) == 0xf);
+    REQUIRE(edges == 5);
+
+    // exceptions thrown by a task are reported by run
+    auto failing = [&]() -> TestTask {
+        co_await bench.steps(2);
+        throw std::runtime_error("failed");
+    };
+    bench.spawn(failing());
+    REQUIRE_THROWS_AS(bench.run(10), std::runtime_error);
+    REQUIRE(bench.num_running() == 0);
+}